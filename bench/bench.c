@@ -0,0 +1,223 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * bench.c - implementation file for the benchmark harness of zencp
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "bench.h"
+
+/**
+ * compare_times() sorts the times of the runs of a benchmark.
+ */
+static int compare_times(const void *a, const void *b) {
+	double x = *(const double*)a, y = *(const double*)b;
+
+	return (x > y) - (x < y);
+}
+
+
+/**
+ * bench_disk_writes() returns the number of bytes this process has written to files
+ * on the disk so far or 0 if the kernel does not tell. A file that is deleted before
+ * it has been written back still counts, files in memory (tmpfs, memfd) do not.
+ */
+static unsigned long long bench_disk_writes(void) {
+	char line[128];
+	unsigned long long n = 0;
+	FILE *f;
+
+	if (!(f = fopen("/proc/self/io", "r"))) return 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "write_bytes: %llu", &n) == 1) break;
+	}
+	fclose(f);
+	return n;
+}
+
+
+int bench_wanted(struct bench *b, const char *name) {
+	return (!b->filter) || (strstr(name, b->filter) != 0);
+}
+
+
+int bench_run(struct bench *b, const char *name, unsigned long long ops, bench_fn setup,
+	      bench_run_fn run, bench_fn teardown, void *ctx) {
+	double times[_BENCH_MAX_REPETITIONS], t0;
+	unsigned long long disk = 0, w;
+	struct bench_result *r;
+	int i;
+
+	if ((!bench_wanted(b, name)) || (!ops) || (b->n >= _BENCH_MAX_RESULTS)) return 0;
+
+	/* the first run fills the caches and is not counted */
+	for (i = -1; i < b->repetitions; i++) {
+		if (setup) setup(ctx);
+		w = bench_disk_writes();
+		t0 = stats_now();
+		run(ctx, ops);
+		if (i >= 0) times[i] = (stats_now() - t0) * 1e9 / (double)ops;
+		if (i >= 0) disk += bench_disk_writes() - w;	/* it never goes down */
+		if (teardown) teardown(ctx);
+	}
+	qsort(times, b->repetitions, sizeof(double), compare_times);
+
+	r = &b->results[b->n++];
+	snprintf(r->name, sizeof(r->name), "%s", name);
+	r->ops = ops;
+	r->median = times[b->repetitions / 2];
+	r->min = times[0];
+	r->max = times[b->repetitions - 1];
+	r->disk = (double)disk / ((double)ops * b->repetitions);
+	r->memory = 0.0;
+
+	fprintf(stderr, " %-44s %12.1f ns/op %12.0f B/op on disk\n", r->name, r->median, r->disk);
+	return 1;
+}
+
+
+void bench_set_memory(struct bench *b, size_t bytes) {
+	struct bench_result *r;
+
+	if (!b->n) return;
+	r = &b->results[b->n - 1];
+	r->memory = (double)bytes / (double)r->ops;
+	fprintf(stderr, " %-44s %12.1f B/op in memory\n", r->name, r->memory);
+}
+
+
+unsigned int bench_random(unsigned int *state) {
+	/* xorshift32, the same numbers on every machine */
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+
+int bench_write(struct bench *b, FILE *out) {
+	struct bench_result *r;
+	unsigned int i;
+
+	/* one result per line, so that bench_compare() and diff can read it */
+	fprintf(out, "{\n  \"benchmark\": \"zencp\",\n  \"repetitions\": %d,\n  \"results\": [\n", b->repetitions);
+	for (i = 0; i < b->n; i++) {
+		r = &b->results[i];
+		fprintf(out, "    {\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.2f, \"min\": %.2f, \"max\": %.2f, "
+			"\"disk_bytes_per_op\": %.1f, \"memory_bytes_per_op\": %.1f}%s\n",
+			r->name, r->ops, r->median, r->min, r->max, r->disk, r->memory, (i + 1 < b->n) ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+	return !ferror(out);
+}
+
+
+int bench_compare(struct bench *b, const char *baseline, double threshold, FILE *out) {
+	char line[512], name[_BENCH_NAME_LEN];
+	unsigned long long ops;
+	double before, change;
+	unsigned int i;
+	int slower = 0, found;
+	char *p;
+	FILE *f;
+
+	if (!(f = fopen(baseline, "r"))) return -1;
+
+	fprintf(out, "\n %-44s %12s %12s %8s\n", "benchmark (ns/op)", "baseline", "now", "change");
+	for (i = 0; i < b->n; i++) {
+		found = 0;
+		rewind(f);
+		while ((!found) && (fgets(line, sizeof(line), f))) {
+			if ((!(p = strstr(line, "{\"name\": \""))) ||
+			    (sscanf(p, "{\"name\": \"%63[^\"]\", \"ops\": %llu, \"ns_per_op\": %lf", name, &ops, &before) != 3) ||
+			    (strcmp(name, b->results[i].name))) {
+				continue;
+			}
+			found = 1;
+		}
+
+		if ((!found) || (before <= 0.0)) {
+			fprintf(out, " %-44s %12s %12.1f %8s\n", b->results[i].name, "-", b->results[i].median, "new");
+			continue;
+		}
+
+		change = (b->results[i].median - before) * 100.0 / before;
+		fprintf(out, " %-44s %12.1f %12.1f %+7.1f%%%s\n", b->results[i].name, before,
+			b->results[i].median, change, (change > threshold) ? "  SLOWER" : "");
+		if (change > threshold) slower++;
+	}
+	fprintf(out, "\n");
+
+	fclose(f);
+	return slower;
+}
+
+
+static void print_usage(void) {
+	fprintf(stderr, " Usage: zencp-bench [-r RUNS] [-f FILTER] [-o FILE] [-b BASELINE] [-t PERCENT]\n\n");
+	fprintf(stderr, "   -r RUNS \t\t the timed runs of every benchmark (default %d)\n", _BENCH_REPETITIONS);
+	fprintf(stderr, "   -f FILTER \t\t only run the benchmarks whose name contains FILTER\n");
+	fprintf(stderr, "   -o FILE \t\t write the results as JSON to FILE instead of the screen\n");
+	fprintf(stderr, "   -b BASELINE \t\t compare the results with those of an earlier run\n");
+	fprintf(stderr, "   -t PERCENT \t\t with -b: slower by more than PERCENT is a regression (default %.0f)\n\n",
+		_BENCH_THRESHOLD);
+}
+
+
+int main(int argc, char *argv[]) {
+	static struct bench b;
+	const char *output = 0, *baseline = 0;
+	double threshold = _BENCH_THRESHOLD;
+	FILE *out = stdout;
+	int i, slower = 0;
+
+	b.repetitions = _BENCH_REPETITIONS;
+	for (i = 1; i < argc; i++) {
+		if ((!strcmp(argv[i], "-r")) && (i + 1 < argc)) {
+			b.repetitions = atoi(argv[++i]);
+		} else if ((!strcmp(argv[i], "-f")) && (i + 1 < argc)) {
+			b.filter = argv[++i];
+		} else if ((!strcmp(argv[i], "-o")) && (i + 1 < argc)) {
+			output = argv[++i];
+		} else if ((!strcmp(argv[i], "-b")) && (i + 1 < argc)) {
+			baseline = argv[++i];
+		} else if ((!strcmp(argv[i], "-t")) && (i + 1 < argc)) {
+			threshold = atof(argv[++i]);
+		} else {
+			print_usage();
+			return 1;
+		}
+	}
+	if ((b.repetitions < 1) || (b.repetitions > _BENCH_MAX_REPETITIONS)) {
+		print_usage();
+		return 1;
+	}
+
+	bench_tracklist(&b);
+	bench_trackcols(&b);
+	bench_genre(&b);
+	bench_strings(&b);
+	bench_id3(&b);
+	bench_source(&b);
+	bench_cli(&b);
+
+	if ((output) && (!(out = fopen(output, "w")))) {
+		fprintf(stderr, " ERROR: %s could not be written\n\n", output);
+		return 2;
+	}
+	if ((!bench_write(&b, out)) | ((out != stdout) && (fclose(out)))) {
+		fprintf(stderr, " ERROR: the results could not be written\n\n");
+		return 2;
+	}
+
+	if ((baseline) && ((slower = bench_compare(&b, baseline, threshold, stderr)) < 0)) {
+		fprintf(stderr, " ERROR: the baseline %s could not be read\n\n", baseline);
+		return 2;
+	}
+	return (slower) ? 3 : 0;
+}
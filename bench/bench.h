@@ -0,0 +1,130 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * bench.h - header file for the benchmarks of zencp
+ *
+ * This file provides the prototypes and structures of the benchmark
+ * harness that is built by "make bench". A benchmark runs a number of
+ * operations several times (after one run to warm up) and records the
+ * median, the fastest and the slowest time per operation, as well as the
+ * bytes per operation that were written to files on the disk (write_bytes
+ * of /proc/self/io, so files on a tmpfs or in memory do not count). All input is made by a
+ * fixed pseudo random sequence, so every run measures the same work. The
+ * results are written as JSON and can be compared with those of an
+ * earlier run (see bench_compare()).
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_BENCH_H
+#define __ZENCP_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../stats.h"
+#include "../misc.h"
+
+/* the number of timed runs of every benchmark if none is given */
+#define _BENCH_REPETITIONS 5
+
+/* the most runs of one benchmark */
+#define _BENCH_MAX_REPETITIONS 64
+
+/* the most benchmarks of one run */
+#define _BENCH_MAX_RESULTS 256
+
+/* the change in percent that counts as a regression if none is given */
+#define _BENCH_THRESHOLD 10.0
+
+/* the length of the name of a benchmark */
+#define _BENCH_NAME_LEN 64
+
+/**
+ * The result of a benchmark, all times are in nanoseconds per operation.
+ */
+struct bench_result {
+	char name[_BENCH_NAME_LEN];	/* e.g. "tracklist_insert/uniform/10000" */
+	unsigned long long ops;		/* the operations of one run */
+	double median;
+	double min;
+	double max;
+	double disk;			/* the bytes written to the disk per operation */
+	double memory;			/* the bytes held by the data structure per operation,
+					   0 unless it is set by bench_set_memory() */
+};
+
+/**
+ * A run of the benchmarks.
+ */
+struct bench {
+	int repetitions;		/* the timed runs of every benchmark */
+	const char *filter;		/* only the benchmarks whose name contains it, NULL for all */
+	struct bench_result results[_BENCH_MAX_RESULTS];
+	unsigned int n;			/* the number of results */
+};
+
+/**
+ * The parts of a benchmark. setup() and teardown() are called around every run
+ * and are not timed, both may be NULL. run() does ops operations.
+ */
+typedef void (*bench_fn)(void *ctx);
+typedef void (*bench_run_fn)(void *ctx, unsigned long long ops);
+
+/**
+ * bench_wanted() returns 1 if the benchmark name passes the filter of b. It lets
+ * a suite skip the preparation of benchmarks that are not run.
+ */
+int		bench_wanted(struct bench *b, const char *name);
+
+/**
+ * bench_run() runs the benchmark name with ops operations and records its result.
+ * It returns 1 if it has been run and 0 if it was filtered out or there is no
+ * room for its result.
+ */
+int		bench_run(struct bench *b, const char *name, unsigned long long ops, bench_fn setup,
+			  bench_run_fn run, bench_fn teardown, void *ctx);
+
+/**
+ * bench_set_memory() records that the data structure of the benchmark that has
+ * been run last holds bytes bytes in total.
+ */
+void		bench_set_memory(struct bench *b, size_t bytes);
+
+/**
+ * bench_random() returns the next number of the pseudo random sequence state,
+ * which must not be 0 at the start.
+ */
+unsigned int	bench_random(unsigned int *state);
+
+/**
+ * bench_write() writes the results of b as JSON to out. It returns 1 on success
+ * and 0 if writing failed.
+ */
+int		bench_write(struct bench *b, FILE *out);
+
+/**
+ * bench_compare() reads the results of an earlier run from the JSON file baseline
+ * and prints how much faster or slower every benchmark of b has become. It
+ * returns the number of benchmarks that are slower by more than threshold
+ * percent or -1 if the baseline could not be read.
+ */
+int		bench_compare(struct bench *b, const char *baseline, double threshold, FILE *out);
+
+/**
+ * The suites, each of them runs its benchmarks with bench_run().
+ */
+void		bench_tracklist(struct bench *b);
+void		bench_trackcols(struct bench *b);
+void		bench_genre(struct bench *b);
+void		bench_strings(struct bench *b);
+void		bench_id3(struct bench *b);
+void		bench_source(struct bench *b);
+void		bench_cli(struct bench *b);
+
+#endif
@@ -0,0 +1,121 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * cli.c - implementation file for the benchmarks of the command line
+ *         utility
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+/* parse_cmdline() and cli_progress() are part of zencp.c, whose main() is
+ * renamed so that it does not collide with the one of the benchmarks */
+#define main zencp_main
+#include "../zencp.c"
+#undef main
+
+#include "bench.h"
+
+/* the size of the blocks the progress is reported for */
+#define _BENCH_BLOCK 4096
+
+/**
+ * The command lines of the parser benchmarks.
+ */
+struct cli_bench {
+	char **argv;
+	mp3_file *files;		/* the result of the parser */
+	int saved;			/* stdout while it is sent to /dev/null */
+};
+
+
+static void cli_parse(void *ctx, unsigned long long ops) {
+	struct cli_bench *t = (struct cli_bench*)ctx;
+
+	/* one operation is one filename, they are all different */
+	parse_cmdline(ops + 1, t->argv, &t->files);
+}
+
+
+/**
+ * cli_drop() frees the file list, the names belong to argv.
+ */
+static void cli_drop(void *ctx) {
+	struct cli_bench *t = (struct cli_bench*)ctx;
+	mp3_file *f;
+
+	t->files = list_first_element(t->files);
+	while ((f = t->files)) {
+		t->files = f->next;
+		free(f);
+	}
+}
+
+
+static void cli_quiet(void *ctx) {
+	struct cli_bench *t = (struct cli_bench*)ctx;
+	int fd;
+
+	fflush(stdout);
+	t->saved = dup(STDOUT_FILENO);
+	if ((fd = open("/dev/null", O_WRONLY)) >= 0) {
+		dup2(fd, STDOUT_FILENO);
+		close(fd);
+	}
+}
+
+
+static void cli_loud(void *ctx) {
+	struct cli_bench *t = (struct cli_bench*)ctx;
+
+	fflush(stdout);
+	if (t->saved < 0) return;
+	dup2(t->saved, STDOUT_FILENO);
+	close(t->saved);
+	t->saved = -1;
+}
+
+
+static void cli_progress_run(void *ctx, unsigned long long ops) {
+	unsigned long long i;
+
+	/* a track of ops blocks, as libnjb reports it */
+	for (i = 1; i <= ops; i++) cli_progress(0, 0, i * _BENCH_BLOCK, ops * _BENCH_BLOCK);
+}
+
+
+void bench_cli(struct bench *b) {
+	static const unsigned int sizes[] = { 1000, 10000, 0 };
+	struct cli_bench t;
+	char name[_BENCH_NAME_LEN], buffer[64];
+	unsigned int i;
+	int s;
+
+	memset(&t, 0, sizeof(t));
+	t.saved = -1;
+
+	for (s = 0; sizes[s]; s++) {
+		snprintf(name, sizeof(name), "parse_cmdline/%u", sizes[s]);
+		if (!bench_wanted(b, name)) continue;
+
+		if (!(t.argv = (char**)calloc(sizes[s] + 2, sizeof(char*)))) {
+			print_error(G_NOMEM);
+			return;
+		}
+		t.argv[0] = "zencp";
+		for (i = 1; i <= sizes[s]; i++) {
+			snprintf(buffer, sizeof(buffer), "/home/music/Artist %u/%05u.mp3", i % 97, i);
+			if (!(t.argv[i] = new_string(buffer))) break;
+		}
+		if (i > sizes[s]) bench_run(b, name, sizes[s], 0, cli_parse, cli_drop, &t);
+
+		while (--i > 0) free(t.argv[i]);
+		free(t.argv);
+		t.argv = 0;
+	}
+
+	bench_run(b, "cli_progress", 1000000, cli_quiet, cli_progress_run, cli_loud, &t);
+}
@@ -0,0 +1,758 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * core.c - implementation file for the benchmarks of the core data
+ *          structures: the tracklist and its columns, the file list,
+ *          strings, tags, genres and the sources of tracks
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include <unistd.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "../id3.h"
+#include "../tracklist.h"
+#include "../trackcols.h"
+#include "../genre.h"
+#include "../intern.h"
+#include "../list.h"
+#include "../source.h"
+#include "bench.h"
+
+/* the files of the synthetic corpus for the tag reader */
+#define _BENCH_CORPUS 200
+
+/* the searches of a tracklist benchmark, the inserts are as many as the tracks */
+#define _BENCH_FINDS 10000
+
+/* a prime, so that the searches are spread over the whole tracklist */
+#define _BENCH_STRIDE 7919
+
+/* the size of a track for the sources */
+#define _BENCH_TRACK (4 * 1024 * 1024)
+
+/**
+ * How the tracks of a tracklist are spread over the artists.
+ */
+enum bench_skew {
+	BS_UNIFORM,		/* about ten tracks per artist */
+	BS_SKEWED,		/* a few artists have most of the tracks */
+	BS_SINGLE		/* all tracks are by the same artist */
+};
+
+static const char *bench_skews[] = { "uniform", "skewed", "single" };
+
+/**
+ * The tracks of the tracklist benchmarks.
+ */
+struct tracklist_bench {
+	struct tracklist tl;
+	s_id3_tag **tags;		/* the tracks that are inserted */
+	s_id3_tag **misses;		/* tracks with the same artists that are not inserted */
+	unsigned int n;
+};
+
+
+/**
+ * bench_tag() returns a new track with the given numbers of artist, album and
+ * title, as if it had been read from a file.
+ */
+static s_id3_tag* bench_tag(unsigned int artist, unsigned int album, unsigned int title) {
+	char buffer[64];
+	s_id3_tag *tag;
+
+	if (!(tag = (s_id3_tag*)calloc(1, sizeof(s_id3_tag)))) return 0;
+
+	/* the index of the tracklist is the first letter of the artist */
+	snprintf(buffer, sizeof(buffer), "%c Artist %u", 'A' + artist % 26, artist);
+	tag->artist = intern(buffer);
+	snprintf(buffer, sizeof(buffer), "Album %u", album);
+	tag->album = intern(buffer);
+	snprintf(buffer, sizeof(buffer), "Title %u", title);
+	tag->title = intern(buffer);
+	tag->genre = intern("Rock");
+	tag->year = 1970 + album % 40;
+	tag->trackno = title % 12 + 1;
+	tag->time = 180 + title % 120;
+	tag->size = tag->time * 16000;
+	tag->valid = _ID3_ALL;
+	id3_make_keys(tag);
+	return tag;
+}
+
+
+/**
+ * bench_artist() returns the artist of track i of n for the given skew.
+ */
+static unsigned int bench_artist(int skew, unsigned int i, unsigned int n, unsigned int *state) {
+	double x;
+
+	if (skew == BS_SINGLE) return 0;
+	if (skew == BS_UNIFORM) return bench_random(state) % (n / 10 + 1);
+
+	/* x^3 puts most of the tracks onto the first artists */
+	x = (double)(bench_random(state) % 1000000) / 1000000.0;
+	return (unsigned int)((n / 10 + 1) * x * x * x);
+}
+
+
+/**
+ * tracklist_bench_init() makes the tracks of a benchmark.
+ */
+static int tracklist_bench_init(struct tracklist_bench *t, int skew, unsigned int n) {
+	unsigned int i, artist, state = 2005;
+
+	t->n = n;
+	t->tags = (s_id3_tag**)calloc(n, sizeof(s_id3_tag*));
+	t->misses = (s_id3_tag**)calloc(n, sizeof(s_id3_tag*));
+	if ((!t->tags) || (!t->misses)) return 0;
+
+	for (i = 0; i < n; i++) {
+		artist = bench_artist(skew, i, n, &state);
+		if ((!(t->tags[i] = bench_tag(artist, i / 12, i))) ||
+		    (!(t->misses[i] = bench_tag(artist, i / 12, n + i)))) {
+			return 0;
+		}
+	}
+	tracklist_setup_tracklist(&t->tl);
+	return 1;
+}
+
+
+static void tracklist_bench_free(struct tracklist_bench *t) {
+	unsigned int i;
+
+	tracklist_free(&t->tl);
+	for (i = 0; i < t->n; i++) {
+		if (t->tags) free(t->tags[i]);
+		if (t->misses) free(t->misses[i]);
+	}
+	free(t->tags);
+	free(t->misses);
+}
+
+
+static void tracklist_empty(void *ctx) {
+	struct tracklist_bench *t = (struct tracklist_bench*)ctx;
+
+	tracklist_free(&t->tl);
+	tracklist_setup_tracklist(&t->tl);
+}
+
+
+static void tracklist_fill(void *ctx, unsigned long long ops) {
+	struct tracklist_bench *t = (struct tracklist_bench*)ctx;
+	unsigned long long i;
+
+	for (i = 0; i < ops; i++) tracklist_insert(&t->tl, t->tags[i % t->n]);
+}
+
+
+static void tracklist_find_hits(void *ctx, unsigned long long ops) {
+	struct tracklist_bench *t = (struct tracklist_bench*)ctx;
+	unsigned long long i;
+
+	for (i = 0; i < ops; i++) tracklist_find_tag(&t->tl, t->tags[(i * _BENCH_STRIDE) % t->n]);
+}
+
+
+static void tracklist_find_misses(void *ctx, unsigned long long ops) {
+	struct tracklist_bench *t = (struct tracklist_bench*)ctx;
+	unsigned long long i;
+
+	for (i = 0; i < ops; i++) tracklist_find_tag(&t->tl, t->misses[(i * _BENCH_STRIDE) % t->n]);
+}
+
+
+/**
+ * tracklist_bench_run() runs the tracklist benchmark op with ops operations on
+ * the tracks of t.
+ */
+static void tracklist_bench_run(struct bench *b, const char *op, unsigned long long ops,
+				struct tracklist_bench *t, int skew, bench_fn setup, bench_run_fn run) {
+	char name[_BENCH_NAME_LEN];
+
+	snprintf(name, sizeof(name), "tracklist_%s/%s/%u", op, bench_skews[skew], t->n);
+	bench_run(b, name, ops, setup, run, 0, t);
+}
+
+
+void bench_tracklist(struct bench *b) {
+	static const unsigned int sizes[] = { 1000, 10000, 100000, 0 };
+	struct tracklist_bench t;
+	int skew, s;
+
+	for (skew = BS_UNIFORM; skew <= BS_SINGLE; skew++) {
+		for (s = 0; sizes[s]; s++) {
+			/* one artist keeps all titles in one list, which is too slow for more */
+			if ((skew == BS_SINGLE) && (sizes[s] > 10000)) continue;
+
+			memset(&t, 0, sizeof(t));
+			if (!tracklist_bench_init(&t, skew, sizes[s])) {
+				print_error(G_NOMEM);
+				tracklist_bench_free(&t);
+				return;
+			}
+
+			tracklist_bench_run(b, "insert", t.n, &t, skew, tracklist_empty, tracklist_fill);
+
+			/* the finds search the full list */
+			tracklist_empty(&t);
+			tracklist_fill(&t, t.n);
+			tracklist_bench_run(b, "find_hit", _BENCH_FINDS, &t, skew, 0, tracklist_find_hits);
+			tracklist_bench_run(b, "find_miss", _BENCH_FINDS, &t, skew, 0, tracklist_find_misses);
+			tracklist_bench_free(&t);
+		}
+	}
+}
+
+
+/**
+ * The tracks of the benchmarks that compare the linked tracklist with the
+ * column oriented one (see trackcols.h). Both are scanned for the statistics
+ * of -T, the linked one through its pointers.
+ */
+struct trackcols_bench {
+	struct tracklist_bench t;
+	struct trackcols c;
+	struct trackcols_stats stats;	/* the result of the last scan */
+	unsigned char *seen[3];		/* the distinct artists, albums and genres */
+	size_t size;			/* the size of each of them */
+};
+
+
+/**
+ * trackcols_mark() marks the string s in the bitmap seen and returns 1 if it
+ * has not been marked yet.
+ */
+static unsigned int trackcols_mark(unsigned char *seen, const char *s) {
+	unsigned int id = intern_id_of(s);
+
+	if (seen[id >> 3] & (1 << (id & 7))) return 0;
+	seen[id >> 3] |= 1 << (id & 7);
+	return 1;
+}
+
+
+static void trackcols_scan_linked(void *ctx, unsigned long long ops) {
+	struct trackcols_bench *c = (struct trackcols_bench*)ctx;
+	struct trackcols_stats *st = &c->stats;
+	s_id3_tag *t, *s;
+	int i;
+
+	/* one operation is one track, a run scans all of them */
+	memset(st, 0, sizeof(struct trackcols_stats));
+	for (i = 0; i < 3; i++) memset(c->seen[i], 0, c->size);
+
+	for (i = 0; i < _MAX_INDEX; i++) {
+		for (t = c->t.tl.index[i]; t; t = t->next) {
+			for (s = t; s; s = s->element) {
+				st->tracks++;
+				st->bytes += s->size;
+				st->length += s->time;
+				st->artists += trackcols_mark(c->seen[0], s->artist);
+				st->albums += trackcols_mark(c->seen[1], s->album);
+				st->genres += trackcols_mark(c->seen[2], s->genre);
+			}
+		}
+	}
+}
+
+
+static void trackcols_scan_columns(void *ctx, unsigned long long ops) {
+	struct trackcols_bench *c = (struct trackcols_bench*)ctx;
+
+	trackcols_stats(&c->c, &c->stats);
+}
+
+
+static void trackcols_empty(void *ctx) {
+	struct trackcols_bench *c = (struct trackcols_bench*)ctx;
+
+	trackcols_free(&c->c);
+}
+
+
+static void trackcols_build(void *ctx, unsigned long long ops) {
+	struct trackcols_bench *c = (struct trackcols_bench*)ctx;
+
+	trackcols_from_tracklist(&c->c, &c->t.tl);
+}
+
+
+void bench_trackcols(struct bench *b) {
+	static const unsigned int sizes[] = { 10000, 100000, 0 };
+	struct trackcols_bench c;
+	char name[_BENCH_NAME_LEN];
+	int s, i;
+
+	for (s = 0; sizes[s]; s++) {
+		memset(&c, 0, sizeof(c));
+		trackcols_init(&c.c);
+		if (tracklist_bench_init(&c.t, BS_UNIFORM, sizes[s])) {
+			tracklist_fill(&c.t, c.t.n);
+			trackcols_from_tracklist(&c.c, &c.t.tl);
+			c.size = intern_count() / 8 + 1;
+			for (i = 0; i < 3; i++) c.seen[i] = (unsigned char*)malloc(c.size);
+		}
+		if ((!c.seen[0]) || (!c.seen[1]) || (!c.seen[2]) || (c.c.count != c.t.n)) {
+			print_error(G_NOMEM);
+		} else {
+			/* the strings are shared by both, only the tracks count */
+			snprintf(name, sizeof(name), "tracklist_scan/linked/%u", c.t.n);
+			if (bench_run(b, name, c.t.n, 0, trackcols_scan_linked, 0, &c)) {
+				bench_set_memory(b, c.t.n * sizeof(s_id3_tag) + sizeof(struct tracklist));
+			}
+			snprintf(name, sizeof(name), "tracklist_scan/columns/%u", c.t.n);
+			if (bench_run(b, name, c.t.n, 0, trackcols_scan_columns, 0, &c)) {
+				bench_set_memory(b, trackcols_memory(&c.c));
+			}
+			snprintf(name, sizeof(name), "trackcols_build/%u", c.t.n);
+			bench_run(b, name, c.t.n, trackcols_empty, trackcols_build, 0, &c);
+		}
+
+		trackcols_free(&c.c);
+		for (i = 0; i < 3; i++) free(c.seen[i]);
+		tracklist_bench_free(&c.t);
+	}
+}
+
+
+/**
+ * The content type frames of the genre benchmarks.
+ */
+struct genre_bench {
+	char **frames;
+	size_t *lengths;
+	unsigned int n;
+	size_t total;			/* the length of all genres that were found */
+};
+
+/* the number of frames of the genre benchmarks */
+#define _BENCH_GENRES 4096
+
+
+/**
+ * genre_frame() writes frame i of the genre benchmarks to buffer and returns its
+ * length. The frames are written in all the ways that genre.h knows.
+ */
+static size_t genre_frame(char *buffer, size_t size, unsigned int i, unsigned int *state) {
+	int id = bench_random(state) % _GENRE_COUNT;
+	int l;
+
+	switch (i % 8) {
+		case 0: l = snprintf(buffer, size, "(%d)", id); break;
+		case 1: l = snprintf(buffer, size, "(%d)%s", id, genre_name(id)); break;
+		case 2: l = snprintf(buffer, size, "%d", id); break;
+		case 3: l = snprintf(buffer, size, "%s", genre_name(id)); break;
+		case 4: l = snprintf(buffer, size, "%s", (i & 8) ? "RX" : "(CR)"); break;
+		case 5: l = snprintf(buffer, size, "((Genre %u", i); break;
+		case 6: l = snprintf(buffer, size, "Unknown Genre %u", i); break;
+		default:
+			/* ID3v2.4 values separated by '\0', the first one means nothing */
+			l = snprintf(buffer, size, " %c%d", '\0', id);
+			break;
+	}
+	return (l < 0) ? 0 : ((size_t)l < size) ? (size_t)l : size - 1;
+}
+
+
+static void genre_parse_frames(void *ctx, unsigned long long ops) {
+	struct genre_bench *g = (struct genre_bench*)ctx;
+	char out[64];
+	unsigned long long i;
+
+	for (i = 0; i < ops; i++) {
+		g->total += genre_parse(g->frames[i % g->n], g->lengths[i % g->n], out, sizeof(out));
+	}
+}
+
+
+static void genre_lookup_names(void *ctx, unsigned long long ops) {
+	struct genre_bench *g = (struct genre_bench*)ctx;
+	unsigned long long i;
+
+	/* the frames that are names (3) and unknown names (6) */
+	for (i = 0; i < ops; i++) g->total += genre_id(g->frames[(i * 8 + 3 + (i & 1) * 3) % g->n]) + 1;
+}
+
+
+void bench_genre(struct bench *b) {
+	struct genre_bench g;
+	char buffer[64];
+	unsigned int i, state = 1977;
+
+	if ((!bench_wanted(b, "genre_parse/mixed")) && (!bench_wanted(b, "genre_id/names"))) return;
+
+	memset(&g, 0, sizeof(g));
+	g.frames = (char**)calloc(_BENCH_GENRES, sizeof(char*));
+	g.lengths = (size_t*)calloc(_BENCH_GENRES, sizeof(size_t));
+	if ((g.frames) && (g.lengths)) {
+		for (g.n = 0; g.n < _BENCH_GENRES; g.n++) {
+			g.lengths[g.n] = genre_frame(buffer, sizeof(buffer), g.n, &state);
+			if (!(g.frames[g.n] = (char*)malloc(g.lengths[g.n] + 1))) break;
+			memcpy(g.frames[g.n], buffer, g.lengths[g.n] + 1);
+		}
+	}
+
+	if (g.n < _BENCH_GENRES) {
+		print_error(G_NOMEM);
+	} else {
+		bench_run(b, "genre_parse/mixed", 100000, 0, genre_parse_frames, 0, &g);
+		bench_run(b, "genre_id/names", 100000, 0, genre_lookup_names, 0, &g);
+	}
+
+	for (i = 0; (g.frames) && (i < g.n); i++) free(g.frames[i]);
+	free(g.frames);
+	free(g.lengths);
+}
+
+
+/**
+ * The strings and the file list of the string benchmarks.
+ */
+struct strings_bench {
+	char **strings;			/* the strings that are copied */
+	char **live;			/* the copies that are still allocated */
+	unsigned int n, nlive;
+	mp3_file *files;		/* a list of n files */
+};
+
+/* the number of strings and of copies that are alive at once */
+#define _BENCH_STRINGS 4096
+#define _BENCH_LIVE 1024
+
+
+static void strings_churn(void *ctx, unsigned long long ops) {
+	struct strings_bench *t = (struct strings_bench*)ctx;
+	unsigned long long i;
+	unsigned int slot;
+
+	/* every copy replaces an older one, like the filenames of a transfer */
+	for (i = 0; i < ops; i++) {
+		slot = (unsigned int)(i * _BENCH_STRIDE) % t->nlive;
+		free(t->live[slot]);
+		t->live[slot] = new_string(t->strings[i % t->n]);
+	}
+}
+
+
+static void strings_release(void *ctx) {
+	struct strings_bench *t = (struct strings_bench*)ctx;
+	unsigned int i;
+
+	for (i = 0; i < t->nlive; i++) {
+		free(t->live[i]);
+		t->live[i] = 0;
+	}
+}
+
+
+static void strings_search(void *ctx, unsigned long long ops) {
+	struct strings_bench *t = (struct strings_bench*)ctx;
+	unsigned long long i;
+
+	/* every other name is not in the list and has to be compared with all */
+	for (i = 0; i < ops; i++) search_file(t->files, t->strings[(i * 2654435761u) % t->n]);
+}
+
+
+static void strings_append(void *ctx, unsigned long long ops) {
+	struct strings_bench *t = (struct strings_bench*)ctx;
+	unsigned long long i;
+	mp3_file *last = 0;
+
+	for (i = 0; i < ops; i++) {
+		last = append_new_file(last, t->strings[i % t->n]);
+		if (!t->files) t->files = last;
+	}
+}
+
+
+/**
+ * strings_drop() frees the file list of t, but not the names.
+ */
+static void strings_drop(void *ctx) {
+	struct strings_bench *t = (struct strings_bench*)ctx;
+	mp3_file *f;
+
+	while ((f = t->files)) {
+		t->files = f->next;
+		free(f);
+	}
+}
+
+
+void bench_strings(struct bench *b) {
+	static const unsigned int sizes[] = { 1000, 10000, 0 };
+	struct strings_bench t;
+	char name[_BENCH_NAME_LEN], buffer[PATH_MAX];
+	unsigned int i, j, len, state = 1977;
+	int s;
+
+	memset(&t, 0, sizeof(t));
+	t.n = _BENCH_STRINGS;
+	t.nlive = _BENCH_LIVE;
+	t.strings = (char**)calloc(t.n, sizeof(char*));
+	t.live = (char**)calloc(t.nlive, sizeof(char*));
+	if ((!t.strings) || (!t.live)) {
+		print_error(G_NOMEM);
+		goto out;
+	}
+
+	/* paths of music files from 8 to 200 characters */
+	for (i = 0; i < t.n; i++) {
+		len = snprintf(buffer, sizeof(buffer), "/home/music/Artist %u/Album %u/", i % 97, i % 13);
+		for (j = 8 + bench_random(&state) % 160; (j > 0) && (len < sizeof(buffer) - 5); j--) {
+			buffer[len++] = 'a' + bench_random(&state) % 26;
+		}
+		strcpy(buffer + len, ".mp3");
+		if (!(t.strings[i] = new_string(buffer))) goto out;
+	}
+
+	bench_run(b, "new_string/churn", 100000, 0, strings_churn, strings_release, &t);
+
+	for (s = 0; sizes[s]; s++) {
+		snprintf(name, sizeof(name), "append_new_file/%u", sizes[s]);
+		bench_run(b, name, sizes[s], 0, strings_append, strings_drop, &t);
+
+		/* the list has the first half of the names, twice if it is longer */
+		snprintf(name, sizeof(name), "search_file/%u", sizes[s]);
+		if (!bench_wanted(b, name)) continue;
+		t.n = _BENCH_STRINGS / 2;
+		strings_append(&t, sizes[s]);
+		t.n = _BENCH_STRINGS;
+		bench_run(b, name, 1000, 0, strings_search, 0, &t);
+		strings_drop(&t);
+	}
+
+out:
+	if (t.strings) for (i = 0; i < t.n; i++) free(t.strings[i]);
+	free(t.strings);
+	free(t.live);
+}
+
+
+/**
+ * The files of the tag benchmarks.
+ */
+struct id3_bench {
+	char dir[PATH_MAX];
+	char *files[_BENCH_CORPUS];
+	unsigned int n;
+	char id3v1;
+};
+
+
+/**
+ * bench_frame() writes an ID3v2.3 text frame to p and returns its size.
+ */
+static unsigned int bench_frame(unsigned char *p, const char *id, const char *text) {
+	unsigned int len = strlen(text) + 1;
+
+	memcpy(p, id, 4);
+	p[4] = (len >> 24) & 0xff;
+	p[5] = (len >> 16) & 0xff;
+	p[6] = (len >> 8) & 0xff;
+	p[7] = len & 0xff;
+	p[8] = p[9] = 0;
+	p[10] = 0;			/* ISO-8859-1 */
+	memcpy(p + 11, text, len - 1);
+	return 10 + len;
+}
+
+
+/**
+ * bench_mp3() writes a short MP3 file with an ID3v2.3 tag, 32 frames of
+ * silence at 128 kbit/s and an ID3v1 tag. It returns 1 on success.
+ */
+static int bench_mp3(const char *filename, unsigned int i) {
+	unsigned char data[1024 + 32 * 417 + 128], *p;
+	char text[64];
+	unsigned int size;
+	int fd, r;
+
+	memset(data, 0, sizeof(data));
+	p = data + 10;
+	snprintf(text, sizeof(text), "Artist %u", i % 17);
+	p += bench_frame(p, "TPE1", text);
+	snprintf(text, sizeof(text), "Title %u", i);
+	p += bench_frame(p, "TIT2", text);
+	snprintf(text, sizeof(text), "Album %u", i / 12);
+	p += bench_frame(p, "TALB", text);
+	p += bench_frame(p, "TCON", "Rock");
+	snprintf(text, sizeof(text), "%u", 1970 + i % 40);
+	p += bench_frame(p, "TYER", text);
+	snprintf(text, sizeof(text), "%u", i % 12 + 1);
+	p += bench_frame(p, "TRCK", text);
+
+	/* the header of the tag, its size is syncsafe */
+	size = p - data - 10;
+	memcpy(data, "ID3\3\0\0", 6);
+	data[6] = (size >> 21) & 0x7f;
+	data[7] = (size >> 14) & 0x7f;
+	data[8] = (size >> 7) & 0x7f;
+	data[9] = size & 0x7f;
+
+	/* MPEG 1 layer III, 128 kbit/s, 44.1 kHz */
+	for (r = 0; r < 32; r++, p += 417) {
+		p[0] = 0xff;
+		p[1] = 0xfb;
+		p[2] = 0x90;
+		p[3] = 0x00;
+	}
+
+	memcpy(p, "TAG", 3);
+	snprintf((char*)p + 3, 30, "Title %u", i);
+	snprintf((char*)p + 33, 30, "Artist %u", i % 17);
+	snprintf((char*)p + 63, 30, "Album %u", i / 12);
+	p[127] = 17;
+	p += 128;
+
+	if ((fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0) return 0;
+	r = (write(fd, data, p - data) == p - data);
+	return (close(fd) == 0) && (r);
+}
+
+
+static void id3_read(void *ctx, unsigned long long ops) {
+	struct id3_bench *t = (struct id3_bench*)ctx;
+	unsigned long long i;
+	s_id3_tag *tag;
+
+	for (i = 0; i < ops; i++) {
+		if (!(tag = id3_get_id3_struct(t->files[i % t->n], t->id3v1))) continue;
+		id3_tag_need(tag, _ID3_ALL);
+		id3_delete_id3_struct(tag);
+	}
+}
+
+
+void bench_id3(struct bench *b) {
+	struct id3_bench t;
+	unsigned int i;
+	char *tmp;
+
+	if ((!bench_wanted(b, "id3_get_id3_struct/v2")) && (!bench_wanted(b, "id3_get_id3_struct/v1"))) return;
+
+	memset(&t, 0, sizeof(t));
+	tmp = getenv("TMPDIR");
+	snprintf(t.dir, sizeof(t.dir), "%s/zencp-bench.XXXXXX", (tmp) ? tmp : "/tmp");
+	if (!mkdtemp(t.dir)) {
+		fprintf(stderr, " ERROR: %s could not be made, the tags are not measured\n", t.dir);
+		return;
+	}
+
+	for (t.n = 0; t.n < _BENCH_CORPUS; t.n++) {
+		if (!(t.files[t.n] = (char*)malloc(strlen(t.dir) + 16))) break;
+		sprintf(t.files[t.n], "%s/%03u.mp3", t.dir, t.n);
+		if (!bench_mp3(t.files[t.n], t.n)) {
+			free(t.files[t.n]);
+			break;
+		}
+	}
+
+	if (t.n == _BENCH_CORPUS) {
+		bench_run(b, "id3_get_id3_struct/v2", t.n, 0, id3_read, 0, &t);
+		t.id3v1 = 1;
+		bench_run(b, "id3_get_id3_struct/v1", t.n, 0, id3_read, 0, &t);
+	} else {
+		fprintf(stderr, " ERROR: the files in %s could not be written, the tags are not measured\n", t.dir);
+	}
+
+	for (i = 0; i < t.n; i++) {
+		unlink(t.files[i]);
+		free(t.files[i]);
+	}
+	rmdir(t.dir);
+}
+
+
+/**
+ * The data of the source benchmarks.
+ */
+struct source_bench {
+	char *data;			/* a track of _BENCH_TRACK bytes */
+	char *back;			/* what is read back */
+	char dir[PATH_MAX];
+};
+
+
+/**
+ * bench_read_back() reads the file filename into buffer the way libnjb does,
+ * by its name. It returns 1 if all _BENCH_TRACK bytes were read.
+ */
+static int bench_read_back(const char *filename, char *buffer) {
+	ssize_t r;
+	size_t n = 0;
+	int fd;
+
+	if ((fd = open(filename, O_RDONLY)) < 0) return 0;
+	while ((n < _BENCH_TRACK) && ((r = read(fd, buffer + n, _BENCH_TRACK - n)) > 0)) n += r;
+	close(fd);
+	return n == _BENCH_TRACK;
+}
+
+
+static void source_memory(void *ctx, unsigned long long ops) {
+	struct source_bench *t = (struct source_bench*)ctx;
+	struct source s;
+	unsigned long long i;
+
+	for (i = 0; i < ops; i++) {
+		if (!source_from_buffer(&s, t->data, _BENCH_TRACK)) continue;
+		bench_read_back(s.path, t->back);
+		source_free(&s);
+	}
+}
+
+
+static void source_tmpfile(void *ctx, unsigned long long ops) {
+	struct source_bench *t = (struct source_bench*)ctx;
+	char filename[PATH_MAX + 32];
+	unsigned long long i;
+	int fd, ok;
+
+	/* what zencp did before there were sources */
+	for (i = 0; i < ops; i++) {
+		snprintf(filename, sizeof(filename), "%s/zencp-bench.XXXXXX", t->dir);
+		if ((fd = mkstemp(filename)) < 0) continue;
+		ok = (write(fd, t->data, _BENCH_TRACK) == _BENCH_TRACK);
+		if ((close(fd) == 0) && (ok)) bench_read_back(filename, t->back);
+		unlink(filename);
+	}
+}
+
+
+void bench_source(struct bench *b) {
+	struct source_bench t;
+	unsigned int i, state = 1989;
+	char *tmp;
+
+	if ((!bench_wanted(b, "source/memory/4MB")) && (!bench_wanted(b, "source/tmpfile/4MB"))) return;
+
+	memset(&t, 0, sizeof(t));
+	tmp = getenv("TMPDIR");
+	snprintf(t.dir, sizeof(t.dir), "%s", (tmp) ? tmp : "/tmp");
+	t.data = (char*)malloc(_BENCH_TRACK);
+	t.back = (char*)malloc(_BENCH_TRACK);
+	if ((!t.data) || (!t.back)) {
+		print_error(G_NOMEM);
+	} else {
+		for (i = 0; i < _BENCH_TRACK; i++) t.data[i] = bench_random(&state) & 0xff;
+
+		/* one operation is one track */
+		bench_run(b, "source/memory/4MB", 8, 0, source_memory, 0, &t);
+		bench_run(b, "source/tmpfile/4MB", 8, 0, source_tmpfile, 0, &t);
+	}
+	free(t.data);
+	free(t.back);
+}
@@ -0,0 +1,169 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * copy.c - implementation file for copying tracks from one player to another
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "copy.h"
+
+int copy_init(struct copy *c, njb_t *from, s_id3_tag **tracks, unsigned int n,
+	      unsigned long long memory) {
+	unsigned int i;
+
+	memset(c, 0, sizeof(struct copy));
+	c->from = from;
+	c->tracks = tracks;
+	c->n = n;
+	c->memory = (memory) ? memory : _COPY_MEMORY;
+	c->nslots = (n < _COPY_SLOTS) ? n : _COPY_SLOTS;
+
+	for (i = 0; i < c->nslots; i++) {
+		if ((c->slots[i].fd = source_memfd()) < 0) {
+			while (i--) close(c->slots[i].fd);
+			return 0;
+		}
+		snprintf(c->slots[i].path, sizeof(c->slots[i].path), "/proc/self/fd/%d", c->slots[i].fd);
+		c->slots[i].state = CS_FREE;
+	}
+
+	pthread_mutex_init(&c->lock, 0);
+	pthread_cond_init(&c->changed, 0);
+	return 1;
+}
+
+
+/**
+ * copy_claim() checks whether the next track may be fetched: its slot must be free
+ * and there must be room for it, unless nothing else is held. If so, the slot is
+ * CS_FILLING and returned, otherwise NULL is returned. The lock must be held.
+ */
+static struct copy_slot* copy_claim(struct copy *c) {
+	struct copy_slot *slot = &c->slots[c->fetched % c->nslots];
+	s_id3_tag *tag = c->tracks[c->fetched];
+
+	if (slot->state != CS_FREE) return 0;
+	if ((c->held) && (c->held + tag->size > c->memory)) return 0;
+
+	slot->state = CS_FILLING;
+	slot->tag = tag;
+	slot->ok = 0;
+	c->held += tag->size;
+	c->fetched++;
+	return slot;
+}
+
+
+/**
+ * copy_fill() fetches the track of the slot from the source player. The lock must
+ * not be held.
+ */
+static void copy_fill(struct copy *c, struct copy_slot *slot) {
+	struct stat st;
+
+	if (lseek(slot->fd, 0, SEEK_SET) == (off_t)-1) return;
+	if (!player_get_track_fd(c->from, slot->tag, slot->fd, 0, 0)) return;
+
+	/* libnjb does not tell whether everything has arrived */
+	slot->ok = ((!fstat(slot->fd, &st)) && ((!slot->tag->size) || (st.st_size == slot->tag->size)));
+}
+
+
+/**
+ * copy_fetcher() is the fetcher thread, it fills the slots in the order of the
+ * tracks.
+ */
+static void* copy_fetcher(void *arg) {
+	struct copy *c = (struct copy*)arg;
+	struct copy_slot *slot;
+
+	pthread_mutex_lock(&c->lock);
+	while ((!c->stop) && (c->fetched < c->n)) {
+		if (!(slot = copy_claim(c))) {
+			pthread_cond_wait(&c->changed, &c->lock);
+			continue;
+		}
+		pthread_mutex_unlock(&c->lock);
+
+		copy_fill(c, slot);
+
+		pthread_mutex_lock(&c->lock);
+		slot->state = CS_FULL;
+		pthread_cond_broadcast(&c->changed);
+	}
+	pthread_mutex_unlock(&c->lock);
+	return 0;
+}
+
+
+int copy_start(struct copy *c) {
+	if ((c->running) || (!c->nslots)) return c->running;
+	c->running = !pthread_create(&c->fetcher, 0, copy_fetcher, c);
+	return c->running;
+}
+
+
+struct copy_slot* copy_next(struct copy *c) {
+	struct copy_slot *slot;
+
+	pthread_mutex_lock(&c->lock);
+	if (c->taken >= c->n) {
+		pthread_mutex_unlock(&c->lock);
+		return 0;
+	}
+
+	slot = &c->slots[c->taken % c->nslots];
+	while (slot->state != CS_FULL) {
+		/* without the fetcher thread the track is fetched right here; the
+		 * slot is free then, as all others are */
+		if ((!c->running) && (copy_claim(c))) {
+			pthread_mutex_unlock(&c->lock);
+			copy_fill(c, slot);
+			pthread_mutex_lock(&c->lock);
+			slot->state = CS_FULL;
+			break;
+		}
+		pthread_cond_wait(&c->changed, &c->lock);
+	}
+
+	slot->state = CS_SENDING;
+	c->taken++;
+	pthread_mutex_unlock(&c->lock);
+	return slot;
+}
+
+
+void copy_done(struct copy *c, struct copy_slot *slot) {
+	/* the memory of the track is given back right away */
+	ftruncate(slot->fd, 0);
+
+	pthread_mutex_lock(&c->lock);
+	c->held -= slot->tag->size;
+	slot->tag = 0;
+	slot->state = CS_FREE;
+	pthread_cond_broadcast(&c->changed);
+	pthread_mutex_unlock(&c->lock);
+}
+
+
+void copy_free(struct copy *c) {
+	unsigned int i;
+
+	if (!c->nslots) return;
+
+	pthread_mutex_lock(&c->lock);
+	c->stop = 1;
+	pthread_cond_broadcast(&c->changed);
+	pthread_mutex_unlock(&c->lock);
+	if (c->running) pthread_join(c->fetcher, 0);
+
+	for (i = 0; i < c->nslots; i++) close(c->slots[i].fd);
+	pthread_cond_destroy(&c->changed);
+	pthread_mutex_destroy(&c->lock);
+	memset(c, 0, sizeof(struct copy));
+}
@@ -0,0 +1,120 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * copy.h - header file for copying tracks from one player to another
+ *
+ * This file provides the prototypes and structures that are needed to
+ * stream tracks from one player to another (--copy-from) without writing
+ * them to the disk. The tracks pass through a ring of slots, each of which
+ * is a file in memory (see source.h) that libnjb can read by its name in
+ * /proc/self/fd. A fetcher thread fills the slots from the source player
+ * while the caller sends the full ones to the destination, so both players
+ * are busy at the same time. The number of slots and the bytes they hold
+ * together are bounded.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_COPY_H
+#define __ZENCP_COPY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <libnjb.h>
+
+#include "id3.h"
+#include "player.h"
+#include "source.h"
+#include "misc.h"
+
+/* the number of slots in the ring */
+#define _COPY_SLOTS 4
+
+/* the bytes all slots may hold together; a larger track is still copied, but
+ * alone */
+#define _COPY_MEMORY (128 * 1024 * 1024)
+
+/**
+ * The states of a slot.
+ */
+enum copy_state {
+	CS_FREE,		/* empty */
+	CS_FILLING,		/* the track is being fetched */
+	CS_FULL,		/* the track is there */
+	CS_SENDING		/* handed to the caller */
+};
+
+/**
+ * A slot of the ring.
+ */
+struct copy_slot {
+	int fd;			/* the file in memory */
+	char path[32];		/* its name, which is handed to libnjb */
+	s_id3_tag *tag;		/* the track that is in it */
+	int ok;			/* the track has been fetched completely */
+	int state;		/* see enum copy_state */
+};
+
+/**
+ * The ring of one copy.
+ */
+struct copy {
+	njb_t *from;			/* the captured source player */
+	s_id3_tag **tracks;		/* the tracks to be copied */
+	unsigned int n;			/* their number */
+	unsigned int fetched;		/* the next track the fetcher takes */
+	unsigned int taken;		/* the next track that is handed out */
+
+	struct copy_slot slots[_COPY_SLOTS];
+	unsigned int nslots;		/* the slots in use */
+	unsigned long long memory;	/* the bytes the slots may hold */
+	unsigned long long held;	/* the bytes they hold */
+
+	int running;			/* the fetcher thread has been started */
+	int stop;			/* the fetcher thread has to stop */
+	pthread_t fetcher;
+	pthread_mutex_t lock;		/* protects all of the above */
+	pthread_cond_t changed;		/* signalled whenever a slot changes its state */
+};
+
+/**
+ * copy_init() sets up a ring for copying the n tracks (from the tracklist of the
+ * player from) with slots that hold up to memory bytes (0 means _COPY_MEMORY). It
+ * returns 1 on success and 0 if the slots could not be created.
+ */
+int		copy_init(struct copy *c, njb_t *from, s_id3_tag **tracks, unsigned int n,
+			  unsigned long long memory);
+
+/**
+ * copy_start() starts the fetcher thread. Without it, the tracks are fetched by
+ * copy_next() one by one. It returns 1 if the thread is running and 0 otherwise.
+ */
+int		copy_start(struct copy *c);
+
+/**
+ * copy_next() waits for the next track and returns its slot or NULL if all tracks
+ * have been handed out. The track can be read from slot->path if slot->ok is set.
+ * The slot belongs to the caller until it is given back with copy_done().
+ */
+struct copy_slot* copy_next(struct copy *c);
+
+/**
+ * copy_done() gives the slot back to the ring, its memory is freed.
+ */
+void		copy_done(struct copy *c, struct copy_slot *slot);
+
+/**
+ * copy_free() stops the fetcher thread and frees the slots.
+ */
+void		copy_free(struct copy *c);
+
+#endif
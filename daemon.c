@@ -0,0 +1,658 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * daemon.c - implementation file for the daemon mode
+ *
+ * This file provides the implementation of the daemon and of its client.
+ * The daemon is a single thread that waits for commands with poll(). The
+ * player is only used by that thread, so it needs no locking; the work
+ * that can be done in parallel (fingerprints and tags) is done on the
+ * thread pool as in a normal run.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "daemon.h"
+
+/**
+ * The names of the commands and whether they take an argument.
+ */
+static const struct {
+	const char *name;
+	int command;
+	int arg;
+} daemon_commands[] = {
+	{ "SEND",     DC_SEND,     1 },
+	{ "DELETE",   DC_DELETE,   1 },
+	{ "WHERE",    DC_WHERE,    1 },
+	{ "SORT",     DC_SORT,     1 },
+	{ "FIELDS",   DC_FIELDS,   1 },
+	{ "FORMAT",   DC_FORMAT,   1 },
+	{ "LIST",     DC_LIST,     0 },
+	{ "QUIT",     DC_QUIT,     0 },
+	{ "SHUTDOWN", DC_SHUTDOWN, 0 }
+};
+
+#define _DAEMON_COMMANDS (sizeof(daemon_commands) / sizeof(daemon_commands[0]))
+
+
+char* daemon_socket_path(void) {
+	return config_file_path(_DAEMON_SOCKET);
+}
+
+
+/**
+ * daemon_address() fills in the address of the socket path. It returns 0 if the
+ * path is too long for a Unix socket.
+ */
+static int daemon_address(struct sockaddr_un *addr, const char *path) {
+	if ((!path) || (strlen(path) >= sizeof(addr->sun_path))) return 0;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path, path);
+	return 1;
+}
+
+
+/**
+ * daemon_connect() connects to the socket path. It returns the socket or -1 if
+ * nobody is listening there.
+ */
+static int daemon_connect(const char *path) {
+	struct sockaddr_un addr;
+	int fd;
+
+	if (!daemon_address(&addr, path)) return -1;
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return -1;
+
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+/**
+ * daemon_listen() creates the listening socket of the daemon. A socket that is
+ * left over from a daemon that did not exit cleanly is removed, a socket of a
+ * running daemon is not.
+ */
+static int daemon_listen(struct daemon *d) {
+	struct sockaddr_un addr;
+	int fd;
+
+	if (!daemon_address(&addr, d->path)) return 0;
+
+	if ((fd = daemon_connect(d->path)) >= 0) {
+		close(fd);
+		fprintf(stderr, " ERROR: a daemon is already running on %s\n\n", d->path);
+		return 0;
+	}
+	unlink(d->path);
+
+	if ((d->fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return 0;
+	if ((bind(d->fd, (struct sockaddr*)&addr, sizeof(addr))) ||
+	    (chmod(d->path, 0600)) ||
+	    (listen(d->fd, _DAEMON_MAX_CLIENTS))) {
+		close(d->fd);
+		d->fd = -1;
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * daemon_close() disconnects a client.
+ */
+static void daemon_close(struct daemon_client *c) {
+	if (c->fd < 0) return;
+
+	close(c->fd);
+	c->fd = -1;
+	query_free(&c->query);
+}
+
+
+/**
+ * daemon_find() returns the client with the number id or NULL if it has gone.
+ */
+static struct daemon_client* daemon_find(struct daemon *d, unsigned int id) {
+	int i;
+
+	for (i = 0; i < _DAEMON_MAX_CLIENTS; i++) {
+		if ((d->clients[i].fd >= 0) && (d->clients[i].id == id)) return &d->clients[i];
+	}
+	return 0;
+}
+
+
+/**
+ * daemon_send() writes len bytes of data to the client c. A client that cannot
+ * be written to is disconnected.
+ */
+static void daemon_send(struct daemon_client *c, const char *data, size_t len) {
+	ssize_t n;
+
+	while ((c->fd >= 0) && (len)) {
+		n = send(c->fd, data, len, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			daemon_close(c);
+			return;
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+
+/**
+ * daemon_reply() sends a line of formatted text (see printf()) to the client with
+ * the number id.
+ */
+static void daemon_reply(struct daemon *d, unsigned int id, const char *fmt, ...) {
+	struct daemon_client *c;
+	char line[_DAEMON_LINE + 64];
+	va_list ap;
+	int n;
+
+	if (!(c = daemon_find(d, id))) return;
+
+	va_start(ap, fmt);
+	n = vsnprintf(line, sizeof(line) - 1, fmt, ap);
+	va_end(ap);
+
+	if ((n < 0) || ((size_t)n >= sizeof(line) - 1)) n = sizeof(line) - 2;
+	line[n++] = '\n';
+	daemon_send(c, line, n);
+}
+
+
+/**
+ * daemon_queue() appends a command of the client c to the queue. Commands that
+ * cannot be parsed are queued as well (command -1, the argument is the error
+ * message), so that their answer is sent in the right order.
+ */
+static void daemon_queue(struct daemon *d, struct daemon_client *c, int command, const char *arg) {
+	struct daemon_job *job;
+
+	if (!(job = (struct daemon_job*)malloc(sizeof(struct daemon_job)))) {
+		print_error(G_NOMEM);
+		return;
+	}
+
+	job->client = c->id;
+	job->command = command;
+	job->arg = (arg) ? strdup(arg) : 0;
+	job->next = 0;
+
+	if (d->tail) {
+		d->tail->next = job;
+	} else {
+		d->head = job;
+	}
+	d->tail = job;
+	c->pending++;
+}
+
+
+/**
+ * daemon_parse() queues the command in line that was received from client c.
+ */
+static void daemon_parse(struct daemon *d, struct daemon_client *c, char *line) {
+	char *arg;
+	size_t len;
+	unsigned int i;
+
+	if (!line[0]) return;	/* empty lines are ignored */
+
+	if ((arg = strchr(line, ' '))) {
+		len = arg - line;
+		arg++;
+	} else {
+		len = strlen(line);
+	}
+
+	for (i = 0; i < _DAEMON_COMMANDS; i++) {
+		if ((strlen(daemon_commands[i].name) != len) ||
+		    (strncmp(daemon_commands[i].name, line, len))) continue;
+
+		if ((daemon_commands[i].arg) && ((!arg) || (!arg[0]))) {
+			daemon_queue(d, c, -1, "argument missing");
+			return;
+		}
+
+		/* nothing is read from a client after QUIT */
+		if (daemon_commands[i].command == DC_QUIT) c->closing = 1;
+		daemon_queue(d, c, daemon_commands[i].command, (daemon_commands[i].arg) ? arg : 0);
+		return;
+	}
+
+	daemon_queue(d, c, -1, "unknown command");
+}
+
+
+/**
+ * daemon_accept() accepts a new client.
+ */
+static void daemon_accept(struct daemon *d) {
+	struct daemon_client *c = 0;
+	int fd, i;
+
+	if ((fd = accept(d->fd, 0, 0)) < 0) return;
+
+	for (i = 0; (i < _DAEMON_MAX_CLIENTS) && (!c); i++) {
+		if (d->clients[i].fd < 0) c = &d->clients[i];
+	}
+	if (!c) {
+		send(fd, "ERR too many clients\n", 21, MSG_NOSIGNAL);
+		close(fd);
+		return;
+	}
+
+	c->fd = fd;
+	c->id = ++d->next_id;
+	c->len = 0;
+	c->overflow = 0;
+	c->pending = 0;
+	c->closing = 0;
+	query_init(&c->query);
+}
+
+
+/**
+ * daemon_read() reads what the client c has sent and queues all complete lines.
+ */
+static void daemon_read(struct daemon *d, struct daemon_client *c) {
+	char buff[4096];
+	ssize_t n, i;
+
+	n = read(c->fd, buff, sizeof(buff));
+	if ((n < 0) && (errno == EINTR)) return;
+
+	if (n <= 0) {
+		/* the client has gone, but the answers of its queued commands might
+		 * still be read */
+		c->closing = 1;
+		if (!c->pending) daemon_close(c);
+		return;
+	}
+
+	for (i = 0; (i < n) && (!c->closing); i++) {
+		if (buff[i] == '\n') {
+			if (c->overflow) {
+				daemon_queue(d, c, -1, "line too long");
+			} else {
+				if ((c->len) && (c->line[c->len - 1] == '\r')) c->len--;
+				c->line[c->len] = '\0';
+				daemon_parse(d, c, c->line);
+			}
+			c->len = 0;
+			c->overflow = 0;
+		} else if (c->len < sizeof(c->line) - 1) {
+			c->line[c->len++] = buff[i];
+		} else {
+			c->overflow = 1;
+		}
+	}
+}
+
+
+/**
+ * daemon_send_file() transfers the file of a SEND command. The fingerprint and
+ * the tags have already been read.
+ */
+static void daemon_send_file(struct daemon *d, struct daemon_job *job, mp3_file *file) {
+	s_id3_tag *tag = file->tag, *track;
+
+	if (!tag) {
+		d->z->stats.failed++;
+		daemon_reply(d, job->client, "ERR 0 %s", job->arg);
+		return;
+	}
+
+	/* the same check as in a normal run, the tracklist is always up to date */
+	track = zencp_find_duplicate(d->z, file);
+	if ((track) && (!d->z->options.force)) {
+		d->z->stats.skipped++;
+		daemon_reply(d, job->client, "SKIP %u %s", track->trackid, job->arg);
+		id3_delete_id3_struct(tag);
+		file->tag = 0;
+		return;
+	}
+
+	/* the statistics, the library and the tracklist are kept by the context */
+	if (zencp_send(d->z, file, track)) {
+		daemon_reply(d, job->client, "OK %u %s", tag->trackid, job->arg);
+	} else {
+		daemon_reply(d, job->client, "ERR 0 %s", job->arg);
+	}
+
+	id3_delete_id3_struct(tag);
+	file->tag = 0;
+}
+
+
+/**
+ * daemon_delete() deletes the track of a DELETE command.
+ */
+static void daemon_delete(struct daemon *d, struct daemon_job *job) {
+	unsigned int id = (unsigned int)strtoul(job->arg, 0, 10);
+	s_id3_tag *track = tracklist_find_trackid(&d->z->tracklist, id);
+	const char *artist = (track) ? track->artist : 0, *title = (track) ? track->title : 0;
+
+	/* the names are interned, so they outlive the track */
+	if (!zencp_delete(d->z, id)) {
+		daemon_reply(d, job->client, "ERR %u", id);
+		return;
+	}
+
+	printf(" Deleted %s - %s\n", artist, title);
+	daemon_reply(d, job->client, "OK %u", id);
+}
+
+
+/**
+ * daemon_list() runs the query of the client and sends the track list.
+ */
+static void daemon_list(struct daemon *d, struct daemon_job *job) {
+	struct daemon_client *c;
+	s_id3_tag **tracks;
+	unsigned int count = 0;
+	char *data = 0;
+	size_t size = 0;
+	FILE *mem;
+
+	if (!(c = daemon_find(d, job->client))) return;
+
+	/* the track list is written into memory first, its size is sent before it */
+	if ((!(tracks = query_run(&c->query, &d->z->tracklist, &count))) ||
+	    (!(mem = open_memstream(&data, &size)))) {
+		free(tracks);
+		daemon_reply(d, job->client, "ERR 0");
+		return;
+	}
+	query_write(&c->query, tracks, count, mem);
+	fclose(mem);
+	free(tracks);
+
+	daemon_reply(d, job->client, "DATA %lu", (unsigned long)size);
+	daemon_send(c, data, size);
+	daemon_reply(d, job->client, "OK %u", count);
+	free(data);
+
+	/* the next LIST starts with a new query */
+	if (c->fd >= 0) {
+		query_free(&c->query);
+		query_init(&c->query);
+	}
+}
+
+
+/**
+ * daemon_set_query() changes the query of the client by a WHERE, SORT, FIELDS
+ * or FORMAT command.
+ */
+static void daemon_set_query(struct daemon *d, struct daemon_job *job) {
+	struct daemon_client *c;
+	int k;
+
+	if (!(c = daemon_find(d, job->client))) return;
+
+	switch (job->command) {
+		case DC_WHERE:  k = query_add_term(&c->query, job->arg); break;
+		case DC_SORT:   k = query_set_sort(&c->query, job->arg); break;
+		case DC_FIELDS: k = query_set_fields(&c->query, job->arg); break;
+		default:        k = query_set_format(&c->query, job->arg);
+	}
+	daemon_reply(d, job->client, (k) ? "OK" : "ERR invalid query");
+}
+
+
+/**
+ * daemon_work() works on all commands in the queue. The files of all SEND
+ * commands are fingerprinted and their tags are read before the first one is
+ * sent.
+ */
+static void daemon_work(struct daemon *d) {
+	struct daemon_job *jobs = d->head, *job;
+	struct daemon_client *c;
+	mp3_file *files = 0, *file, *e;
+
+	d->head = d->tail = 0;
+
+	for (job = jobs; job; job = job->next) {
+		if (job->command != DC_SEND) continue;
+		e = append_new_file(files, job->arg);
+		if (!files) files = e;
+	}
+	if (files) {
+		library_scan(&d->z->library, files, d->z->options.threads);
+		schedule_read_tags(files, d->z->options.id3v1, 0);
+	}
+
+	file = files;
+	while ((job = jobs)) {
+		jobs = job->next;
+
+		switch (job->command) {
+			case DC_SEND:
+				daemon_send_file(d, job, file);
+				file = file->next;
+				break;
+			case DC_DELETE:
+				daemon_delete(d, job);
+				break;
+			case DC_WHERE:
+			case DC_SORT:
+			case DC_FIELDS:
+			case DC_FORMAT:
+				daemon_set_query(d, job);
+				break;
+			case DC_LIST:
+				daemon_list(d, job);
+				break;
+			case DC_QUIT:
+				daemon_reply(d, job->client, "OK");
+				break;
+			case DC_SHUTDOWN:
+				daemon_reply(d, job->client, "OK");
+				d->running = 0;
+				break;
+			default:
+				daemon_reply(d, job->client, "ERR %s", job->arg);
+		}
+
+		/* a client that has said QUIT is closed after its last answer */
+		if ((c = daemon_find(d, job->client)) && (!--c->pending) && (c->closing)) {
+			daemon_close(c);
+		}
+		free(job->arg);
+		free(job);
+	}
+
+	while (files) {
+		file = files->next;
+		free(files);
+		files = file;
+	}
+	library_save(&d->z->library);
+}
+
+
+int daemon_serve(const char *path, struct zencp *z) {
+	struct daemon d;
+	struct pollfd fds[_DAEMON_MAX_CLIENTS + 1];
+	struct daemon_client *polled[_DAEMON_MAX_CLIENTS + 1];
+	int i, n, r;
+
+	memset(&d, 0, sizeof(d));
+	d.path = path;
+	d.fd = -1;
+	d.running = 1;
+	d.z = z;
+	for (i = 0; i < _DAEMON_MAX_CLIENTS; i++) d.clients[i].fd = -1;
+
+	/* a client that goes away must not kill the daemon */
+	signal(SIGPIPE, SIG_IGN);
+	if (!daemon_listen(&d)) return 0;
+	printf(" Waiting for jobs on %s\n\n", path);
+	fflush(stdout);
+
+	while (d.running) {
+		n = 0;
+		fds[n].fd = d.fd;
+		fds[n].events = POLLIN;
+		polled[n++] = 0;
+		for (i = 0; i < _DAEMON_MAX_CLIENTS; i++) {
+			if ((d.clients[i].fd < 0) || (d.clients[i].closing)) continue;
+			fds[n].fd = d.clients[i].fd;
+			fds[n].events = POLLIN;
+			polled[n++] = &d.clients[i];
+		}
+
+		/* with commands in the queue, we only look for what has arrived already
+		 * and start working as soon as nothing more is waiting */
+		r = poll(fds, n, (d.head) ? 0 : -1);
+		if (r < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (!r) {
+			daemon_work(&d);
+			fflush(stdout);
+			continue;
+		}
+
+		if (fds[0].revents & POLLIN) daemon_accept(&d);
+		for (i = 1; i < n; i++) {
+			if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) daemon_read(&d, polled[i]);
+		}
+	}
+
+	/* commands that arrived after SHUTDOWN are not carried out */
+	while (d.head) {
+		d.tail = d.head->next;
+		daemon_reply(&d, d.head->client, "ERR shutting down");
+		free(d.head->arg);
+		free(d.head);
+		d.head = d.tail;
+	}
+	for (i = 0; i < _DAEMON_MAX_CLIENTS; i++) daemon_close(&d.clients[i]);
+	close(d.fd);
+	unlink(path);
+
+	stats_print(&z->stats, "sent");
+	return 1;
+}
+
+
+void daemon_request_init(struct daemon_request *req) {
+	req->lines = 0;
+	req->n = 0;
+	req->size = 0;
+}
+
+
+int daemon_request_add(struct daemon_request *req, const char *command, const char *arg) {
+	char **lines;
+	size_t l;
+
+	if ((!req) || (!command)) return 0;
+
+	if (req->n == req->size) {
+		lines = (char**)realloc(req->lines, ((req->size) ? req->size * 2 : 16) * sizeof(char*));
+		if (!lines) return 0;
+		req->lines = lines;
+		req->size = (req->size) ? req->size * 2 : 16;
+	}
+
+	l = strlen(command) + ((arg) ? strlen(arg) + 1 : 0) + 1;
+	if (!(req->lines[req->n] = (char*)malloc(l))) return 0;
+	snprintf(req->lines[req->n], l, (arg) ? "%s %s" : "%s", command, arg);
+	req->n++;
+	return 1;
+}
+
+
+void daemon_request_free(struct daemon_request *req) {
+	unsigned int i;
+
+	if (!req) return;
+
+	for (i = 0; i < req->n; i++) free(req->lines[i]);
+	free(req->lines);
+	daemon_request_init(req);
+}
+
+
+/**
+ * daemon_write() writes len bytes of data to fd. It returns 0 if that failed.
+ */
+static int daemon_write(int fd, const char *data, size_t len) {
+	ssize_t n;
+
+	while (len) {
+		n = send(fd, data, len, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return 0;
+		}
+		data += n;
+		len -= n;
+	}
+	return 1;
+}
+
+
+int daemon_client(const char *path, struct daemon_request *req, FILE *out, FILE *msg) {
+	FILE *in;
+	char line[_DAEMON_LINE + 64];
+	char buff[4096];
+	unsigned long size;
+	unsigned int i, answers = 0;
+	size_t n;
+	int fd, failed = 0;
+
+	if ((!req) || ((fd = daemon_connect(path)) < 0)) return -1;
+
+	/* all commands are sent at once, so the daemon can work on them together */
+	for (i = 0; i < req->n; i++) {
+		if ((!daemon_write(fd, req->lines[i], strlen(req->lines[i]))) ||
+		    (!daemon_write(fd, "\n", 1))) break;
+	}
+	daemon_write(fd, "QUIT\n", 5);
+
+	if (!(in = fdopen(fd, "r"))) {
+		close(fd);
+		return -1;
+	}
+
+	while ((answers <= req->n) && (fgets(line, sizeof(line), in))) {
+		if (!strncmp(line, "DATA ", 5)) {
+			/* a track list follows */
+			for (size = strtoul(line + 5, 0, 10); size; size -= n) {
+				n = fread(buff, 1, (size < sizeof(buff)) ? size : sizeof(buff), in);
+				if (!n) break;
+				fwrite(buff, 1, n, out);
+			}
+			continue;
+		}
+
+		if (!strncmp(line, "ERR", 3)) failed++;
+		if (answers < req->n) fprintf(msg, " %s", line);
+		answers++;
+	}
+	fclose(in);
+
+	/* commands without an answer have not been carried out */
+	if (answers < req->n) failed += req->n - answers;
+	return failed;
+}
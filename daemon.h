@@ -0,0 +1,175 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * daemon.h - header file for the daemon mode
+ *
+ * This file provides the prototypes and structures of the daemon mode
+ * (-D) and of the client (-C) that talks to it. The daemon keeps a player
+ * captured and its tracklist in memory, so that a job does not have to
+ * pay for the discovery, the capture and reading the tracklist. Clients
+ * connect to a Unix socket ($HOME/.zencp/socket unless -S is given) and
+ * send one command per line:
+ *
+ *   SEND path       transfer the MP3 file path (an absolute path)
+ *   DELETE id       delete the track with the track ID id
+ *   WHERE term      add a term to the query of the connection (see -w)
+ *   SORT fields     sort the query by fields (see -s)
+ *   FIELDS fields   print the fields of the query (see -c)
+ *   FORMAT format   print the query as tsv, csv or json (see -o)
+ *   LIST            run the query of the connection and start a new one
+ *   QUIT            close the connection
+ *   SHUTDOWN        release the player and stop the daemon
+ *
+ * Every command is answered by exactly one line in the order the commands
+ * were sent. It starts with OK, SKIP (the track is already on the player)
+ * or ERR, followed by the track ID for SEND and DELETE and the path for
+ * SEND. LIST sends "DATA <bytes>" and the track list before its OK line.
+ *
+ * All commands are queued. The daemon works on the queue whenever no more
+ * commands are waiting to be read, so the files of all SEND commands that
+ * arrived together are fingerprinted and their tags are read in parallel
+ * before they are transferred one after another.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_DAEMON_H
+#define __ZENCP_DAEMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "libzencp.h"
+#include "query.h"
+#include "misc.h"
+
+/* the name of the socket within $HOME/.zencp */
+#define _DAEMON_SOCKET "socket"
+
+/* the maximum number of clients that are connected at the same time */
+#define _DAEMON_MAX_CLIENTS 16
+
+/* the maximum length of a command line */
+#define _DAEMON_LINE (PATH_MAX + 64)
+
+/**
+ * The commands of the protocol, see above.
+ */
+enum daemon_command {
+	DC_SEND,
+	DC_DELETE,
+	DC_WHERE,
+	DC_SORT,
+	DC_FIELDS,
+	DC_FORMAT,
+	DC_LIST,
+	DC_QUIT,
+	DC_SHUTDOWN
+};
+
+/**
+ * A command that waits in the queue. The client is identified by its number,
+ * so the answer is dropped if the client has gone in the meantime.
+ */
+struct daemon_job {
+	unsigned int client;		/* the number of the client */
+	int command;			/* see enum daemon_command */
+	char *arg;			/* the argument of the command or NULL */
+
+	struct daemon_job *next;
+};
+
+/**
+ * A connected client.
+ */
+struct daemon_client {
+	int fd;				/* the socket, -1 if the slot is free */
+	unsigned int id;		/* the number of the client */
+	char line[_DAEMON_LINE];	/* the command line that is being read */
+	size_t len;			/* the number of bytes in line */
+	int overflow;			/* the current line is too long */
+	unsigned int pending;		/* the number of queued commands */
+	int closing;			/* QUIT was received, close when pending is 0 */
+	struct query query;		/* the query for LIST */
+};
+
+/**
+ * The state of the daemon.
+ */
+struct daemon {
+	const char *path;		/* the path of the socket */
+	int fd;				/* the listening socket */
+	int running;			/* 0 after SHUTDOWN */
+	unsigned int next_id;		/* the number of the next client */
+
+	struct zencp *z;		/* the context with the captured player */
+
+	struct daemon_client clients[_DAEMON_MAX_CLIENTS];
+	struct daemon_job *head;	/* the queue */
+	struct daemon_job *tail;
+};
+
+/**
+ * The command lines a client sends to the daemon.
+ */
+struct daemon_request {
+	char **lines;
+	unsigned int n;			/* the number of lines */
+	unsigned int size;		/* the number of allocated lines */
+};
+
+/**
+ * daemon_socket_path() returns a newly allocated string with the default path of
+ * the socket or NULL if $HOME/.zencp cannot be used.
+ */
+char*		daemon_socket_path(void);
+
+/**
+ * daemon_serve() runs the daemon on the socket path for the player of z, which
+ * must be captured and loaded (see zencp_load()). The options of z are used for
+ * all jobs. It returns 1 after SHUTDOWN and 0 if the socket could not be set up
+ * (e.g. because another daemon is running).
+ */
+int		daemon_serve(const char *path, struct zencp *z);
+
+/**
+ * daemon_request_init() sets up an empty request.
+ */
+void		daemon_request_init(struct daemon_request *req);
+
+/**
+ * daemon_request_add() appends the command line "command arg" (or just command if
+ * arg is NULL) to the request. It returns 1 on success and 0 if there was no
+ * memory left.
+ */
+int		daemon_request_add(struct daemon_request *req, const char *command, const char *arg);
+
+/**
+ * daemon_request_free() frees all lines of the request.
+ */
+void		daemon_request_free(struct daemon_request *req);
+
+/**
+ * daemon_client() sends the request to the daemon on the socket path and waits
+ * for all answers. Track lists are written to out, all other answers to msg. It
+ * returns the number of commands that failed or -1 if the daemon could not be
+ * reached.
+ */
+int		daemon_client(const char *path, struct daemon_request *req, FILE *out, FILE *msg);
+
+#endif
@@ -0,0 +1,156 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * datafile.c - implementation file for data files on the player
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "datafile.h"
+
+/**
+ * datafile_cmp() is the qsort() function of the list, it sorts by the addresses
+ * of the interned folders and names.
+ */
+static int datafile_cmp(const void *a, const void *b) {
+	const struct datafile *x = (const struct datafile*)a;
+	const struct datafile *y = (const struct datafile*)b;
+
+	if (x->folder != y->folder) return ((unsigned long)x->folder > (unsigned long)y->folder) ? 1 : -1;
+	return ((unsigned long)x->name > (unsigned long)y->name) - ((unsigned long)x->name < (unsigned long)y->name);
+}
+
+
+void datafile_init(struct datafile_list *l) {
+	l->files = 0;
+	l->n = l->size = 0;
+	l->sorted = 1;
+}
+
+
+int datafile_add(struct datafile_list *l, const char *folder, const char *name,
+		 const char *path, unsigned long long size, long long mtime, unsigned int id) {
+	struct datafile *p;
+	unsigned int size_new;
+
+	if ((!folder) || (!name)) return 0;
+
+	if (l->n == l->size) {
+		size_new = (l->size) ? l->size * 2 : 256;
+		if (!(p = (struct datafile*)realloc(l->files, size_new * sizeof(struct datafile)))) {
+			print_error(G_NOMEM);
+			return 0;
+		}
+		l->files = p;
+		l->size = size_new;
+	}
+
+	p = &l->files[l->n++];
+	p->folder = intern(folder);
+	p->name = intern(name);
+	p->path = (path) ? intern(path) : 0;
+	p->size = size;
+	p->mtime = mtime;
+	p->id = id;
+	l->sorted = 0;
+	return 1;
+}
+
+
+/**
+ * datafile_walk() adds the files of the directory path to the folder of the
+ * player. Both buffers have room for PATH_MAX characters and are changed while
+ * the subdirectories are walked, but are given back as they came. It returns the
+ * number of files added or -1 if the directory cannot be read.
+ */
+static int datafile_walk(struct datafile_list *l, char *path, char *folder) {
+	struct dirent *e;
+	struct stat st;
+	size_t lp = strlen(path), lf = strlen(folder);
+	int n = 0, k;
+	DIR *d;
+
+	if (!(d = opendir(path))) return -1;
+
+	while ((e = readdir(d))) {
+		if ((!strcmp(e->d_name, ".")) || (!strcmp(e->d_name, ".."))) continue;
+		if (snprintf(path + lp, PATH_MAX - lp, "/%s", e->d_name) >= (int)(PATH_MAX - lp)) continue;
+
+		/* a link to a directory may lead back up the tree, so it is not followed */
+		if (lstat(path, &st)) continue;
+		if ((S_ISLNK(st.st_mode)) && ((stat(path, &st)) || (!S_ISREG(st.st_mode)))) continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			if (snprintf(folder + lf, PATH_MAX - lf, "%s%c", e->d_name, _DATAFILE_SEPARATOR) <
+			    (int)(PATH_MAX - lf)) {
+				if ((k = datafile_walk(l, path, folder)) > 0) n += k;
+			}
+		} else if (S_ISREG(st.st_mode)) {
+			if (datafile_add(l, folder, e->d_name, path, st.st_size, st.st_mtime, 0)) n++;
+		}
+		path[lp] = '\0';
+		folder[lf] = '\0';
+	}
+
+	path[lp] = '\0';
+	folder[lf] = '\0';
+	closedir(d);
+	return n;
+}
+
+
+int datafile_scan(struct datafile_list *l, const char *dir) {
+	char path[PATH_MAX], folder[PATH_MAX];
+	const char *base;
+	size_t len;
+	int r;
+
+	if ((!dir) || (!*dir) || (strlen(dir) >= sizeof(path))) return -1;
+
+	/* the trailing slashes do not count, the last part names the folder */
+	strcpy(path, dir);
+	for (len = strlen(path); (len > 1) && (path[len - 1] == '/'); len--) path[len - 1] = '\0';
+	base = strrchr(path, '/');
+	base = (base) ? base + 1 : path;
+	if ((!*base) || (!strcmp(base, ".")) || (!strcmp(base, ".."))) {
+		r = snprintf(folder, sizeof(folder), "%c", _DATAFILE_SEPARATOR);
+	} else {
+		r = snprintf(folder, sizeof(folder), "%c%s%c", _DATAFILE_SEPARATOR, base, _DATAFILE_SEPARATOR);
+	}
+
+	/* a folder whose name does not fit would put the tree somewhere else */
+	if ((r < 0) || (r >= (int)sizeof(folder))) return -1;
+
+	return datafile_walk(l, path, folder);
+}
+
+
+struct datafile* datafile_find(struct datafile_list *l, const char *folder, const char *name) {
+	struct datafile key;
+
+	if ((!l->n) || (!folder) || (!name)) return 0;
+	if (!l->sorted) {
+		qsort(l->files, l->n, sizeof(struct datafile), datafile_cmp);
+		l->sorted = 1;
+	}
+
+	key.folder = intern(folder);
+	key.name = intern(name);
+	return (struct datafile*)bsearch(&key, l->files, l->n, sizeof(struct datafile), datafile_cmp);
+}
+
+
+int datafile_same(const struct datafile *disk, const struct datafile *player) {
+	if ((!disk) || (!player)) return 0;
+	return (disk->size == player->size) && (player->mtime >= disk->mtime);
+}
+
+
+void datafile_free(struct datafile_list *l) {
+	free(l->files);
+	datafile_init(l);
+}
@@ -0,0 +1,99 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * datafile.h - header file for data files on the player
+ *
+ * Besides tracks, the players (the Zen Touch, for example) keep ordinary
+ * files in a data area of their own, in folders that are written like
+ * "\Documents\Letters\". This file provides the prototypes and structures
+ * of a list of such files: the files of a directory tree on the disk and
+ * the data files on a player (see player_get_datafiles()), so that files
+ * that are on the player already do not have to be sent again.
+ *
+ * Names and folders are interned (see intern.h), so a file is found by
+ * the addresses of its folder and name.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_DATAFILE_H
+#define __ZENCP_DATAFILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "intern.h"
+#include "misc.h"
+
+/* the separator of the folders on the player */
+#define _DATAFILE_SEPARATOR '\\'
+
+/**
+ * A file on the disk or on the player.
+ */
+struct datafile {
+	const char *folder;		/* the folder on the player, e.g. "\Docs\" */
+	const char *name;		/* the name within the folder */
+	const char *path;		/* the file on the disk, NULL for the player */
+	unsigned long long size;	/* its size */
+	long long mtime;		/* its modification time */
+	unsigned int id;		/* its file ID on the player, 0 for the disk */
+};
+
+/**
+ * A list of files.
+ */
+struct datafile_list {
+	struct datafile *files;
+	unsigned int n;			/* the number of files */
+	unsigned int size;		/* the room in files */
+	int sorted;			/* files is sorted by folder and name */
+};
+
+/**
+ * datafile_init() sets up an empty list.
+ */
+void		datafile_init(struct datafile_list *l);
+
+/**
+ * datafile_add() adds a file to the list. It returns 1 on success and 0 if there
+ * is no memory.
+ */
+int		datafile_add(struct datafile_list *l, const char *folder, const char *name,
+			     const char *path, unsigned long long size, long long mtime, unsigned int id);
+
+/**
+ * datafile_scan() adds all regular files below the directory dir to the list, in
+ * the folder that is named like dir (below the root folder of the player) and its
+ * subfolders. It returns the number of files added or -1 if dir cannot be read or
+ * its name is too long for a folder of the player.
+ */
+int		datafile_scan(struct datafile_list *l, const char *dir);
+
+/**
+ * datafile_find() returns the file name in folder (both need not be interned) or
+ * NULL if it is not in the list.
+ */
+struct datafile* datafile_find(struct datafile_list *l, const char *folder, const char *name);
+
+/**
+ * datafile_same() returns 1 if the file on the player is the same as the file on
+ * the disk: it has the same size and is not older.
+ */
+int		datafile_same(const struct datafile *disk, const struct datafile *player);
+
+/**
+ * datafile_free() frees the list.
+ */
+void		datafile_free(struct datafile_list *l);
+
+#endif
@@ -0,0 +1,189 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * device.c - implementation file for the identity of players
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "device.h"
+
+int device_path(njb_t *player, char *out) {
+	int l;
+
+	if ((!player) || (!out) || (!player->device) || (!player->device->bus)) return 0;
+
+	/* a path that has been cut could be the one of another player */
+	l = snprintf(out, _DEVICE_PATH_LEN, "%s/%s", player->device->bus->dirname,
+		     player->device->filename);
+	if ((l < 0) || (l >= _DEVICE_PATH_LEN)) {
+		out[0] = '\0';
+		return 0;
+	}
+	return 1;
+}
+
+
+int device_serial(njb_t *player, char *out) {
+	u_int8_t sdmid[16];
+	int i;
+
+	if ((!player) || (!out)) return 0;
+	if (NJB_Get_SDMID(player, sdmid) == -1) return 0;
+
+	for (i = 0; i < 16; i++) sprintf(out + 2 * i, "%02x", sdmid[i]);
+	out[32] = '\0';
+
+	/* players that do not know their SDMID answer with zeros */
+	for (i = 0; (i < 16) && (!sdmid[i]); i++);
+	return (i < 16);
+}
+
+
+int device_probe(njb_t *player, char *out) {
+	int r;
+
+	if ((!player) || (NJB_Open(player) == -1)) return 0;
+	r = device_serial(player, out);
+	NJB_Close(player);
+	return r;
+}
+
+
+int device_matches(const struct device_id *id, const char *name) {
+	size_t l;
+
+	if ((!id) || (!name) || (!*name)) return 0;
+	if ((id->path[0]) && (!strcmp(id->path, name))) return 1;
+
+	/* a prefix of the serial number must be long enough not to be a USB path */
+	l = strlen(name);
+	if ((!id->serial[0]) || (l < 4) || (l > _DEVICE_SERIAL_LEN - 1)) return 0;
+	return !strncasecmp(id->serial, name, l);
+}
+
+
+void device_cache_init(struct device_cache *c) {
+	c->ids = 0;
+	c->n = 0;
+	c->size = 0;
+	c->changed = 0;
+}
+
+
+int device_cache_load(struct device_cache *c) {
+	char line[_DEVICE_PATH_LEN + _DEVICE_SERIAL_LEN + 2];
+	char *path, *serial;
+	FILE *f;
+	int n = 0;
+
+	if (!(path = config_file_path(_DEVICE_FILE))) return 0;
+	f = fopen(path, "r");
+	free(path);
+	if (!f) return 0;
+
+	/* every line holds the serial number and the USB path */
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = '\0';
+		if (!(path = strchr(line, '\t'))) continue;
+		*path++ = '\0';
+		serial = line;
+
+		if ((strlen(serial) != _DEVICE_SERIAL_LEN - 1) || (strlen(path) >= _DEVICE_PATH_LEN)) continue;
+		if (device_cache_set(c, path, serial)) n++;
+	}
+
+	fclose(f);
+	c->changed = 0;
+	return n;
+}
+
+
+int device_cache_save(struct device_cache *c) {
+	char *path, *tmp_path;
+	FILE *out;
+	unsigned int i;
+	size_t l;
+
+	if ((!c) || (!c->changed)) return 1;
+	if (!(path = config_file_path(_DEVICE_FILE))) return 0;
+
+	l = strlen(path) + 5;
+	if (!(tmp_path = (char*)malloc(sizeof(char[l])))) {
+		free(path);
+		return 0;
+	}
+	snprintf(tmp_path, l, "%s.new", path);
+
+	if (!(out = fopen(tmp_path, "w"))) {
+		free(tmp_path);
+		free(path);
+		return 0;
+	}
+	for (i = 0; i < c->n; i++) fprintf(out, "%s\t%s\n", c->ids[i].serial, c->ids[i].path);
+
+	/* rename() replaces the old file atomically */
+	l = ((fclose(out) == 0) && (rename(tmp_path, path) == 0));
+	if (l) c->changed = 0;
+
+	free(tmp_path);
+	free(path);
+	return l;
+}
+
+
+const char* device_cache_serial(struct device_cache *c, const char *path) {
+	unsigned int i;
+
+	if ((!c) || (!path)) return 0;
+	for (i = 0; i < c->n; i++) {
+		if (!strcmp(c->ids[i].path, path)) return c->ids[i].serial;
+	}
+	return 0;
+}
+
+
+int device_cache_set(struct device_cache *c, const char *path, const char *serial) {
+	struct device_id *ids;
+	unsigned int i;
+
+	if ((!c) || (!path) || (!serial) || (!*path) || (strlen(path) >= _DEVICE_PATH_LEN)) return 0;
+	if ((*serial) && (device_cache_serial(c, path)) && (!strcmp(device_cache_serial(c, path), serial))) {
+		return 1;
+	}
+
+	/* a serial number is only found at one path, so older entries go */
+	for (i = 0; i < c->n; ) {
+		if ((!strcmp(c->ids[i].path, path)) || (!strcmp(c->ids[i].serial, serial))) {
+			c->ids[i] = c->ids[--c->n];
+			c->changed = 1;
+		} else {
+			i++;
+		}
+	}
+	if (!*serial) return 1;
+
+	if (c->n == c->size) {
+		i = (c->size) ? c->size * 2 : 8;
+		if (!(ids = (struct device_id*)realloc(c->ids, i * sizeof(struct device_id)))) return 0;
+		c->ids = ids;
+		c->size = i;
+	}
+
+	snprintf(c->ids[c->n].path, _DEVICE_PATH_LEN, "%s", path);
+	snprintf(c->ids[c->n].serial, _DEVICE_SERIAL_LEN, "%s", serial);
+	c->n++;
+	c->changed = 1;
+	return 1;
+}
+
+
+void device_cache_free(struct device_cache *c) {
+	if (!c) return;
+	free(c->ids);
+	device_cache_init(c);
+}
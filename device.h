@@ -0,0 +1,130 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * device.h - header file for the identity of players
+ *
+ * This file provides the prototypes and structures that identify a player
+ * by hardware instead of by its owner string and free space. Every player
+ * is known by two things:
+ *
+ *   - its USB path (bus/device), which libnjb knows after the discovery,
+ *     so it costs nothing, but which changes when the player is plugged
+ *     into another port
+ *   - its serial number, the SDMID of the player as 32 hex digits, which
+ *     never changes, but has to be read from the player (it needs to be
+ *     opened, but not captured)
+ *
+ * The serial numbers that have been read are cached by USB path in
+ * $HOME/.zencp/devices, so selecting a player usually does not touch any
+ * other player. A cached serial number is checked again once the player
+ * has been captured.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_DEVICE_H
+#define __ZENCP_DEVICE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <libnjb.h>
+
+#include "misc.h"
+
+/* the name of the cache within $HOME/.zencp */
+#define _DEVICE_FILE "devices"
+
+/* the length of a serial number (16 bytes SDMID as hex) and of a USB path */
+#define _DEVICE_SERIAL_LEN 33
+#define _DEVICE_PATH_LEN 64
+
+/**
+ * The identity of a player.
+ */
+struct device_id {
+	char path[_DEVICE_PATH_LEN];		/* the USB path, e.g. "001/004" */
+	char serial[_DEVICE_SERIAL_LEN];	/* the serial number, "" if unknown */
+};
+
+/**
+ * The cache of serial numbers by USB path.
+ */
+struct device_cache {
+	struct device_id *ids;
+	unsigned int n;			/* the number of entries */
+	unsigned int size;		/* the number of allocated entries */
+	int changed;			/* the cache has to be saved */
+};
+
+/**
+ * device_path() writes the USB path of a discovered player to out, which has
+ * room for _DEVICE_PATH_LEN characters. It does not talk to the player. It
+ * returns 1 on success and 0 if libnjb does not know the USB device or its path
+ * does not fit.
+ */
+int		device_path(njb_t *player, char *out);
+
+/**
+ * device_serial() writes the serial number of a player that has been opened
+ * (see player_lock()) to out, which has room for _DEVICE_SERIAL_LEN characters.
+ * It returns 1 on success and 0 otherwise.
+ */
+int		device_serial(njb_t *player, char *out);
+
+/**
+ * device_probe() reads the serial number of a discovered player that is not
+ * open: it is opened, asked for its serial number and closed again, without
+ * capturing it. It returns 1 on success and 0 otherwise.
+ */
+int		device_probe(njb_t *player, char *out);
+
+/**
+ * device_matches() returns 1 if name (as given to -d) names the player id: name
+ * is either the USB path or the serial number or a prefix of it (case does not
+ * matter). It returns 0 otherwise.
+ */
+int		device_matches(const struct device_id *id, const char *name);
+
+/**
+ * device_cache_init() sets up an empty cache.
+ */
+void		device_cache_init(struct device_cache *c);
+
+/**
+ * device_cache_load() reads the cache from $HOME/.zencp/devices. It returns the
+ * number of entries read.
+ */
+int		device_cache_load(struct device_cache *c);
+
+/**
+ * device_cache_save() writes the cache back if it has changed. It returns 1 on
+ * success and 0 otherwise.
+ */
+int		device_cache_save(struct device_cache *c);
+
+/**
+ * device_cache_serial() returns the cached serial number of the player at the
+ * USB path or NULL.
+ */
+const char*	device_cache_serial(struct device_cache *c, const char *path);
+
+/**
+ * device_cache_set() caches serial for the player at the USB path. An empty
+ * serial removes the entry. It returns 1 on success and 0 if there was no memory
+ * left or the path is empty or longer than _DEVICE_PATH_LEN - 1 characters.
+ */
+int		device_cache_set(struct device_cache *c, const char *path, const char *serial);
+
+/**
+ * device_cache_free() frees all entries of the cache.
+ */
+void		device_cache_free(struct device_cache *c);
+
+#endif
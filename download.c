@@ -0,0 +1,189 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * download.c - implementation file for fetching tracks from the player
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+/* F_SETPIPE_SZ is only known with the GNU extensions */
+#define _GNU_SOURCE
+
+#include "download.h"
+
+/**
+ * What the writer thread of one track needs.
+ */
+struct download_writer {
+	int in;				/* the end of the pipe libnjb writes to */
+	int out;			/* the file */
+	unsigned long long bytes;	/* the bytes that have been read from the pipe */
+	int error;			/* the file could not be written */
+};
+
+
+/**
+ * download_writer() copies everything that comes through the pipe to the file.
+ * If the file cannot be written, the pipe is still emptied so that libnjb does
+ * not block.
+ */
+static void* download_writer(void *arg) {
+	struct download_writer *w = (struct download_writer*)arg;
+	char buffer[_DOWNLOAD_BUFFER];
+	ssize_t n, k, done;
+
+	for (;;) {
+		if ((n = read(w->in, buffer, sizeof(buffer))) < 0) {
+			if (errno == EINTR) continue;
+			w->error = 1;
+			break;
+		}
+		if (n == 0) break;	/* the track is complete */
+		w->bytes += n;
+
+		for (done = 0; (!w->error) && (done < n); done += k) {
+			if ((k = write(w->out, buffer + done, n - done)) < 0) {
+				if (errno == EINTR) {
+					k = 0;
+					continue;
+				}
+				w->error = 1;
+			}
+		}
+	}
+	return 0;
+}
+
+
+/**
+ * download_name() copies text to out (which has room for _DOWNLOAD_NAME_LEN + 1
+ * characters) so that it can be used as the name of a file: slashes and control
+ * characters are replaced and a leading dot as well, so that there are neither
+ * hidden files nor "..". An empty text is replaced by fallback, which may be NULL.
+ * It returns the length of the name.
+ */
+static size_t download_name(char *out, const char *text, const char *fallback) {
+	size_t l = 0;
+
+	if ((!text) || (!*text)) text = (fallback) ? fallback : "";
+
+	for (; (*text) && (l < _DOWNLOAD_NAME_LEN); text++, l++) {
+		out[l] = ((*text == '/') || ((unsigned char)*text < 32) || ((!l) && (*text == '.'))) ? '_' : *text;
+	}
+
+	/* a name that is cut must not end within a UTF-8 character or with a blank:
+	 * if the cut is before a continuation byte, the bytes of that character that
+	 * have been copied go, down to its lead byte */
+	if (((unsigned char)*text & 0xc0) == 0x80) {
+		while ((l) && (((unsigned char)out[l - 1] & 0xc0) == 0x80)) l--;
+		if (l) l--;
+	}
+	while ((l) && (out[l - 1] == ' ')) l--;
+	out[l] = '\0';
+	return l;
+}
+
+
+int download_path(const char *dir, const s_id3_tag *tag, char *out, size_t len) {
+	char artist[_DOWNLOAD_NAME_LEN + 1], album[_DOWNLOAD_NAME_LEN + 1], title[_DOWNLOAD_NAME_LEN + 1];
+	int n;
+
+	if ((!tag) || (!out)) return 0;
+	if ((!dir) || (!*dir)) dir = ".";
+
+	download_name(artist, tag->artist, "Unknown Artist");
+	download_name(album, tag->album, "Unknown Album");
+	if (!download_name(title, tag->title, 0)) snprintf(title, sizeof(title), "Track %u", tag->trackid);
+
+	if (tag->trackno) {
+		n = snprintf(out, len, "%s/%s/%s/%02u %s.mp3", dir, artist, album, tag->trackno, title);
+	} else {
+		n = snprintf(out, len, "%s/%s/%s/%s.mp3", dir, artist, album, title);
+	}
+	return (n >= 0) && ((size_t)n < len);
+}
+
+
+/**
+ * download_mkdirs() creates the directories of path that do not exist yet. It
+ * returns 1 on success and 0 otherwise.
+ */
+static int download_mkdirs(const char *path) {
+	char *dir, *p;
+	int r = 1;
+
+	if (!(dir = new_string(path))) return 0;
+
+	for (p = strchr(dir + 1, '/'); (r) && (p); p = strchr(p + 1, '/')) {
+		*p = '\0';
+		if ((mkdir(dir, 0755)) && (errno != EEXIST)) r = 0;
+		*p = '/';
+	}
+
+	free(dir);
+	return r;
+}
+
+
+int download_track(njb_t *player, s_id3_tag *tag, const char *path, char id3v1,
+		   NJB_Xfer_Callback *progress, void *data) {
+	struct download_writer w;
+	pthread_t tid;
+	char *tmp_path;
+	size_t l;
+	int fds[2], r;
+
+	if ((!player) || (!tag) || (!path) || (!download_mkdirs(path))) return 0;
+
+	l = strlen(path) + 6;
+	if (!(tmp_path = (char*)malloc(sizeof(char[l])))) return 0;
+	snprintf(tmp_path, l, "%s.part", path);
+
+	if ((w.out = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		free(tmp_path);
+		return 0;
+	}
+	if (pipe(fds)) {
+		close(w.out);
+		unlink(tmp_path);
+		free(tmp_path);
+		return 0;
+	}
+#ifdef F_SETPIPE_SZ
+	/* the larger the pipe, the longer the disk may take without stopping the player */
+	fcntl(fds[1], F_SETPIPE_SZ, _DOWNLOAD_PIPE);
+#endif
+
+	w.in = fds[0];
+	w.bytes = 0;
+	w.error = 0;
+	if (pthread_create(&tid, 0, download_writer, &w)) {
+		close(fds[0]);
+		close(fds[1]);
+		close(w.out);
+		unlink(tmp_path);
+		free(tmp_path);
+		return 0;
+	}
+
+	r = player_get_track_fd(player, tag, fds[1], progress, data);
+	close(fds[1]);			/* the writer sees the end of the track */
+	pthread_join(tid, 0);
+	close(fds[0]);
+
+	r = (r) && (!w.error) && ((!tag->size) || (w.bytes == tag->size));
+	if (close(w.out)) r = 0;
+
+	/* the tags of the player are the ones the user sees there; a track that
+	 * cannot be tagged (it may not be an MP3 file) is kept anyway */
+	if (r) id3_write_tags(tmp_path, tag, id3v1);
+	if ((r) && (rename(tmp_path, path))) r = 0;
+	if (!r) unlink(tmp_path);
+
+	free(tmp_path);
+	return r;
+}
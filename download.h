@@ -0,0 +1,69 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * download.h - header file for fetching tracks from the player
+ *
+ * This file provides the prototypes that are needed to copy tracks from
+ * the player back to the local disk (-G), e.g. for a backup. A track is
+ * laid out below the target directory as
+ *
+ *   Artist/Album/NN Title.mp3
+ *
+ * and gets the tags the player knows about it. libnjb writes the track
+ * into a pipe that is emptied into the file by a writer thread, so the
+ * player is not kept waiting while the disk is busy: the pipe and the
+ * buffer of the writer are the two buffers between USB and disk.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_DOWNLOAD_H
+#define __ZENCP_DOWNLOAD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <libnjb.h>
+
+#include "id3.h"
+#include "player.h"
+#include "misc.h"
+
+/* the size of the buffer of the writer thread */
+#define _DOWNLOAD_BUFFER (64 * 1024)
+
+/* the size the pipe is grown to, where the system allows it */
+#define _DOWNLOAD_PIPE (1024 * 1024)
+
+/* the longest name of a directory or file that is made from a tag */
+#define _DOWNLOAD_NAME_LEN 120
+
+/**
+ * download_path() writes the path of the track tag below the directory dir to
+ * out, which has room for len characters. Characters that may not appear in a
+ * file name are replaced. It returns 1 on success and 0 if the path is too long.
+ */
+int	download_path(const char *dir, const s_id3_tag *tag, char *out, size_t len);
+
+/**
+ * download_track() fetches the track tag from the player into the file path,
+ * whose directories are created if needed. The file is written under a
+ * temporary name and only renamed to path once it is complete and its tags
+ * (ID3v1 if id3v1 is set, ID3v2 otherwise) have been written. If progress is
+ * non-NULL, it is called with data as the track comes in. It returns 1 on
+ * success and 0 otherwise.
+ */
+int	download_track(njb_t *player, s_id3_tag *tag, const char *path, char id3v1,
+		       NJB_Xfer_Callback *progress, void *data);
+
+#endif
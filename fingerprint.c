@@ -0,0 +1,255 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * fingerprint.c - implementation file for audio fingerprints
+ *
+ * This file provides the implementation of XXH64 (see the specification at
+ * https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md) and of
+ * the search for the audio data within an MP3 file.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "fingerprint.h"
+
+/* the primes of XXH64 */
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+#define PRIME4 0x85EBCA77C2B2AE63ULL
+#define PRIME5 0x27D4EB2F165667C5ULL
+
+#define ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/**
+ * read64() and read32() read little endian numbers from p, no matter what
+ * the byte order and alignment of the machine is.
+ */
+static unsigned long long read64(const unsigned char *p) {
+	unsigned long long v;
+	memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	v = __builtin_bswap64(v);
+#endif
+	return v;
+}
+
+
+static unsigned int read32(const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+
+/**
+ * fingerprint_round() mixes 8 bytes of input into one lane.
+ */
+static unsigned long long fingerprint_round(unsigned long long acc, unsigned long long input) {
+	acc += input * PRIME2;
+	acc = ROTL(acc, 31);
+	return acc * PRIME1;
+}
+
+
+/**
+ * fingerprint_merge() mixes a lane into the final hash value.
+ */
+static unsigned long long fingerprint_merge(unsigned long long h, unsigned long long v) {
+	h ^= fingerprint_round(0, v);
+	return h * PRIME1 + PRIME4;
+}
+
+
+void fingerprint_init(struct fingerprint_state *s, unsigned long long seed) {
+	if (!s) return;
+
+	s->v[0] = seed + PRIME1 + PRIME2;
+	s->v[1] = seed + PRIME2;
+	s->v[2] = seed;
+	s->v[3] = seed - PRIME1;
+	s->length = 0;
+	s->memsize = 0;
+	s->seed = seed;
+}
+
+
+void fingerprint_update(struct fingerprint_state *s, const void *data, size_t len) {
+	const unsigned char *p = (const unsigned char*)data;
+	const unsigned char *end = p + len;
+	unsigned long long v0, v1, v2, v3;
+	unsigned int fill;
+
+	if ((!s) || (!data)) return;
+	s->length += len;
+
+	/* not even one round: just keep the bytes */
+	if (s->memsize + len < 32) {
+		memcpy(s->mem + s->memsize, p, len);
+		s->memsize += len;
+		return;
+	}
+
+	/* complete the round that has been started by the last call */
+	if (s->memsize) {
+		fill = 32 - s->memsize;
+		memcpy(s->mem + s->memsize, p, fill);
+		s->v[0] = fingerprint_round(s->v[0], read64(s->mem));
+		s->v[1] = fingerprint_round(s->v[1], read64(s->mem + 8));
+		s->v[2] = fingerprint_round(s->v[2], read64(s->mem + 16));
+		s->v[3] = fingerprint_round(s->v[3], read64(s->mem + 24));
+		p += fill;
+		s->memsize = 0;
+	}
+
+	/* the lanes are kept in local variables, so the compiler can keep them
+	 * in registers and interleave the four independent rounds */
+	v0 = s->v[0];
+	v1 = s->v[1];
+	v2 = s->v[2];
+	v3 = s->v[3];
+	while (p + 32 <= end) {
+		v0 = fingerprint_round(v0, read64(p));
+		v1 = fingerprint_round(v1, read64(p + 8));
+		v2 = fingerprint_round(v2, read64(p + 16));
+		v3 = fingerprint_round(v3, read64(p + 24));
+		p += 32;
+	}
+	s->v[0] = v0;
+	s->v[1] = v1;
+	s->v[2] = v2;
+	s->v[3] = v3;
+
+	if (p < end) {
+		memcpy(s->mem, p, end - p);
+		s->memsize = end - p;
+	}
+}
+
+
+unsigned long long fingerprint_digest(const struct fingerprint_state *s) {
+	const unsigned char *p, *end;
+	unsigned long long h;
+
+	if (!s) return 0;
+
+	if (s->length >= 32) {
+		h = ROTL(s->v[0], 1) + ROTL(s->v[1], 7) + ROTL(s->v[2], 12) + ROTL(s->v[3], 18);
+		h = fingerprint_merge(h, s->v[0]);
+		h = fingerprint_merge(h, s->v[1]);
+		h = fingerprint_merge(h, s->v[2]);
+		h = fingerprint_merge(h, s->v[3]);
+	} else {
+		h = s->seed + PRIME5;
+	}
+	h += s->length;
+
+	/* the rest that did not fill a round */
+	p = s->mem;
+	end = p + s->memsize;
+	for (; p + 8 <= end; p += 8) {
+		h ^= fingerprint_round(0, read64(p));
+		h = ROTL(h, 27) * PRIME1 + PRIME4;
+	}
+	if (p + 4 <= end) {
+		h ^= (unsigned long long)read32(p) * PRIME1;
+		h = ROTL(h, 23) * PRIME2 + PRIME3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= (*p) * PRIME5;
+		h = ROTL(h, 11) * PRIME1;
+	}
+
+	/* the avalanche */
+	h ^= h >> 33;
+	h *= PRIME2;
+	h ^= h >> 29;
+	h *= PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+
+/**
+ * fingerprint_syncsafe() returns the syncsafe integer (7 bits per byte) that
+ * is stored in the four bytes at p.
+ */
+static off_t fingerprint_syncsafe(const unsigned char *p) {
+	return ((off_t)(p[0] & 0x7f) << 21) | ((p[1] & 0x7f) << 14) | ((p[2] & 0x7f) << 7) | (p[3] & 0x7f);
+}
+
+
+int fingerprint_payload(int fd, off_t size, off_t *start, off_t *end) {
+	unsigned char buff[10];
+
+	if ((fd < 0) || (!start) || (!end)) return 0;
+	*start = 0;
+	*end = size;
+
+	/* ID3v2 tags at the beginning, there may be more than one; bit 4 of the
+	 * flags announces a footer of another 10 bytes */
+	while ((*start + 10 <= *end) && (pread(fd, buff, 10, *start) == 10) &&
+	       (!memcmp(buff, "ID3", 3)) && (buff[3] != 0xff) && (buff[4] != 0xff)) {
+		*start += 10 + fingerprint_syncsafe(buff + 6) + ((buff[5] & 0x10) ? 10 : 0);
+	}
+
+	/* the ID3v1 tag in the last 128 bytes */
+	if ((*end - 128 >= *start) && (pread(fd, buff, 3, *end - 128) == 3) && (!memcmp(buff, "TAG", 3))) {
+		*end -= 128;
+	}
+
+	/* an ID3v2 tag at the end is found by its footer */
+	if ((*end - 10 >= *start) && (pread(fd, buff, 10, *end - 10) == 10) && (!memcmp(buff, "3DI", 3))) {
+		*end -= 20 + fingerprint_syncsafe(buff + 6);
+	}
+
+	/* broken tags may point anywhere, in that case the whole file is hashed */
+	if ((*start > size) || (*end < *start)) {
+		*start = 0;
+		*end = size;
+	}
+	return 1;
+}
+
+
+int fingerprint_file(const char *filename, unsigned long long *hash) {
+	struct fingerprint_state s;
+	struct stat st;
+	unsigned char *buff;
+	off_t start, end;
+	ssize_t r;
+	size_t l;
+	int fd;
+
+	if ((!filename) || (!hash)) return 0;
+	if ((fd = open(filename, O_RDONLY)) < 0) return 0;
+
+	if ((fstat(fd, &st)) || (!fingerprint_payload(fd, st.st_size, &start, &end)) ||
+	    (!(buff = (unsigned char*)malloc(_FINGERPRINT_BUFFER_SIZE)))) {
+		close(fd);
+		return 0;
+	}
+
+	/* the whole file is read from front to back, so tell the kernel */
+#ifdef POSIX_FADV_SEQUENTIAL
+	posix_fadvise(fd, start, end - start, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	fingerprint_init(&s, 0);
+	while (start < end) {
+		l = (end - start > _FINGERPRINT_BUFFER_SIZE) ? _FINGERPRINT_BUFFER_SIZE : end - start;
+		if ((r = pread(fd, buff, l, start)) <= 0) break;
+		fingerprint_update(&s, buff, r);
+		start += r;
+	}
+
+	free(buff);
+	close(fd);
+	if (start < end) return 0;	/* the file could not be read completely */
+
+	*hash = fingerprint_digest(&s);
+	return 1;
+}
@@ -0,0 +1,82 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * fingerprint.h - header file for audio fingerprints
+ *
+ * This file provides the prototypes and structures that are needed to
+ * compute a fingerprint of the audio data of an MP3 file. Only the MPEG
+ * frames are hashed, the ID3v2 tags at the beginning or end and the ID3v1
+ * tag at the end of the file are left out. Retagging a file does therefore
+ * not change its fingerprint, while two different songs with the same tags
+ * have different fingerprints.
+ *
+ * The hash function is XXH64 by Yann Collet, which reads 32 bytes per round
+ * in four independent lanes and is limited by the speed of the disk rather
+ * than by the CPU.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_FINGERPRINT_H
+#define __ZENCP_FINGERPRINT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "misc.h"
+
+/* the size of the buffer files are read with */
+#define _FINGERPRINT_BUFFER_SIZE (256 * 1024)
+
+/**
+ * The state of an XXH64 computation over data that arrives in pieces.
+ */
+struct fingerprint_state {
+	unsigned long long v[4];	/* the four lanes */
+	unsigned long long length;	/* the number of bytes hashed so far */
+	unsigned char mem[32];		/* the bytes that did not fill a round yet */
+	unsigned int memsize;		/* the number of bytes in mem */
+	unsigned long long seed;
+};
+
+/**
+ * fingerprint_init() starts a new XXH64 computation with the given seed.
+ */
+void			fingerprint_init(struct fingerprint_state *s, unsigned long long seed);
+
+/**
+ * fingerprint_update() adds len bytes of data to the computation.
+ */
+void			fingerprint_update(struct fingerprint_state *s, const void *data, size_t len);
+
+/**
+ * fingerprint_digest() returns the hash value of all data that has been added.
+ * The state is not changed, so more data may be added afterwards.
+ */
+unsigned long long	fingerprint_digest(const struct fingerprint_state *s);
+
+/**
+ * fingerprint_payload() finds the audio data in the open file fd of the given
+ * size and stores its first byte in start and the byte after its end in end.
+ * It returns 1 on success and 0 if the file could not be read.
+ */
+int			fingerprint_payload(int fd, off_t size, off_t *start, off_t *end);
+
+/**
+ * fingerprint_file() computes the fingerprint of the audio data of the file
+ * filename and stores it in hash. It returns 1 on success and 0 if the file
+ * could not be read. It does not use any global state, so it may be called by
+ * several threads at once.
+ */
+int			fingerprint_file(const char *filename, unsigned long long *hash);
+
+#endif
@@ -0,0 +1,276 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * genre.cpp - implementation file for ID3 genres
+ *
+ * This file provides the implementation of the genre resolver. The IDs
+ * are found by a perfect hash table (hash and displace) that the compiler
+ * builds from the list of names: every name falls into one of BUCKETS
+ * buckets by its hash value, and for every bucket a seed is chosen so that
+ * all names of the bucket land in empty slots when they are hashed again
+ * with that seed. Looking up a name therefore takes two hash values and a
+ * single comparison.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include <string.h>
+
+#include "genre.h"
+
+namespace {
+
+	/* the extended Winamp genre list, the index is the ID */
+	constexpr const char *names[_GENRE_COUNT] = {
+		"Blues", "Classic Rock", "Country", "Dance", "Disco", "Funk", "Grunge",
+		"Hip-Hop", "Jazz", "Metal", "New Age", "Oldies", "Other", "Pop", "R&B",
+		"Rap", "Reggae", "Rock", "Techno", "Industrial", "Alternative", "Ska",
+		"Death Metal", "Pranks", "Soundtrack", "Euro-Techno", "Ambient",
+		"Trip-Hop", "Vocal", "Jazz+Funk", "Fusion", "Trance", "Classical",
+		"Instrumental", "Acid", "House", "Game", "Sound Clip", "Gospel", "Noise",
+		"AlternRock", "Bass", "Soul", "Punk", "Space", "Meditative",
+		"Instrumental Pop", "Instrumental Rock", "Ethnic", "Gothic", "Darkwave",
+		"Techno-Industrial", "Electronic", "Pop-Folk", "Eurodance", "Dream",
+		"Southern Rock", "Comedy", "Cult", "Gangsta", "Top 40", "Christian Rap",
+		"Pop/Funk", "Jungle", "Native American", "Cabaret", "New Wave",
+		"Psychedelic", "Rave", "Showtunes", "Trailer", "Lo-Fi", "Tribal",
+		"Acid Punk", "Acid Jazz", "Polka", "Retro", "Musical", "Rock & Roll",
+		"Hard Rock",
+		/* the Winamp extensions */
+		"Folk", "Folk-Rock", "National Folk", "Swing", "Fast Fusion", "Bebop",
+		"Latin", "Revival", "Celtic", "Bluegrass", "Avantgarde", "Gothic Rock",
+		"Progressive Rock", "Psychedelic Rock", "Symphonic Rock", "Slow Rock",
+		"Big Band", "Chorus", "Easy Listening", "Acoustic", "Humour", "Speech",
+		"Chanson", "Opera", "Chamber Music", "Sonata", "Symphony", "Booty Bass",
+		"Primus", "Porn Groove", "Satire", "Slow Jam", "Club", "Tango", "Samba",
+		"Folklore", "Ballad", "Power Ballad", "Rhythmic Soul", "Freestyle",
+		"Duet", "Punk Rock", "Drum Solo", "A Cappella", "Euro-House",
+		"Dance Hall", "Goa", "Drum & Bass", "Club-House", "Hardcore", "Terror",
+		"Indie", "BritPop", "Afro-Punk", "Polsk Punk", "Beat",
+		"Christian Gangsta Rap", "Heavy Metal", "Black Metal", "Crossover",
+		"Contemporary Christian", "Christian Rock", "Merengue", "Salsa",
+		"Thrash Metal", "Anime", "JPop", "Synthpop", "Abstract", "Art Rock",
+		"Baroque", "Bhangra", "Big Beat", "Breakbeat", "Chillout", "Downtempo",
+		"Dub", "EBM", "Eclectic", "Electro", "Electroclash", "Emo",
+		"Experimental", "Garage", "Global", "IDM", "Illbient", "Industro-Goth",
+		"Jam Band", "Krautrock", "Leftfield", "Lounge", "Math Rock",
+		"New Romantic", "Nu-Breakz", "Post-Punk", "Post-Rock", "Psytrance",
+		"Shoegaze", "Space Rock", "Trop Rock", "World Music", "Neoclassical",
+		"Audiobook", "Audio Theatre", "Neue Deutsche Welle", "Podcast",
+		"Indie Rock", "G-Funk", "Dubstep", "Garage Rock", "Psybient"
+	};
+
+	/* the size of the hash table and the number of buckets */
+	constexpr unsigned int SLOTS = 256;
+	constexpr unsigned int BUCKETS = 64;
+
+	constexpr char lower(char c) {
+		return ((c >= 'A') && (c <= 'Z')) ? c + ('a' - 'A') : c;
+	}
+
+	constexpr size_t length(const char *s) {
+		size_t l = 0;
+		while (s[l]) l++;
+		return l;
+	}
+
+	/**
+	 * hash() is FNV-1a over the lower case characters of s, followed by a
+	 * finalizer so that the low bits depend on all characters.
+	 */
+	constexpr unsigned int hash(const char *s, size_t len, unsigned int seed) {
+		unsigned int h = 2166136261u ^ (seed * 0x9e3779b9u);
+
+		for (size_t i = 0; i < len; i++) {
+			h ^= (unsigned char)lower(s[i]);
+			h *= 16777619u;
+		}
+		h ^= h >> 15;
+		h *= 0x2c1b3c6du;
+		h ^= h >> 12;
+		return h;
+	}
+
+	/**
+	 * The perfect hash table: the seed of every bucket and the ID in every
+	 * slot (-1 for empty slots).
+	 */
+	struct table {
+		unsigned short seed[BUCKETS];
+		short slot[SLOTS];
+	};
+
+	/**
+	 * build() chooses the seeds, starting with the largest bucket while the
+	 * table is still empty.
+	 */
+	constexpr table build() {
+		table t{};
+		unsigned int size[BUCKETS] = {};
+		bool done[BUCKETS] = {};
+		short placed[_GENRE_COUNT] = {};
+		unsigned int i = 0, k = 0, b = 0, n = 0, s = 0, seed = 0;
+		bool fits = false;
+
+		for (s = 0; s < SLOTS; s++) t.slot[s] = -1;
+		for (i = 0; i < _GENRE_COUNT; i++) size[hash(names[i], length(names[i]), 0) % BUCKETS]++;
+
+		for (k = 0; k < BUCKETS; k++) {
+			b = BUCKETS;
+			for (i = 0; i < BUCKETS; i++) {
+				if ((!done[i]) && ((b == BUCKETS) || (size[i] > size[b]))) b = i;
+			}
+			done[b] = true;
+
+			for (seed = 1; ; seed++) {
+				/* put the names of the bucket into the table, take them out
+				 * again if one of them does not fit */
+				fits = true;
+				n = 0;
+				for (i = 0; (i < _GENRE_COUNT) && (fits); i++) {
+					if (hash(names[i], length(names[i]), 0) % BUCKETS != b) continue;
+					s = hash(names[i], length(names[i]), seed) % SLOTS;
+					if (t.slot[s] >= 0) {
+						fits = false;
+					} else {
+						t.slot[s] = i;
+						placed[n++] = s;
+					}
+				}
+				if (fits) break;
+				while (n) t.slot[placed[--n]] = -1;
+			}
+			t.seed[b] = seed;
+		}
+		return t;
+	}
+
+	constexpr table genres = build();
+
+	/**
+	 * lookup() returns the ID of the genre with the name given by the len
+	 * characters at s or _GENRE_NONE.
+	 */
+	int lookup(const char *s, size_t len) {
+		unsigned int b = hash(s, len, 0) % BUCKETS;
+		int id = genres.slot[hash(s, len, genres.seed[b]) % SLOTS];
+
+		if ((id < 0) || (length(names[id]) != len) || (strncasecmp(names[id], s, len))) return _GENRE_NONE;
+		return id;
+	}
+
+	/**
+	 * number() returns the ID that is written as the decimal number given by the
+	 * len characters at s or _GENRE_NONE if it is not a number of a genre.
+	 */
+	int number(const char *s, size_t len) {
+		int id = 0;
+
+		if ((!len) || (len > 3)) return _GENRE_NONE;
+		for (size_t i = 0; i < len; i++) {
+			if ((s[i] < '0') || (s[i] > '9')) return _GENRE_NONE;
+			id = id * 10 + (s[i] - '0');
+		}
+		return (id < _GENRE_COUNT) ? id : _GENRE_NONE;
+	}
+
+	/**
+	 * special() returns the name of the ID3v2 keywords RX and CR given by the
+	 * len characters at s or NULL.
+	 */
+	const char* special(const char *s, size_t len) {
+		if ((len == 2) && (!strncmp(s, "RX", 2))) return "Remix";
+		if ((len == 2) && (!strncmp(s, "CR", 2))) return "Cover";
+		return 0;
+	}
+
+	/**
+	 * copy() writes the len characters at s to out and returns the number of
+	 * characters written.
+	 */
+	size_t copy(const char *s, size_t len, char *out, size_t size) {
+		if (!size) return 0;
+		if (len >= size) len = size - 1;
+		memcpy(out, s, len);
+		out[len] = '\0';
+		return len;
+	}
+
+	/**
+	 * value() resolves a single value (the characters from p to e) of the
+	 * content type frame and returns the length of the name written to out or 0.
+	 */
+	size_t value(const char *p, const char *e, char *out, size_t size) {
+		const char *ref = 0;	/* the name of the first reference */
+		const char *q, *name;
+		int id;
+
+		while ((p < e) && (*p == ' ')) p++;
+
+		/* the references in parentheses; "((" starts a name */
+		while ((p < e) && (*p == '(') && (p + 1 < e) && (p[1] != '(')) {
+			for (q = p + 1; (q < e) && (*q != ')'); q++);
+			if (q == e) break;		/* not a reference, but a name */
+
+			if (!ref) {
+				if ((id = number(p + 1, q - p - 1)) != _GENRE_NONE) {
+					ref = names[id];
+				} else {
+					ref = special(p + 1, q - p - 1);
+				}
+			}
+			p = q + 1;
+		}
+
+		/* the refinement, it is more specific than the reference */
+		while ((p < e) && (*p == ' ')) p++;
+		while ((e > p) && (e[-1] == ' ')) e--;
+		if ((e - p >= 2) && (p[0] == '(') && (p[1] == '(')) p++;
+
+		if (p < e) {
+			if ((id = number(p, e - p)) != _GENRE_NONE) {
+				name = names[id];
+			} else if ((id = lookup(p, e - p)) != _GENRE_NONE) {
+				name = names[id];
+			} else if (!(name = special(p, e - p))) {
+				return copy(p, e - p, out, size);	/* a genre we do not know */
+			}
+			return copy(name, length(name), out, size);
+		}
+
+		if (ref) return copy(ref, length(ref), out, size);
+		return 0;
+	}
+}
+
+
+const char* genre_name(int id) {
+	if ((id < 0) || (id >= _GENRE_COUNT)) return 0;
+	return names[id];
+}
+
+
+int genre_id(const char *name) {
+	if (!name) return _GENRE_NONE;
+	return lookup(name, length(name));
+}
+
+
+size_t genre_parse(const char *text, size_t len, char *out, size_t size) {
+	const char *p, *e, *end;
+	size_t l;
+
+	if ((!text) || (!out) || (!size)) return 0;
+	out[0] = '\0';
+
+	/* ID3v2.4 separates several values by '\0', the first one that resolves wins */
+	for (p = text, end = text + len; p < end; p = e + 1) {
+		for (e = p; (e < end) && (*e); e++);
+		if ((l = value(p, e, out, size))) return l;
+	}
+	return 0;
+}
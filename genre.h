@@ -0,0 +1,72 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * genre.h - header file for ID3 genres
+ *
+ * This file provides the prototypes of the genre resolver. It knows the
+ * extended Winamp list of genres (0 to 191, the first 80 of them are the
+ * ones of ID3v1) and understands all the ways a genre can be written into
+ * the content type frame (TCON) of an ID3v2 tag:
+ *
+ *   (17)           a reference to genre 17 (ID3v1 and ID3v2.3)
+ *   (17)Rock       a reference followed by a refinement (ID3v2.3)
+ *   (4)Eurodisco   the refinement is more specific than the reference
+ *   ((Foo)         a genre that starts with '(' (ID3v2.3)
+ *   (RX), (CR)     Remix and Cover (ID3v2.3)
+ *   17, RX, CR     the same without parentheses (ID3v2.4)
+ *   Rock           a genre given by its name
+ *
+ * ID3v2.4 separates several genres by '\0', of which the first one that
+ * means something is used.
+ *
+ * The resolver is implemented in C++ (genre.cpp), as the perfect hash
+ * table for the names is generated by the compiler.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_GENRE_H
+#define __ZENCP_GENRE_H
+
+#include <stddef.h>
+
+/* the number of known genres */
+#define _GENRE_COUNT 192
+
+/* the ID that is returned for unknown genres */
+#define _GENRE_NONE (-1)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * genre_name() returns the name of the genre with the given ID or NULL if
+	 * there is no such genre.
+	 */
+	const char*	genre_name(int id);
+
+	/**
+	 * genre_id() returns the ID of the genre with the given name (case does not
+	 * matter) or _GENRE_NONE if there is no such genre.
+	 */
+	int		genre_id(const char *name);
+
+	/**
+	 * genre_parse() resolves the len bytes of the content type frame in text (see
+	 * above) and writes the name of the genre to out, which has room for size
+	 * characters. Known genres are written with their name from the list, all
+	 * others as they are. It returns the length of the name or 0 if text does
+	 * not contain a genre.
+	 */
+	size_t		genre_parse(const char *text, size_t len, char *out, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,12 +19,6 @@
 
 #include "id3.h"
 
-/**
- * make a real string from the _DEFAULT_STRING preprocessor constant
- */
-char default_tag[256] = _DEFAULT_STRING;
-
-
 ID3Tag* id3_link_file(const char *filename, char id3_v1) {
 	ID3Tag *t = ID3Tag_New();		/* allocate a new tag object (id3lib) */
 	if ((!filename) || (!t)) return 0;	/* if no filename was given or a 
@@ -54,155 +48,214 @@ size_t id3_get_file_size(const char *filename) {
 }
 
 
+void id3_context_init(struct id3_context *ctx, char id3v1) {
+	if (!ctx) return;
+
+	ctx->id3v1 = id3v1;
+	ctx->transient = 0;
+	ctx->copied = 0;
+	ctx->fill = _DEFAULT_STRING;
+	ctx->buff[0] = '\0';
+	ctx->big = 0;
+	ctx->big_size = 0;
+}
+
+
+void id3_context_free(struct id3_context *ctx) {
+	if (!ctx) return;
+
+	free(ctx->big);
+	ctx->big = 0;
+	ctx->big_size = 0;
+}
+
+
 /**
- * id3_get_frame_text() extracts the text information that is contained in an MP3 ID3 frame
- * and returns it as string. ID3 tags have the following structure:
+ * id3_read_frame() extracts the text information that is contained in an MP3 ID3 frame
+ * into a buffer of the context and returns it. The text is only valid until the next
+ * call with the same context. An empty string is returned if the frame does not
+ * contain text and NULL if no memory could be allocated. If len is not NULL, the
+ * length of the whole text is stored in it, which is longer than the string if the
+ * frame holds several values separated by '\0' (ID3v2.4). ID3 tags have the following
+ * structure:
  * MP3 file -> ID3 tag +> ID3 frame (artist) +> ID3 field (text)
  *                     |                     -> ID3 field (integer)
  *                     +> ID3 frame (title)  +> ID3 field (text)
  *                                           -  ID3 field (integer)
  *            ... and so on ...
  */
-const char* id3_get_frame_text(ID3Frame *frame) {
+static char* id3_read_frame(struct id3_context *ctx, ID3Frame *frame, size_t *len) {
 	ID3Field *field;
-	char *buff = 0;
-	size_t size = 0;
+	char *text = ctx->buff;
+	char *p;
+	size_t size = 0, l;
+
+	text[0] = '\0';
+	if (len) *len = 0;
+	if (!frame) return text;
 	
-	if (frame) {						/* if an ID3 frame was given... */
-		field = ID3Frame_GetField(frame, ID3FN_TEXT);	/* ... try to extract the text field */
-		
-		if (field) {					/* if the field is there */
-			size = 1 + ID3Field_Size(field);	/* determine the field size */
-			buff = (char*)malloc(sizeof(char[size]));	/* allocate a string */
-			ID3Field_GetASCII(field, buff, size);	/* and fill it with the field contents */
+	field = ID3Frame_GetField(frame, ID3FN_TEXT);	/* try to extract the text field */
+	if (!field) return text;
+
+	size = 1 + ID3Field_Size(field);		/* determine the field size */
+
+	/* only very long texts need the larger buffer, which is kept for the next one */
+	if (size > _ID3_MAX_LEN) {
+		if (size > ctx->big_size) {
+			if (!(p = (char*)realloc(ctx->big, sizeof(char[size])))) return 0;
+			ctx->big = p;
+			ctx->big_size = size;
 		}
+		text = ctx->big;
+		text[0] = '\0';
 	}
 
-        if ((!buff) || (strlen(buff) == 0)) buff = default_tag;	/* if the field was empty, return the 
-								   default value */
-	return buff;
+	l = ID3Field_GetASCII(field, text, size);	/* and fill it with the field contents */
+	if (len) *len = (l < size) ? l : size - 1;
+	return text;
+}
+
+
+/**
+ * id3_keep() returns the interned copy of s. A transient context does not add s
+ * to the string table, it returns a copy of its own if s is not interned yet and
+ * remembers that in copied.
+ */
+static const char* id3_keep(struct id3_context *ctx, const char *s) {
+	const char *r;
+
+	ctx->copied = 0;
+	if (!ctx->transient) return intern(s);
+	if ((r = intern_known(s))) return r;
+	if ((r = new_string(s))) ctx->copied = 1;
+	return r;
+}
+
+
+/**
+ * id3_get_frame_text() returns the interned text of a frame or the fill string if
+ * the frame is empty.
+ */
+static const char* id3_get_frame_text(struct id3_context *ctx, ID3Frame *frame) {
+	const char *text = id3_read_frame(ctx, frame, 0);
+
+	ctx->copied = 0;
+	if (!text) return 0;
+	return id3_keep(ctx, (strlen(text)) ? text : ctx->fill);
 }
 
 
-const char* id3_get_artist(ID3Tag *tag) {
+const char* id3_get_artist(struct id3_context *ctx, ID3Tag *tag) {
 	ID3Frame *frame; 
 	
+	if (!ctx) return 0;
+
 	/* extract the right frame for the artist */
 	if ((frame = ID3Tag_FindFrameWithID(tag, ID3FID_LEADARTIST)) ||
 		(frame = ID3Tag_FindFrameWithID(tag, ID3FID_BAND)) ||
 		(frame = ID3Tag_FindFrameWithID(tag, ID3FID_CONDUCTOR)) ||
 		(frame = ID3Tag_FindFrameWithID(tag, ID3FID_COMPOSER))	) {
 		
-		return id3_get_frame_text(frame);	/* and return the frame's text field */
+		return id3_get_frame_text(ctx, frame);	/* and return the frame's text field */
 	}
-	return default_tag;
+	return id3_keep(ctx, ctx->fill);
 }
 
 
-const char* id3_get_title(ID3Tag *tag) {
+const char* id3_get_title(struct id3_context *ctx, ID3Tag *tag) {
 	ID3Frame *frame;
 
+	if (!ctx) return 0;
+
 	/* extract the right frame for the title */
 	if ((frame = ID3Tag_FindFrameWithID(tag, ID3FID_TITLE))) {
-		return id3_get_frame_text(frame);	/* and return the frame's text field */
+		return id3_get_frame_text(ctx, frame);	/* and return the frame's text field */
 	}
-	return default_tag;
+	return id3_keep(ctx, ctx->fill);
 }
 
 
-const char* id3_get_album(ID3Tag *tag) {
+const char* id3_get_album(struct id3_context *ctx, ID3Tag *tag) {
 	ID3Frame *frame;
 
+	if (!ctx) return 0;
+
 	/* extract the right frame for the album */
 	if ((frame = ID3Tag_FindFrameWithID(tag, ID3FID_ALBUM))) {
-		return id3_get_frame_text(frame);	/* and return the frame's text field */
+		return id3_get_frame_text(ctx, frame);	/* and return the frame's text field */
 	}
-	return default_tag;
+	return id3_keep(ctx, ctx->fill);
 }
 
 
 /**
- * The genre description is not encoded in plain text into an ID3 tag. It is just a number
- * that is looked up in an array (ID3_v1_genre_description provided by id3lib). Unfortunately
- * this number is stored in the text field of that frame in this way: (42). Therefore, after
- * retrieving the text field in the usual way, the string must be parsed to the get the number
- * that is used for looking up the right genre description in the array.
+ * The genre is stored in the text field of the content type frame in one of several ways,
+ * e.g. as a reference to the ID3v1 list like (42), as a name or as both (see genre.h).
+ * After retrieving the text field in the usual way, genre_parse() finds out which genre
+ * is meant.
  */
-const char* id3_get_genre(ID3Tag *tag) {
+const char* id3_get_genre(struct id3_context *ctx, ID3Tag *tag) {
 	ID3Frame *frame;
-	char *buff = 0;
-	char ch_tmp[16];
-	unsigned int genre_id;
-	unsigned short i = 1;
+	const char *buff = 0;
+	char name[_ID3_MAX_LEN];
+	size_t len = 0;
+
+	if (!ctx) return 0;
 
 	/* extract the right frame for the genre */
 	if ((frame = ID3Tag_FindFrameWithID(tag, ID3FID_CONTENTTYPE))) {
-		buff = (char*)id3_get_frame_text(frame);	/* and return the frame's text field */
-	}
-
-	if (!buff) return default_tag;
-
-	/* if the first character is a '(' */
-	if (buff[0] == '(') {
-		/* copy all following number characters into ch_tmp until ')' is found */
-		while ((buff[i] != ')') && (buff[i] != '\0') && (is_digit(buff[i]))) {
-			ch_tmp[i-1] = buff[i];
-			i++;
-		}
-		ch_tmp[i-1] = '\0';	/* better put a null terminator in there */
-	} else {
-		return default_tag;
+		buff = id3_read_frame(ctx, frame, &len);	/* and read the frame's text field */
 	}
 
-	if (strlen(ch_tmp) == 0) return default_tag;
+	/* all values of the frame are passed, not only the first string */
+	if ((!buff) || (!genre_parse(buff, len, name, sizeof(name)))) return id3_keep(ctx, ctx->fill);
 
-	genre_id = (unsigned int)strtol(ch_tmp, 0, 10);	/* convert the number to an integer */
-	
-		/* if the number obtained is bigger than the number of know genre descriptions,
-		 * we will return the default string */
-	if (genre_id >= ID3_NR_OF_V1_GENRES) return default_tag;
-	
-	return ID3_v1_genre_description[genre_id];	/* return the right genre description */
+	return id3_keep(ctx, name);
 }
 
 
-const char *id3_get_syear(ID3Tag *tag) {
+const char *id3_get_syear(struct id3_context *ctx, ID3Tag *tag) {
 	ID3Frame *frame;
-	static char *buff = 0;
+	const char *buff = 0;
+
+	if (!ctx) return 0;
 
 	if ((frame = ID3Tag_FindFrameWithID(tag, ID3FID_YEAR))) {
-		buff = (char*)id3_get_frame_text(frame);
+		buff = id3_read_frame(ctx, frame, 0);
 	}
 
 	/* if the ID3 information for the year was not set, we will return the string "0" */
-	if ((!buff) || (strlen(buff) == 0)) {
-		buff = (char*)malloc(sizeof(char[2]));
-		buff = "0";
-	}
-	return (const char*)buff;
+	if ((!buff) || (strlen(buff) == 0)) buff = "0";
+	return id3_keep(ctx, buff);
 }
 
 
-unsigned int id3_get_year(ID3Tag *tag) {
-	char *s_year;
-	if (!tag) return 0;
+unsigned int id3_get_year(struct id3_context *ctx, ID3Tag *tag) {
+	const char *s_year;
+	unsigned int year;
+	if ((!ctx) || (!tag)) return 0;
 
 	/* get the year string by id3_get_syear() */
-	s_year = (char*)id3_get_syear(tag);
+	s_year = id3_get_syear(ctx, tag);
 	if (!s_year) return 0;
 
-	/* convert the string to an integer and return it */
-	return (unsigned int)strtol(s_year, 0, 10);
+	/* convert the string to an integer and return it, a copy is not needed anymore */
+	year = (unsigned int)strtol(s_year, 0, 10);
+	if (ctx->copied) free((char*)s_year);
+	return year;
 }
 
 
-unsigned int id3_get_trackno(ID3Tag *tag) {
+unsigned int id3_get_trackno(struct id3_context *ctx, ID3Tag *tag) {
 	ID3Frame *frame;
-	static char *buff = 0;
+	const char *buff = 0;
+
+	if (!ctx) return 0;
 
-	/* get the track number in the usual fashion as string */
+	/* get the track number in the usual fashion as string, it is only needed
+	 * until it has been converted */
 	if ((frame = ID3Tag_FindFrameWithID(tag, ID3FID_TRACKNUM))) {
-		buff = (char*)id3_get_frame_text(frame);
+		buff = id3_read_frame(ctx, frame, 0);
 	}
 
 	if ((!buff) || (strlen(buff) == 0)) return 0;
@@ -211,70 +264,357 @@ unsigned int id3_get_trackno(ID3Tag *tag) {
 }
 
 
-s_id3_tag* id3_get_id3_struct(const char *filename, char id3v1) {
+/**
+ * id3_set() makes field of tag the string value, which has just been returned for
+ * the context ctx. A copy of its own that was there before is freed and flag
+ * tells if the new one is a copy as well.
+ */
+static void id3_set(s_id3_tag *tag, struct id3_context *ctx, const char **field, const char *value,
+		    unsigned int flag) {
+	if (tag->owned & flag) free((char*)*field);
+	*field = value;
+	if (ctx->copied) {
+		tag->owned |= flag;
+	} else {
+		tag->owned &= ~flag;
+	}
+}
+
+
+s_id3_tag* id3_read_file(struct id3_context *ctx, const char *filename) {
 	s_id3_tag *tag;
 	ID3Tag *t;
 	size_t filesize;
 
 	/* if the filename was not given or the filesize cannot be determined (i.e. error
 	 * in accessing the file), return 0 */
-	if ((!filename) || (!(filesize = id3_get_file_size(filename)))) {
+	if ((!ctx) || (!filename) || (!(filesize = id3_get_file_size(filename)))) {
 		return 0;
 	}
 	
 	/* try to link the file, if that does not work, return 0 */
-	t = id3_link_file(filename, id3v1);
+	t = id3_link_file(filename, ctx->id3v1);
 	if (!t) return 0;
 
 	/* allocate a new instance if struct id3_struct, if it fails, we return 0 */
-	tag = (s_id3_tag*)malloc(sizeof(s_id3_tag));
-	if (!tag) return 0;
+	tag = (s_id3_tag*)calloc(1, sizeof(s_id3_tag));
+	if (!tag) {
+		id3_unlink_file(t);
+		return 0;
+	}
 	
-	/* fill in all the struct's fields by just calling all the functions above */
+	/* fill in the fields that are needed by every run: the names decide if the file
+	 * has to be transferred at all, everything else waits for id3_tag_need() */
 	tag->filename = filename;
 	tag->size     = filesize;
-	tag->artist   = id3_get_artist(t);
-	tag->title    = id3_get_title(t);
-	tag->album    = id3_get_album(t);
-	tag->genre    = id3_get_genre(t);
-	tag->year     = id3_get_year(t);
-	tag->s_year   = id3_get_syear(t);
-	tag->trackno  = id3_get_trackno(t);
-	tag->time     = id3_get_time(t);
-	tag->frequency = id3_get_frequency(t);
-	tag->bitrate  = id3_get_bitrate(t);
+	tag->transient = ctx->transient;
+	id3_set(tag, ctx, &tag->artist, id3_get_artist(ctx, t), _OWN_ARTIST);
+	id3_set(tag, ctx, &tag->title, id3_get_title(ctx, t), _OWN_TITLE);
+	id3_set(tag, ctx, &tag->album, id3_get_album(ctx, t), _OWN_ALBUM);
 	tag->trackid  = 0;	/* will be set by the player if a transfer succeeded */
 	
 	tag->next     = 0;	/* needed for the tracklist and MUST be NULL at init time */
 	tag->element  = 0;
+	id3_make_keys(tag);	/* the keys to find duplicates with */
+
+	/* the tag object is kept for the rest of the fields */
+	tag->id3      = t;
+	tag->id3v1    = ctx->id3v1;
+	tag->valid    = _ID3_NAMES;
+	return tag;
+}
+
+
+int id3_tag_need(s_id3_tag *tag, unsigned int fields) {
+	struct id3_context ctx;
+	unsigned int missing;
+
+	if (!tag) return 0;
+	if (!(missing = fields & ~tag->valid)) return 1;	/* nothing to do */
+
+	/* the tag object may have been released, then the file is linked again */
+	if ((!tag->id3) &&
+	    ((!tag->filename) || (!(tag->id3 = id3_link_file(tag->filename, tag->id3v1))))) {
+		return 0;
+	}
+
+	id3_context_init(&ctx, tag->id3v1);
+	ctx.transient = tag->transient;
+	if (missing & _ID3_NAMES) {
+		id3_set(tag, &ctx, &tag->artist, id3_get_artist(&ctx, tag->id3), _OWN_ARTIST);
+		id3_set(tag, &ctx, &tag->title, id3_get_title(&ctx, tag->id3), _OWN_TITLE);
+		id3_set(tag, &ctx, &tag->album, id3_get_album(&ctx, tag->id3), _OWN_ALBUM);
+		id3_make_keys(tag);
+	}
+	if (missing & _ID3_GENRE) {
+		id3_set(tag, &ctx, &tag->genre, id3_get_genre(&ctx, tag->id3), _OWN_GENRE);
+	}
+	if (missing & _ID3_NUMBERS) {
+		id3_set(tag, &ctx, &tag->s_year, id3_get_syear(&ctx, tag->id3), _OWN_YEAR);
+		tag->year   = (tag->s_year) ? (unsigned int)strtol(tag->s_year, 0, 10) : 0;
+		tag->trackno = id3_get_trackno(&ctx, tag->id3);
+	}
+	if (missing & _ID3_HEADER) {
+		/* one look at the MP3 header gives all three of them */
+		id3_get_header(tag->id3, &tag->time, &tag->frequency, &tag->bitrate);
+	}
+	id3_context_free(&ctx);
+	tag->valid |= missing;
+
+	/* everything has been read, so the tag object is not needed anymore */
+	if (tag->valid == _ID3_ALL) id3_tag_release(tag);
+	return 1;
+}
+
+
+void id3_tag_release(s_id3_tag *tag) {
+	if ((!tag) || (!tag->id3)) return;
+
+	id3_unlink_file(tag->id3);
+	tag->id3 = 0;
+}
+
+
+/**
+ * id3_set_frame() replaces the frames with the given ID of the tag object t by one
+ * that holds text. If text is empty, the frames are only removed.
+ */
+static void id3_set_frame(ID3Tag *t, ID3_FrameID id, const char *text) {
+	ID3Frame *frame;
+	ID3Field *field;
 
-	/* unlink and destroy the tag object and return the freshly created id3_struct */
+	while ((frame = ID3Tag_FindFrameWithID(t, id))) {
+		ID3Tag_RemoveFrame(t, frame);
+		ID3Frame_Delete(frame);
+	}
+	if ((!text) || (!*text) || (!(frame = ID3Frame_NewID(id)))) return;
+
+	if ((field = ID3Frame_GetField(frame, ID3FN_TEXT))) ID3Field_SetASCII(field, text);
+	ID3Tag_AttachFrame(t, frame);	/* the tag object owns the frame now */
+}
+
+
+int id3_write_tags(const char *filename, const s_id3_tag *tag, char id3v1) {
+	ID3Tag *t;
+	char year[16], trackno[16];
+	int r;
+
+	if ((!tag) || (!(t = id3_link_file(filename, id3v1)))) return 0;
+
+	snprintf(year, sizeof(year), "%u", tag->year);
+	snprintf(trackno, sizeof(trackno), "%u", tag->trackno);
+
+	id3_set_frame(t, ID3FID_LEADARTIST, tag->artist);
+	id3_set_frame(t, ID3FID_TITLE, tag->title);
+	id3_set_frame(t, ID3FID_ALBUM, tag->album);
+	id3_set_frame(t, ID3FID_CONTENTTYPE, tag->genre);
+	id3_set_frame(t, ID3FID_YEAR, (tag->year) ? year : 0);
+	id3_set_frame(t, ID3FID_TRACKNUM, (tag->trackno) ? trackno : 0);
+
+	r = (ID3Tag_UpdateByTagType(t, (id3v1) ? ID3TT_ID3V1 : ID3TT_ID3V2) != ID3TT_NONE);
+	id3_unlink_file(t);
+	return r;
+}
+
+
+int id3_write_replaygain(const char *filename, double gain, double peak) {
+	static const char *names[2] = { "REPLAYGAIN_TRACK_GAIN", "REPLAYGAIN_TRACK_PEAK" };
+	char values[2][32], old[32];
+	ID3Frame *frame;
+	ID3Field *field;
+	ID3Tag *t;
+	int i, changed = 0, r = 1;
+
+	if (!(t = id3_link_file(filename, 0))) return 0;
+
+	snprintf(values[0], sizeof(values[0]), "%+.2f dB", gain);
+	snprintf(values[1], sizeof(values[1]), "%.6f", peak);
+
+	for (i = 0; i < 2; i++) {
+		/* a frame that is right already is kept, so the file is not written again */
+		if ((frame = ID3Tag_FindFrameWithASCII(t, ID3FID_USERTEXT, ID3FN_DESCRIPTION, names[i]))) {
+			memset(old, 0, sizeof(old));
+			if ((field = ID3Frame_GetField(frame, ID3FN_TEXT)) &&
+			    (ID3Field_GetASCII(field, old, sizeof(old) - 1)) && (!strcmp(old, values[i]))) {
+				continue;
+			}
+			ID3Tag_RemoveFrame(t, frame);
+			ID3Frame_Delete(frame);
+		}
+
+		if (!(frame = ID3Frame_NewID(ID3FID_USERTEXT))) {
+			r = 0;
+			break;
+		}
+		if ((field = ID3Frame_GetField(frame, ID3FN_DESCRIPTION))) ID3Field_SetASCII(field, names[i]);
+		if ((field = ID3Frame_GetField(frame, ID3FN_TEXT))) ID3Field_SetASCII(field, values[i]);
+		ID3Tag_AttachFrame(t, frame);	/* the tag object owns the frame now */
+		changed = 1;
+	}
+
+	/* ID3v1 has no room for them */
+	if (changed) r = (ID3Tag_UpdateByTagType(t, ID3TT_ID3V2) != ID3TT_NONE) && (r);
 	id3_unlink_file(t);
+	return r;
+}
+
+
+s_id3_tag* id3_get_id3_struct(const char *filename, char id3v1) {
+	struct id3_context ctx;
+	s_id3_tag *tag;
+
+	id3_context_init(&ctx, id3v1);
+	tag = id3_read_file(&ctx, filename);
+	id3_context_free(&ctx);
 	return tag;
 }
 
 
-/* Did I already mention that this method is dangerous as it does not work and just produces
- * segfaults? */
-void id3_delete_id3_struct(s_id3_tag *tag) {
+/**
+ * id3_set_key() makes key the key of the string s. The key of a transient tag is
+ * only interned if it is known already, otherwise it is a copy of its own.
+ */
+static void id3_set_key(s_id3_tag *tag, const char **key, const char *s, unsigned int flag) {
+	const char *k;
+	char *copy;
+
+	if (tag->owned & flag) free((char*)*key);
+	tag->owned &= ~flag;
+
+	if (!tag->transient) {
+		*key = normalize_key(s);
+		return;
+	}
+
+	*key = 0;
+	if (!s) return;
+	if (!(copy = (char*)malloc(strlen(s) + 1))) {
+		print_error(G_NOMEM);
+		return;
+	}
+	normalize_string(s, copy);
+
+	if ((k = intern_known(copy))) {
+		free(copy);
+		*key = k;
+	} else {
+		*key = copy;
+		tag->owned |= flag;
+	}
+}
+
+
+void id3_make_keys(s_id3_tag *tag) {
 	if (!tag) return;
 
-	free((char*)tag->filename);
-	free((char*)tag->artist);
-	free((char*)tag->title);
-	free((char*)tag->album);
-	free((char*)tag->genre);
-	free((char*)tag->s_year);
+	id3_set_key(tag, &tag->k_artist, tag->artist, _OWN_K_ARTIST);
+	id3_set_key(tag, &tag->k_title, tag->title, _OWN_K_TITLE);
+	id3_set_key(tag, &tag->k_album, tag->album, _OWN_K_ALBUM);
+
+	/* a field that fills an ID3v1 tag completely has probably been cut */
+	tag->cut = 0;
+	if ((tag->artist) && (strlen(tag->artist) == _ID3V1_FIELD_LEN)) tag->cut |= _CUT_ARTIST;
+	if ((tag->title) && (strlen(tag->title) == _ID3V1_FIELD_LEN)) tag->cut |= _CUT_TITLE;
+	if ((tag->album) && (strlen(tag->album) == _ID3V1_FIELD_LEN)) tag->cut |= _CUT_ALBUM;
+}
+
+
+/**
+ * id3_settle_field() replaces field of tag by the interned string if it is a copy
+ * of its own (flag) and has been interned since.
+ */
+static void id3_settle_field(s_id3_tag *tag, const char **field, unsigned int flag) {
+	const char *r;
+
+	if ((!(tag->owned & flag)) || (!(r = intern_known(*field)))) return;
+	free((char*)*field);
+	*field = r;
+	tag->owned &= ~flag;
+}
+
+
+void id3_settle(s_id3_tag *tag) {
+	if ((!tag) || (!tag->owned)) return;
+
+	id3_settle_field(tag, &tag->artist, _OWN_ARTIST);
+	id3_settle_field(tag, &tag->title, _OWN_TITLE);
+	id3_settle_field(tag, &tag->album, _OWN_ALBUM);
+	id3_settle_field(tag, &tag->genre, _OWN_GENRE);
+	id3_settle_field(tag, &tag->s_year, _OWN_YEAR);
+	id3_settle_field(tag, &tag->k_artist, _OWN_K_ARTIST);
+	id3_settle_field(tag, &tag->k_title, _OWN_K_TITLE);
+	id3_settle_field(tag, &tag->k_album, _OWN_K_ALBUM);
+}
+
+
+/**
+ * id3_owned_size() returns the size of field of tag if it is a copy of its own.
+ */
+static size_t id3_owned_size(const s_id3_tag *tag, const char *field, unsigned int flag) {
+	return ((tag->owned & flag) && (field)) ? strlen(field) + 1 : 0;
+}
 
-	free(tag);
 
+size_t id3_tag_memory(const s_id3_tag *tag) {
+	if (!tag) return 0;
+
+	return sizeof(s_id3_tag) +
+		id3_owned_size(tag, tag->artist, _OWN_ARTIST) + id3_owned_size(tag, tag->title, _OWN_TITLE) +
+		id3_owned_size(tag, tag->album, _OWN_ALBUM) + id3_owned_size(tag, tag->genre, _OWN_GENRE) +
+		id3_owned_size(tag, tag->s_year, _OWN_YEAR) +
+		id3_owned_size(tag, tag->k_artist, _OWN_K_ARTIST) +
+		id3_owned_size(tag, tag->k_title, _OWN_K_TITLE) +
+		id3_owned_size(tag, tag->k_album, _OWN_K_ALBUM);
+}
+
+
+void id3_delete_id3_struct(s_id3_tag *tag) {
+	if (!tag) return;
+
+	/* the interned strings belong to nobody and the filename is not ours, only the
+	 * copies of a transient tag are freed */
+	if (tag->owned & _OWN_ARTIST) free((char*)tag->artist);
+	if (tag->owned & _OWN_TITLE) free((char*)tag->title);
+	if (tag->owned & _OWN_ALBUM) free((char*)tag->album);
+	if (tag->owned & _OWN_GENRE) free((char*)tag->genre);
+	if (tag->owned & _OWN_YEAR) free((char*)tag->s_year);
+	if (tag->owned & _OWN_K_ARTIST) free((char*)tag->k_artist);
+	if (tag->owned & _OWN_K_TITLE) free((char*)tag->k_title);
+	if (tag->owned & _OWN_K_ALBUM) free((char*)tag->k_album);
+
+	id3_tag_release(tag);
+	free(tag);
 	return;
 }
 
 
+/**
+ * id3_is_empty() returns 1 if the string s of a tag has no contents.
+ */
+static int id3_is_empty(const char *s) {
+	return ((!s) || (!s[0]) || (!strcmp(s, _DEFAULT_STRING)));
+}
+
+
+unsigned int id3_missing_fields(s_id3_tag *tag) {
+	unsigned int missing = 0;
+
+	if (!id3_tag_need(tag, _ID3_ALL)) return _MISSING_ALL;
+
+	if (id3_is_empty(tag->artist)) missing |= _MISSING_ARTIST;
+	if (id3_is_empty(tag->title))  missing |= _MISSING_TITLE;
+	if (id3_is_empty(tag->album))  missing |= _MISSING_ALBUM;
+	if (id3_is_empty(tag->genre))  missing |= _MISSING_GENRE;
+	if (!tag->year) missing |= _MISSING_YEAR;
+	if (!tag->time) missing |= _MISSING_TIME;
+	return missing;
+}
+
+
 void id3_print_tags(s_id3_tag *tag) {
 	if (!tag) return;	/* if the tag or any of the string fields is NULL, return without
 				   doing anything */
+	id3_tag_need(tag, _ID3_ALL);
 	if ((!tag->filename) ||
 		(!tag->size) ||
 		(!tag->artist) ||
@@ -28,10 +28,14 @@
 #include <sys/stat.h>
 
 #include "list.h"
+#include "intern.h"
+#include "normalize.h"
+#include "genre.h"
 #include "misc.h"
 
 /** 
- * I don't know if I used this constant anywhere in the program
+ * The size of the buffer that ID3 frame texts are read into before they are
+ * interned. Longer texts need a larger buffer (see struct id3_context).
  */
 #define _ID3_MAX_LEN 1024
 
@@ -43,10 +47,64 @@
 	#define _DEFAULT_STRING "<Unbekannt>"
 #endif
 
+/**
+ * The length of the text fields of an ID3v1 tag. Longer artists, titles and
+ * albums are cut to this length when they are stored as ID3v1 tags.
+ */
+#define _ID3V1_FIELD_LEN 30
+
+/**
+ * The groups of fields of a tag that are read separately (see the field valid
+ * below and id3_tag_need()). The names are needed to find duplicates and are
+ * always read, everything else is only read when it is asked for.
+ */
+#define _ID3_NAMES	1	/* artist, title, album and their keys */
+#define _ID3_GENRE	2	/* the genre */
+#define _ID3_NUMBERS	4	/* the year and the track number */
+#define _ID3_HEADER	8	/* the time, frequency and bitrate from the MP3 header */
+#define _ID3_ALL	15
+
+/**
+ * The flags that tell which fields of a tag may have been cut to
+ * _ID3V1_FIELD_LEN characters (see the field cut below).
+ */
+#define _CUT_ARTIST	1
+#define _CUT_TITLE	2
+#define _CUT_ALBUM	4
+
+/**
+ * The flags for the fields that a tag needs for a transfer but does not have
+ * (see id3_missing_fields()).
+ */
+#define _MISSING_ARTIST	1
+#define _MISSING_TITLE	2
+#define _MISSING_ALBUM	4
+#define _MISSING_GENRE	8
+#define _MISSING_YEAR	16
+#define _MISSING_TIME	32
+#define _MISSING_ALL	63
+
+/**
+ * The flags for the strings of a transient tag that are copies of their own
+ * and not interned (see the field owned below).
+ */
+#define _OWN_ARTIST	1
+#define _OWN_TITLE	2
+#define _OWN_ALBUM	4
+#define _OWN_GENRE	8
+#define _OWN_YEAR	16
+#define _OWN_K_ARTIST	32
+#define _OWN_K_TITLE	64
+#define _OWN_K_ALBUM	128
+
 /**
  * The basic structure for the MP3 files in this program: it stores
  * everything that is needed for file transfer to the Creative Audio
- * Player.
+ * Player. All strings except the filename are interned (see intern.h): two
+ * tags have the same artist if and only if their artist pointers are equal
+ * and the strings must never be freed. A transient tag (see id3_context) only
+ * uses strings that are interned already, all others are copies of its own
+ * that are freed with it.
  */
 struct id3_struct {
 	const char *filename;	/* the filename as string */
@@ -63,12 +121,48 @@ struct id3_struct {
 	unsigned int frequency;	/* the sample frequency of an MP3 file (may be ununsed) */
 	unsigned int bitrate;	/* the bitrate on an MP3 file (may be unused) */
 
+	const char *k_artist;	/* the keys of artist, title and album that are used */
+	const char *k_title;	/* to find duplicates (see normalize.h), NULL if they */
+	const char *k_album;	/* have not been made yet */
+	unsigned int cut;	/* the fields that are exactly _ID3V1_FIELD_LEN long */
+
+	ID3Tag *id3;		/* the linked tag object while fields are missing, NULL
+				   if it is not needed or has been released */
+	unsigned int valid;	/* the groups of fields that have been read (_ID3_...) */
+	char id3v1;		/* the tags are read with ID3v1 only */
+	char transient;		/* the tag does not add strings to the string table */
+	unsigned int owned;	/* the strings that are copies of their own (_OWN_...) */
+
 	struct id3_struct *next;	/* pointer for the tracklist */
 	struct id3_struct *element;	/* pointer for the tracklist */
 };
 
 typedef struct id3_struct s_id3_tag;
 
+/**
+ * The context of the ID3 functions. It holds everything they need to remember
+ * between two calls, so several threads can read tags at the same time as long
+ * as each of them uses a context of its own. All strings that are returned are
+ * interned: they belong to nobody, must never be freed and stay valid until the
+ * program ends, no matter what happens to the context.
+ *
+ * The interned strings are never freed, so reading an endless number of files
+ * would take ever more memory. A transient context only returns strings that
+ * are interned already and copies of all others, which belong to the tag they
+ * are read for (see id3_read_file() and id3_settle()).
+ */
+struct id3_context {
+	char id3v1;			/* use ID3v1 tags only */
+	char transient;			/* do not add strings to the string table, 0 unless
+					   it is changed after id3_context_init() */
+	char copied;			/* the last string that was returned is a copy */
+	const char *fill;		/* the string for empty tags, _DEFAULT_STRING unless
+					   it is changed after id3_context_init() */
+	char buff[_ID3_MAX_LEN];	/* the buffer frame texts are read into */
+	char *big;			/* the buffer for texts that do not fit into buff */
+	size_t big_size;		/* the size of big */
+};
+
 /**
  * id3_link_file() opens an MP3 file with the given filename and will return
  * an ID3 tag object that is used for further MP3 tag processing. This function
@@ -92,52 +186,128 @@ void		id3_unlink_file(ID3Tag *tag);
  */
 size_t 		id3_get_file_size(const char *filename);
 
+/**
+ * id3_context_init() sets up a context. If id3v1 is non-NULL, only ID3 version 1
+ * tags are used (see id3_link_file()).
+ */
+void		id3_context_init(struct id3_context *ctx, char id3v1);
+
+/**
+ * id3_context_free() frees the buffers of a context. The strings that have been
+ * returned stay valid.
+ */
+void		id3_context_free(struct id3_context *ctx);
+
 /**
  * The following functions will retrieve the ID3 information from a tag object that has
  * been obtained by id3_link_file(). They will return NULL, if the specific tag cannot be
- * read for some reason and they will return _DEFAULT_STRING if the tag is not set in
- * the MP3 file (i.e. it is an empty string).
+ * read for some reason and they will return the fill string of the context if the tag
+ * is not set in the MP3 file (i.e. it is an empty string). The strings are interned,
+ * unless the context is transient (see struct id3_context).
  */
-const char*	id3_get_artist(ID3Tag *tag);
-const char*	id3_get_title(ID3Tag *tag);
-const char*	id3_get_album(ID3Tag *tag);
-const char*	id3_get_genre(ID3Tag *tag);
+const char*	id3_get_artist(struct id3_context *ctx, ID3Tag *tag);
+const char*	id3_get_title(struct id3_context *ctx, ID3Tag *tag);
+const char*	id3_get_album(struct id3_context *ctx, ID3Tag *tag);
+const char*	id3_get_genre(struct id3_context *ctx, ID3Tag *tag);
 
 /**
- * id3_get_syear() returns the year of the MP3 file as string, 
- * id3_get_year() returns the year as integer
+ * id3_get_syear() returns the year of the MP3 file as string like the functions
+ * above ("0" if it is not set), id3_get_year() returns the year as integer and
+ * id3_get_trackno() the number of the track (0 if they are not set).
  */
-const char*	id3_get_syear(ID3Tag *tag);
-unsigned int	id3_get_year(ID3Tag *tag);
-unsigned int	id3_get_trackno(ID3Tag *tag);
+const char*	id3_get_syear(struct id3_context *ctx, ID3Tag *tag);
+unsigned int	id3_get_year(struct id3_context *ctx, ID3Tag *tag);
+unsigned int	id3_get_trackno(struct id3_context *ctx, ID3Tag *tag);
 
 /**
- * These are C++ functions that are very important to the program and are described in
+ * This is a C++ function that is very important to the program and is described in
  * detail in id3_header.h .
  */
-extern unsigned int id3_get_time(ID3Tag *t);
-extern unsigned int id3_get_frequency(ID3Tag *t);
-extern unsigned int id3_get_bitrate(ID3Tag *t);
+extern int id3_get_header(ID3Tag *t, unsigned int *time, unsigned int *frequency,
+			  unsigned int *bitrate);
 
 /**
- * id3_get_id3_struct() will take the filename of an MP3 file as an argument and will
- * return a complete struct id3_struct with all pieces of information already filled in.
- * It automatically does all the stuff like memory allocation, linking files to tag objects,
- * retrieving the necessary information using the functions defined above and finally
- * unlinking the MP3 file from its tag object. It will return NULL if anything in that
- * whole processing line went wrong.
+ * id3_read_file() will take the filename of an MP3 file as an argument and will
+ * return a struct id3_struct with the filename, the size and the names already filled
+ * in. It automatically does all the stuff like memory allocation and linking files to
+ * tag objects. The tag object stays linked, so the other fields can be read later on
+ * by id3_tag_need(). It will return NULL if anything in that whole processing line
+ * went wrong. The struct belongs to the caller (see id3_delete_id3_struct()), the
+ * filename is not copied. The tag is transient if the context is.
+ */
+s_id3_tag*	id3_read_file(struct id3_context *ctx, const char *filename);
+
+/**
+ * id3_get_id3_struct() is the same as id3_read_file() with a context of its own.
  */
 s_id3_tag*      id3_get_id3_struct(const char *filename, char id3v1);
 
 /**
- * id3_delete_id3_struct() tries to free all the memory that is occupied by an instance of
- * struct id3_struct. This method is dangerous, as it causes SEGFAULTS as well as memory
- * leaks. This is still a big TODO!
+ * id3_tag_need() makes sure that the groups of fields given by fields (_ID3_...) have
+ * been read. If the tag object has been released, the file is linked again. Once all
+ * fields have been read, the tag object is released. It returns 1 on success and 0 if
+ * the fields could not be read.
+ */
+int		id3_tag_need(s_id3_tag *tag, unsigned int fields);
+
+/**
+ * id3_tag_release() unlinks the tag object of tag to save memory. The fields that have
+ * been read stay valid.
+ */
+void		id3_tag_release(s_id3_tag *tag);
+
+/**
+ * id3_write_tags() writes artist, title, album, genre, year and track number of tag
+ * to the ID3 tag (ID3v1 if id3v1 is set, ID3v2 otherwise) of the file filename.
+ * Frames of other kinds are kept. It returns 1 on success and 0 otherwise.
+ */
+int		id3_write_tags(const char *filename, const s_id3_tag *tag, char id3v1);
+
+/**
+ * id3_write_replaygain() writes the ReplayGain track gain (in dB) and peak as
+ * REPLAYGAIN_TRACK_GAIN and REPLAYGAIN_TRACK_PEAK frames to the ID3v2 tag of the
+ * file filename. A file that has these values already is left as it is. It
+ * returns 1 on success and 0 otherwise.
+ */
+int		id3_write_replaygain(const char *filename, double gain, double peak);
+
+/**
+ * id3_make_keys() sets the keys of artist, title and album and the cut flags of
+ * tag. It must be called again whenever one of these strings changes.
+ */
+void id3_make_keys(s_id3_tag *tag);
+
+/**
+ * id3_settle() replaces the strings of a transient tag that are copies of their
+ * own by the interned ones if they have been interned since the tag was read, so
+ * the tag can be compared with the tracklist (see tracklist_find_tag()).
+ */
+void		id3_settle(s_id3_tag *tag);
+
+/**
+ * id3_tag_memory() returns the number of bytes that are held by tag, including the
+ * strings that are copies of its own.
+ */
+size_t		id3_tag_memory(const s_id3_tag *tag);
+
+/**
+ * id3_delete_id3_struct() frees an instance of struct id3_struct and its tag object.
+ * The interned strings and the filename, which belongs to the caller, are not freed,
+ * the copies of a transient tag are.
  */
 void		id3_delete_id3_struct(s_id3_tag *tag);
 
 /**
- * id3_print_tags() prints the ID3 tags in a fancy manner to the screen.
+ * id3_missing_fields() returns the fields (_MISSING_...) that player_send_file() needs
+ * but the file does not have: strings that are empty or have been filled with
+ * _DEFAULT_STRING, a year of 0 and a length of 0. All fields are read for that, if
+ * that fails, _MISSING_ALL is returned.
+ */
+unsigned int	id3_missing_fields(s_id3_tag *tag);
+
+/**
+ * id3_print_tags() prints the ID3 tags in a fancy manner to the screen. All fields
+ * are read for that.
  */
 void		id3_print_tags(s_id3_tag *tag);
 
@@ -20,35 +20,14 @@
 
 #include "id3_header.h"
 
-unsigned int id3_get_time(ID3Tag *t) {
-	unsigned int time = 0;
+int id3_get_header(ID3Tag *t, unsigned int *time, unsigned int *frequency,
+		   unsigned int *bitrate) {
 	ID3_Tag *tag = (ID3_Tag*)t;	/* cast the C ID3Tag object to a C++ ID3_Tag object - their structure is identical */
-	const Mp3_Headerinfo *header = tag->GetMp3HeaderInfo();	/* obtain the header object */
+	const Mp3_Headerinfo *header = (tag) ? tag->GetMp3HeaderInfo() : 0;	/* obtain the header object */
 
-	if (header) time = header->time;  /* if the header could be obtained, read the time field */
-	tag = 0;
-	return time;			/* and return the time */
-}
-
-
-/* the following functions are the same as above */
-unsigned int id3_get_frequency(ID3Tag *t) {
-	unsigned int f = 0;
-	ID3_Tag *tag = (ID3_Tag*)t;
-	const Mp3_Headerinfo *header = tag->GetMp3HeaderInfo();
-
-	if (header) f = header->frequency;
-	tag = 0;
-	return f;
-}
-
-
-unsigned int id3_get_bitrate(ID3Tag *t) {
-	unsigned int b = 0;
-	ID3_Tag *tag = (ID3_Tag*)t;
-	const Mp3_Headerinfo *header = tag->GetMp3HeaderInfo();
-
-	if (header) b = header->bitrate;
-	tag = 0;
-	return b;
+	/* if the header could be obtained, read the fields */
+	if (time) *time = (header) ? header->time : 0;
+	if (frequency) *frequency = (header) ? header->frequency : 0;
+	if (bitrate) *bitrate = (header) ? header->bitrate : 0;
+	return (header) ? 1 : 0;
 }
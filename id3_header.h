@@ -27,25 +27,16 @@
 extern "C" {
 
 	/**
-	 * id3_get_time() returns the length of an MP3 file, i.e. the playtime.
-	 * This information is very important for the Creative MP3 player. It will
-	 * return 0 if the time cannot be determined. Is there a better way to get
-	 * this information?
+	 * id3_get_header() reads the length of an MP3 file, i.e. the playtime,
+	 * the sample frequency and the bitrate from the MP3 header with a single
+	 * look at it. The length is very important for the Creative MP3 player,
+	 * the other two are not crucial and the bitrate is even useless for VBR
+	 * files, but since we are here... Each of the pointers may be NULL. All
+	 * values are set to 0 and 0 is returned if the header cannot be read,
+	 * otherwise 1 is returned.
 	 */
-	unsigned int id3_get_time(ID3Tag *t);
-
-	/**
-	 * id3_get_frequency() returns the sample frequency of the MP3 file.
-	 * This information is not crucial but since we are here...
-	 */
-	unsigned int id3_get_frequency(ID3Tag *t);
-
-	/**
-	 * id3_get_bitrate() return the bitrate that has been used to encode the
-	 * MP3 file. Again, not very important and even returns useless results for
-	 * VBR files. But since we are here...
-	 */
-	unsigned int id3_get_bitrate(ID3Tag *t);
+	int id3_get_header(ID3Tag *t, unsigned int *time, unsigned int *frequency,
+			   unsigned int *bitrate);
 }
 
 #endif
@@ -0,0 +1,254 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * intern.c - implementation file for string interning
+ *
+ * This file provides the implementation of the string table. The strings
+ * are found through an open addressing hash table (FNV-1a hash, linear
+ * probing) that is kept at most half full. Each block of strings starts
+ * with a pointer to the previous block, so all of them can be freed.
+ * Within a block, each string is preceded by its ID (4 bytes, aligned), so
+ * the ID of an interned string can be read without hashing it again.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "intern.h"
+
+/**
+ * The global string table, see intern().
+ */
+static struct intern_table global_table;
+static pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * intern_hash() returns the FNV-1a hash value of the string s.
+ */
+static unsigned int intern_hash(const char *s) {
+	unsigned int h = 2166136261u;
+
+	while (*s) {
+		h ^= (unsigned char)*s++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+
+/**
+ * intern_lookup() returns the slot that contains the string s with the hash
+ * value h or the empty slot where it would have to be inserted.
+ */
+static unsigned int intern_lookup(const struct intern_table *t, const char *s, unsigned int h) {
+	unsigned int i = h & (t->nslots - 1);
+	unsigned int id;
+
+	while ((id = t->slots[i])) {
+		if ((t->hashes[id - 1] == h) && (!strcmp(t->strings[id - 1], s))) break;
+		i = (i + 1) & (t->nslots - 1);
+	}
+	return i;
+}
+
+
+/**
+ * intern_grow() doubles the number of slots and the number of entries. It
+ * returns 1 on success and 0 if no memory could be allocated.
+ */
+static int intern_grow(struct intern_table *t) {
+	unsigned int nslots = (t->nslots) ? t->nslots * 2 : 64;
+	unsigned int *slots, i, k;
+	const char **strings;
+	unsigned int *hashes;
+
+	if (!(slots = (unsigned int*)calloc(nslots, sizeof(unsigned int)))) return 0;
+
+	strings = (const char**)realloc(t->strings, (nslots / 2) * sizeof(const char*));
+	if (strings) t->strings = strings;
+	hashes = (unsigned int*)realloc(t->hashes, (nslots / 2) * sizeof(unsigned int));
+	if (hashes) t->hashes = hashes;
+
+	if ((!strings) || (!hashes)) {
+		free(slots);
+		return 0;
+	}
+
+	/* put all strings into the new slots */
+	for (i = 0; i < t->count; i++) {
+		k = t->hashes[i] & (nslots - 1);
+		while (slots[k]) k = (k + 1) & (nslots - 1);
+		slots[k] = i + 1;
+	}
+
+	free(t->slots);
+	t->slots = slots;
+	t->nslots = nslots;
+	t->size = nslots / 2;
+	return 1;
+}
+
+
+/**
+ * intern_copy() copies the ID and the string s into the current block and
+ * returns the copy. A new block is started if s does not fit anymore.
+ */
+static const char* intern_copy(struct intern_table *t, const char *s, unsigned int id) {
+	size_t l = strlen(s) + 1;
+	size_t size = _INTERN_BLOCK_SIZE;
+	char *block, *p;
+
+	/* the ID in front of the string is kept aligned */
+	t->block_used = (t->block_used + sizeof(unsigned int) - 1) & ~(sizeof(unsigned int) - 1);
+	l += sizeof(unsigned int);
+
+	if ((!t->block) || (t->block_used + l > _INTERN_BLOCK_SIZE)) {
+		/* very long strings get a block of their own */
+		if (l > _INTERN_BLOCK_SIZE - sizeof(char*)) size = l + sizeof(char*);
+
+		if (!(block = (char*)malloc(size))) return 0;
+		*(char**)block = t->block;	/* link the blocks for intern_free() */
+		t->block = block;
+		t->block_used = sizeof(char*);
+		t->memory += size;
+	}
+
+	p = t->block + t->block_used;
+	*(unsigned int*)p = id;
+	memcpy(p + sizeof(unsigned int), s, l - sizeof(unsigned int));
+	t->block_used += l;
+	return p + sizeof(unsigned int);
+}
+
+
+void intern_init(struct intern_table *t) {
+	if (!t) return;
+
+	t->strings = 0;
+	t->hashes = 0;
+	t->count = 0;
+	t->size = 0;
+	t->slots = 0;
+	t->nslots = 0;
+	t->block = 0;
+	t->block_used = 0;
+	t->memory = 0;
+}
+
+
+unsigned int intern_add(struct intern_table *t, const char *s) {
+	unsigned int h, i;
+	const char *copy;
+
+	if ((!t) || (!s)) return _INTERN_NONE;
+
+	/* keep the hash table at most half full */
+	if ((t->count >= t->size) && (!intern_grow(t))) {
+		print_error(G_NOMEM);
+		return _INTERN_NONE;
+	}
+
+	h = intern_hash(s);
+	i = intern_lookup(t, s, h);
+	if (t->slots[i]) return t->slots[i] - 1;	/* we already know that one */
+
+	if (!(copy = intern_copy(t, s, t->count))) {
+		print_error(G_NOMEM);
+		return _INTERN_NONE;
+	}
+
+	t->strings[t->count] = copy;
+	t->hashes[t->count] = h;
+	t->slots[i] = ++t->count;
+	return t->count - 1;
+}
+
+
+unsigned int intern_find(const struct intern_table *t, const char *s) {
+	unsigned int i;
+
+	if ((!t) || (!s) || (!t->nslots)) return _INTERN_NONE;
+
+	i = intern_lookup(t, s, intern_hash(s));
+	return (t->slots[i]) ? t->slots[i] - 1 : _INTERN_NONE;
+}
+
+
+const char* intern_string(const struct intern_table *t, unsigned int id) {
+	if ((!t) || (id >= t->count)) return 0;
+	return t->strings[id];
+}
+
+
+unsigned int intern_id_of(const char *s) {
+	if (!s) return _INTERN_NONE;
+	return *(const unsigned int*)(s - sizeof(unsigned int));
+}
+
+
+const char* intern(const char *s) {
+	const char *r = 0;
+	unsigned int id;
+
+	if (!s) return 0;
+
+	/* the strings never move, so the pointer stays valid after unlocking */
+	pthread_mutex_lock(&global_lock);
+	if ((id = intern_add(&global_table, s)) != _INTERN_NONE) r = global_table.strings[id];
+	pthread_mutex_unlock(&global_lock);
+	return r;
+}
+
+
+const char* intern_known(const char *s) {
+	const char *r;
+
+	if (!s) return 0;
+
+	pthread_mutex_lock(&global_lock);
+	r = intern_string(&global_table, intern_find(&global_table, s));
+	pthread_mutex_unlock(&global_lock);
+	return r;
+}
+
+
+unsigned int intern_count(void) {
+	unsigned int n;
+
+	pthread_mutex_lock(&global_lock);
+	n = global_table.count;
+	pthread_mutex_unlock(&global_lock);
+	return n;
+}
+
+
+struct intern_table* intern_global(void) {
+	return &global_table;
+}
+
+
+size_t intern_memory(const struct intern_table *t) {
+	if (!t) return 0;
+	return t->memory + t->size * (sizeof(const char*) + sizeof(unsigned int)) +
+		t->nslots * sizeof(unsigned int);
+}
+
+
+void intern_free(struct intern_table *t) {
+	char *block;
+
+	if (!t) return;
+
+	while ((block = t->block)) {
+		t->block = *(char**)block;
+		free(block);
+	}
+
+	free(t->strings);
+	free(t->hashes);
+	free(t->slots);
+	intern_init(t);
+}
@@ -0,0 +1,128 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * intern.h - header file for string interning
+ *
+ * This file provides the prototypes and structures of a string table that
+ * stores every distinct string exactly once. Each string gets a small
+ * integer ID that stays the same for the lifetime of the table, so two
+ * strings in the same table are equal if and only if their IDs are equal.
+ *
+ * There is one global table that is shared by the ID3 scanner and the
+ * tracklists. All strings of a struct id3_struct live in that table (see
+ * intern() below), so they are compared by pointer and never freed. The
+ * global table is protected by a mutex, so intern() may be called by several
+ * threads at once. All other functions leave locking to the caller.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_INTERN_H
+#define __ZENCP_INTERN_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "misc.h"
+
+/* the ID that is returned if a string is not contained in the table */
+#define _INTERN_NONE ((unsigned int)-1)
+
+/* the size of the memory blocks the strings are stored in */
+#define _INTERN_BLOCK_SIZE (64 * 1024)
+
+/**
+ * A string table. The strings are stored back to back in large blocks, so
+ * they never move and their pointers stay valid until intern_free(). Every
+ * string is preceded by its ID.
+ */
+struct intern_table {
+	const char **strings;	/* the strings by their ID */
+	unsigned int *hashes;	/* the hash values by ID, needed for growing */
+	unsigned int count;	/* the number of strings in the table */
+	unsigned int size;	/* the number of allocated entries in strings */
+
+	unsigned int *slots;	/* open addressing hash table of ID + 1, 0 is empty */
+	unsigned int nslots;	/* the number of slots, always a power of 2 */
+
+	char *block;		/* the block new strings are copied into */
+	size_t block_used;	/* the number of bytes used in block */
+	size_t memory;		/* the number of bytes allocated for blocks */
+};
+
+/**
+ * intern_init() sets up an empty string table.
+ */
+void		intern_init(struct intern_table *t);
+
+/**
+ * intern_add() returns the ID of the string s, adding a copy of it to the
+ * table if it is not contained yet. _INTERN_NONE is returned in case of errors.
+ */
+unsigned int	intern_add(struct intern_table *t, const char *s);
+
+/**
+ * intern_find() returns the ID of the string s or _INTERN_NONE if it is not
+ * contained in the table. The table is not changed.
+ */
+unsigned int	intern_find(const struct intern_table *t, const char *s);
+
+/**
+ * intern_string() returns the string with the given ID or NULL if there is
+ * no such ID.
+ */
+const char*	intern_string(const struct intern_table *t, unsigned int id);
+
+/**
+ * intern_memory() returns the number of bytes that are allocated by the table.
+ */
+size_t		intern_memory(const struct intern_table *t);
+
+/**
+ * intern_id_of() returns the ID of a string that has been returned by
+ * intern_string() of the same table without looking it up.
+ */
+unsigned int	intern_id_of(const char *s);
+
+/**
+ * intern() returns the copy of s in the global string table, adding it if it is
+ * not contained yet. Equal strings result in equal pointers. The copy must not
+ * be changed or freed. NULL is returned if s is NULL or in case of errors. It is
+ * safe to call intern() from several threads.
+ */
+const char*	intern(const char *s);
+
+/**
+ * intern_known() returns the copy of s in the global string table or NULL if s
+ * has not been interned. Unlike intern(), it never adds s, so it can be used for
+ * strings that are only needed for a while (see id3_context). It is safe to call
+ * intern_known() from several threads.
+ */
+const char*	intern_known(const char *s);
+
+/**
+ * intern_count() returns the number of strings in the global string table, so
+ * all IDs of strings that have been returned by intern() are lower. It is safe
+ * to call intern_count() from several threads.
+ */
+unsigned int	intern_count(void);
+
+/**
+ * intern_global() returns the global string table. Its IDs are used by the column
+ * oriented tracklist. The table must not be read directly while other threads
+ * may call intern().
+ */
+struct intern_table* intern_global(void);
+
+/**
+ * intern_free() frees all strings of the table. All pointers that have been
+ * returned by intern_string() become invalid.
+ */
+void		intern_free(struct intern_table *t);
+
+#endif
@@ -0,0 +1,634 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * library.c - implementation file for the local library index
+ *
+ * This file provides the implementation of the library index. Paths and
+ * players are interned, so the records are sorted by the addresses of
+ * their strings and found by binary search. Fingerprints are computed in
+ * parallel (see pool.h); the threads only read files and write their own
+ * result, everything else happens in the calling thread.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "library.h"
+
+/**
+ * A file that has to be read by library_scan().
+ */
+struct scan_job {
+	const char *path;		/* the interned absolute path */
+	char *copy;			/* the path if it is not interned, or NULL */
+	unsigned long long size;
+	long long mtime;
+	unsigned long long hash;	/* the result */
+	int ok;				/* the file could be read */
+	int record;			/* the old record of the file or -1 */
+	mp3_file *file;
+};
+
+/**
+ * An element of the list for library_unique().
+ */
+struct unique_entry {
+	unsigned long long hash;
+	unsigned int pos;		/* the position in the list */
+	mp3_file *file;
+};
+
+
+/**
+ * library_cmp_file(), library_cmp_place() and library_cmp_gain() are the qsort()
+ * functions for the three arrays of the index.
+ */
+static int library_cmp_file(const void *a, const void *b) {
+	unsigned long x = (unsigned long)((const struct library_file*)a)->path;
+	unsigned long y = (unsigned long)((const struct library_file*)b)->path;
+
+	return (x > y) - (x < y);
+}
+
+
+static int library_cmp_place(const void *a, const void *b) {
+	const struct library_place *x = (const struct library_place*)a;
+	const struct library_place *y = (const struct library_place*)b;
+
+	if (x->device != y->device) {
+		return ((unsigned long)x->device > (unsigned long)y->device) ? 1 : -1;
+	}
+	return (x->hash > y->hash) - (x->hash < y->hash);
+}
+
+
+static int library_cmp_gain(const void *a, const void *b) {
+	unsigned long long x = ((const struct library_gain*)a)->hash;
+	unsigned long long y = ((const struct library_gain*)b)->hash;
+
+	return (x > y) - (x < y);
+}
+
+
+static int library_cmp_unique(const void *a, const void *b) {
+	const struct unique_entry *x = (const struct unique_entry*)a;
+	const struct unique_entry *y = (const struct unique_entry*)b;
+
+	if (x->hash != y->hash) return (x->hash > y->hash) ? 1 : -1;
+	return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+
+/**
+ * library_find_file() returns the record of the interned path or -1 if the
+ * file is not known.
+ */
+static int library_find_file(struct library *lib, const char *path) {
+	struct library_file key, *r;
+
+	if (!lib->nfiles) return -1;
+	if (!lib->files_sorted) {
+		qsort(lib->files, lib->nfiles, sizeof(struct library_file), library_cmp_file);
+		lib->files_sorted = 1;
+	}
+
+	key.path = path;
+	r = (struct library_file*)bsearch(&key, lib->files, lib->nfiles, sizeof(struct library_file),
+					  library_cmp_file);
+	return (r) ? (int)(r - lib->files) : -1;
+}
+
+
+/**
+ * library_first_place() returns the first record of the interned device with
+ * the fingerprint hash or nplaces if there is none.
+ */
+static unsigned int library_first_place(struct library *lib, const char *device, unsigned long long hash) {
+	struct library_place key;
+	unsigned int lo = 0, hi = lib->nplaces, mid;
+
+	if (!lib->places_sorted) {
+		qsort(lib->places, lib->nplaces, sizeof(struct library_place), library_cmp_place);
+		lib->places_sorted = 1;
+	}
+
+	/* the lower bound, as several tracks may have the same fingerprint */
+	key.device = device;
+	key.hash = hash;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (library_cmp_place(&lib->places[mid], &key) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if ((lo < lib->nplaces) && (!library_cmp_place(&lib->places[lo], &key))) return lo;
+	return lib->nplaces;
+}
+
+
+/**
+ * library_add_file() appends a record for a file. It returns 1 on success and 0
+ * if no memory could be allocated.
+ */
+static int library_add_file(struct library *lib, const char *path, unsigned long long size,
+			    long long mtime, unsigned long long hash) {
+	struct library_file *p;
+	unsigned int size_new;
+
+	if (lib->nfiles == lib->sfiles) {
+		size_new = (lib->sfiles) ? lib->sfiles * 2 : 256;
+		if (!(p = (struct library_file*)realloc(lib->files, size_new * sizeof(struct library_file)))) {
+			print_error(G_NOMEM);
+			return 0;
+		}
+		lib->files = p;
+		lib->sfiles = size_new;
+	}
+
+	p = &lib->files[lib->nfiles++];
+	p->path = path;
+	p->size = size;
+	p->mtime = mtime;
+	p->hash = hash;
+	lib->files_sorted = 0;
+	lib->changed = 1;
+	return 1;
+}
+
+
+/**
+ * library_append_place() appends a record for a track on a player. It returns 1
+ * on success and 0 if no memory could be allocated.
+ */
+static int library_append_place(struct library *lib, const char *device, unsigned long long hash,
+				unsigned int trackid) {
+	struct library_place *p;
+	unsigned int size_new;
+
+	if (lib->nplaces == lib->splaces) {
+		size_new = (lib->splaces) ? lib->splaces * 2 : 256;
+		if (!(p = (struct library_place*)realloc(lib->places, size_new * sizeof(struct library_place)))) {
+			print_error(G_NOMEM);
+			return 0;
+		}
+		lib->places = p;
+		lib->splaces = size_new;
+	}
+
+	p = &lib->places[lib->nplaces++];
+	p->device = device;
+	p->hash = hash;
+	p->trackid = trackid;
+	lib->places_sorted = 0;
+	lib->changed = 1;
+	return 1;
+}
+
+
+/**
+ * library_find_gain() returns the loudness record of the fingerprint hash or NULL
+ * if the audio data has not been analysed.
+ */
+static struct library_gain* library_find_gain(struct library *lib, unsigned long long hash) {
+	struct library_gain key;
+
+	if (!lib->ngains) return 0;
+	if (!lib->gains_sorted) {
+		qsort(lib->gains, lib->ngains, sizeof(struct library_gain), library_cmp_gain);
+		lib->gains_sorted = 1;
+	}
+
+	key.hash = hash;
+	return (struct library_gain*)bsearch(&key, lib->gains, lib->ngains, sizeof(struct library_gain),
+					     library_cmp_gain);
+}
+
+
+/**
+ * library_append_gain() appends a loudness record. It returns 1 on success and 0
+ * if no memory could be allocated.
+ */
+static int library_append_gain(struct library *lib, unsigned long long hash, double loudness,
+			       double peak) {
+	struct library_gain *p;
+	unsigned int size_new;
+
+	if (lib->ngains == lib->sgains) {
+		size_new = (lib->sgains) ? lib->sgains * 2 : 256;
+		if (!(p = (struct library_gain*)realloc(lib->gains, size_new * sizeof(struct library_gain)))) {
+			print_error(G_NOMEM);
+			return 0;
+		}
+		lib->gains = p;
+		lib->sgains = size_new;
+	}
+
+	p = &lib->gains[lib->ngains++];
+	p->hash = hash;
+	p->loudness = loudness;
+	p->peak = peak;
+	lib->gains_sorted = 0;
+	lib->changed = 1;
+	return 1;
+}
+
+
+/**
+ * library_hash_job() computes the fingerprint of one file for library_scan().
+ */
+static void library_hash_job(void *ctx, unsigned int i) {
+	struct scan_job *job = (struct scan_job*)ctx + i;
+
+	/* the jobs are sorted by path, a file that is in the list twice is read once */
+	if ((i) && (job->path == job[-1].path)) {
+		job->ok = 0;
+		return;
+	}
+	job->ok = fingerprint_file(job->path, &job->hash);
+}
+
+
+/**
+ * compare_jobs() sorts the jobs of library_scan() by their interned path.
+ */
+static int compare_jobs(const void *a, const void *b) {
+	const char *x = ((const struct scan_job*)a)->path;
+	const char *y = ((const struct scan_job*)b)->path;
+
+	return (x < y) ? -1 : (x > y);
+}
+
+
+void library_init(struct library *lib) {
+	if (!lib) return;
+
+	lib->files = 0;
+	lib->nfiles = lib->sfiles = 0;
+	lib->files_sorted = 1;
+	lib->places = 0;
+	lib->nplaces = lib->splaces = 0;
+	lib->places_sorted = 1;
+	lib->gains = 0;
+	lib->ngains = lib->sgains = 0;
+	lib->gains_sorted = 1;
+	lib->changed = 0;
+}
+
+
+int library_load(struct library *lib) {
+	char line[PATH_MAX + 128];
+	char *path, *p, *q, *r;
+	unsigned long long hash;
+	FILE *f;
+
+	if (!lib) return 0;
+
+	if (!(path = config_file_path(_LIBRARY_FILE))) return 0;
+	f = fopen(path, "r");
+	free(path);
+	if (!f) return 0;
+
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = '\0';
+
+		/* every record has at least four fields, the last one is the rest of the line */
+		if ((line[1] != '\t') || (!(p = strchr(line + 2, '\t'))) || (!(q = strchr(p + 1, '\t')))) continue;
+		*p++ = '\0';
+		*q++ = '\0';
+		hash = strtoull(line + 2, 0, 16);
+
+		if (line[0] == 'F') {
+			if (!(r = strchr(q, '\t'))) continue;
+			*r++ = '\0';
+			library_add_file(lib, intern(r), strtoull(p, 0, 10), strtoll(q, 0, 10), hash);
+		} else if (line[0] == 'D') {
+			library_append_place(lib, intern(q), hash, (unsigned int)strtoul(p, 0, 10));
+		} else if (line[0] == 'G') {
+			library_append_gain(lib, hash, strtod(p, 0), strtod(q, 0));
+		}
+	}
+
+	fclose(f);
+	lib->changed = 0;
+	return 1;
+}
+
+
+int library_save(struct library *lib) {
+	char *path, *tmp_path;
+	unsigned int i;
+	FILE *out;
+	size_t l;
+
+	if ((!lib) || (!lib->changed)) return 0;
+	if (!(path = config_file_path(_LIBRARY_FILE))) return 0;
+
+	l = strlen(path) + 5;
+	if (!(tmp_path = (char*)malloc(sizeof(char[l])))) {
+		free(path);
+		return 0;
+	}
+	snprintf(tmp_path, l, "%s.new", path);
+
+	if (!(out = fopen(tmp_path, "w"))) {
+		free(tmp_path);
+		free(path);
+		return 0;
+	}
+
+	for (i = 0; i < lib->nfiles; i++) {
+		fprintf(out, "F\t%016llx\t%llu\t%lld\t%s\n", lib->files[i].hash, lib->files[i].size,
+			lib->files[i].mtime, lib->files[i].path);
+	}
+	for (i = 0; i < lib->nplaces; i++) {
+		fprintf(out, "D\t%016llx\t%u\t%s\n", lib->places[i].hash, lib->places[i].trackid,
+			lib->places[i].device);
+	}
+	for (i = 0; i < lib->ngains; i++) {
+		fprintf(out, "G\t%016llx\t%.2f\t%.6f\n", lib->gains[i].hash, lib->gains[i].loudness,
+			lib->gains[i].peak);
+	}
+
+	/* rename() replaces the old file atomically */
+	l = ((fclose(out) == 0) && (rename(tmp_path, path) == 0));
+	if (l) lib->changed = 0;
+
+	free(tmp_path);
+	free(path);
+	return (int)l;
+}
+
+
+unsigned int library_scan(struct library *lib, mp3_file *list, int threads) {
+	return library_scan_shared(lib, list, threads, 0, 1);
+}
+
+
+unsigned int library_scan_shared(struct library *lib, mp3_file *list, int threads, pthread_mutex_t *lock,
+				 int remember) {
+	char real[PATH_MAX];
+	struct scan_job *jobs;
+	struct library_file *known;
+	struct stat st;
+	unsigned int n = 0, i;
+	mp3_file *f;
+	int k;
+
+	if ((!lib) || (!list)) return 0;
+
+	for (f = list; f; f = f->next) n++;
+	if (!(jobs = (struct scan_job*)malloc(n * sizeof(struct scan_job)))) {
+		print_error(G_NOMEM);
+		return 0;
+	}
+
+	/* first find out which files are known and did not change */
+	n = 0;
+	if (lock) pthread_mutex_lock(lock);
+	for (f = list; f; f = f->next) {
+		f->hash = 0;
+		if ((!realpath(f->filename, real)) || (stat(real, &st))) continue;
+
+		/* a path that is not interned yet cannot be in the library, it is only
+		 * interned if the file is remembered */
+		jobs[n].copy = 0;
+		if (remember) {
+			jobs[n].path = intern(real);
+		} else if (!(jobs[n].path = intern_known(real))) {
+			if (!(jobs[n].path = jobs[n].copy = strdup(real))) continue;
+		}
+		jobs[n].size = st.st_size;
+		jobs[n].mtime = st.st_mtime;
+		jobs[n].record = (jobs[n].copy) ? -1 : library_find_file(lib, jobs[n].path);
+		jobs[n].file = f;
+
+		if (jobs[n].record >= 0) {
+			known = &lib->files[jobs[n].record];
+			if ((known->size == jobs[n].size) && (known->mtime == jobs[n].mtime)) {
+				f->hash = known->hash;
+				continue;
+			}
+		}
+		n++;
+	}
+
+	if (lock) pthread_mutex_unlock(lock);
+
+	/* then read all the others at once */
+	qsort(jobs, n, sizeof(struct scan_job), compare_jobs);
+	pool_run(n, threads, library_hash_job, jobs);
+
+	/* only library_scan() moves the records of files, so they are where they were */
+	if (lock) pthread_mutex_lock(lock);
+
+	for (i = 0; i < n; i++) {
+		if ((i) && (jobs[i].path == jobs[i-1].path)) {
+			if (jobs[i-1].ok) jobs[i].file->hash = jobs[i-1].hash;
+			continue;
+		}
+		if (!jobs[i].ok) continue;
+		jobs[i].file->hash = jobs[i].hash;
+
+		if ((k = jobs[i].record) >= 0) {
+			lib->files[k].size = jobs[i].size;
+			lib->files[k].mtime = jobs[i].mtime;
+			lib->files[k].hash = jobs[i].hash;
+			lib->changed = 1;
+		} else if (remember) {
+			library_add_file(lib, jobs[i].path, jobs[i].size, jobs[i].mtime, jobs[i].hash);
+		}
+	}
+	if (lock) pthread_mutex_unlock(lock);
+
+	for (i = 0; i < n; i++) free(jobs[i].copy);
+	free(jobs);
+	return n;
+}
+
+
+mp3_file* library_unique(mp3_file *list, unsigned int *dropped) {
+	struct unique_entry *e;
+	unsigned int n = 0, i;
+	mp3_file *f;
+
+	if (dropped) *dropped = 0;
+	if (!list) return 0;
+
+	for (f = list; f; f = f->next) n++;
+	if (!(e = (struct unique_entry*)malloc(n * sizeof(struct unique_entry)))) {
+		print_error(G_NOMEM);
+		return list;
+	}
+
+	n = 0;
+	for (f = list; f; f = f->next) {
+		e[n].hash = f->hash;
+		e[n].pos = n;
+		e[n].file = f;
+		n++;
+	}
+
+	/* equal fingerprints end up next to each other, the first file in front */
+	qsort(e, n, sizeof(struct unique_entry), library_cmp_unique);
+
+	for (i = 1; i < n; i++) {
+		if ((!e[i].hash) || (e[i].hash != e[i - 1].hash)) continue;
+
+		/* the head of the list always comes first, so it is never removed */
+		if (e[i].file->tag) id3_delete_id3_struct(e[i].file->tag);
+		list_delete(e[i].file, 0);
+		if (dropped) (*dropped)++;
+	}
+
+	free(e);
+	return list;
+}
+
+
+void library_add_place(struct library *lib, const char *device, unsigned long long hash,
+		       unsigned int trackid) {
+	unsigned int i;
+
+	if ((!lib) || (!device) || (!hash) || (!trackid)) return;
+	device = intern(device);
+
+	/* the player reuses the IDs of deleted tracks */
+	for (i = 0; i < lib->nplaces; i++) {
+		if ((lib->places[i].device == device) && (lib->places[i].trackid == trackid)) {
+			lib->places[i].hash = hash;
+			lib->places_sorted = 0;
+			lib->changed = 1;
+			return;
+		}
+	}
+
+	library_append_place(lib, device, hash, trackid);
+}
+
+
+void library_remove_place(struct library *lib, const char *device, unsigned int trackid) {
+	unsigned int i, j;
+
+	if ((!lib) || (!device) || (!trackid)) return;
+	device = intern(device);
+
+	/* the records keep their order, so a sorted array stays sorted */
+	for (i = j = 0; i < lib->nplaces; i++) {
+		if ((lib->places[i].device == device) && (lib->places[i].trackid == trackid)) continue;
+		if (i != j) lib->places[j] = lib->places[i];
+		j++;
+	}
+
+	if (j != lib->nplaces) {
+		lib->nplaces = j;
+		lib->changed = 1;
+	}
+}
+
+
+s_id3_tag* library_find_duplicate(struct library *lib, const char *device, unsigned long long hash,
+				  s_id3_tag *tag, struct tracklist *tracklist) {
+	s_id3_tag *t;
+	unsigned int i;
+
+	if ((!lib) || (!device) || (!tag) || (!tracklist)) return 0;
+	device = intern(device);
+
+	/* the same audio data has been sent to this player before, but it may have
+	 * been deleted since */
+	if (hash) {
+		for (i = library_first_place(lib, device, hash);
+		     (i < lib->nplaces) && (lib->places[i].device == device) && (lib->places[i].hash == hash); i++) {
+			if ((t = tracklist_find_trackid(tracklist, lib->places[i].trackid))) return t;
+		}
+	}
+
+	if ((!(t = tracklist_find_tag(tracklist, tag))) || (!hash)) return t;
+
+	/* the tags are the same, but the track on the player may be a different one */
+	for (i = 0; i < lib->nplaces; i++) {
+		if ((lib->places[i].device == device) && (lib->places[i].trackid == t->trackid)) {
+			return (lib->places[i].hash == hash) ? t : 0;
+		}
+	}
+	return t;
+}
+
+
+/**
+ * library_file_hash() returns the fingerprint of the file path, which is only
+ * read if the library does not know it yet, or 0 if it cannot be read.
+ */
+static unsigned long long library_file_hash(struct library *lib, const char *path) {
+	mp3_file file;
+
+	memset(&file, 0, sizeof(mp3_file));
+	file.filename = (char*)path;
+	library_scan(lib, &file, 1);
+	return file.hash;
+}
+
+
+int library_add_fetched(struct library *lib, const char *path, const char *device, unsigned int trackid) {
+	unsigned long long hash;
+
+	if ((!lib) || (!path) || (!device) || (!(hash = library_file_hash(lib, path)))) return 0;
+	library_add_place(lib, device, hash, trackid);
+	return 1;
+}
+
+
+int library_is_fetched(struct library *lib, const char *path, const char *device, unsigned int trackid) {
+	unsigned long long hash;
+	unsigned int i;
+
+	if ((!lib) || (!path) || (!device) || (!(hash = library_file_hash(lib, path)))) return 0;
+	device = intern(device);
+
+	for (i = library_first_place(lib, device, hash);
+	     (i < lib->nplaces) && (lib->places[i].device == device) && (lib->places[i].hash == hash); i++) {
+		if (lib->places[i].trackid == trackid) return 1;
+	}
+	return 0;
+}
+
+
+int library_get_gain(struct library *lib, unsigned long long hash, double *loudness, double *peak) {
+	struct library_gain *g;
+
+	if ((!lib) || (!hash) || (!(g = library_find_gain(lib, hash)))) return 0;
+	if (loudness) *loudness = g->loudness;
+	if (peak) *peak = g->peak;
+	return 1;
+}
+
+
+void library_set_gain(struct library *lib, unsigned long long hash, double loudness, double peak) {
+	struct library_gain *g;
+
+	if ((!lib) || (!hash)) return;
+
+	if ((g = library_find_gain(lib, hash))) {
+		g->loudness = loudness;
+		g->peak = peak;
+		lib->changed = 1;
+		return;
+	}
+	library_append_gain(lib, hash, loudness, peak);
+}
+
+
+void library_free(struct library *lib) {
+	if (!lib) return;
+
+	free(lib->files);
+	free(lib->places);
+	free(lib->gains);
+	library_init(lib);
+}
@@ -0,0 +1,203 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * library.h - header file for the local library index
+ *
+ * This file provides the prototypes and structures of the library index,
+ * which remembers the fingerprint of every file that has been scanned (see
+ * fingerprint.h) and which fingerprint has been sent to which player under
+ * which track ID. It is kept in $HOME/.zencp/library, one record per line:
+ *
+ *   F <tab> fingerprint <tab> size <tab> mtime <tab> path
+ *   D <tab> fingerprint <tab> track ID <tab> player
+ *   G <tab> fingerprint <tab> loudness <tab> peak
+ *
+ * A file whose size and modification time did not change is not read
+ * again, audio data whose loudness is known is not analysed again (see
+ * loudness.h). The fingerprints are written as 16 hex digits.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_LIBRARY_H
+#define __ZENCP_LIBRARY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "list.h"
+#include "id3.h"
+#include "tracklist.h"
+#include "intern.h"
+#include "fingerprint.h"
+#include "pool.h"
+#include "misc.h"
+
+/* the name of the library file within $HOME/.zencp */
+#define _LIBRARY_FILE "library"
+
+/**
+ * A file that has been scanned. The path is interned.
+ */
+struct library_file {
+	const char *path;		/* the absolute path of the file */
+	unsigned long long size;	/* the size and modification time when the */
+	long long mtime;		/* fingerprint was computed */
+	unsigned long long hash;	/* the fingerprint */
+};
+
+/**
+ * A track that has been sent to a player. The player is the interned key
+ * that is also used for the throughput (see schedule.h).
+ */
+struct library_place {
+	const char *device;		/* the player */
+	unsigned long long hash;	/* the fingerprint of the track */
+	unsigned int trackid;		/* the track ID on the player */
+};
+
+/**
+ * The loudness of audio data.
+ */
+struct library_gain {
+	unsigned long long hash;	/* the fingerprint of the audio data */
+	double loudness;		/* its loudness in LUFS */
+	double peak;			/* its highest sample, 1.0 is full scale */
+};
+
+/**
+ * The library index. All arrays are sorted when they are searched, new
+ * records are appended and mark them as unsorted.
+ */
+struct library {
+	struct library_file *files;
+	unsigned int nfiles;		/* the number of files */
+	unsigned int sfiles;		/* the number of allocated files */
+	int files_sorted;		/* files is sorted by path */
+
+	struct library_place *places;
+	unsigned int nplaces;		/* the number of places */
+	unsigned int splaces;		/* the number of allocated places */
+	int places_sorted;		/* places is sorted by player and fingerprint */
+
+	struct library_gain *gains;
+	unsigned int ngains;		/* the number of loudness records */
+	unsigned int sgains;		/* the number of allocated records */
+	int gains_sorted;		/* gains is sorted by fingerprint */
+
+	int changed;			/* the index has to be saved */
+};
+
+/**
+ * library_init() sets up an empty library index.
+ */
+void		library_init(struct library *lib);
+
+/**
+ * library_load() reads the library file into lib. It returns 1 on success and
+ * 0 if there is no library file yet.
+ */
+int		library_load(struct library *lib);
+
+/**
+ * library_save() writes lib to the library file if it has changed. It returns
+ * 1 on success and 0 in case of errors.
+ */
+int		library_save(struct library *lib);
+
+/**
+ * library_scan() stores the fingerprint of every file in the list in its field
+ * hash. Files that are known and did not change are not read, all others are
+ * read in parallel on up to threads threads (0 means one per CPU). It returns
+ * the number of files that had to be read.
+ */
+unsigned int	library_scan(struct library *lib, mp3_file *list, int threads);
+
+/**
+ * library_scan_shared() is library_scan() for a library that other threads use
+ * at the same time: lock is held while the index is looked at and changed, but
+ * not while the files are read. Only one thread may scan at a time. If remember
+ * is 0, files that are not in the library yet are not added to it and their
+ * paths are not interned, so a long stream of files does not make it grow.
+ */
+unsigned int	library_scan_shared(struct library *lib, mp3_file *list, int threads, pthread_mutex_t *lock,
+				    int remember);
+
+/**
+ * library_unique() removes every file from the list that has the same
+ * fingerprint as a file before it. It returns the new head of the list and
+ * stores the number of removed files in dropped. The names of the files belong
+ * to the caller and are not freed.
+ */
+mp3_file*	library_unique(mp3_file *list, unsigned int *dropped);
+
+/**
+ * library_add_place() records that the track with the fingerprint hash has been
+ * sent to device under the given track ID. Older records of that track ID are
+ * replaced, as the player reuses the IDs of deleted tracks.
+ */
+void		library_add_place(struct library *lib, const char *device, unsigned long long hash,
+				  unsigned int trackid);
+
+/**
+ * library_remove_place() forgets the track with the given track ID on device,
+ * e.g. because it has been deleted.
+ */
+void		library_remove_place(struct library *lib, const char *device, unsigned int trackid);
+
+/**
+ * library_find_duplicate() looks for a track on device that is the same as the
+ * file with fingerprint hash and the tags tag. The fingerprint decides if the
+ * library knows the track on the player, the tags are only used otherwise. It
+ * returns the track in tracklist or NULL if the file is not on the player. A hash
+ * of 0 means that the fingerprint is unknown.
+ */
+s_id3_tag*	library_find_duplicate(struct library *lib, const char *device, unsigned long long hash,
+				       s_id3_tag *tag, struct tracklist *tracklist);
+
+/**
+ * library_add_fetched() records that the file path holds the track with the given
+ * track ID on device, e.g. because it has just been fetched from there (see
+ * download.h). The file is known by the fingerprint of its audio data, so it is
+ * still recognized when its tags have been rewritten. It returns 1 on success and
+ * 0 if the file cannot be read.
+ */
+int		library_add_fetched(struct library *lib, const char *path, const char *device,
+				    unsigned int trackid);
+
+/**
+ * library_is_fetched() returns 1 if the file path holds the track with the given
+ * track ID on device (see library_add_fetched()) and 0 otherwise.
+ */
+int		library_is_fetched(struct library *lib, const char *path, const char *device,
+				   unsigned int trackid);
+
+/**
+ * library_get_gain() looks up the loudness and peak of the audio data with the
+ * fingerprint hash. It returns 1 if they are known and 0 otherwise.
+ */
+int		library_get_gain(struct library *lib, unsigned long long hash, double *loudness,
+				 double *peak);
+
+/**
+ * library_set_gain() records the loudness and peak of the audio data with the
+ * fingerprint hash.
+ */
+void		library_set_gain(struct library *lib, unsigned long long hash, double loudness,
+				 double peak);
+
+/**
+ * library_free() frees all memory that is held by lib.
+ */
+void		library_free(struct library *lib);
+
+#endif
@@ -0,0 +1,1260 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * libzencp.c - implementation file for the zencp library
+ *
+ * This file provides the implementation of the context and the transfer
+ * pipeline of libzencp. All output goes through the callbacks of the
+ * context, see libzencp.h.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "libzencp.h"
+
+/**
+ * What zencp_progress() needs to know about the file that is being sent.
+ */
+struct zencp_sending {
+	struct zencp *z;
+	s_id3_tag *tag;
+};
+
+
+/**
+ * zencp_progress() is handed to player_send_file() and passes the progress on
+ * to the progress callback of the context.
+ */
+static int zencp_progress(u_int64_t sent, u_int64_t total, const char *buf, unsigned len, void *data) {
+	struct zencp_sending *s = (struct zencp_sending*)data;
+
+	s->z->callbacks.progress(s->z->callbacks.user, s->tag, sent, total);
+	return 0;
+}
+
+
+/**
+ * zencp_event() tells the event callback (if any) about an event of the given
+ * type. The fields that are not needed are 0.
+ */
+static void zencp_event(struct zencp *z, int type, const char *filename, s_id3_tag *tag,
+			unsigned int count, double seconds, double rate) {
+	struct zencp_event event;
+
+	if (!z->callbacks.event) return;
+
+	event.type = type;
+	event.filename = filename;
+	event.tag = tag;
+	event.count = count;
+	event.seconds = seconds;
+	event.rate = rate;
+	event.player = (z->player) ? z->player - z->players : -1;
+	z->callbacks.event(z->callbacks.user, &event);
+}
+
+
+/**
+ * zencp_drop() frees the rest of a file list including the tags that have been
+ * read in advance. The names of the files belong to the caller.
+ */
+static void zencp_drop(mp3_file *files) {
+	while (files) {
+		if (files->tag) id3_delete_id3_struct(files->tag);
+		files->tag = 0;
+		files = list_delete(files, 0);
+	}
+}
+
+
+void zencp_init(struct zencp *z) {
+	memset(z, 0, sizeof(struct zencp));
+	tracklist_setup_tracklist(&z->tracklist);
+	tracklist_setup_tracklist(&z->source_tracklist);
+	device_cache_init(&z->devices);
+	library_init(&z->library);
+	stats_init(&z->stats);
+	z->options.deadline = -1.0;
+	z->options.retries = _ZENCP_RETRIES;
+}
+
+
+int zencp_discover(struct zencp *z) {
+	z->nplayers = player_discovery(z->players);
+	if (z->nplayers < 0) {
+		z->error = PL_DISC;
+		z->nplayers = 0;
+		return -1;
+	}
+	return z->nplayers;
+}
+
+
+/**
+ * zencp_busy() returns 1 if the n-th player cannot be captured, because it is
+ * captured already or because it did not answer before.
+ */
+static int zencp_busy(struct zencp *z, int n) {
+	return (z->lost[n]) || (z->player == &z->players[n]) || (z->source == &z->players[n]);
+}
+
+
+/**
+ * zencp_capture() captures the n-th player, whose identity is id. Its serial
+ * number is read again and cached; if the player turns out not to be the one
+ * given by name (the cache was out of date), it is released again. It returns the
+ * player, whose identity is copied to out, or NULL.
+ */
+static njb_t* zencp_capture(struct zencp *z, int n, struct device_id *id, const char *name,
+			    struct device_id *out) {
+	char serial[_DEVICE_SERIAL_LEN];
+	njb_t *player;
+
+	if (!(player = player_lock(z->players, n))) {
+		z->error = PL_COMM;
+		return 0;
+	}
+
+	if (device_serial(player, serial)) {
+		strcpy(id->serial, serial);
+		if (id->path[0]) device_cache_set(&z->devices, id->path, serial);
+	}
+	if ((name) && (!device_matches(id, name))) {
+		player_release(&player);
+		return 0;
+	}
+
+	*out = *id;
+	return player;
+}
+
+
+/**
+ * zencp_devices() loads the cache of serial numbers if that has not been done.
+ */
+static void zencp_devices(struct zencp *z) {
+	if (z->cached) return;
+	device_cache_load(&z->devices);
+	z->cached = 1;
+}
+
+
+/**
+ * zencp_select() captures the player given by name as described for zencp_open(),
+ * but without a name the first player that is not captured yet is used. It
+ * returns the player, whose identity is written to out, or NULL.
+ */
+static njb_t* zencp_select(struct zencp *z, const char *name, struct device_id *out) {
+	struct survey_result results[_MAX_PLAYERS];
+	struct device_id id;
+	const char *serial;
+	char skip[_MAX_PLAYERS];
+	njb_t *player = 0;
+	int i, pass;
+
+	z->error = PL_COMM;
+	if (!z->nplayers) return 0;
+
+	zencp_devices(z);
+
+	/* no specific player is wanted, so the first one is used */
+	if (!name) {
+		for (i = 0; (i < z->nplayers) && (zencp_busy(z, i)); i++);
+		if (i == z->nplayers) return 0;
+		memset(&id, 0, sizeof(id));
+		device_path(&z->players[i], id.path);
+		return zencp_capture(z, i, &id, 0, out);
+	}
+
+	for (i = 0; i < z->nplayers; i++) skip[i] = zencp_busy(z, i);
+	z->error = PL_NOID;
+
+	/* first the players whose USB path or cached serial number matches, they
+	 * are the only ones that are touched if the cache is right. Then the
+	 * serial numbers of all other players are read at once, without capturing
+	 * them. */
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) zencp_survey(z, SM_PROBE, skip, results);
+
+		for (i = 0; i < z->nplayers; i++) {
+			if ((pass == 0) ? skip[i] : (results[i].state != SS_DONE)) continue;
+			if (pass == 0) {
+				memset(&id, 0, sizeof(id));
+				device_path(&z->players[i], id.path);
+				if ((serial = device_cache_serial(&z->devices, id.path))) strcpy(id.serial, serial);
+			} else {
+				id = results[i].id;
+			}
+			if (!device_matches(&id, name)) continue;
+
+			skip[i] = 1;
+			if ((player = zencp_capture(z, i, &id, name, out)) || (z->error == PL_COMM)) break;
+		}
+		if (i < z->nplayers) break;
+	}
+
+	device_cache_save(&z->devices);
+	return player;
+}
+
+
+njb_t* zencp_open(struct zencp *z, const char *name) {
+	if (!z->player) z->player = zencp_select(z, name, &z->id);
+	return z->player;
+}
+
+
+njb_t* zencp_open_source(struct zencp *z, const char *name) {
+	if (!z->source) z->source = zencp_select(z, name, &z->source_id);
+	return z->source;
+}
+
+
+int zencp_survey(struct zencp *z, int mode, const char *skip, struct survey_result *results) {
+	char lost[_MAX_PLAYERS];
+	int i, n;
+
+	zencp_devices(z);
+
+	/* players that did not answer before are never asked again */
+	for (i = 0; i < z->nplayers; i++) {
+		lost[i] = (zencp_busy(z, i)) || ((skip) && (skip[i]));
+	}
+
+	n = survey_run(z->players, z->nplayers, lost, mode, z->options.devices, z->options.timeout,
+		       results);
+
+	for (i = 0; i < z->nplayers; i++) {
+		if (results[i].state == SS_TIMEOUT) z->lost[i] = 1;
+		if ((results[i].id.path[0]) && (results[i].id.serial[0])) {
+			device_cache_set(&z->devices, results[i].id.path, results[i].id.serial);
+		}
+	}
+	return n;
+}
+
+
+/**
+ * zencp_device_key() writes the key of a captured player to out, which has room
+ * for len characters. The player is known by its model and owner, both for the
+ * throughput and for the library of tracks that have been sent to it.
+ */
+static void zencp_device_key(njb_t *player, char *out, size_t len) {
+	const char *owner, *model;
+
+	owner = player_get_owner(player);
+	model = player_get_model(player);
+	snprintf(out, len, "%s/%s", model ? model : "", owner ? owner : "");
+	free((char*)owner);
+	free((char*)model);
+}
+
+
+/**
+ * zencp_library() loads the library if that has not been done.
+ */
+static void zencp_library(struct zencp *z) {
+	if (z->loaded) return;
+	library_load(&z->library);
+	z->loaded = 1;
+}
+
+
+unsigned int zencp_load(struct zencp *z) {
+	if (!z->player) return 0;
+
+	z->tracks = player_get_tracklist(z->player, &z->tracklist);
+	zencp_device_key(z->player, z->device, sizeof(z->device));
+	zencp_library(z);
+	return z->tracks;
+}
+
+
+
+unsigned int zencp_load_source(struct zencp *z) {
+	if (!z->source) return 0;
+
+	tracklist_free(&z->source_tracklist);
+	tracklist_set_policy(&z->source_tracklist, z->tracklist.policy);
+	return (z->source_tracks = player_get_tracklist(z->source, &z->source_tracklist));
+}
+
+
+/**
+ * zencp_lock() guards the library while a stream scans files (see zencp_stream()),
+ * zencp_unlock() lets go of it. Otherwise they do nothing.
+ */
+static void zencp_lock(struct zencp *z) {
+	if (z->lock) pthread_mutex_lock(z->lock);
+}
+
+
+static void zencp_unlock(struct zencp *z) {
+	if (z->lock) pthread_mutex_unlock(z->lock);
+}
+
+
+/**
+ * zencp_remove() deletes track from the player and then takes it out of the
+ * library and the tracklist, which frees it. It returns 1 on success and 0 if
+ * the player could not delete it.
+ */
+static int zencp_remove(struct zencp *z, s_id3_tag *track) {
+	unsigned int trackid = track->trackid;
+
+	if (!player_delete_track(z->player, track)) return 0;
+	zencp_lock(z);
+	library_remove_place(&z->library, z->device, trackid);
+	zencp_unlock(z);
+	tracklist_remove(&z->tracklist, track);
+	return 1;
+}
+
+
+s_id3_tag* zencp_find_duplicate(struct zencp *z, mp3_file *file) {
+	s_id3_tag *track;
+
+	if ((!file) || (!file->tag)) return 0;
+	zencp_lock(z);
+	track = library_find_duplicate(&z->library, z->device, file->hash, file->tag, &z->tracklist);
+	zencp_unlock(z);
+	return track;
+}
+
+
+/**
+ * zencp_louder() makes a copy of the file in memory with the gain that the
+ * loudness of its audio data (see zencp_loudness()) calls for. It returns 1 if
+ * the copy is in src and 0 if the file is sent as it is.
+ */
+static int zencp_louder(struct zencp *z, mp3_file *file, struct source *src) {
+	double loudness, peak, gain;
+	int fd, r;
+
+	zencp_lock(z);
+	r = library_get_gain(&z->library, file->hash, &loudness, &peak);
+	zencp_unlock(z);
+	if (!r) return 0;
+	if (!(gain = loudness_gain(loudness, peak))) return 0;
+	if ((fd = open(file->filename, O_RDONLY)) < 0) return 0;
+
+	r = source_from_pipe(src, fd, 0);
+	close(fd);
+	if ((r) && (loudness_apply(src->fd, gain) > 0)) return 1;
+	if (r) source_free(src);
+	return 0;
+}
+
+
+unsigned int zencp_send(struct zencp *z, mp3_file *file, s_id3_tag *existing) {
+	struct zencp_sending sending;
+	struct source copy;
+	const char *filename;
+	s_id3_tag *tag;
+	double t0, seconds;
+	int attempt;
+
+	if ((!z->player) || (!file) || (!(tag = file->tag))) return 0;
+
+	/* the track is overwritten, so the old one goes first */
+	if (existing) zencp_remove(z, existing);
+
+	/* the gain keeps the size of the file, so only its name is changed; the
+	 * fingerprint is that of the file on the disk */
+	filename = tag->filename;
+	copy.path = 0;
+	if ((z->options.normalize == LM_APPLY) && (zencp_louder(z, file, &copy))) tag->filename = copy.path;
+
+	zencp_event(z, ZE_SENDING, file->filename, tag, 0, 0.0, 0.0);
+	sending.z = z;
+	sending.tag = tag;
+	for (attempt = 0; ; attempt++) {
+		t0 = stats_now();
+		tag->trackid = player_send_file(z->player, tag, (z->callbacks.progress) ? zencp_progress : 0,
+						&sending);
+		seconds = stats_now() - t0;
+		if ((tag->trackid) || (attempt >= z->options.retries)) break;
+		zencp_event(z, ZE_RETRYING, file->filename, tag, attempt + 1, 0.0, 0.0);
+	}
+
+	if (copy.path) {
+		tag->filename = filename;
+		source_free(&copy);
+	}
+
+	if (!tag->trackid) {
+		z->stats.failed++;
+		zencp_event(z, ZE_FAILED, file->filename, tag, 0, 0.0, 0.0);
+		return 0;
+	}
+
+	stats_add(&z->stats, tag->size, seconds);
+	if (z->sched) schedule_update_rate(z->sched, tag->size, seconds);
+	zencp_lock(z);
+	library_add_place(&z->library, z->device, file->hash, tag->trackid);
+	zencp_unlock(z);
+	/* insert the new track in the tracklist so that it cannot be sent twice */
+	tracklist_insert(&z->tracklist, tag);
+	zencp_event(z, ZE_SENT, file->filename, tag, 0, 0.0, 0.0);
+	return tag->trackid;
+}
+
+
+unsigned int zencp_send_source(struct zencp *z, struct source *src, s_id3_tag *tag) {
+	struct zencp_sending sending;
+	unsigned long long hash;
+	unsigned int trackid;
+	double t0, seconds;
+	int attempt;
+
+	if ((!z->player) || (!src) || (!src->path) || (!tag)) return 0;
+
+	/* the player is told the size of the data, not that of any file */
+	tag->size = src->size;
+
+	zencp_event(z, ZE_SENDING, tag->filename, tag, 0, 0.0, 0.0);
+	sending.z = z;
+	sending.tag = tag;
+	for (attempt = 0; ; attempt++) {
+		t0 = stats_now();
+		trackid = player_send_track(z->player, src->path, tag,
+					    (z->callbacks.progress) ? zencp_progress : 0, &sending);
+		seconds = stats_now() - t0;
+		if ((trackid) || (attempt >= z->options.retries)) break;
+		zencp_event(z, ZE_RETRYING, tag->filename, tag, attempt + 1, 0.0, 0.0);
+	}
+
+	if (!trackid) {
+		z->stats.failed++;
+		zencp_event(z, ZE_FAILED, tag->filename, tag, 0, 0.0, 0.0);
+		return 0;
+	}
+
+	stats_add(&z->stats, src->size, seconds);
+	if (z->sched) schedule_update_rate(z->sched, src->size, seconds);
+	/* the data is still there, so its fingerprint is booked like that of a file */
+	if (fingerprint_file(src->path, &hash)) library_add_place(&z->library, z->device, hash, trackid);
+	tag->trackid = trackid;
+	tracklist_insert(&z->tracklist, tag);
+	zencp_event(z, ZE_SENT, tag->filename, tag, 0, 0.0, 0.0);
+	return trackid;
+}
+
+
+int zencp_delete(struct zencp *z, unsigned int trackid) {
+	s_id3_tag *track;
+
+	if ((!z->player) || (!(track = tracklist_find_trackid(&z->tracklist, trackid)))) return 0;
+	return zencp_remove(z, track);
+}
+
+
+int zencp_delete_tracks(struct zencp *z, s_id3_tag **tracks, unsigned int count) {
+	unsigned long long size;
+	unsigned int i, trackid;
+	double t0, seconds;
+	int done = 1;
+
+	if ((!z->player) || ((!tracks) && (count))) return 0;
+
+	for (i = 0; i < count; i++) {
+		t0 = stats_now();
+		if (!player_delete_track(z->player, tracks[i])) {
+			z->stats.failed++;
+			zencp_event(z, ZE_FAILED, 0, tracks[i], 0, 0.0, 0.0);
+			done = 0;
+			continue;
+		}
+		seconds = stats_now() - t0;
+
+		/* the tags are freed with the track, so everything is taken first */
+		size = tracks[i]->size;
+		trackid = tracks[i]->trackid;
+		zencp_event(z, ZE_DELETED, 0, tracks[i], 0, 0.0, 0.0);
+		zencp_lock(z);
+		library_remove_place(&z->library, z->device, trackid);
+		zencp_unlock(z);
+		tracklist_remove(&z->tracklist, tracks[i]);
+		tracks[i] = 0;
+		stats_add(&z->stats, size, seconds);
+	}
+	return done;
+}
+
+
+/**
+ * zencp_loudness() measures the loudness of the files of the list that have not
+ * been measured before and writes the ReplayGain frames if the normalize option
+ * asks for them.
+ */
+static void zencp_loudness(struct zencp *z, mp3_file *files) {
+	double loudness, peak;
+	unsigned int n;
+	mp3_file *f;
+
+	if ((n = loudness_scan(&z->library, files, z->options.decoder, z->options.threads))) {
+		zencp_event(z, ZE_ANALYSED, 0, 0, n, 0.0, 0.0);
+	}
+	if (z->options.normalize != LM_TAG) return;
+
+	/* ReplayGain leaves the limit of the peak to the player */
+	for (f = files; f; f = f->next) {
+		if ((!library_get_gain(&z->library, f->hash, &loudness, &peak)) ||
+		    (loudness <= _LOUDNESS_SILENCE)) continue;
+		id3_write_replaygain(f->filename, _LOUDNESS_TARGET - loudness, peak);
+	}
+}
+
+
+/**
+ * zencp_transcoding() sets up t for the encoder of the options and moves the files
+ * of the list that are not MP3 there. It returns the rest of the list.
+ */
+static mp3_file* zencp_transcoding(struct zencp *z, mp3_file *files, struct transcoder *t) {
+	mp3_file *f, *next;
+
+	transcode_init(t, z->options.transcode, z->options.id3v1);
+	for (f = files; f; f = next) {
+		next = f->next;
+		if ((!transcode_wanted(f->filename)) || (!transcode_add(t, f->filename, f->hash))) continue;
+		if (f == files) files = next;
+		list_delete(f, 0);
+	}
+	return files;
+}
+
+
+/**
+ * zencp_transcoded() sends the files of t as soon as they are encoded, like
+ * zencp_transfer() does with the others. It returns 1 if all files have been
+ * handled and 0 if the deadline or the decide callback stopped it.
+ */
+static int zencp_transcoded(struct zencp *z, struct transcoder *t) {
+	struct transcode_job *job;
+	s_id3_tag *tag, *track;
+	int answer, done = 1;
+
+	while ((done) && (job = transcode_next(t))) {
+		if (!(tag = job->tag)) {
+			zencp_event(z, ZE_UNREADABLE, job->filename, 0, 0, 0.0, 0.0);
+			transcode_done(t, job);
+			continue;
+		}
+		/* the encoder gives the same data each time, so the fingerprint finds
+		 * the tracks of earlier runs */
+		track = library_find_duplicate(&z->library, z->device, job->mp3hash, tag, &z->tracklist);
+
+		if ((z->sched) && (!schedule_fits(z->sched, tag)) && ((z->options.force) || (!track))) {
+			zencp_event(z, ZE_DEADLINE, 0, 0, t->n - t->taken + 1, schedule_remaining(z->sched), 0.0);
+			done = 0;
+		} else if ((track) && (!z->options.force)) {
+			z->stats.skipped++;
+			zencp_event(z, ZE_EXISTS, job->filename, tag, 0, 0.0, 0.0);
+		} else {
+			answer = (z->callbacks.decide) ? z->callbacks.decide(z->callbacks.user, tag, track) : ZD_SEND;
+			if (answer == ZD_QUIT) {
+				zencp_event(z, ZE_ABORTED, job->filename, tag, 0, 0.0, 0.0);
+				done = 0;
+			} else if (answer == ZD_SEND) {
+				/* the track is overwritten, so the old one goes first */
+				if (track) zencp_remove(z, track);
+				zencp_send_source(z, &job->src, tag);
+			}
+		}
+		transcode_done(t, job);
+	}
+	return done;
+}
+
+
+int zencp_transfer(struct zencp *z, mp3_file *files) {
+	struct transcoder transcoder;
+	struct schedule sched;
+	s_id3_tag *tag, *track;
+	mp3_file *f;
+	unsigned int dropped = 0, n;
+	int answer, done = 1;
+	char sent;
+
+	if (!(files = list_first_element(files))) return (z->playlists) ? zencp_playlists(z) : 1;
+	if (!z->player) {
+		z->error = PL_COMM;
+		zencp_drop(files);
+		return 0;
+	}
+
+	/* the fingerprints of the audio data decide which files are already on the
+	 * player, files that only differ in their tags are sent once */
+	library_scan(&z->library, files, z->options.threads);
+	files = library_unique(files, &dropped);
+	if (dropped) {
+		z->stats.skipped += dropped;
+		zencp_event(z, ZE_SAME_AUDIO, 0, 0, dropped, 0.0, 0.0);
+	}
+
+	/* the encoders are busy while the MP3 files are sent */
+	if (z->options.transcode) {
+		files = zencp_transcoding(z, files, &transcoder);
+		transcode_start(&transcoder, z->options.threads);
+	}
+	if (z->options.normalize != LM_OFF) zencp_loudness(z, files);
+
+	/* with a time budget, the files are read in advance and put into an order that
+	 * gets as many albums as possible onto the player before the deadline */
+	if (z->options.deadline >= 0) {
+		schedule_init(&sched, (z->options.start > 0.0) ? z->options.start : stats_now(),
+			      z->options.deadline);
+
+		/* the throughput of this player from earlier runs is our first guess */
+		schedule_load_rate(&sched, z->device);
+		schedule_read_tags(files, z->options.id3v1, 0);
+		files = schedule_plan(&sched, files, &z->tracklist, z->options.force);
+		z->sched = &sched;
+		zencp_event(z, ZE_PLAN, 0, 0, 0, schedule_remaining(&sched), sched.rate);
+	}
+
+	while (files) {
+		sent = 0;
+
+		/* the tags may have been read in advance */
+		if ((!files->tag) && (!z->sched)) files->tag = id3_get_id3_struct(files->filename, z->options.id3v1);
+		if (!(tag = files->tag)) {
+			zencp_event(z, ZE_UNREADABLE, files->filename, 0, 0, 0.0, 0.0);
+			files = list_delete(files, 0);
+			continue;
+		}
+		track = zencp_find_duplicate(z, files);
+
+		/* do not start a track that would not be finished before the deadline;
+		 * the plan puts all tracks that fit first, so we are done here. Tracks
+		 * that are skipped anyway do not cost any time. */
+		if ((z->sched) && (!schedule_fits(z->sched, tag)) && ((z->options.force) || (!track))) {
+			for (n = 0, f = files; f; f = f->next) n++;
+			zencp_event(z, ZE_DEADLINE, 0, 0, n, schedule_remaining(z->sched), 0.0);
+			done = 0;
+			break;
+		}
+
+		if ((track) && (!z->options.force)) {
+			z->stats.skipped++;
+			zencp_event(z, ZE_EXISTS, files->filename, tag, 0, 0.0, 0.0);
+		} else {
+			answer = (z->callbacks.decide) ? z->callbacks.decide(z->callbacks.user, tag, track) : ZD_SEND;
+			if (answer == ZD_QUIT) {
+				zencp_event(z, ZE_ABORTED, files->filename, tag, 0, 0.0, 0.0);
+				done = 0;
+				break;
+			}
+			if (answer == ZD_SEND) {
+				/* the next file is read from the disk while this one is sent */
+				if (files->next) source_prefetch(files->next->filename);
+				zencp_send(z, files, track);
+				sent = 1;
+			}
+		}
+
+		/* the tracklist holds a copy, so the tags of the file are not needed any more */
+		id3_delete_id3_struct(tag);
+		files->tag = 0;
+		files = list_delete(files, 0);
+
+		/* the throughput may have changed, so plan the rest of the files again */
+		if ((z->sched) && (sent)) files = schedule_plan(z->sched, files, &z->tracklist, z->options.force);
+	}
+
+	zencp_drop(files);
+	if (z->options.transcode) {
+		if (done) done = zencp_transcoded(z, &transcoder);
+		transcode_free(&transcoder);
+	}
+
+	/* the playlists get what is on the player now, even after a deadline */
+	if ((z->playlists) && (!zencp_playlists(z))) done = 0;
+	if (z->sched) {
+		schedule_save_rate(z->sched);
+		schedule_free(z->sched);
+		z->sched = 0;
+	}
+	library_save(&z->library);
+	return done;
+}
+
+
+int zencp_send_data(struct zencp *z, const char *dir) {
+	struct zencp_sending sending;
+	struct datafile_list disk, player;
+	struct datafile *f, *old;
+	unsigned int i, id;
+	int attempt, done = 1;
+	double t0, seconds;
+
+	if (!z->player) {
+		z->error = PL_COMM;
+		return 0;
+	}
+
+	datafile_init(&disk);
+	datafile_init(&player);
+	if (datafile_scan(&disk, dir) < 0) {
+		zencp_event(z, ZE_UNREADABLE, dir, 0, 0, 0.0, 0.0);
+		return 0;
+	}
+	player_get_datafiles(z->player, &player);
+
+	sending.z = z;
+	sending.tag = 0;
+	for (i = 0; i < disk.n; i++) {
+		f = &disk.files[i];
+
+		old = datafile_find(&player, f->folder, f->name);
+		if ((old) && (!z->options.force) && (datafile_same(f, old))) {
+			z->stats.skipped++;
+			zencp_event(z, ZE_EXISTS, f->path, 0, 0, 0.0, 0.0);
+			continue;
+		}
+
+		/* the player would keep both files, so the old one goes first */
+		if (old) player_delete_datafile(z->player, old->id);
+
+		if (i + 1 < disk.n) source_prefetch(disk.files[i + 1].path);
+		zencp_event(z, ZE_SENDING, f->path, 0, 0, 0.0, 0.0);
+		for (attempt = 0; ; attempt++) {
+			t0 = stats_now();
+			id = player_send_datafile(z->player, f->path, f->name, f->folder,
+						  (z->callbacks.progress) ? zencp_progress : 0, &sending);
+			seconds = stats_now() - t0;
+			if ((id) || (attempt >= z->options.retries)) break;
+			zencp_event(z, ZE_RETRYING, f->path, 0, attempt + 1, 0.0, 0.0);
+		}
+
+		if (!id) {
+			z->stats.failed++;
+			zencp_event(z, ZE_FAILED, f->path, 0, 0, 0.0, 0.0);
+			done = 0;
+			continue;
+		}
+		stats_add(&z->stats, f->size, seconds);
+		zencp_event(z, ZE_SENT, f->path, 0, 0, 0.0, 0.0);
+	}
+
+	datafile_free(&disk);
+	datafile_free(&player);
+	return done;
+}
+
+
+/**
+ * What the threads of zencp_shard() share.
+ */
+struct zencp_sharding {
+	struct zencp *z;
+	struct shard *s;
+};
+
+
+/**
+ * zencp_shard_event() tells the event callback (if any) about an event of the
+ * given type that concerns the entry e (or NULL) on the d-th device of the shard
+ * (or -1). While the players are sending, the lock of the shard must be held.
+ */
+static void zencp_shard_event(struct zencp *z, struct shard *s, int type, int d, struct shard_entry *e,
+			      unsigned int count) {
+	struct zencp_event event;
+
+	if (!z->callbacks.event) return;
+
+	memset(&event, 0, sizeof(event));
+	event.type = type;
+	event.filename = (e) ? e->filename : 0;
+	event.tag = (e) ? e->tag : 0;
+	event.count = count;
+	event.player = (d >= 0) ? s->devices[d].index : -1;
+	z->callbacks.event(z->callbacks.user, &event);
+}
+
+
+/**
+ * zencp_shard_open() captures the d-th device of the shard and reads its tracks
+ * and free space. It is a job of pool_run(), so all players are opened at once.
+ */
+static void zencp_shard_open(void *ctx, unsigned int d) {
+	struct zencp_sharding *sh = (struct zencp_sharding*)ctx;
+	struct shard_device *dev = &sh->s->devices[d];
+	unsigned long long room;
+
+	device_path(&sh->z->players[dev->index], dev->id.path);
+	if (!(dev->player = player_lock(sh->z->players, dev->index))) return;
+
+	device_serial(dev->player, dev->id.serial);
+	tracklist_set_policy(&dev->tracklist, sh->z->tracklist.policy);
+	player_get_tracklist(dev->player, &dev->tracklist);
+	zencp_device_key(dev->player, dev->key, sizeof(dev->key));
+
+	room = player_get_diskfree(dev->player);
+	dev->free = (room > _SHARD_RESERVE) ? room - _SHARD_RESERVE : 0;
+}
+
+
+/**
+ * zencp_shard_send() sends files to the d-th device of the shard until there is
+ * none left that it has room for. It is a job of pool_run(), so all players send
+ * at once; everything they share is only touched with the lock of the shard.
+ */
+static void zencp_shard_send(void *ctx, unsigned int d) {
+	struct zencp_sharding *sh = (struct zencp_sharding*)ctx;
+	struct shard_device *dev = &sh->s->devices[d];
+	struct shard_entry *e;
+	unsigned int trackid;
+	double t0, seconds;
+	int i;
+
+	if (!dev->player) return;
+
+	pthread_mutex_lock(&sh->s->lock);
+	while ((i = shard_take(sh->s, d)) >= 0) {
+		e = &sh->s->entries[i];
+		zencp_shard_event(sh->z, sh->s, ZE_SENDING, d, e, 0);
+		pthread_mutex_unlock(&sh->s->lock);
+
+		t0 = stats_now();
+		trackid = player_send_file(dev->player, e->tag, 0, 0);
+		seconds = stats_now() - t0;
+
+		pthread_mutex_lock(&sh->s->lock);
+		shard_finish(sh->s, i, trackid);
+		if (trackid) {
+			e->tag->trackid = trackid;
+			stats_add(&dev->stats, e->size, seconds);
+			/* the time of the whole run is added by zencp_shard() */
+			stats_add(&sh->z->stats, e->size, 0.0);
+			library_add_place(&sh->z->library, dev->key, e->hash, trackid);
+			zencp_shard_event(sh->z, sh->s, ZE_SENT, d, e, 0);
+		} else {
+			dev->stats.failed++;
+			sh->z->stats.failed++;
+			zencp_shard_event(sh->z, sh->s, ZE_FAILED, d, e, 0);
+		}
+	}
+	pthread_mutex_unlock(&sh->s->lock);
+}
+
+
+int zencp_shard(struct zencp *z, mp3_file *files, struct shard *s) {
+	struct zencp_sharding sh;
+	struct shard_device *dev;
+	struct shard_entry *e;
+	s_id3_tag *track;
+	unsigned int dropped = 0, i, n;
+	double t0;
+	int k;
+
+	files = list_first_element(files);
+	sh.z = z;
+	sh.s = s;
+
+	/* every player that has not been lost or captured is used */
+	for (k = 0; k < z->nplayers; k++) {
+		if (!zencp_busy(z, k)) shard_add_device(s, k);
+	}
+	pool_run(s->ndevices, s->ndevices, zencp_shard_open, &sh);
+
+	zencp_devices(z);
+	for (k = 0, n = 0; k < s->ndevices; k++) {
+		dev = &s->devices[k];
+		if (!dev->player) continue;
+		if ((dev->id.path[0]) && (dev->id.serial[0])) {
+			device_cache_set(&z->devices, dev->id.path, dev->id.serial);
+		}
+		n++;
+	}
+	device_cache_save(&z->devices);
+	if (!n) {
+		z->error = PL_COMM;
+		zencp_drop(files);
+		return 0;
+	}
+
+	/* files with the same audio data are sent once; the tags of all files are
+	 * needed before the first one is sent, so they are read in parallel */
+	zencp_library(z);
+	if (files) {
+		library_scan(&z->library, files, z->options.threads);
+		files = library_unique(files, &dropped);
+	}
+	if (dropped) {
+		z->stats.skipped += dropped;
+		zencp_event(z, ZE_SAME_AUDIO, 0, 0, dropped, 0.0, 0.0);
+	}
+	schedule_read_tags(files, z->options.id3v1, 0);
+
+	for (; files; files = list_delete(files, 0)) {
+		if (!files->tag) {
+			zencp_event(z, ZE_UNREADABLE, files->filename, 0, 0, 0.0, 0.0);
+		} else if (shard_add(s, files->filename, files->tag, files->hash) < 0) {
+			z->stats.failed++;
+			zencp_event(z, ZE_FAILED, files->filename, files->tag, 0, 0.0, 0.0);
+			id3_delete_id3_struct(files->tag);
+		}
+		files->tag = 0;
+	}
+
+	/* a file that one of the players already has is not sent to another one */
+	for (i = 0; (!z->options.force) && (i < s->n); i++) {
+		e = &s->entries[i];
+		for (k = 0; k < s->ndevices; k++) {
+			dev = &s->devices[k];
+			if (!dev->player) continue;
+			if (!(track = library_find_duplicate(&z->library, dev->key, e->hash, e->tag, &dev->tracklist))) {
+				continue;
+			}
+
+			e->status = SH_EXISTS;
+			e->device = k;
+			e->trackid = track->trackid;
+			z->stats.skipped++;
+			zencp_shard_event(z, s, ZE_EXISTS, k, e, 0);
+			break;
+		}
+	}
+
+	shard_deal(s);
+	t0 = stats_now();
+	pool_run(s->ndevices, s->ndevices, zencp_shard_send, &sh);
+	z->stats.seconds += stats_now() - t0;
+
+	shard_leftover(s);
+	if ((n = shard_count(s, SH_NOROOM))) zencp_shard_event(z, s, ZE_NOROOM, -1, 0, n);
+
+	for (k = 0; k < s->ndevices; k++) {
+		if (s->devices[k].player) player_release(&s->devices[k].player);
+	}
+	library_save(&z->library);
+	return (shard_count(s, SH_SENT) + shard_count(s, SH_EXISTS) == s->n);
+}
+
+
+int zencp_download(struct zencp *z, s_id3_tag **tracks, unsigned int count, const char *dir) {
+	struct zencp_sending sending;
+	struct stat st;
+	char path[PATH_MAX];
+	double t0, seconds;
+	unsigned int i;
+	int done = 1, present;
+
+	if (!z->player) {
+		z->error = PL_COMM;
+		return 0;
+	}
+
+	zencp_library(z);
+	for (i = 0; i < count; i++) {
+		if (!download_path(dir, tracks[i], path, sizeof(path))) {
+			z->stats.failed++;
+			zencp_event(z, ZE_FAILED, 0, tracks[i], 0, 0.0, 0.0);
+			done = 0;
+			continue;
+		}
+
+		/* a track that has been fetched before is not fetched again, another
+		 * track with the same name gets its track ID appended. The size of a file
+		 * does not tell, as its tags have been rewritten, the library knows which
+		 * audio data came from which track. */
+		present = 0;
+		if (!stat(path, &st)) {
+			if (!(present = library_is_fetched(&z->library, path, z->device, tracks[i]->trackid))) {
+				snprintf(path + strlen(path) - 4, sizeof(path) - strlen(path) + 4, " (%u).mp3",
+					 tracks[i]->trackid);
+				present = ((!stat(path, &st)) &&
+					   (library_is_fetched(&z->library, path, z->device, tracks[i]->trackid)));
+			}
+		}
+		if (present) {
+			z->stats.skipped++;
+			zencp_event(z, ZE_PRESENT, path, tracks[i], 0, 0.0, 0.0);
+			continue;
+		}
+
+		zencp_event(z, ZE_RECEIVING, path, tracks[i], 0, 0.0, 0.0);
+		sending.z = z;
+		sending.tag = tracks[i];
+		t0 = stats_now();
+		if (!download_track(z->player, tracks[i], path, z->options.id3v1,
+				    (z->callbacks.progress) ? zencp_progress : 0, &sending)) {
+			z->stats.failed++;
+			zencp_event(z, ZE_FAILED, path, tracks[i], 0, 0.0, 0.0);
+			done = 0;
+			continue;
+		}
+		seconds = stats_now() - t0;
+
+		stats_add(&z->stats, tracks[i]->size, seconds);
+		library_add_fetched(&z->library, path, z->device, tracks[i]->trackid);
+		zencp_event(z, ZE_RECEIVED, path, tracks[i], 0, 0.0, 0.0);
+	}
+	library_save(&z->library);
+	return done;
+}
+
+
+int zencp_copy(struct zencp *z, s_id3_tag **tracks, unsigned int count) {
+	struct zencp_sending sending;
+	struct copy c;
+	struct copy_slot *slot;
+	s_id3_tag **todo, *tag, *track;
+	unsigned int i, n = 0, trackid, source_id;
+	double t0, seconds;
+	int done = 1;
+
+	if ((!z->player) || (!z->source)) {
+		z->error = PL_COMM;
+		return 0;
+	}
+	if (!count) return 1;
+	if (!(todo = (s_id3_tag**)malloc(count * sizeof(s_id3_tag*)))) {
+		z->error = G_NOMEM;
+		return 0;
+	}
+
+	/* only the tracks that the destination does not have yet are fetched */
+	for (i = 0; i < count; i++) {
+		if ((!z->options.force) && (tracklist_find_tag(&z->tracklist, tracks[i]))) {
+			z->stats.skipped++;
+			zencp_event(z, ZE_EXISTS, 0, tracks[i], 0, 0.0, 0.0);
+		} else {
+			todo[n++] = tracks[i];
+		}
+	}
+
+	if (!copy_init(&c, z->source, todo, n, 0)) {
+		free(todo);
+		z->error = G_NOMEM;
+		return 0;
+	}
+	copy_start(&c);
+
+	while ((slot = copy_next(&c))) {
+		tag = slot->tag;
+		if (!slot->ok) {
+			copy_done(&c, slot);
+			z->stats.failed++;
+			zencp_event(z, ZE_FAILED, 0, tag, 0, 0.0, 0.0);
+			done = 0;
+			continue;
+		}
+
+		/* the track is overwritten, so the old one goes first */
+		if ((z->options.force) && (track = tracklist_find_tag(&z->tracklist, tag))) zencp_remove(z, track);
+
+		zencp_event(z, ZE_SENDING, 0, tag, 0, 0.0, 0.0);
+		sending.z = z;
+		sending.tag = tag;
+		t0 = stats_now();
+		trackid = player_send_track(z->player, slot->path, tag,
+					    (z->callbacks.progress) ? zencp_progress : 0, &sending);
+		seconds = stats_now() - t0;
+		copy_done(&c, slot);
+
+		if (!trackid) {
+			z->stats.failed++;
+			zencp_event(z, ZE_FAILED, 0, tag, 0, 0.0, 0.0);
+			done = 0;
+			continue;
+		}
+
+		/* the tracklist of the destination gets a copy with the new track ID,
+		 * the tag itself still belongs to the source */
+		stats_add(&z->stats, tag->size, seconds);
+		source_id = tag->trackid;
+		tag->trackid = trackid;
+		tracklist_insert(&z->tracklist, tag);
+		zencp_event(z, ZE_SENT, 0, tag, 0, 0.0, 0.0);
+		tag->trackid = source_id;
+	}
+
+	copy_free(&c);
+	free(todo);
+	return done;
+}
+
+
+void zencp_release(struct zencp *z) {
+	if (z->player) player_release(&z->player);
+	if (z->source) player_release(&z->source);
+}
+
+
+int zencp_release_all(struct zencp *z) {
+	njb_t *player;
+	int i, n = 0;
+
+	/* a player that did not answer would not answer now either */
+	for (i = 0; i < z->nplayers; i++) {
+		player = &(z->players[i]);
+		if ((!z->lost[i]) && (player_release(&player))) n++;
+	}
+	z->player = 0;
+	z->source = 0;
+	return n;
+}
+
+
+int zencp_stream(struct zencp *z, FILE *in, mp3_file *files) {
+	pthread_mutex_t lock;
+	struct stream s;
+	struct stream_item item;
+	s_id3_tag *tag, *track;
+	int answer, done = 1;
+
+	if (!z->player) {
+		z->error = PL_COMM;
+		zencp_drop(list_first_element(files));
+		return 0;
+	}
+
+	/* the scanner of the stream adds files to the library while we add tracks */
+	pthread_mutex_init(&lock, 0);
+	stream_init(&s, in, files, &z->library, &lock, z->options.id3v1, z->options.threads, z->options.memory);
+	z->lock = &lock;
+	if (!stream_start(&s)) done = 0;
+
+	while ((done) && (stream_next(&s, &item))) {
+		if (!(tag = item.file->tag)) {
+			zencp_event(z, ZE_UNREADABLE, item.file->filename, 0, 0, 0.0, 0.0);
+			stream_done(&s, &item);
+			continue;
+		}
+
+		/* the names of tracks sent since the tags were read are interned now,
+		 * the places of the library know these tracks, too, so files with the
+		 * same audio data or names are sent once */
+		id3_settle(tag);
+		track = zencp_find_duplicate(z, item.file);
+		if ((track) && (!z->options.force)) {
+			z->stats.skipped++;
+			zencp_event(z, ZE_EXISTS, item.file->filename, tag, 0, 0.0, 0.0);
+		} else {
+			answer = (z->callbacks.decide) ? z->callbacks.decide(z->callbacks.user, tag, track) : ZD_SEND;
+			if (answer == ZD_QUIT) {
+				zencp_event(z, ZE_ABORTED, item.file->filename, tag, 0, 0.0, 0.0);
+				done = 0;
+			} else if (answer == ZD_SEND) {
+				zencp_send(z, item.file, track);
+			}
+		}
+		stream_done(&s, &item);
+	}
+
+	stream_free(&s);
+	z->lock = 0;
+	pthread_mutex_destroy(&lock);
+	library_save(&z->library);
+	return done;
+}
+
+
+mp3_file* zencp_add_playlists(struct zencp *z, mp3_file *files) {
+	struct playlist *p, **last;
+	mp3_file *f, *next, *n;
+	unsigned int i;
+
+	for (last = &z->playlists; *last; last = &(*last)->next);
+
+	for (f = list_first_element(files); f; f = next) {
+		next = f->next;
+		if (!playlist_is(f->filename)) continue;
+
+		if (!(p = playlist_read(f->filename))) {
+			zencp_event(z, ZE_UNREADABLE, f->filename, 0, 0, 0.0, 0.0);
+		} else {
+			*last = p;
+			last = &p->next;
+
+			/* the files take the place of the playlist, so albums stay together */
+			for (i = 0; i < p->n; i++) {
+				if ((search_file(f, p->files[i])) || (!(n = new_mp3_element(p->files[i])))) continue;
+				list_insert_before(f, n);
+			}
+		}
+
+		/* the files of the playlist are not looked at again, so playlists in
+		 * playlists are not followed */
+		files = (f->prev) ? f->prev : next;
+		list_delete(f, 0);
+	}
+	return list_first_element(files);
+}
+
+
+int zencp_playlists(struct zencp *z) {
+	struct playlist *p;
+	mp3_file *files = 0, *last = 0, *f;
+	s_id3_tag *tag, *track;
+	unsigned int i, n;
+	int done = 1;
+
+	if (!z->player) {
+		z->error = PL_COMM;
+		return 0;
+	}
+
+	/* the files are found like the duplicates of a transfer, the fingerprints
+	 * are known from it */
+	for (p = z->playlists; p; p = p->next) {
+		for (i = 0; i < p->n; i++) {
+			if ((f = new_mp3_element(p->files[i]))) last = (last) ? list_append(last, f) : (files = f);
+		}
+	}
+	library_scan(&z->library, files, z->options.threads);
+
+	for (p = z->playlists, f = files; p; p = p->next) {
+		for (i = 0; (i < p->n) && (f); i++, f = f->next) {
+			p->trackids[i] = 0;
+			if ((tag = id3_get_id3_struct(f->filename, z->options.id3v1))) {
+				f->tag = tag;
+				if ((track = zencp_find_duplicate(z, f))) p->trackids[i] = track->trackid;
+				id3_delete_id3_struct(tag);
+				f->tag = 0;
+			}
+			if (!p->trackids[i]) zencp_event(z, ZE_LEFT_OUT, p->files[i], 0, 0, 0.0, 0.0);
+		}
+	}
+	zencp_drop(files);
+
+	/* all playlists in one go, the player's own are read only once */
+	player_update_playlists(z->player, z->playlists);
+	for (p = z->playlists; p; p = p->next) {
+		for (i = n = 0; i < p->n; i++) {
+			if (p->trackids[i]) n++;
+		}
+		if (p->state == PS_SAME) {
+			zencp_event(z, ZE_EXISTS, p->name, 0, n, 0.0, 0.0);
+		} else if (p->state == PS_WRITTEN) {
+			zencp_event(z, ZE_PLAYLIST, p->name, 0, n, 0.0, 0.0);
+		} else {
+			zencp_event(z, ZE_FAILED, p->name, 0, 0, 0.0, 0.0);
+			done = 0;
+		}
+	}
+	return done;
+}
+
+
+void zencp_free(struct zencp *z) {
+	zencp_release(z);
+	if (z->loaded) library_save(&z->library);
+	library_free(&z->library);
+	tracklist_free(&z->tracklist);
+	tracklist_free(&z->source_tracklist);
+	playlist_free(z->playlists);
+	z->playlists = 0;
+	device_cache_save(&z->devices);
+	device_cache_free(&z->devices);
+	z->cached = 0;
+	z->loaded = 0;
+	z->tracks = 0;
+	z->source_tracks = 0;
+}
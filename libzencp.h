@@ -0,0 +1,411 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * libzencp.h - header file for the zencp library
+ *
+ * This file provides the prototypes and structures of libzencp, the core
+ * of zencp that can be linked into other programs (libzencp.a and
+ * libzencp.so). Everything a run needs is kept in a context (struct zencp):
+ * the discovered players, the captured player, its tracklist, the library
+ * of fingerprints, the options and the statistics. There is no global
+ * state besides the string table of intern.h, which is a cache that is
+ * shared by all contexts and may be used by several threads at once.
+ *
+ * The library does not print anything. What happens during a transfer is
+ * reported to the callbacks of the context, which also decide whether a
+ * file is sent. A context is used by one thread at a time, but several
+ * contexts (one per player) may be used by several threads. zencp_shard()
+ * sends to all players at once; it calls the callbacks from several
+ * threads, but never two of them at the same time.
+ *
+ * A typical program looks like this:
+ *
+ *   struct zencp z;
+ *
+ *   zencp_init(&z);
+ *   z.options.id3v1 = 1;
+ *   if ((zencp_discover(&z) > 0) && (zencp_open(&z, 0))) {
+ *           zencp_load(&z);
+ *           zencp_transfer(&z, files);
+ *   }
+ *   zencp_free(&z);
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_LIBZENCP_H
+#define __ZENCP_LIBZENCP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <regex.h>
+#include <pthread.h>
+#include <id3.h>
+#include <libnjb.h>
+
+/* the headers of zencp are C, so C++ programs have to be told */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "list.h"
+#include "id3.h"
+#include "player.h"
+#include "tracklist.h"
+#include "schedule.h"
+#include "stats.h"
+#include "library.h"
+#include "device.h"
+#include "survey.h"
+#include "scan.h"
+#include "shard.h"
+#include "download.h"
+#include "copy.h"
+#include "source.h"
+#include "transcode.h"
+#include "loudness.h"
+#include "datafile.h"
+#include "playlist.h"
+#include "stream.h"
+#include "misc.h"
+
+/* the version of the API, it is raised whenever a structure or prototype changes */
+#define LIBZENCP_API_VERSION 13
+
+/* how often a file that failed is sent again unless the options say otherwise */
+#define _ZENCP_RETRIES 1
+
+/**
+ * The answers of the decide callback.
+ */
+enum zencp_decision {
+	ZD_SEND,		/* send the file */
+	ZD_SKIP,		/* do not send the file */
+	ZD_QUIT			/* stop the transfer */
+};
+
+/**
+ * What the event callback is told about, see struct zencp_event.
+ */
+enum zencp_event_type {
+	ZE_SAME_AUDIO,		/* count files have the same audio data as others */
+	ZE_PLAN,		/* the deadline plan: seconds left at rate bytes/s */
+	ZE_UNREADABLE,		/* the tags of filename could not be read */
+	ZE_EXISTS,		/* tag is already on the player, it is skipped */
+	ZE_SENDING,		/* tag is about to be sent */
+	ZE_SENT,		/* tag has been sent, its track ID is set */
+	ZE_FAILED,		/* tag could not be sent (or fetched to filename) */
+	ZE_DEADLINE,		/* count files are not started, seconds are left */
+	ZE_ABORTED,		/* the decide callback said ZD_QUIT */
+	ZE_NOROOM,		/* count files do not fit on any player */
+	ZE_RECEIVING,		/* tag is about to be fetched to filename */
+	ZE_RECEIVED,		/* tag has been fetched to filename */
+	ZE_PRESENT,		/* tag has been fetched to filename before, it is skipped */
+	ZE_ANALYSED,		/* the loudness of count files has been measured */
+	ZE_RETRYING,		/* tag could not be sent, it is sent again for the
+				   count-th time */
+	ZE_DELETED,		/* tag has been deleted, it is freed after the event */
+	ZE_PLAYLIST,		/* the playlist filename has been written with count
+				   tracks */
+	ZE_LEFT_OUT		/* filename of a playlist is not on the player, it is
+				   left out of the playlist */
+};
+
+/**
+ * An event of a transfer. Only the fields named in enum zencp_event_type are set.
+ */
+struct zencp_event {
+	int type;		/* see enum zencp_event_type */
+	const char *filename;	/* the file the event is about */
+	s_id3_tag *tag;		/* its tags, NULL for data files */
+	unsigned int count;	/* a number of files */
+	double seconds;		/* the time left before the deadline */
+	double rate;		/* the assumed throughput in bytes per second */
+	int player;		/* the index of the player in the array of players,
+				   -1 if the event is not about a player */
+};
+
+/**
+ * The callbacks of a context. All of them may be NULL and get user as their
+ * first argument.
+ */
+struct zencp_callbacks {
+	/* progress() is called while tag is being sent, sent of total bytes are done */
+	void	(*progress)(void *user, s_id3_tag *tag, unsigned long long sent,
+			    unsigned long long total);
+	/* decide() is called before tag is sent; existing is the track on the player
+	 * that will be overwritten or NULL. It returns one of enum zencp_decision,
+	 * without it every file is sent. */
+	int	(*decide)(void *user, s_id3_tag *tag, s_id3_tag *existing);
+	/* event() is told what happens during a transfer */
+	void	(*event)(void *user, const struct zencp_event *event);
+	void	*user;
+};
+
+/**
+ * The options of a context. They may be changed at any time between calls.
+ */
+struct zencp_options {
+	char id3v1;		/* use ID3v1 tags instead of ID3v2 */
+	char force;		/* overwrite tracks that are on the player */
+	double deadline;	/* the time budget of a transfer in seconds, < 0 for none */
+	double start;		/* when the budget started (see stats_now()), 0 means
+				   when zencp_transfer() is called */
+	int threads;		/* the threads for fingerprints, 0 means one per CPU */
+	int devices;		/* the players that are talked to at once, 0 means
+				   _SURVEY_THREADS (see survey.h) */
+	double timeout;		/* the seconds a player may take to answer when all
+				   players are asked, 0 means _SURVEY_TIMEOUT */
+	const char *transcode;	/* the encoder for files that are not MP3 (see
+				   transcode.h), NULL if they are sent as they are */
+	int normalize;		/* what is done with the loudness of the files, see
+				   enum loudness_mode in loudness.h */
+	const char *decoder;	/* the decoder for the loudness, NULL means
+				   _LOUDNESS_DECODER */
+	int retries;		/* how often a failed file is sent again */
+	size_t memory;		/* the memory budget of zencp_stream() in bytes, 0
+				   means _STREAM_MEMORY */
+};
+
+/**
+ * A context. Its fields may be read, but are only changed by the functions below
+ * (except for options and callbacks).
+ */
+struct zencp {
+	njb_t players[_MAX_PLAYERS];	/* the discovered players */
+	int nplayers;			/* their number */
+	njb_t *player;			/* the captured player or NULL */
+	struct device_id id;		/* its identity */
+	int error;			/* the error of the last failed call, see misc.h */
+	char lost[_MAX_PLAYERS];	/* the players that did not answer in time */
+	struct device_cache devices;	/* the serial numbers of players by USB path */
+	int cached;			/* the cache has been loaded */
+
+	struct tracklist tracklist;	/* the tracks on the captured player */
+	unsigned int tracks;		/* their number when they were read */
+	struct library library;		/* the fingerprints of files and tracks */
+	int loaded;			/* the library has been loaded */
+	char device[256];		/* the key of the player in the library */
+
+	njb_t *source;			/* the captured source of a copy or NULL */
+	struct device_id source_id;	/* its identity */
+	struct tracklist source_tracklist;	/* its tracks */
+	unsigned int source_tracks;	/* their number when they were read */
+
+	struct playlist *playlists;	/* the playlists of the transfer, see
+					   zencp_add_playlists() */
+
+	pthread_mutex_t *lock;		/* guards the library during zencp_stream(),
+					   NULL otherwise */
+	struct schedule *sched;		/* the scheduler of a transfer with deadline */
+	struct transfer_stats stats;	/* what has been transferred */
+	struct zencp_options options;
+	struct zencp_callbacks callbacks;
+};
+
+/**
+ * zencp_init() sets up a context without players, with the default options and
+ * without callbacks.
+ */
+void		zencp_init(struct zencp *z);
+
+/**
+ * zencp_discover() looks for connected players. It returns their number or -1 if
+ * the discovery failed.
+ */
+int		zencp_discover(struct zencp *z);
+
+/**
+ * zencp_open() captures the player given by name, its serial number (or a prefix
+ * of at least 4 digits) or its USB path (see device.h), or the first player that
+ * is not captured yet if name is NULL. Only the players that may be the one are opened; if the cache of
+ * serial numbers does not know it, the other players are asked in parallel (see
+ * zencp_survey()). It returns the player or NULL, in which case z->error is
+ * PL_COMM or PL_NOID.
+ */
+njb_t*		zencp_open(struct zencp *z, const char *name);
+
+/**
+ * zencp_open_source() captures the player given by name (or the first one that is
+ * not captured if name is NULL) as the source of zencp_copy(). It returns the
+ * player or NULL, in which case z->error is PL_COMM or PL_NOID.
+ */
+njb_t*		zencp_open_source(struct zencp *z, const char *name);
+
+/**
+ * zencp_survey() talks to all discovered players that are not captured at once
+ * (see survey.h for the modes), except for those whose entry in skip is non-zero
+ * (skip may be NULL). results must have room for z->nplayers entries, which are
+ * in the order of the players. Serial numbers that were read are cached and
+ * players that did not answer in time are never used again. It returns the
+ * number of players that answered.
+ */
+int		zencp_survey(struct zencp *z, int mode, const char *skip,
+			     struct survey_result *results);
+
+/**
+ * zencp_load() reads the tracklist of the captured player and loads the library.
+ * It returns the number of tracks on the player.
+ */
+unsigned int	zencp_load(struct zencp *z);
+
+/**
+ * zencp_load_source() reads the tracklist of the source player. It returns the
+ * number of tracks on it.
+ */
+unsigned int	zencp_load_source(struct zencp *z);
+
+/**
+ * zencp_find_duplicate() returns the track on the captured player that file
+ * (whose tags have been read into file->tag) would duplicate or NULL.
+ */
+s_id3_tag*	zencp_find_duplicate(struct zencp *z, mp3_file *file);
+
+/**
+ * zencp_send() sends file (whose tags have been read into file->tag) to the
+ * captured player. If existing is non-NULL, that track is deleted first. The
+ * transfer is booked in the statistics, the library and the tracklist. It returns
+ * the track ID of the new track or 0 if the file could not be sent.
+ */
+unsigned int	zencp_send(struct zencp *z, mp3_file *file, s_id3_tag *existing);
+
+/**
+ * zencp_send_source() sends the data of src (see source.h), e.g. a pipe or a
+ * buffer, as a track with the metadata of tag, whose size is set to that of the
+ * data. No file is needed, so tag may come from anywhere, but all of its fields
+ * must have been read (tag->valid is _ID3_ALL). The transfer is booked like that of zencp_send(). It returns the
+ * track ID of the new track or 0 if it could not be sent.
+ */
+unsigned int	zencp_send_source(struct zencp *z, struct source *src, s_id3_tag *tag);
+
+/**
+ * zencp_delete() deletes the track with the given track ID from the captured
+ * player and its tracklist. It returns 1 on success and 0 otherwise.
+ */
+int		zencp_delete(struct zencp *z, unsigned int trackid);
+
+/**
+ * zencp_delete_tracks() deletes the count tracks (from the tracklist of the
+ * captured player, see query_run()) one after the other. The tracklist and the
+ * library follow every single track, the statistics count the bytes that have
+ * been freed. The entries of tracks are not valid afterwards. It returns 1 if
+ * every track has been deleted and 0 otherwise.
+ */
+int		zencp_delete_tracks(struct zencp *z, s_id3_tag **tracks, unsigned int count);
+
+/**
+ * zencp_transfer() sends all files of the list to the captured player: files
+ * with the same audio data are sent once, tracks that are on the player are
+ * skipped (unless the force option is set) and with a deadline the files are
+ * sent in the order of the plan (see schedule.h). With the transcode option,
+ * files that are not MP3 are encoded while the others are sent and follow them.
+ * With the normalize option, the loudness of the MP3 files is measured first.
+ * Afterwards, the playlists of zencp_add_playlists() are written to the player
+ * (see zencp_playlists()). The list is freed, the names of its files belong to
+ * the caller. It returns 1 if all files have been handled and 0 if the transfer
+ * was stopped by the deadline or the decide callback.
+ */
+int		zencp_transfer(struct zencp *z, mp3_file *files);
+
+/**
+ * zencp_stream() sends the files of the list and then those named by the lines
+ * of in (which may be NULL) to the captured player like zencp_transfer(), but
+ * while the names are read (see stream.h): the files waiting to be sent stay
+ * within the memory option, however many files there are, and only the tracks
+ * that are sent leave their names and places behind. New files are not added
+ * to the library, so the next run fingerprints them again. Files are only
+ * compared with the tracks on the player, which include the ones sent before;
+ * the deadline, transcode and normalize options and playlists are not used.
+ * The list is freed. It returns 1 if all files have been handled and 0 if the
+ * transfer was stopped by the decide callback or could not be started.
+ */
+int		zencp_stream(struct zencp *z, FILE *in, mp3_file *files);
+
+/**
+ * zencp_add_playlists() replaces every playlist (see playlist_is()) in the list
+ * of files by the files it lists that are not in the list yet and keeps the
+ * playlist for zencp_playlists(). A playlist that cannot be read is reported as
+ * ZE_UNREADABLE. The elements of the playlists are freed, but not their names.
+ * It returns the new head of the list.
+ */
+mp3_file*	zencp_add_playlists(struct zencp *z, mp3_file *files);
+
+/**
+ * zencp_playlists() looks up the track IDs of the files of the playlists of
+ * zencp_add_playlists() on the captured player, like zencp_transfer() finds
+ * duplicates, and writes them with the player's playlists of the same names
+ * (see player_update_playlists()). Files that are not on the player are left
+ * out. A playlist that the player has with the same tracks is reported as
+ * ZE_EXISTS and one that could not be written as ZE_FAILED, both without a tag.
+ * It returns 1 if every playlist is on the player and 0 otherwise.
+ */
+int		zencp_playlists(struct zencp *z);
+
+/**
+ * zencp_send_data() copies the directory tree dir to the data area of the captured
+ * player (see datafile.h), below a folder that is named like dir. Files that are
+ * there with the same size and are not older are skipped unless the force option
+ * is set, other files of the same name are replaced. The files are read ahead and
+ * sent again if they fail like tracks; the progress and event callbacks are called
+ * with a NULL tag, the decide callback and the deadline are not used. It returns 1
+ * if every file is on the player and 0 otherwise.
+ */
+int		zencp_send_data(struct zencp *z, const char *dir);
+
+/**
+ * zencp_shard() spreads the files of the list over all discovered players that
+ * are not captured yet (see shard.h), which are captured for the time of the
+ * transfer: every file is sent to one player that has room for it, unless one of
+ * the players already has it (and the force option is not set). All players send at the same time. The
+ * decide and progress callbacks and the deadline are not used. The list is freed
+ * and the result is left in s, which has been set up by shard_init(). It returns
+ * 1 if every file is on a player and 0 otherwise; z->error is PL_COMM if no player
+ * could be captured.
+ */
+int		zencp_shard(struct zencp *z, mp3_file *files, struct shard *s);
+
+/**
+ * zencp_download() fetches the count tracks (from the tracklist of the captured
+ * player, see query_run()) to files below the directory dir (see download.h).
+ * A track whose file has been fetched by an earlier run is skipped, the library
+ * recognizes it by its audio data (see library_add_fetched()), so its tags may
+ * have been rewritten since. It returns 1 if every track is there and 0 otherwise.
+ */
+int		zencp_download(struct zencp *z, s_id3_tag **tracks, unsigned int count, const char *dir);
+
+/**
+ * zencp_copy() copies the count tracks (from the tracklist of the source player,
+ * see query_run()) to the captured player. They are streamed through memory (see
+ * copy.h) and keep the metadata of the source. Tracks that the captured player
+ * has are skipped unless the force option is set. The decide callback is not
+ * used. It returns 1 if every track has been copied or skipped and 0 otherwise.
+ */
+int		zencp_copy(struct zencp *z, s_id3_tag **tracks, unsigned int count);
+
+/**
+ * zencp_release() releases the captured player and source, if there are any.
+ */
+void		zencp_release(struct zencp *z);
+
+/**
+ * zencp_release_all() releases every discovered player, e.g. from a signal
+ * handler. It returns the number of players that were released.
+ */
+int		zencp_release_all(struct zencp *z);
+
+/**
+ * zencp_free() releases the player, saves the library and frees everything the
+ * context holds.
+ */
+void		zencp_free(struct zencp *z);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
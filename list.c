@@ -86,11 +86,28 @@ mp3_file* list_remove(mp3_file *e) {
 	return t;
 }
 
+mp3_file* list_delete(mp3_file *e, int owned) {
+	mp3_file *t;
+
+	if (!e) return 0;
+
+	/* unlike list_remove(), an element without neighbours is freed as well */
+	t = e->next;
+	if (e->prev) e->prev->next = e->next;
+	if (e->next) e->next->prev = e->prev;
+
+	if (owned) free(e->filename);
+	free(e);
+	return t;
+}
+
 mp3_file* new_mp3_element(char *filename) {
 	mp3_file *n = (mp3_file*)malloc(sizeof(mp3_file));
 	if (!n) return 0;
 	
 	n->filename = filename;
+	n->tag = 0;
+	n->hash = 0;
 	n->prev = n->next = 0;
 
 	return n;
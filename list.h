@@ -29,6 +29,10 @@
  */
 struct mp3_file_struct {
 	char *filename;
+	struct id3_struct *tag;	/* the ID3 tags of the file if they have been read
+				   in advance, NULL otherwise */
+	unsigned long long hash;	/* the fingerprint of the audio data, 0 if it
+					   is unknown (see fingerprint.h) */
 
 	struct mp3_file_struct *prev;
 	struct mp3_file_struct *next;
@@ -78,6 +82,15 @@ mp3_file* list_insert_after(mp3_file *e, mp3_file *n);
  */
 mp3_file* list_remove(mp3_file *e);
 
+/**
+ * list_delete() removes element e from the doubly linked list it is
+ * contained in and frees it, even if it is the only element of the list.
+ * Its filename is freed as well if owned is set, i.e. if the list owns
+ * its names. It returns the element that came immediately after e or
+ * NULL if e was the last element.
+ */
+mp3_file* list_delete(mp3_file *e, int owned);
+
 
 /**
  * append_new_file() will insert a new element with filename into 
@@ -0,0 +1,377 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * loudness.c - implementation file for the loudness normalization
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "loudness.h"
+
+/* the K-weighting filters of BS.1770 for 48 kHz: a shelving filter that models
+ * the head and a high pass */
+#define _K_SB0 1.53512485958697
+#define _K_SB1 (-2.69169618940638)
+#define _K_SB2 1.19839281085285
+#define _K_SA1 (-1.69065929318241)
+#define _K_SA2 0.73248077421585
+#define _K_HA1 (-1.99004745483398)
+#define _K_HA2 0.99007225036621
+
+/* the bitrates of layer III in kbit/s for MPEG 1 and for MPEG 2 and 2.5 */
+static const unsigned int loudness_bitrates[2][15] = {
+	{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+	{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 }
+};
+
+/* the sample rates of MPEG 1, they are halved for MPEG 2 and quartered for 2.5 */
+static const unsigned int loudness_rates[3] = { 44100, 48000, 32000 };
+
+/**
+ * A file that is analysed by loudness_scan().
+ */
+struct loudness_job {
+	const char *filename;
+	unsigned long long hash;
+	double loudness;		/* the results */
+	double peak;
+	int ok;				/* the file could be decoded */
+};
+
+/**
+ * What the threads of loudness_scan() share.
+ */
+struct loudness_jobs {
+	struct loudness_job *jobs;
+	const char *decoder;
+};
+
+
+int loudness_parse_mode(const char *name) {
+	if (!name) return -1;
+	if (!strcmp(name, "off")) return LM_OFF;
+	if (!strcmp(name, "tag")) return LM_TAG;
+	if (!strcmp(name, "apply")) return LM_APPLY;
+	return -1;
+}
+
+
+void loudness_init(struct loudness *l) {
+	memset(l, 0, sizeof(struct loudness));
+}
+
+
+/**
+ * loudness_step() stores the mean square of the 100 ms that are complete. It
+ * returns 1 on success and 0 if there is no memory.
+ */
+static int loudness_step(struct loudness *l) {
+	double *steps;
+	unsigned int size;
+
+	if (l->n == l->size) {
+		size = (l->size) ? 2 * l->size : 1024;
+		if (!(steps = (double*)realloc(l->steps, size * sizeof(double)))) {
+			print_error(G_NOMEM);
+			return 0;
+		}
+		l->steps = steps;
+		l->size = size;
+	}
+
+	l->steps[l->n++] = l->energy / _LOUDNESS_STEP;
+	l->energy = 0.0;
+	l->count = 0;
+	return 1;
+}
+
+
+int loudness_add(struct loudness *l, const float *samples, size_t frames) {
+	double x[2], y[2], z[2];
+	float a, peak = (float)l->peak;
+	size_t i;
+	int c;
+
+	/* the peak is a loop of its own, so that it can be done with SIMD */
+	for (i = 0; i < 2 * frames; i++) {
+		a = fabsf(samples[i]);
+		peak = (a > peak) ? a : peak;
+	}
+	l->peak = peak;
+
+	for (i = 0; i < frames; i++) {
+		/* the recursion of the filters goes from one sample to the next, but the
+		 * two channels are independent and are filtered side by side */
+		for (c = 0; c < 2; c++) {
+			x[c] = samples[2 * i + c];
+			y[c] = _K_SB0 * x[c] + l->s1[c];
+			l->s1[c] = _K_SB1 * x[c] - _K_SA1 * y[c] + l->s2[c];
+			l->s2[c] = _K_SB2 * x[c] - _K_SA2 * y[c];
+			z[c] = y[c] + l->t1[c];
+			l->t1[c] = -2.0 * y[c] - _K_HA1 * z[c] + l->t2[c];
+			l->t2[c] = y[c] - _K_HA2 * z[c];
+		}
+		l->energy += z[0] * z[0] + z[1] * z[1];
+
+		if ((++l->count == _LOUDNESS_STEP) && (!loudness_step(l))) return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * loudness_lufs() returns the loudness of the mean square z.
+ */
+static double loudness_lufs(double z) {
+	return (z > 0.0) ? -0.691 + 10.0 * log10(z) : -HUGE_VAL;
+}
+
+
+double loudness_result(struct loudness *l) {
+	double z, sum = 0.0, gate;
+	unsigned int i, k = 0;
+
+	/* the blocks are 400 ms long and overlap by 300 ms */
+	for (i = 0; i + 3 < l->n; i++) {
+		z = (l->steps[i] + l->steps[i + 1] + l->steps[i + 2] + l->steps[i + 3]) / 4.0;
+		if (loudness_lufs(z) > _LOUDNESS_SILENCE) {
+			sum += z;
+			k++;
+		}
+	}
+	if (!k) return _LOUDNESS_SILENCE;
+
+	/* the quiet passages do not count, the relative gate is 10 LU below the rest */
+	gate = loudness_lufs(sum / k) - 10.0;
+	sum = 0.0;
+	k = 0;
+	for (i = 0; i + 3 < l->n; i++) {
+		z = (l->steps[i] + l->steps[i + 1] + l->steps[i + 2] + l->steps[i + 3]) / 4.0;
+		if ((loudness_lufs(z) > _LOUDNESS_SILENCE) && (loudness_lufs(z) > gate)) {
+			sum += z;
+			k++;
+		}
+	}
+	return (k) ? loudness_lufs(sum / k) : _LOUDNESS_SILENCE;
+}
+
+
+void loudness_free(struct loudness *l) {
+	free(l->steps);
+	loudness_init(l);
+}
+
+
+int loudness_file(const char *filename, const char *decoder, double *loudness, double *peak) {
+	float samples[2 * _LOUDNESS_FRAMES];
+	char *buffer = (char*)samples;
+	struct loudness l;
+	size_t have = 0, frames;
+	ssize_t n;
+	pid_t pid;
+	int fd, r = 1;
+
+	if ((fd = transcode_open((decoder) ? decoder : _LOUDNESS_DECODER, filename, &pid)) < 0) return 0;
+
+	loudness_init(&l);
+	for (;;) {
+		if ((n = read(fd, buffer + have, sizeof(samples) - have)) < 0) {
+			if (errno == EINTR) continue;
+			r = 0;
+			break;
+		}
+		if (n == 0) break;
+		have += n;
+
+		/* a frame may be cut in two by the pipe */
+		frames = have / (2 * sizeof(float));
+		if ((frames) && (!loudness_add(&l, samples, frames))) {
+			r = 0;
+			break;
+		}
+		have -= frames * 2 * sizeof(float);
+		memmove(buffer, buffer + frames * 2 * sizeof(float), have);
+	}
+
+	r = (transcode_close(fd, pid)) && (r);
+	if (r) {
+		if (loudness) *loudness = loudness_result(&l);
+		if (peak) *peak = l.peak;
+	}
+	loudness_free(&l);
+	return r;
+}
+
+
+/**
+ * loudness_job() analyses one file for loudness_scan().
+ */
+static void loudness_job(void *ctx, unsigned int i) {
+	struct loudness_jobs *j = (struct loudness_jobs*)ctx;
+	struct loudness_job *job = &j->jobs[i];
+
+	job->ok = loudness_file(job->filename, j->decoder, &job->loudness, &job->peak);
+}
+
+
+unsigned int loudness_scan(struct library *lib, mp3_file *list, const char *decoder, int threads) {
+	struct loudness_jobs j;
+	unsigned int n = 0, i;
+	mp3_file *f;
+
+	if ((!lib) || (!list)) return 0;
+
+	for (f = list; f; f = f->next) n++;
+	if (!(j.jobs = (struct loudness_job*)malloc(n * sizeof(struct loudness_job)))) {
+		print_error(G_NOMEM);
+		return 0;
+	}
+	j.decoder = decoder;
+
+	/* files without a fingerprint could not be read, those with a known one have
+	 * been analysed before */
+	n = 0;
+	for (f = list; f; f = f->next) {
+		if ((!f->hash) || (library_get_gain(lib, f->hash, 0, 0))) continue;
+		j.jobs[n].filename = f->filename;
+		j.jobs[n].hash = f->hash;
+		j.jobs[n].ok = 0;
+		n++;
+	}
+
+	pool_run(n, threads, loudness_job, &j);
+
+	for (i = 0; i < n; i++) {
+		if (j.jobs[i].ok) library_set_gain(lib, j.jobs[i].hash, j.jobs[i].loudness, j.jobs[i].peak);
+	}
+
+	free(j.jobs);
+	return n;
+}
+
+
+double loudness_gain(double loudness, double peak) {
+	double gain;
+
+	if ((loudness <= _LOUDNESS_SILENCE) || (peak <= 0.0)) return 0.0;
+
+	gain = _LOUDNESS_TARGET - loudness;
+	if (gain > -20.0 * log10(peak)) gain = -20.0 * log10(peak);
+	return gain;
+}
+
+
+/**
+ * loudness_get_bits() returns the n bits of p that start at bit (counted from the
+ * highest bit of the first byte).
+ */
+static unsigned int loudness_get_bits(const unsigned char *p, unsigned int bit, unsigned int n) {
+	unsigned int v = 0;
+
+	for (; n; n--, bit++) v = (v << 1) | ((p[bit >> 3] >> (7 - (bit & 7))) & 1);
+	return v;
+}
+
+
+/**
+ * loudness_set_bits() stores v in the n bits of p that start at bit.
+ */
+static void loudness_set_bits(unsigned char *p, unsigned int bit, unsigned int n, unsigned int v) {
+	unsigned char mask;
+
+	for (; n; n--, bit++) {
+		mask = 0x80 >> (bit & 7);
+		if ((v >> (n - 1)) & 1) {
+			p[bit >> 3] |= mask;
+		} else {
+			p[bit >> 3] &= ~mask;
+		}
+	}
+}
+
+
+/**
+ * loudness_crc() adds len bytes at p to the CRC-16 of MPEG audio.
+ */
+static unsigned int loudness_crc(unsigned int crc, const unsigned char *p, size_t len) {
+	int i;
+
+	for (; len; len--, p++) {
+		crc ^= (unsigned int)*p << 8;
+		for (i = 0; i < 8; i++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+	}
+	return crc & 0xffff;
+}
+
+
+int loudness_apply(int fd, double gain) {
+	unsigned char frame[4 + 2 + 32], *side;
+	unsigned int version, lsf, bitrate, rate, length, channels, size, bits, gr, ch, crc, crcbytes;
+	unsigned int bit;
+	int steps, g, n = 0;
+	struct stat st;
+	off_t pos, end;
+
+	/* a file that is made louder must not clip, so that goes down */
+	steps = (gain > 0.0) ? (int)floor(gain / _LOUDNESS_GAIN_STEP) : (int)floor(gain / _LOUDNESS_GAIN_STEP + 0.5);
+	if ((fstat(fd, &st)) || (!fingerprint_payload(fd, st.st_size, &pos, &end))) return -1;
+	if (!steps) return 0;
+
+	while (pos + 4 <= end) {
+		if (pread(fd, frame, 4, pos) != 4) return -1;
+
+		/* layer III frames only, anything else is skipped byte by byte */
+		version = (frame[1] >> 3) & 3;		/* 3: MPEG 1, 2: MPEG 2, 0: MPEG 2.5 */
+		if ((frame[0] != 0xff) || ((frame[1] & 0xe0) != 0xe0) || (version == 1) ||
+		    (((frame[1] >> 1) & 3) != 1) || (!(frame[2] >> 4)) || ((frame[2] >> 4) == 15) ||
+		    (((frame[2] >> 2) & 3) == 3)) {
+			pos++;
+			continue;
+		}
+
+		lsf = (version != 3);
+		bitrate = loudness_bitrates[lsf][frame[2] >> 4] * 1000;
+		rate = loudness_rates[(frame[2] >> 2) & 3] >> ((version == 3) ? 0 : ((version == 2) ? 1 : 2));
+		length = ((lsf) ? 72 : 144) * bitrate / rate + ((frame[2] >> 1) & 1);
+		channels = ((frame[3] >> 6) == 3) ? 1 : 2;
+		crcbytes = (frame[1] & 1) ? 0 : 2;
+
+		/* the side information: its length, where the first granule starts and
+		 * how long a granule of one channel is */
+		if (lsf) {
+			size = (channels == 1) ? 9 : 17;
+			bits = (channels == 1) ? 9 : 10;
+		} else {
+			size = (channels == 1) ? 17 : 32;
+			bits = (channels == 1) ? 18 : 20;
+		}
+		if (pos + length > end) break;
+		if (pread(fd, frame + 4, crcbytes + size, pos + 4) != (ssize_t)(crcbytes + size)) return -1;
+		side = frame + 4 + crcbytes;
+
+		/* global_gain comes after part2_3_length and big_values */
+		for (gr = 0; gr < ((lsf) ? 1u : 2u); gr++) {
+			for (ch = 0; ch < channels; ch++) {
+				bit = bits + (gr * channels + ch) * ((lsf) ? 63 : 59) + 21;
+				g = (int)loudness_get_bits(side, bit, 8) + steps;
+				loudness_set_bits(side, bit, 8, (g < 0) ? 0 : ((g > 255) ? 255 : g));
+			}
+		}
+
+		/* the checksum covers the side information */
+		if (crcbytes) {
+			crc = loudness_crc(loudness_crc(0xffff, frame + 2, 2), side, size);
+			frame[4] = crc >> 8;
+			frame[5] = crc & 0xff;
+		}
+		if (pwrite(fd, frame + 4, crcbytes + size, pos + 4) != (ssize_t)(crcbytes + size)) return -1;
+
+		n++;
+		pos += length;
+	}
+	return n;
+}
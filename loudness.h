@@ -0,0 +1,150 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * loudness.h - header file for the loudness normalization
+ *
+ * The players have no volume normalization, so one album may be much
+ * louder than the next. This file provides the prototypes and structures
+ * that are needed to measure the loudness of the files before they are
+ * sent (EBU R128 / ITU-R BS.1770: K-weighting, 400 ms blocks and the
+ * absolute and relative gates) and to even it out in one of two ways:
+ *
+ *   - tag:   the ReplayGain frames are written to the files on the disk
+ *   - apply: the player gets a copy of the file whose global_gain fields
+ *            are changed. global_gain scales every granule of an MP3 frame
+ *            in steps of 1.5 dB, so nothing has to be decoded or encoded
+ *            again and the data keeps its size
+ *
+ * The files are decoded by an external decoder to 48 kHz stereo float
+ * samples on a pool of threads (see pool.h). The results are kept in the
+ * library by the fingerprint of the audio data (see library.h), so every
+ * file is analysed only once.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_LOUDNESS_H
+#define __ZENCP_LOUDNESS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "list.h"
+#include "id3.h"
+#include "library.h"
+#include "transcode.h"
+#include "fingerprint.h"
+#include "pool.h"
+#include "misc.h"
+
+/* the decoder, which writes 48 kHz stereo 32 bit float samples to stdout */
+#define _LOUDNESS_DECODER "ffmpeg -v quiet -i %i -vn -f f32le -ac 2 -ar 48000 -"
+
+/* the sample rate of the decoder and the samples of 100 ms */
+#define _LOUDNESS_RATE 48000
+#define _LOUDNESS_STEP (_LOUDNESS_RATE / 10)
+
+/* the loudness everything is brought to, that of ReplayGain 2.0 */
+#define _LOUDNESS_TARGET (-18.0)
+
+/* the loudness of silence, which is also the absolute gate */
+#define _LOUDNESS_SILENCE (-70.0)
+
+/* the dB of one step of global_gain */
+#define _LOUDNESS_GAIN_STEP 1.5
+
+/* the number of frames the decoded samples are read in */
+#define _LOUDNESS_FRAMES 4096
+
+/**
+ * What is done with the loudness.
+ */
+enum loudness_mode {
+	LM_OFF,			/* nothing */
+	LM_TAG,			/* the ReplayGain frames are written to the files */
+	LM_APPLY		/* the player gets the files with the gain applied */
+};
+
+/**
+ * The measurement of one file.
+ */
+struct loudness {
+	double s1[2], s2[2];		/* the state of the shelving filter per channel */
+	double t1[2], t2[2];		/* the state of the high pass filter per channel */
+	double energy;			/* the sum of the squares of the current 100 ms */
+	unsigned int count;		/* the samples in it */
+	double *steps;			/* the mean square of every 100 ms */
+	unsigned int n;			/* their number */
+	unsigned int size;		/* the room in steps */
+	double peak;			/* the highest sample */
+};
+
+/**
+ * loudness_parse_mode() returns the mode given by name (off, tag or apply) or -1
+ * if there is none of that name.
+ */
+int		loudness_parse_mode(const char *name);
+
+/**
+ * loudness_init() starts a measurement.
+ */
+void		loudness_init(struct loudness *l);
+
+/**
+ * loudness_add() adds frames stereo frames of interleaved 48 kHz float samples.
+ * It returns 1 on success and 0 if there is no memory.
+ */
+int		loudness_add(struct loudness *l, const float *samples, size_t frames);
+
+/**
+ * loudness_result() returns the integrated loudness of everything that has been
+ * added in LUFS, _LOUDNESS_SILENCE for silence.
+ */
+double		loudness_result(struct loudness *l);
+
+/**
+ * loudness_free() frees a measurement.
+ */
+void		loudness_free(struct loudness *l);
+
+/**
+ * loudness_file() decodes the file filename with decoder (NULL means
+ * _LOUDNESS_DECODER, see transcode_open()) and stores its loudness and peak. It
+ * returns 1 on success and 0 if the file could not be decoded.
+ */
+int		loudness_file(const char *filename, const char *decoder, double *loudness, double *peak);
+
+/**
+ * loudness_scan() analyses all files of the list whose loudness is not in the
+ * library yet on up to threads threads (0 means one per CPU) and records it
+ * there. The fingerprints of the files must be known (see library_scan()). It
+ * returns the number of files that have been analysed.
+ */
+unsigned int	loudness_scan(struct library *lib, mp3_file *list, const char *decoder, int threads);
+
+/**
+ * loudness_gain() returns the gain in dB that brings audio data of the given
+ * loudness to _LOUDNESS_TARGET, but not so far that its peak goes over full scale.
+ */
+double		loudness_gain(double loudness, double peak);
+
+/**
+ * loudness_apply() changes every global_gain of the MP3 data in the file fd in
+ * place by gain dB, rounded to steps of _LOUDNESS_GAIN_STEP (down for a positive
+ * gain, so that a peak limit holds). It returns the number of frames changed or
+ * -1 if the file could not be read or written.
+ */
+int		loudness_apply(int fd, double gain);
+
+#endif
@@ -40,6 +40,33 @@ char is_digit(char c) {
 }
 
 
+char* config_file_path(const char *name) {
+	const char *home = getenv("HOME");
+	char *path;
+	size_t l;
+
+	if ((!home) || (!name)) return 0;
+
+	/* room for "<home>/.zencp/<name>" and the \0 */
+	l = strlen(home) + strlen(name) + 9;
+	path = (char*)malloc(sizeof(char[l]));
+	if (!path) {
+		print_error(G_NOMEM);
+		return 0;
+	}
+
+	/* create the directory first, it is fine if it is already there */
+	snprintf(path, l, "%s/.zencp", home);
+	if ((mkdir(path, 0700)) && (errno != EEXIST)) {
+		free(path);
+		return 0;
+	}
+
+	snprintf(path, l, "%s/.zencp/%s", home, name);
+	return path;
+}
+
+
 void print_error(int msg_num) {
 	fprintf(stderr, " ERROR: ");
 
@@ -48,9 +75,33 @@ void print_error(int msg_num) {
 			break;
 		case OPT_FE: fprintf(stderr, "-F option cannot be used in conjunction with -e option\n\n");
 			break;
-		case OPT_D: fprintf(stderr, "-d option was called without device identifier\n\n");
+		case OPT_D: fprintf(stderr, "-d, --to and --copy-from must be called with a device identifier\n\n");
+			break;
+		case OPT_P: fprintf(stderr, "-p option must be called with at least one file, directory or playlist\n\n");
+			break;
+		case OPT_T: fprintf(stderr, "-t option was called without a valid time budget\n\n");
+			break;
+		case OPT_Q: fprintf(stderr, "invalid query: see -w, -s, -c and -o in the help screen\n\n");
+			break;
+		case OPT_M: fprintf(stderr, "-m option must be called with exact, normal or loose\n\n");
+			break;
+		case OPT_R: fprintf(stderr, "-R option must be called with a track ID and together with -C\n\n");
+			break;
+		case OPT_S: fprintf(stderr, "-S option was called without the path of a socket\n\n");
+			break;
+		case OPT_G: fprintf(stderr, "-G option was called without a directory\n\n");
+			break;
+		case OPT_X: fprintf(stderr, "--encoder option was called without a command\n\n");
+			break;
+		case OPT_N: fprintf(stderr, "-n option must be called with off, tag or apply\n\n");
+			break;
+		case OPT_A: fprintf(stderr, "--data option was called without a directory\n\n");
+			break;
+		case OPT_W: fprintf(stderr, "--delete option needs at least one -w term\n\n");
+			break;
+		case OPT_L: fprintf(stderr, "--stream option must be called with a list of files (- for the standard input, which needs -y)\n\n");
 			break;
-		case OPT_P: fprintf(stderr, "-p option must be called with exactly one file\n\n");
+		case OPT_B: fprintf(stderr, "--memory option must be called with a number of megabytes\n\n");
 			break;
 		case ID3_RETR: fprintf(stderr, "ID3 tags could not be retrieved\n\n");
 			break;
@@ -58,7 +109,7 @@ void print_error(int msg_num) {
 			break;
 		case PL_COMM: fprintf(stderr, "player communication failed\n\n");
 			break;
-		case PL_NOID: fprintf(stderr, "no player with that ID was found\n\n");
+		case PL_NOID: fprintf(stderr, "no player with that serial number or USB path was found\n\n");
 			break;
 		case G_ABRT: fprintf(stderr, "aborted by user\n\n");
 			break;
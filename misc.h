@@ -19,6 +19,9 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
 
 /**
  * An enumeration of error types that are used within zencp. Makes it
@@ -29,6 +32,18 @@ enum zencp_errors {
 	OPT_FE, 	/* Options: option -e fas not been correctly */
 	OPT_D, 		/* Options: option -D fas not been correctly */
 	OPT_P,		/* Options: option -p fas not been correctly */
+	OPT_T,		/* Options: option -t fas not been correctly */
+	OPT_Q,		/* Options: a query option (-w, -s, -c, -o) fas not been correctly */
+	OPT_M,		/* Options: option -m fas not been correctly */
+	OPT_R,		/* Options: option -R fas not been correctly */
+	OPT_S,		/* Options: option -S fas not been correctly */
+	OPT_G,		/* Options: option -G fas not been correctly */
+	OPT_X,		/* Options: option --encoder fas not been correctly */
+	OPT_N,		/* Options: option -n fas not been correctly */
+	OPT_A,		/* Options: option --data fas not been correctly */
+	OPT_W,		/* Options: option --delete fas not been correctly */
+	OPT_L,		/* Options: option --stream fas not been correctly */
+	OPT_B,		/* Options: option --memory fas not been correctly */
 	ID3_RETR, 	/* ID3 Tags: error with ID3 tag processing */
 	PL_DISC, 	/* Player: player discovery failed */
 	PL_COMM, 	/* Player: player communictaion failed */
@@ -57,4 +72,12 @@ void	print_error(int msg_num);
  */
 char	is_digit(char c);
 
+/**
+ * config_file_path() returns a newly allocated string that contains the path
+ * of the file called name within zencp's directory in the user's home
+ * ($HOME/.zencp). The directory is created if it does not exist yet. NULL is
+ * returned if $HOME is not set or the directory cannot be created.
+ */
+char*	config_file_path(const char *name);
+
 #endif
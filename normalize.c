@@ -0,0 +1,166 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * normalize.c - implementation file for the normalization of tag strings
+ *
+ * This file provides the implementation of the normalization. The string
+ * is read once from front to back: ASCII characters are translated by a
+ * table, the few UTF-8 sequences that have a lower case form are folded by
+ * adding a constant and bytes that do not form a valid UTF-8 sequence are
+ * treated as Latin-1. Spaces are only written before the next character
+ * that is kept, so runs of them collapse and trailing ones vanish.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "normalize.h"
+
+/* the marker in ascii_map for characters that are removed */
+#define DROP '\1'
+
+/**
+ * The translation of the ASCII characters: letters and digits are kept in
+ * lower case, apostrophes are dropped and everything else is a space.
+ */
+static const char ascii_map[129] =
+	"                "	/* 00-0f */
+	"                "	/* 10-1f */
+	"       \1        "	/* 20-2f */
+	"0123456789      "	/* 30-3f */
+	" abcdefghijklmno"	/* 40-4f */
+	"pqrstuvwxyz     "	/* 50-5f */
+	"\1abcdefghijklmno"	/* 60-6f */
+	"pqrstuvwxyz     ";	/* 70-7f */
+
+
+/**
+ * fold_utf8() folds the two byte UTF-8 sequence in b to lower case. It
+ * returns 1 if the sequence is a letter or another symbol that is kept and
+ * 0 if it is punctuation that becomes a space.
+ */
+static int fold_utf8(unsigned char b[2]) {
+	switch (b[0]) {
+		case 0xc2:			/* Latin-1 punctuation */
+			return 0;
+		case 0xc3:			/* Latin-1 letters */
+			if ((b[1] >= 0x80) && (b[1] <= 0x9e) && (b[1] != 0x97)) b[1] += 0x20;
+			return 1;
+		case 0xce:			/* Greek capitals */
+			if ((b[1] >= 0x91) && (b[1] <= 0x9f)) {
+				b[1] += 0x20;
+			} else if ((b[1] >= 0xa0) && (b[1] <= 0xa9)) {
+				b[0] = 0xcf;
+				b[1] -= 0x20;
+			}
+			return 1;
+		case 0xd0:			/* Cyrillic capitals */
+			if ((b[1] >= 0x80) && (b[1] <= 0x8f)) {
+				b[0] = 0xd1;
+				b[1] += 0x10;
+			} else if ((b[1] >= 0x90) && (b[1] <= 0x9f)) {
+				b[1] += 0x20;
+			} else if ((b[1] >= 0xa0) && (b[1] <= 0xaf)) {
+				b[0] = 0xd1;
+				b[1] -= 0x20;
+			}
+			return 1;
+	}
+	return 1;
+}
+
+
+size_t normalize_string(const char *s, char *out) {
+	const unsigned char *p = (const unsigned char*)s;
+	unsigned char b[2];
+	size_t n = 0;
+	int space = 0;		/* a space is due before the next character */
+	char c;
+
+/* append character x to out, preceded by a pending space */
+#define PUT(x) \
+	{ \
+		if ((space) && (n)) out[n++] = ' '; \
+		space = 0; \
+		out[n++] = (x); \
+	}
+
+	while (*p) {
+		if (*p < 0x80) {
+			/* ASCII: one lookup */
+			if ((c = ascii_map[*p++]) == ' ') {
+				space = 1;
+			} else if (c != DROP) {
+				PUT(c);
+			}
+		} else if ((*p >= 0xc2) && (*p <= 0xdf) && ((p[1] & 0xc0) == 0x80)) {
+			/* a two byte UTF-8 sequence */
+			b[0] = p[0];
+			b[1] = p[1];
+			p += 2;
+			if (!fold_utf8(b)) {
+				if (b[1] == 0xb4) continue;	/* the acute accent is used as an apostrophe */
+				space = 1;
+				continue;
+			}
+			PUT(b[0]);
+			out[n++] = b[1];
+		} else if ((*p == 0xe2) && (p[1] == 0x80) && ((p[2] & 0xc0) == 0x80)) {
+			/* General Punctuation: typographic apostrophes are dropped, dashes
+			 * and quotes become spaces */
+			if ((p[2] != 0x98) && (p[2] != 0x99)) space = 1;
+			p += 3;
+		} else if ((*p >= 0xe0) && ((p[1] & 0xc0) == 0x80)) {
+			/* any other multi byte sequence is kept as it is */
+			PUT(*p++);
+			while ((*p & 0xc0) == 0x80) out[n++] = *p++;
+		} else if ((*p >= 0xc0) && (*p <= 0xde) && (*p != 0xd7)) {
+			/* Latin-1 capitals */
+			PUT(*p + 0x20);
+			p++;
+		} else if ((*p >= 0xa0) && (*p <= 0xbf)) {
+			/* Latin-1 punctuation, the acute accent is used as an apostrophe */
+			if (*p != 0xb4) space = 1;
+			p++;
+		} else {
+			PUT(*p++);
+		}
+	}
+#undef PUT
+
+	out[n] = '\0';
+	return n;
+}
+
+
+const char* normalize_key(const char *s) {
+	char buff[_NORMALIZE_MAX_LEN];
+	char *key = buff;
+	const char *r;
+	size_t l;
+
+	if (!s) return 0;
+
+	/* only very long strings need memory of their own */
+	if (((l = strlen(s) + 1) > _NORMALIZE_MAX_LEN) && (!(key = (char*)malloc(l)))) {
+		print_error(G_NOMEM);
+		return 0;
+	}
+
+	normalize_string(s, key);
+	r = intern(key);
+
+	if (key != buff) free(key);
+	return r;
+}
+
+
+int normalize_is_prefix(const char *prefix, const char *s) {
+	size_t l;
+
+	if ((!prefix) || (!s) || (!(l = strlen(prefix)))) return 0;
+	return !strncmp(prefix, s, l);
+}
@@ -0,0 +1,59 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * normalize.h - header file for the normalization of tag strings
+ *
+ * This file provides the prototypes that are needed to turn a tag string
+ * into a key that is used to find duplicates. Two strings that only differ
+ * in case, whitespace or punctuation ("AC/DC", "ac-dc ", "Ac Dc") result
+ * in the same key:
+ *
+ *  - letters are folded to lower case (ASCII, Latin-1 and the Latin-1,
+ *    Greek and Cyrillic letters of UTF-8)
+ *  - apostrophes are removed ("Don't" becomes "dont")
+ *  - all other punctuation and whitespace becomes a single space, leading
+ *    and trailing spaces are removed
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_NORMALIZE_H
+#define __ZENCP_NORMALIZE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "intern.h"
+#include "misc.h"
+
+/* the size of the buffer that keys are built in, longer strings get a
+ * buffer of their own */
+#define _NORMALIZE_MAX_LEN 1024
+
+/**
+ * normalize_string() writes the key of the string s to out, which must have
+ * room for strlen(s) + 1 characters (a key is never longer than its string).
+ * It returns the length of the key.
+ */
+size_t		normalize_string(const char *s, char *out);
+
+/**
+ * normalize_key() returns the interned key of the string s, so two strings
+ * have the same key if and only if the pointers are equal. NULL is returned
+ * if s is NULL or in case of errors.
+ */
+const char*	normalize_key(const char *s);
+
+/**
+ * normalize_is_prefix() returns 1 if the key s begins with the key prefix,
+ * which is what is left of a string that has been cut. An empty prefix
+ * matches nothing, so 0 is returned in that case and if s does not begin
+ * with prefix.
+ */
+int		normalize_is_prefix(const char *prefix, const char *s);
+
+#endif
@@ -0,0 +1,114 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * outbuf.c - implementation file for a buffered output writer
+ *
+ * This file provides the implementation of the output buffer.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "outbuf.h"
+
+int outbuf_init(struct outbuf *ob, FILE *out) {
+	if ((!ob) || (!out)) return 0;
+
+	ob->out = out;
+	ob->len = 0;
+	ob->error = 0;
+
+	if (!(ob->buf = (char*)malloc(_OUTBUF_SIZE))) {
+		print_error(G_NOMEM);
+		return 0;
+	}
+	return 1;
+}
+
+
+int outbuf_flush(struct outbuf *ob) {
+	if (!ob) return 0;
+
+	/* everything that has been printf'ed to the stream before must come first */
+	if ((ob->len) && (fwrite(ob->buf, 1, ob->len, ob->out) != ob->len)) ob->error = 1;
+	if (fflush(ob->out)) ob->error = 1;
+
+	ob->len = 0;
+	return !ob->error;
+}
+
+
+void outbuf_write(struct outbuf *ob, const char *data, size_t len) {
+	if ((!ob) || (!ob->buf) || (!data)) return;
+
+	/* things that do not fit into an empty buffer are written directly */
+	if (ob->len + len > _OUTBUF_SIZE) {
+		outbuf_flush(ob);
+		if (len > _OUTBUF_SIZE) {
+			if (fwrite(data, 1, len, ob->out) != len) ob->error = 1;
+			return;
+		}
+	}
+
+	memcpy(ob->buf + ob->len, data, len);
+	ob->len += len;
+}
+
+
+void outbuf_puts(struct outbuf *ob, const char *s) {
+	if (!s) return;
+	outbuf_write(ob, s, strlen(s));
+}
+
+
+void outbuf_putc(struct outbuf *ob, char c) {
+	if ((!ob) || (!ob->buf)) return;
+
+	if (ob->len == _OUTBUF_SIZE) outbuf_flush(ob);
+	ob->buf[ob->len++] = c;
+}
+
+
+void outbuf_printf(struct outbuf *ob, const char *fmt, ...) {
+	va_list ap;
+	int l;
+
+	if ((!ob) || (!ob->buf)) return;
+
+	/* try to print directly into the buffer */
+	va_start(ap, fmt);
+	l = vsnprintf(ob->buf + ob->len, _OUTBUF_SIZE - ob->len, fmt, ap);
+	va_end(ap);
+
+	if (l < 0) return;
+	if ((size_t)l < _OUTBUF_SIZE - ob->len) {
+		ob->len += l;
+		return;
+	}
+
+	/* it did not fit, so make room and print it again, things that are
+	 * larger than the whole buffer go directly to the stream */
+	outbuf_flush(ob);
+	va_start(ap, fmt);
+	if ((size_t)l < _OUTBUF_SIZE) {
+		ob->len = vsnprintf(ob->buf, _OUTBUF_SIZE, fmt, ap);
+	} else if (vfprintf(ob->out, fmt, ap) < 0) {
+		ob->error = 1;
+	}
+	va_end(ap);
+}
+
+
+int outbuf_free(struct outbuf *ob) {
+	int r;
+
+	if (!ob) return 0;
+
+	r = outbuf_flush(ob);
+	free(ob->buf);
+	ob->buf = 0;
+	return r;
+}
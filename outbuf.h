@@ -0,0 +1,79 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * outbuf.h - header file for a buffered output writer
+ *
+ * This file provides the prototypes and structures of a simple output
+ * buffer. Output that consists of many small pieces (track listings, tag
+ * reports) is collected in one large buffer and written with a single call
+ * whenever the buffer is full instead of one printf() per line.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_OUTBUF_H
+#define __ZENCP_OUTBUF_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "misc.h"
+
+/* the size of the output buffer, it is flushed whenever it is full */
+#define _OUTBUF_SIZE (1024 * 1024)
+
+/**
+ * An output buffer for the stream out.
+ */
+struct outbuf {
+	FILE *out;	/* the stream the buffer is written to */
+	char *buf;	/* the buffer itself */
+	size_t len;	/* the number of bytes in the buffer */
+	int error;	/* non-zero if writing to out failed */
+};
+
+/**
+ * outbuf_init() sets up the output buffer ob for the stream out. It returns
+ * 1 on success and 0 if no memory could be allocated.
+ */
+int	outbuf_init(struct outbuf *ob, FILE *out);
+
+/**
+ * outbuf_write() appends len bytes of data to the buffer.
+ */
+void	outbuf_write(struct outbuf *ob, const char *data, size_t len);
+
+/**
+ * outbuf_puts() appends the string s (without a newline) to the buffer.
+ */
+void	outbuf_puts(struct outbuf *ob, const char *s);
+
+/**
+ * outbuf_putc() appends the character c to the buffer.
+ */
+void	outbuf_putc(struct outbuf *ob, char c);
+
+/**
+ * outbuf_printf() appends formatted output to the buffer, see printf().
+ */
+void	outbuf_printf(struct outbuf *ob, const char *fmt, ...);
+
+/**
+ * outbuf_flush() writes the contents of the buffer to its stream. It returns
+ * 1 on success and 0 if an error occured at any time since outbuf_init().
+ */
+int	outbuf_flush(struct outbuf *ob);
+
+/**
+ * outbuf_free() flushes the buffer and frees its memory. The stream is not
+ * closed. The return value is the same as for outbuf_flush().
+ */
+int	outbuf_free(struct outbuf *ob);
+
+#endif
@@ -22,29 +22,6 @@
 
 #include "player.h"
 
-/**
- * callback_progress() is a callback function that, guess what, provides for a
- * progress indicator. It is provided to data transfer functions and called for every
- * byte that is sent/received. Only used internally and not exported via the header
- * file.
- * This function will print a message about current progress to the screen whenever
- * the number of transmitted bytes is divisable by 10. 
- */
-static int callback_progress(u_int64_t sent, u_int64_t total, const char* buf, unsigned len, void *data) {
-	int sent_kb = sent / 1024;
-	int total_kb = total / 1024;
-	int percentage = (((float)sent / (float)total) * 100);
-	
-	if ((sent % 10 != 0) && (sent != total)) return 0;  /* return if number of tx bytes is
-							       not divisable by 10 */
-
-	printf("   %8d KB of %d KB sent (%2d%%)\r", sent_kb, total_kb, percentage);
-	fflush(stdout);
-
-	return 0;
-}
-
-
 int player_discovery(njb_t *njb_array) {
 	int i = 0;
 	
@@ -175,16 +152,25 @@ const char* player_get_model(njb_t *player) {
  * Formerly that was done by the NJB_Send_File method but now, we have to do it by ourselves.
  * The information is stored in a song-id object.
  */
-unsigned int player_send_file(njb_t *player, struct id3_struct *tag) {
+unsigned int player_send_file(njb_t *player, struct id3_struct *tag, NJB_Xfer_Callback *progress,
+			      void *data) {
+	/* a lot of fields that are better not NULL, so we read them all and check */
+	if ((!player) || (!tag) || (!id3_tag_need(tag, _ID3_ALL))) return 0;
+	if ((!tag->filename) || (!tag->title) || (!tag->album) || (!tag->genre) ||
+		(!tag->artist) || (tag->time == 0) || (!tag->s_year)) 
+		return 0;
+
+	return player_send_track(player, tag->filename, tag, progress, data);
+}
+
+
+unsigned int player_send_track(njb_t *player, const char *path, struct id3_struct *tag,
+			       NJB_Xfer_Callback *progress, void *data) {
 	unsigned int track = 0;
 	njb_songid_t *songid = 0;
 	njb_songid_frame_t *frame = 0;
 
-	/* a lot of fields that are better not NULL, so we check */
-	if ((!player) || (!tag)) return 0;
-	if ((!tag->filename) || (!tag->title) || (!tag->album) || (!tag->genre) ||
-		(!tag->artist) || (tag->time == 0) || (!tag->s_year)) 
-		return 0;
+	if ((!player) || (!path) || (!tag)) return 0;
 
 	/* create a new player song-id object */
 	songid = NJB_Songid_New();
@@ -225,79 +211,68 @@ unsigned int player_send_file(njb_t *player, struct id3_struct *tag) {
 	frame = NJB_Songid_Frame_New_Length(tag->time);
 	NJB_Songid_Addframe(songid, frame);
 	
-	/* NJB_Send_Track will now send the track (identified by its filename),
+	/* NJB_Send_Track will now send the track (identified by its path),
 	 * together with the song-id to the player and indicate its progress via the
-	 * callback_progress function. The referenced track variable will contain the
+	 * progress function (if any). The referenced track variable will contain the
 	 * unique track-ID of that track on the player afterwards. */
-	if (NJB_Send_Track (player, tag->filename, songid, callback_progress, NULL, &track) == -1) {
+	if (NJB_Send_Track (player, path, songid, progress, data, &track) == -1) {
 	      NJB_Error_Dump(player, stderr);
-	      return 0;
+	      track = 0;
 	}
 
+	NJB_Songid_Destroy(songid);	/* the frames go with it */
 	return track;
 }
 
 
-void player_list_device(njb_t *player, int n) {
-	const char *owner = 0, *model = 0;
-	
-	if (!player) return;
-	owner = player_get_owner(player);
-	model = player_get_model(player);
+int player_get_track_fd(njb_t *player, struct id3_struct *tag, int fd, NJB_Xfer_Callback *progress,
+			void *data) {
+	if ((!player) || (!tag) || (!tag->trackid) || (fd < 0)) return 0;
 
-	printf("   %2d\t --- %s\t\tOwner: %s \n", n, model, owner);
-	printf("\t     Capacity: %llu MB\t", (player_get_disksize(player)/1024));
-	printf("\tFree:  %llu MB\n", (player_get_diskfree(player)/1024));
-	printf("\t     DeviceID: %d\n\n", player_get_deviceid(player));
+	/* NJB_Get_Track_fd() needs the size of the track to know when it is done */
+	if (NJB_Get_Track_fd(player, tag->trackid, tag->size, fd, progress, data) == -1) {
+		NJB_Error_Dump(player, stderr);
+		return 0;
+	}
 
-	return;
+	return 1;
 }
 
 
-/** read the information in player.h 
- * What this function does is to create an ID that can be used to identify the player with
- * the -d switch. The algorithm is simple, not fail proven and I cannot guarantee that
- * two players connceted to the host will have unique IDs.
- */
-unsigned int player_get_deviceid(njb_t *player) {
-	unsigned int id = 0;
-	char *owner = 0;
-	int i, k = 0;
+void player_list_device(FILE *out, njb_t *player, int n) {
+	const char *owner = 0, *model = 0;
+	char serial[_DEVICE_SERIAL_LEN], path[_DEVICE_PATH_LEN];
 	
-	if (!player) return 0;
-
-	/* first, get the owner string an sum up the ASCII values of each character */
-	owner = (char*)player_get_owner(player);
-	for (i = 0; i < strlen(owner); i++) {
-		k += (int)owner[i];
-	}
-	free(owner);
+	if ((!out) || (!player)) return;
+	owner = player_get_owner(player);
+	model = player_get_model(player);
 
-	id = player_get_disksize(player);	/* get the capacity of the player */
-	id ^= k;				/* XOR it with the owner */
-	id += player_get_diskfree(player);	/* add the free space */
-	id ^= player_get_diskfree(player);	/* and do a second XOR with the free space */
+	fprintf(out, "   %2d\t --- %s\t\tOwner: %s \n", n, model, owner);
+	fprintf(out, "\t     Capacity: %llu MB\t", (player_get_disksize(player)/1024));
+	fprintf(out, "\tFree:  %llu MB\n", (player_get_diskfree(player)/1024));
+	fprintf(out, "\t     Serial: %s\n", (device_serial(player, serial)) ? serial : "unknown");
+	fprintf(out, "\t     USB: %s\n\n", (device_path(player, path)) ? path : "unknown");
 
-	return id;				/* voila l'ID */
+	return;
 }
 
 
-char* player_extract_frame_string(njb_songid_frame_t *playerframe) {
+const char* player_extract_frame_string(njb_songid_frame_t *playerframe) {
 	char buff[32];	/* buffer needed for int->string conversion, 31 places should be
 			   sufficient */
-	char *r = 0;
+	const char *r = 0;
 	
 	if (!playerframe) return 0;
 
 	/* detect the way, data is encoded in the frame and return a string */
 	if (playerframe->type == NJB_TYPE_STRING) {	/* strings wont be converted */
-		r = new_string(playerframe->data.strval);
+		r = intern(playerframe->data.strval);
 	} else if (playerframe->type == NJB_TYPE_UINT16) {	/* 16bit ints */
 		snprintf(buff, 32, "%d", playerframe->data.u_int16_val);
-		r = new_string(buff);
+		r = intern(buff);
 	} else if (playerframe->type == NJB_TYPE_UINT32) {	/* 32 bit ints */
 		snprintf(buff, 32, "%u", playerframe->data.u_int32_val);
-		r = new_string(buff);
+		r = intern(buff);
 	} else {
 		return 0;
 	}
@@ -306,6 +281,20 @@ char* player_extract_frame_string(njb_songid_frame_t *playerframe) {
 }
 
 
+unsigned int player_extract_frame_uint(njb_songid_frame_t *playerframe) {
+	if (!playerframe) return 0;
+
+	/* some players store numbers as strings, so we convert them */
+	switch (playerframe->type) {
+		case NJB_TYPE_UINT16: return playerframe->data.u_int16_val;
+		case NJB_TYPE_UINT32: return playerframe->data.u_int32_val;
+		case NJB_TYPE_STRING: return (playerframe->data.strval) ?
+				(unsigned int)strtoul(playerframe->data.strval, 0, 10) : 0;
+		default: return 0;
+	}
+}
+
+
 int player_delete_track(njb_t *player, s_id3_tag *tag) {
 	int r;
 	
@@ -319,6 +308,126 @@ int player_delete_track(njb_t *player, s_id3_tag *tag) {
 }
 
 
+unsigned int player_get_datafiles(njb_t *player, struct datafile_list *l) {
+	unsigned int files = 0;
+	njb_datafile_t *df = 0;
+
+	if ((!player) || (!l)) return 0;
+
+	/* the data files are iterated like the tracks (see player_get_tracklist()) */
+	NJB_Reset_Get_Datafile_Tag(player);
+
+	while ((df = NJB_Get_Datafile_Tag(player))) {
+		/* folders come as entries without a name */
+		if ((df->filename) && (datafile_add(l, (df->folder) ? df->folder : "\\", df->filename, 0,
+						    df->filesize, df->timestamp, df->dfid))) {
+			files++;
+		}
+		NJB_Datafile_Destroy(df);
+	}
+
+	return files;
+}
+
+
+unsigned int player_send_datafile(njb_t *player, const char *path, const char *name, const char *folder,
+				  NJB_Xfer_Callback *progress, void *data) {
+	u_int32_t file = 0;
+
+	if ((!player) || (!path) || (!name) || (!folder)) return 0;
+
+	/* the folders are created by the player as they are needed */
+	if (NJB_Send_File(player, path, name, folder, progress, data, &file) == -1) {
+		NJB_Error_Dump(player, stderr);
+		file = 0;
+	}
+	return file;
+}
+
+
+int player_delete_datafile(njb_t *player, unsigned int id) {
+	if ((!player) || (!id)) return 0;
+	return (NJB_Delete_File(player, id) == 0);
+}
+
+
+/**
+ * player_same_playlist() returns 1 if the playlist pl of the player has the track
+ * IDs of p (leaving out those that are 0) in the same order.
+ */
+static int player_same_playlist(njb_playlist_t *pl, struct playlist *p) {
+	njb_playlist_track_t *track;
+	unsigned int i = 0;
+
+	NJB_Playlist_Reset_Gettrack(pl);
+	while ((track = NJB_Playlist_Gettrack(pl))) {
+		while ((i < p->n) && (!p->trackids[i])) i++;
+		if ((i >= p->n) || (p->trackids[i] != track->trackid)) return 0;
+		i++;
+	}
+	while ((i < p->n) && (!p->trackids[i])) i++;
+	return (i >= p->n);
+}
+
+
+unsigned int player_update_playlists(njb_t *player, struct playlist *list) {
+	njb_playlist_t *playlists = 0, *pl, *next;
+	njb_playlist_track_t *track;
+	struct playlist *p;
+	unsigned int i, written = 0;
+
+	if (!player) return 0;
+
+	/* the playlists of the player, chained by themselves */
+	NJB_Reset_Get_Playlist(player);
+	while ((pl = NJB_Get_Playlist(player))) {
+		pl->nextpl = playlists;
+		playlists = pl;
+	}
+
+	for (p = list; p; p = p->next) {
+		for (pl = playlists; (pl) && ((!pl->name) || (strcmp(pl->name, p->name))); pl = pl->nextpl);
+
+		if ((pl) && (player_same_playlist(pl, p))) {
+			p->state = PS_SAME;
+			continue;
+		}
+
+		/* a new playlist is chained as well, a second one of that name changes it */
+		if (!pl) {
+			if (!(pl = NJB_Playlist_New())) {
+				p->state = PS_FAILED;
+				continue;
+			}
+			NJB_Playlist_Set_Name(pl, p->name);
+			pl->nextpl = playlists;
+			playlists = pl;
+		}
+
+		while (pl->ntracks) NJB_Playlist_Deltrack(pl, NJB_PL_START);
+		for (i = 0; i < p->n; i++) {
+			if ((p->trackids[i]) && ((track = NJB_Playlist_Track_New(p->trackids[i])))) {
+				NJB_Playlist_Addtrack(pl, track, NJB_PL_END);
+			}
+		}
+
+		if (NJB_Update_Playlist(player, pl) == -1) {
+			NJB_Error_Dump(player, stderr);
+			p->state = PS_FAILED;
+		} else {
+			p->state = PS_WRITTEN;
+			written++;
+		}
+	}
+
+	for (pl = playlists; pl; pl = next) {
+		next = pl->nextpl;
+		NJB_Playlist_Destroy(pl);
+	}
+	return written;
+}
+
+
 /**
  * The function NJB_Get_Track_Tag() will return an object of type njb_songid_t which contains
  * the information about a certain track on the player. It is desirable to have this information
@@ -351,24 +460,34 @@ s_id3_tag* player_get_id3_struct(njb_songid_t *playertag) {
 	playerframe = NJB_Songid_Findframe(playertag, FR_GENRE);
 	tag->genre  = player_extract_frame_string(playerframe);
 	
+	/* the numbers are needed for track listings and queries */
+	tag->year     = player_extract_frame_uint(NJB_Songid_Findframe(playertag, FR_YEAR));
+	tag->trackno  = player_extract_frame_uint(NJB_Songid_Findframe(playertag, FR_TRACK));
+	tag->time     = player_extract_frame_uint(NJB_Songid_Findframe(playertag, FR_LENGTH));
+	tag->size     = player_extract_frame_uint(NJB_Songid_Findframe(playertag, FR_SIZE));
+
 	/* we do not need the following for now, so we leave them alone */
 	tag->s_year = 0;
-	tag->year   = 0;
-
-	tag->trackno  = 0;
-	tag->time     = 0;
 	tag->frequency = 0;
 	tag->bitrate  = 0;
 	tag->trackid  = playertag->trid;	/* the track-ID on the player */
 
 	tag->next     = 0;
 	tag->element  = 0;
+	tag->transient = 0;
+	tag->owned    = 0;
+	id3_make_keys(tag);
+
+	/* the player gives us everything at once */
+	tag->id3      = 0;
+	tag->valid    = _ID3_ALL;
+	tag->id3v1    = 0;
 
 	return tag;
 }
 
 
-unsigned int player_get_tracklist(njb_t *player, s_id3_tag* array[]) {
+unsigned int player_get_tracklist(njb_t *player, struct tracklist *tl) {
 	unsigned int songs = 0;
 	s_id3_tag *tag = 0;
 	njb_songid_t *playertag = 0;
@@ -389,9 +508,9 @@ unsigned int player_get_tracklist(njb_t *player, s_id3_tag* array[]) {
 		tag = player_get_id3_struct(playertag);
 		songs++;
 		
-		/* put that new track into the tracklist that is referred to by array
+		/* put that new track into the tracklist tl,
 		 * see tracklist.h and tracklist.c for details */
-		tracklist_insert(array, tag);
+		tracklist_insert(tl, tag);
 		
 		/* we dont need the track information from the player anymore (it has
 		 * all been copied to s_id3_tag) so we will free it here */
@@ -22,6 +22,9 @@
 #include <libnjb.h>
 #include "id3.h"
 #include "tracklist.h"
+#include "datafile.h"
+#include "playlist.h"
+#include "device.h"
 #include "misc.h"
 
 /* the maximum number of players that are concurrently supported */
@@ -63,10 +66,11 @@ int	player_release(njb_t **player);
 
 /**
  * player_list_device() will print some information about the given player to the
- * screen. Argument n is used in the output to give a number to that specific player
- * and is of no further importance.
+ * stream out, including its serial number and USB path that select it with -d. Argument
+ * n is used in the output to give a number to that specific player and is of no further
+ * importance.
  */
-void	player_list_device(njb_t *player, int n);
+void	player_list_device(FILE *out, njb_t *player, int n);
 
 /**
  * player_get_disksize() obtains the size of the disk in the player referenced by player.
@@ -93,19 +97,19 @@ const char* player_get_owner(njb_t *player);
 const char* player_get_model(njb_t *player);
 
 /**
- * player_get_deviceid() tries to create a unique player ID that can be used within
- * zencp to identify multiple players. This function might be dangerous by the algorithm
- * that is used, by it worked for now. 0 is returned in case of errors.
+ * player_extract_frame_string() : also on the player, ID3 information about tracks is 
+ * stored within frames bit this time, the way to retrieve their contents is different.
+ * This function will return the interned string with the contents of a specific frame
+ * and NULL if this was impossible.
  */
-unsigned int player_get_deviceid(njb_t *player);
+const char* player_extract_frame_string(njb_songid_frame_t *playerframe);
 
 /**
- * player_extract_frame_string() : also on the player, ID3 information about tracks is 
- * stored within frames bit this time, the way to retrieve their contents is different.
- * This function will return a string with the contents of a specific frame and NULL
- * if this was impossible.
+ * player_extract_frame_uint() is the counterpart of player_extract_frame_string() for
+ * frames that contain numbers like the year or the length of a track. It returns 0 if
+ * the frame does not exist or does not contain a number.
  */
-char* player_extract_frame_string(njb_songid_frame_t *playerframe);
+unsigned int player_extract_frame_uint(njb_songid_frame_t *playerframe);
 
 /**
  * player_get_id3_struct() will retrieve every piece of information out of the given tag
@@ -116,21 +120,71 @@ s_id3_tag* player_get_id3_struct(njb_songid_t *playertag);
 
 /**
  * player_get_tracklist() will retrieve a complete list of tracks from the player and put them
- * into a tracklist. The parameter array[] must point to an array that is used to maintain
- * the tracklist. It returns the number of tracks retrieved from the player.
+ * into the tracklist tl. It returns the number of tracks retrieved from the player.
  */
-unsigned int player_get_tracklist(njb_t *player, s_id3_tag* array[]);
+unsigned int player_get_tracklist(njb_t *player, struct tracklist *tl);
 
 /**
  * player_send_file() will send an MP3 file that is represented by tag to the player that is
  * represented by player. It will return the unique track ID of that track when it has been
- * successfully transferred to the player and 0 in case of errors.
+ * successfully transferred to the player and 0 in case of errors. If progress is non-NULL,
+ * it is called with data whenever a part of the file has been sent.
  */
-unsigned int player_send_file(njb_t *player, struct id3_struct *tag);
+unsigned int player_send_file(njb_t *player, struct id3_struct *tag, NJB_Xfer_Callback *progress,
+			      void *data);
+
+/**
+ * player_send_track() will send the track whose data is found at path to the player,
+ * with the metadata of tag, which may come from another player (see
+ * player_get_id3_struct()). It will return the unique track ID of the new track or 0
+ * in case of errors. If progress is non-NULL, it is called with data whenever a part
+ * of the track has been sent.
+ */
+unsigned int player_send_track(njb_t *player, const char *path, struct id3_struct *tag,
+			       NJB_Xfer_Callback *progress, void *data);
+
+/**
+ * player_get_track_fd() will fetch the track represented by tag (its track ID and size
+ * are needed) from the player and write it to the file descriptor fd. If progress is
+ * non-NULL, it is called with data whenever a part of the track has been received. It
+ * will return 1 on success and 0 in case of errors.
+ */
+int player_get_track_fd(njb_t *player, struct id3_struct *tag, int fd, NJB_Xfer_Callback *progress,
+			void *data);
 
 /**
  * player_delete_track() will delete the track represented by tag from the given player.
  */
 int player_delete_track(njb_t *player, s_id3_tag *tag);
 
+/**
+ * player_get_datafiles() will retrieve the data files on the player (see datafile.h) and
+ * add them to the list l. It returns the number of files retrieved from the player.
+ */
+unsigned int player_get_datafiles(njb_t *player, struct datafile_list *l);
+
+/**
+ * player_send_datafile() will send the file at path to the data area of the player, as
+ * name in folder (see datafile.h). It will return the file ID of the new file or 0 in
+ * case of errors. If progress is non-NULL, it is called with data whenever a part of
+ * the file has been sent.
+ */
+unsigned int player_send_datafile(njb_t *player, const char *path, const char *name, const char *folder,
+				  NJB_Xfer_Callback *progress, void *data);
+
+/**
+ * player_delete_datafile() will delete the data file with the given file ID from the
+ * player. It returns 1 on success and 0 otherwise.
+ */
+int player_delete_datafile(njb_t *player, unsigned int id);
+
+/**
+ * player_update_playlists() writes all playlists of the list to the player with
+ * the entries that have a track ID, in their order. A playlist of the same name
+ * is changed, any other one is created; the playlists of the player are read
+ * only once for all of them. The state of every playlist is set. It returns the
+ * number of playlists that have been written.
+ */
+unsigned int player_update_playlists(njb_t *player, struct playlist *list);
+
 #endif
@@ -0,0 +1,128 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * playlist.c - implementation file for playlists
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "playlist.h"
+
+/* the suffixes of playlists, the first one that matches is cut off the name */
+static const char *playlist_suffixes[] = { ".m3u", ".m3u8", 0 };
+
+
+/**
+ * playlist_suffix() returns the length of the playlist suffix of path or 0 if
+ * path does not have one.
+ */
+static size_t playlist_suffix(const char *path) {
+	size_t n = strlen(path), l;
+	int i;
+
+	for (i = 0; playlist_suffixes[i]; i++) {
+		l = strlen(playlist_suffixes[i]);
+		if ((n > l) && (!strcasecmp(path + n - l, playlist_suffixes[i]))) return l;
+	}
+	return 0;
+}
+
+
+int playlist_is(const char *path) {
+	return (path) && (playlist_suffix(path) > 0);
+}
+
+
+/**
+ * playlist_push() appends the entry name to p, joined to the first len characters
+ * of dir unless it is absolute. It returns 1 on success and 0 if there was no
+ * memory left.
+ */
+static int playlist_push(struct playlist *p, const char *dir, size_t len, const char *name) {
+	unsigned int *trackids;
+	char **files, *file;
+	unsigned int size;
+
+	if (p->n == p->size) {
+		size = (p->size) ? p->size * 2 : 64;
+		if (!(files = (char**)realloc(p->files, size * sizeof(char*)))) return 0;
+		p->files = files;
+		if (!(trackids = (unsigned int*)realloc(p->trackids, size * sizeof(unsigned int)))) return 0;
+		p->trackids = trackids;
+		p->size = size;
+	}
+
+	if (name[0] == '/') len = 0;
+	if (!(file = (char*)malloc(len + strlen(name) + 1))) return 0;
+	memcpy(file, dir, len);
+	strcpy(file + len, name);
+
+	p->files[p->n] = file;
+	p->trackids[p->n++] = 0;
+	return 1;
+}
+
+
+struct playlist* playlist_read(const char *path) {
+	struct playlist *p;
+	FILE *f;
+	char line[PATH_MAX + 2];
+	char *s;
+	const char *slash;
+	size_t dirlen, l;
+
+	if ((!path) || (!(f = fopen(path, "r")))) return 0;
+	if (!(p = (struct playlist*)calloc(1, sizeof(struct playlist)))) {
+		print_error(G_NOMEM);
+		fclose(f);
+		return 0;
+	}
+
+	/* the name on the player is that of the file */
+	slash = strrchr(path, '/');
+	dirlen = (slash) ? (size_t)(slash - path + 1) : 0;
+	l = strlen(path + dirlen) - playlist_suffix(path + dirlen);
+	if (!(p->name = (char*)malloc(l + 1))) {
+		print_error(G_NOMEM);
+		fclose(f);
+		playlist_free(p);
+		return 0;
+	}
+	memcpy(p->name, path + dirlen, l);
+	p->name[l] = '\0';
+	p->state = PS_NEW;
+
+	while (fgets(line, sizeof(line), f)) {
+		s = line;
+		if (!strncmp(s, "\xef\xbb\xbf", 3)) s += 3;	/* the byte order mark of .m3u8 */
+		s[strcspn(s, "\r\n")] = '\0';
+		if ((!s[0]) || (s[0] == '#')) continue;
+
+		/* relative entries are relative to the playlist, not to us */
+		if (!playlist_push(p, path, dirlen, s)) {
+			print_error(G_NOMEM);
+			break;
+		}
+	}
+	fclose(f);
+	return p;
+}
+
+
+void playlist_free(struct playlist *p) {
+	struct playlist *next;
+	unsigned int i;
+
+	for (; p; p = next) {
+		next = p->next;
+		for (i = 0; i < p->n; i++) free(p->files[i]);
+		free(p->files);
+		free(p->trackids);
+		free(p->name);
+		free(p);
+	}
+}
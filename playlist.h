@@ -0,0 +1,73 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * playlist.h - header file for playlists
+ *
+ * This file provides the prototypes and structures that are needed to read
+ * playlists (.m3u, .m3u8) from the disk. They are used by -p to collect the
+ * files of a scan and by the transfer, which sends the files of a playlist
+ * and then writes a playlist of the same name with their track IDs to the
+ * player (see player_update_playlists()).
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_PLAYLIST_H
+#define __ZENCP_PLAYLIST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+
+#include "misc.h"
+
+/**
+ * What happened to a playlist on the player.
+ */
+enum playlist_state {
+	PS_NEW,			/* it has not been written yet */
+	PS_SAME,		/* the player has it with the same tracks */
+	PS_WRITTEN,		/* it has been created or updated */
+	PS_FAILED		/* it could not be written */
+};
+
+/**
+ * A playlist. The playlists of a transfer are kept in a simply linked list.
+ */
+struct playlist {
+	char *name;			/* the name on the player, the filename without
+					   its directory and suffix */
+	char **files;			/* the entries, relative to our directory */
+	unsigned int *trackids;		/* the track IDs of the entries on the player,
+					   0 if an entry is not there */
+	unsigned int n;			/* the number of entries */
+	unsigned int size;		/* the room in files and trackids */
+	int state;			/* see enum playlist_state */
+	struct playlist *next;
+};
+
+/**
+ * playlist_is() returns 1 if the file at path is a playlist by its name.
+ */
+int		playlist_is(const char *path);
+
+/**
+ * playlist_read() reads the playlist at path. Lines starting with '#' are
+ * comments (or the extended information of M3U), relative entries are relative
+ * to the directory of the playlist. It returns the new playlist or NULL if the
+ * file cannot be read or there is no memory.
+ */
+struct playlist* playlist_read(const char *path);
+
+/**
+ * playlist_free() frees the playlist p and all playlists after it.
+ */
+void		playlist_free(struct playlist *p);
+
+#endif
@@ -0,0 +1,87 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * pool.c - implementation file for running jobs in parallel
+ *
+ * This file provides the implementation of pool_run(). The threads share
+ * a counter of the next job, which is the only thing that is protected by
+ * a mutex. The calling thread works on the jobs as well.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "pool.h"
+
+/**
+ * The state that is shared by the threads of one pool_run().
+ */
+struct pool {
+	pool_job job;
+	void *ctx;
+	unsigned int n;		/* the number of jobs */
+	unsigned int next;	/* the next job that has not been started */
+	pthread_mutex_t lock;	/* protects next */
+};
+
+
+/**
+ * pool_worker() runs jobs until there are none left.
+ */
+static void* pool_worker(void *arg) {
+	struct pool *p = (struct pool*)arg;
+	unsigned int i;
+
+	for (;;) {
+		pthread_mutex_lock(&p->lock);
+		i = p->next;
+		if (i < p->n) p->next++;
+		pthread_mutex_unlock(&p->lock);
+
+		if (i >= p->n) break;
+		p->job(p->ctx, i);
+	}
+	return 0;
+}
+
+
+int pool_threads(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n < 1) return 1;
+	if (n > _POOL_MAX_THREADS) return _POOL_MAX_THREADS;
+	return (int)n;
+}
+
+
+void pool_run(unsigned int n, int threads, pool_job job, void *ctx) {
+	pthread_t tid[_POOL_MAX_THREADS];
+	struct pool p;
+	int i, started = 0;
+
+	if ((!job) || (!n)) return;
+
+	if (threads <= 0) threads = pool_threads();
+	if (threads > _POOL_MAX_THREADS) threads = _POOL_MAX_THREADS;
+	if ((unsigned int)threads > n) threads = n;
+
+	p.job = job;
+	p.ctx = ctx;
+	p.n = n;
+	p.next = 0;
+	pthread_mutex_init(&p.lock, 0);
+
+	/* the calling thread is one of the workers, so one thread less is started */
+	for (i = 1; i < threads; i++) {
+		if (pthread_create(&tid[started], 0, pool_worker, &p)) break;
+		started++;
+	}
+
+	pool_worker(&p);
+
+	for (i = 0; i < started; i++) pthread_join(tid[i], 0);
+	pthread_mutex_destroy(&p.lock);
+}
@@ -0,0 +1,50 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * pool.h - header file for running jobs in parallel
+ *
+ * This file provides the prototypes that are needed to run a number of
+ * independent jobs on several threads. The jobs are numbered from 0 to
+ * n - 1 and every thread takes the next job that has not been started yet,
+ * so slow jobs do not hold up the others.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_POOL_H
+#define __ZENCP_POOL_H
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "misc.h"
+
+/* the maximum number of threads that are started */
+#define _POOL_MAX_THREADS 16
+
+/**
+ * A job: it is called with the context that was given to pool_run() and the
+ * number of the job.
+ */
+typedef void (*pool_job)(void *ctx, unsigned int i);
+
+/**
+ * pool_threads() returns the number of threads that pool_run() uses, which is
+ * the number of online CPUs but at most _POOL_MAX_THREADS.
+ */
+int	pool_threads(void);
+
+/**
+ * pool_run() calls job(ctx, i) for every i from 0 to n - 1 on up to threads
+ * threads (0 means pool_threads()) and returns when all jobs are done. The
+ * jobs must not depend on each other and must only write to data of their
+ * own. If no thread can be started, the jobs are run by the caller.
+ */
+void	pool_run(unsigned int n, int threads, pool_job job, void *ctx);
+
+#endif
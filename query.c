@@ -0,0 +1,481 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * query.c - implementation file for queries over a tracklist
+ *
+ * This file provides the implementation of queries over a tracklist. The
+ * tracklist is flattened into an array of pointers first, the array is
+ * filtered and sorted in place and the result is written through one large
+ * output buffer (see outbuf.h).
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "query.h"
+
+/**
+ * The names of the fields in the order of enum query_field.
+ */
+static const char *field_names[_QF_COUNT] = {
+	"trackid", "artist", "title", "album", "genre", "year", "trackno", "length", "size"
+};
+
+
+/**
+ * query_field_by_name() returns the field for the first len characters of name
+ * or -1 if there is no such field.
+ */
+static int query_field_by_name(const char *name, size_t len) {
+	int i;
+
+	for (i = 0; i < _QF_COUNT; i++) {
+		if ((strlen(field_names[i]) == len) && (!strncmp(field_names[i], name, len))) return i;
+	}
+	return -1;
+}
+
+
+/**
+ * query_is_string() returns 1 if field is one of the string fields.
+ */
+static int query_is_string(int field) {
+	return ((field == QF_ARTIST) || (field == QF_TITLE) || (field == QF_ALBUM) || (field == QF_GENRE));
+}
+
+
+/**
+ * query_get_string() returns the contents of a string field of tag, never NULL.
+ */
+static const char* query_get_string(const s_id3_tag *tag, int field) {
+	const char *s = 0;
+
+	switch (field) {
+		case QF_ARTIST: s = tag->artist;
+			break;
+		case QF_TITLE: s = tag->title;
+			break;
+		case QF_ALBUM: s = tag->album;
+			break;
+		case QF_GENRE: s = tag->genre;
+			break;
+	}
+	return (s) ? s : "";
+}
+
+
+/**
+ * query_get_number() returns the contents of a numeric field of tag.
+ */
+static unsigned long query_get_number(const s_id3_tag *tag, int field) {
+	switch (field) {
+		case QF_TRACKID: return tag->trackid;
+		case QF_YEAR: return tag->year;
+		case QF_TRACKNO: return tag->trackno;
+		case QF_LENGTH: return tag->time;
+		case QF_SIZE: return tag->size;
+	}
+	return 0;
+}
+
+
+/**
+ * query_contains() is a case insensitive strstr() for ASCII letters.
+ */
+static int query_contains(const char *haystack, const char *needle) {
+	size_t n = strlen(needle);
+
+	for (; *haystack; haystack++) {
+		if (!strncasecmp(haystack, needle, n)) return 1;
+	}
+	return (n == 0);
+}
+
+
+/**
+ * query_parse_number() converts the string between s and end into a number.
+ * An empty string results in def. It returns 1 on success and 0 otherwise.
+ */
+static int query_parse_number(const char *s, const char *end, unsigned long def, unsigned long *n) {
+	char *e = 0;
+
+	if (s == end) {
+		*n = def;
+		return 1;
+	}
+	if (!is_digit(*s)) return 0;
+
+	*n = strtoul(s, &e, 10);
+	return (e == end);
+}
+
+
+void query_init(struct query *q) {
+	int i;
+	if (!q) return;
+
+	q->terms = 0;
+	q->nsort = 0;
+	q->format = QFMT_TSV;
+
+	for (i = 0; i < _QF_COUNT; i++) q->fields[i] = i;
+	q->nfields = _QF_COUNT;
+}
+
+
+int query_add_term(struct query *q, const char *expr) {
+	struct query_term *t, **last;
+	const char *op, *value, *dots;
+	size_t l;
+
+	if ((!q) || (!expr)) return 0;
+	if (!(op = strpbrk(expr, "=~"))) return 0;
+
+	if (!(t = (struct query_term*)malloc(sizeof(struct query_term)))) {
+		print_error(G_NOMEM);
+		return 0;
+	}
+	t->text = 0;
+	t->next = 0;
+	t->min = 0;
+	t->max = (unsigned long)-1;
+	value = op + 1;
+	l = strlen(value);
+
+	if ((t->field = query_field_by_name(expr, op - expr)) < 0) goto invalid;
+
+	if (*op == '~') {
+		/* substrings and regular expressions only work for strings */
+		if (!query_is_string(t->field)) goto invalid;
+
+		if ((l >= 2) && (value[0] == '/') && (value[l - 1] == '/')) {
+			if (!(t->text = new_string(value + 1))) goto invalid;
+			t->text[l - 2] = '\0';
+			if (regcomp(&t->regex, t->text, REG_EXTENDED | REG_ICASE | REG_NOSUB)) goto invalid;
+			t->op = QOP_REGEX;
+		} else {
+			t->op = QOP_SUBSTR;
+			if (!(t->text = new_string(value))) goto invalid;
+		}
+	} else if (query_is_string(t->field)) {
+		t->op = QOP_EQUAL;
+		if (!(t->text = new_string(value))) goto invalid;
+	} else {
+		/* numbers are compared as ranges, a single number is a range as well */
+		t->op = QOP_RANGE;
+		if ((dots = strstr(value, ".."))) {
+			if ((!query_parse_number(value, dots, 0, &t->min)) ||
+			    (!query_parse_number(dots + 2, value + l, (unsigned long)-1, &t->max))) goto invalid;
+		} else {
+			if ((!l) || (!query_parse_number(value, value + l, 0, &t->min))) goto invalid;
+			t->max = t->min;
+		}
+	}
+
+	/* append the term to the list of terms */
+	for (last = &q->terms; *last; last = &(*last)->next);
+	*last = t;
+	return 1;
+
+invalid:
+	free(t->text);
+	free(t);
+	return 0;
+}
+
+
+int query_set_sort(struct query *q, const char *keys) {
+	const char *k, *end;
+	int field, desc;
+
+	if ((!q) || (!keys)) return 0;
+	q->nsort = 0;
+
+	for (k = keys; *k; k = (*end) ? end + 1 : end) {
+		end = k + strcspn(k, ",");
+		desc = (*k == '-');
+		if (desc) k++;
+
+		if ((q->nsort == _QUERY_MAX_KEYS) || ((field = query_field_by_name(k, end - k)) < 0)) return 0;
+		q->sort[q->nsort++] = (desc) ? -(field + 1) : (field + 1);
+	}
+	return 1;
+}
+
+
+int query_set_fields(struct query *q, const char *keys) {
+	const char *k, *end;
+	int field;
+
+	if ((!q) || (!keys)) return 0;
+	q->nfields = 0;
+
+	for (k = keys; *k; k = (*end) ? end + 1 : end) {
+		end = k + strcspn(k, ",");
+		if ((q->nfields == _QF_COUNT) || ((field = query_field_by_name(k, end - k)) < 0)) return 0;
+		q->fields[q->nfields++] = field;
+	}
+	return (q->nfields > 0);
+}
+
+
+int query_set_format(struct query *q, const char *name) {
+	if ((!q) || (!name)) return 0;
+
+	if (!strcasecmp(name, "tsv")) q->format = QFMT_TSV;
+	else if (!strcasecmp(name, "csv")) q->format = QFMT_CSV;
+	else if (!strcasecmp(name, "json")) q->format = QFMT_JSON;
+	else return 0;
+
+	return 1;
+}
+
+
+/**
+ * query_match_string() returns 1 if the string s fulfills the term t and 0
+ * otherwise. The field of the term is not looked at.
+ */
+static int query_match_string(const struct query_term *t, const char *s) {
+	if ((!t) || (!s)) return 0;
+
+	switch (t->op) {
+		case QOP_EQUAL: return !strcmp(s, t->text);
+		case QOP_SUBSTR: return query_contains(s, t->text);
+		case QOP_REGEX: return !regexec(&t->regex, s, 0, 0, 0);
+	}
+	return 0;
+}
+
+
+/**
+ * query_match_number() is the same as query_match_string() for numbers.
+ */
+static int query_match_number(const struct query_term *t, unsigned long n) {
+	if (!t) return 0;
+	return ((n >= t->min) && (n <= t->max));
+}
+
+
+int query_match(const struct query *q, const s_id3_tag *tag) {
+	const struct query_term *t;
+
+	if ((!q) || (!tag)) return 0;
+
+	for (t = q->terms; t; t = t->next) {
+		if (query_is_string(t->field)) {
+			if (!query_match_string(t, query_get_string(tag, t->field))) return 0;
+		} else {
+			if (!query_match_number(t, query_get_number(tag, t->field))) return 0;
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * A track that is sorted by query_run(). As qsort() does not pass any context,
+ * every track carries the query along, so that several queries can be run at
+ * the same time.
+ */
+struct sort_item {
+	const struct query *q;
+	s_id3_tag *tag;
+};
+
+
+/**
+ * compare_tracks() compares two tracks by the sort keys of their query.
+ */
+static int compare_tracks(const void *a, const void *b) {
+	const struct query *q = ((const struct sort_item*)a)->q;
+	const s_id3_tag *x = ((const struct sort_item*)a)->tag;
+	const s_id3_tag *y = ((const struct sort_item*)b)->tag;
+	unsigned long m, n;
+	int i, field, r;
+
+	for (i = 0; i < q->nsort; i++) {
+		field = abs(q->sort[i]) - 1;
+
+		if (query_is_string(field)) {
+			r = strcmp(query_get_string(x, field), query_get_string(y, field));
+		} else {
+			m = query_get_number(x, field);
+			n = query_get_number(y, field);
+			r = (m < n) ? -1 : (m > n);
+		}
+
+		if (r) return (q->sort[i] < 0) ? -r : r;
+	}
+	return 0;
+}
+
+
+s_id3_tag** query_run(const struct query *q, struct tracklist *tl, unsigned int *count) {
+	s_id3_tag **tracks;
+	struct sort_item *items;
+	unsigned int i, n, m = 0;
+
+	if ((!q) || (!count)) return 0;
+	if (!(tracks = tracklist_flatten(tl, &n))) return 0;
+
+	/* filter in place */
+	for (i = 0; i < n; i++) {
+		if (query_match(q, tracks[i])) tracks[m++] = tracks[i];
+	}
+
+	if ((q->nsort) && (m)) {
+		if (!(items = (struct sort_item*)malloc(m * sizeof(struct sort_item)))) {
+			print_error(G_NOMEM);
+			free(tracks);
+			return 0;
+		}
+		for (i = 0; i < m; i++) {
+			items[i].q = q;
+			items[i].tag = tracks[i];
+		}
+		qsort(items, m, sizeof(struct sort_item), compare_tracks);
+		for (i = 0; i < m; i++) tracks[i] = items[i].tag;
+		free(items);
+	}
+
+	*count = m;
+	return tracks;
+}
+
+
+/**
+ * query_utf8_length() returns the length of the UTF-8 sequence at p or 0 if p
+ * does not start a valid one (e.g. a Latin-1 character of an ID3v1 tag).
+ */
+static int query_utf8_length(const unsigned char *p) {
+	int n, i;
+
+	if (p[0] < 0x80) return 1;
+	if ((p[0] >= 0xc2) && (p[0] <= 0xdf)) n = 2;
+	else if ((p[0] >= 0xe0) && (p[0] <= 0xef)) n = 3;
+	else if ((p[0] >= 0xf0) && (p[0] <= 0xf4)) n = 4;
+	else return 0;
+
+	for (i = 1; i < n; i++) {
+		if ((p[i] & 0xc0) != 0x80) return 0;
+	}
+
+	/* neither overlong forms nor surrogates nor anything beyond U+10FFFF */
+	if ((p[0] == 0xe0) && (p[1] < 0xa0)) return 0;
+	if ((p[0] == 0xed) && (p[1] >= 0xa0)) return 0;
+	if ((p[0] == 0xf0) && (p[1] < 0x90)) return 0;
+	if ((p[0] == 0xf4) && (p[1] >= 0x90)) return 0;
+	return n;
+}
+
+
+void query_write_string(struct outbuf *ob, int format, const char *s) {
+	const char *p;
+	int l;
+
+	switch (format) {
+		case QFMT_TSV:
+			/* tabs and line breaks would break the columns, so they become spaces */
+			for (p = s; *p; p++) outbuf_putc(ob, (strchr("\t\r\n", *p)) ? ' ' : *p);
+			break;
+
+		case QFMT_CSV:
+			/* fields with special characters are quoted, quotes are doubled */
+			if (!strpbrk(s, ",\"\r\n")) {
+				outbuf_puts(ob, s);
+				break;
+			}
+			outbuf_putc(ob, '"');
+			for (p = s; *p; p++) {
+				if (*p == '"') outbuf_putc(ob, '"');
+				outbuf_putc(ob, *p);
+			}
+			outbuf_putc(ob, '"');
+			break;
+
+		case QFMT_JSON:
+			outbuf_putc(ob, '"');
+			for (p = s; *p; p++) {
+				if ((*p == '"') || (*p == '\\')) {
+					outbuf_putc(ob, '\\');
+					outbuf_putc(ob, *p);
+				} else if ((unsigned char)*p < 0x20) {
+					outbuf_printf(ob, "\\u%04x", (unsigned char)*p);
+				} else if ((l = query_utf8_length((const unsigned char*)p))) {
+					/* JSON is UTF-8, so UTF-8 is written as it is */
+					outbuf_write(ob, p, l);
+					p += l - 1;
+				} else {
+					/* anything else is taken for Latin-1, whose characters
+					 * are the first 256 of Unicode */
+					outbuf_printf(ob, "\\u%04x", (unsigned char)*p);
+				}
+			}
+			outbuf_putc(ob, '"');
+			break;
+	}
+}
+
+
+int query_write(const struct query *q, s_id3_tag **tracks, unsigned int count, FILE *out) {
+	struct outbuf ob;
+	unsigned int i;
+	int k, field;
+	char sep;
+
+	if ((!q) || ((!tracks) && (count)) || (!outbuf_init(&ob, out))) return 0;
+	sep = (q->format == QFMT_CSV) ? ',' : '\t';
+
+	/* TSV and CSV start with a header line */
+	if (q->format != QFMT_JSON) {
+		for (k = 0; k < q->nfields; k++) {
+			if (k) outbuf_putc(&ob, sep);
+			outbuf_puts(&ob, field_names[q->fields[k]]);
+		}
+		outbuf_putc(&ob, '\n');
+	} else {
+		outbuf_putc(&ob, '[');
+	}
+
+	for (i = 0; i < count; i++) {
+		if (q->format == QFMT_JSON) outbuf_puts(&ob, (i) ? ",\n {" : "\n {");
+
+		for (k = 0; k < q->nfields; k++) {
+			field = q->fields[k];
+
+			if (q->format == QFMT_JSON) {
+				outbuf_printf(&ob, (k) ? ", \"%s\": " : "\"%s\": ", field_names[field]);
+			} else if (k) {
+				outbuf_putc(&ob, sep);
+			}
+
+			if (query_is_string(field)) {
+				query_write_string(&ob, q->format, query_get_string(tracks[i], field));
+			} else {
+				outbuf_printf(&ob, "%lu", query_get_number(tracks[i], field));
+			}
+		}
+
+		outbuf_puts(&ob, (q->format == QFMT_JSON) ? "}" : "\n");
+	}
+
+	if (q->format == QFMT_JSON) outbuf_puts(&ob, "\n]\n");
+	return outbuf_free(&ob);
+}
+
+
+void query_free(struct query *q) {
+	struct query_term *t;
+
+	if (!q) return;
+
+	while ((t = q->terms)) {
+		q->terms = t->next;
+		if (t->op == QOP_REGEX) regfree(&t->regex);
+		free(t->text);
+		free(t);
+	}
+}
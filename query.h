@@ -0,0 +1,167 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * query.h - header file for queries over a tracklist
+ *
+ * This file provides the prototypes and structures that are needed to
+ * select tracks from a tracklist by their tags, sort them and write them
+ * in a machine readable format (TSV, CSV or JSON).
+ *
+ * A query consists of terms that must all be true for a track:
+ *
+ *   field=value      the field equals value (strings are compared exactly)
+ *   field=min..max   a numeric field lies within min and max, either of
+ *                    them may be omitted ("year=..1979", "length=300..")
+ *   field~text       a string field contains text (case insensitive)
+ *   field~/regex/    a string field matches the extended regular expression
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_QUERY_H
+#define __ZENCP_QUERY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <regex.h>
+
+#include "id3.h"
+#include "tracklist.h"
+#include "outbuf.h"
+#include "misc.h"
+
+/* the maximum number of sort keys */
+#define _QUERY_MAX_KEYS 8
+
+/**
+ * The fields of a track that can be used in queries. The names are the
+ * ones that are used on the command line and in the output.
+ */
+enum query_field {
+	QF_TRACKID,
+	QF_ARTIST,
+	QF_TITLE,
+	QF_ALBUM,
+	QF_GENRE,
+	QF_YEAR,
+	QF_TRACKNO,
+	QF_LENGTH,
+	QF_SIZE,
+	_QF_COUNT
+};
+
+/**
+ * The output formats of a query.
+ */
+enum query_format {
+	QFMT_TSV,	/* tab separated values with a header line */
+	QFMT_CSV,	/* comma separated values (RFC 4180) with a header line */
+	QFMT_JSON	/* a JSON array with one object per track */
+};
+
+/**
+ * The kinds of comparisons within a term, see above.
+ */
+enum query_op {
+	QOP_EQUAL,
+	QOP_RANGE,
+	QOP_SUBSTR,
+	QOP_REGEX
+};
+
+/**
+ * A single term of a query. Terms are kept in a simply linked list.
+ */
+struct query_term {
+	int field;		/* the field that is compared, see enum query_field */
+	int op;			/* the comparison, see enum query_op */
+	char *text;		/* the text for string comparisons */
+	regex_t regex;		/* the compiled regular expression for QOP_REGEX */
+	unsigned long min;	/* the bounds for numeric comparisons */
+	unsigned long max;
+
+	struct query_term *next;
+};
+
+/**
+ * A complete query: what to select, how to sort it and what to print.
+ */
+struct query {
+	struct query_term *terms;	/* all terms must match */
+	int sort[_QUERY_MAX_KEYS];	/* the sort keys: field + 1, negative for descending */
+	int nsort;			/* the number of sort keys */
+	int fields[_QF_COUNT];		/* the fields that are printed */
+	int nfields;			/* the number of fields that are printed */
+	int format;			/* the output format, see enum query_format */
+};
+
+/**
+ * query_init() sets up an empty query that matches all tracks, does not sort
+ * and prints every field as TSV.
+ */
+void	query_init(struct query *q);
+
+/**
+ * query_add_term() parses expr (see above) and adds it to the query. It returns
+ * 1 on success and 0 if expr is invalid.
+ */
+int	query_add_term(struct query *q, const char *expr);
+
+/**
+ * query_set_sort() parses a comma separated list of fields to sort by. A leading
+ * '-' sorts a field in descending order ("artist,-year"). It returns 1 on success
+ * and 0 if the list is invalid.
+ */
+int	query_set_sort(struct query *q, const char *keys);
+
+/**
+ * query_set_fields() parses a comma separated list of fields that are printed.
+ * It returns 1 on success and 0 if the list is invalid.
+ */
+int	query_set_fields(struct query *q, const char *keys);
+
+/**
+ * query_set_format() selects the output format by its name ("tsv", "csv" or
+ * "json"). It returns 1 on success and 0 if the name is unknown.
+ */
+int	query_set_format(struct query *q, const char *name);
+
+/**
+ * query_match() returns 1 if the track represented by tag matches all terms of
+ * the query and 0 otherwise.
+ */
+int	query_match(const struct query *q, const s_id3_tag *tag);
+
+/**
+ * query_run() selects all matching tracks from the tracklist tl and sorts
+ * them. It returns a newly allocated array of pointers to the
+ * tracks (the tracks are not copied) and stores their number in count. NULL is
+ * returned in case of errors.
+ */
+s_id3_tag** query_run(const struct query *q, struct tracklist *tl, unsigned int *count);
+
+/**
+ * query_write() writes count tracks in the format of the query to out.
+ * It returns 1 on success and 0 if writing failed.
+ */
+int	query_write(const struct query *q, s_id3_tag **tracks, unsigned int count, FILE *out);
+
+/**
+ * query_write_string() appends the string s to ob, escaped for the given format
+ * (see enum query_format). JSON strings are quoted, bytes that are not UTF-8
+ * are taken for Latin-1 (as in ID3v1 tags) and written as \u00XX.
+ */
+void	query_write_string(struct outbuf *ob, int format, const char *s);
+
+/**
+ * query_free() frees all memory that is held by the terms of a query.
+ */
+void	query_free(struct query *q);
+
+#endif
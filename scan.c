@@ -0,0 +1,366 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * scan.c - implementation file for inspecting the tags of many files
+ *
+ * This file provides the implementation of the tag scanner. The files are
+ * collected into an array first, then the tags are read in parallel into
+ * a second array of the same order, so the results can be written in that
+ * order through one output buffer (see outbuf.h).
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "scan.h"
+
+/**
+ * The columns of the output.
+ */
+static const char *scan_columns[] = {
+	"file", "artist", "title", "album", "genre", "year", "trackno", "length",
+	"bitrate", "frequency", "size", "missing"
+};
+
+#define _SCAN_COLUMNS (sizeof(scan_columns) / sizeof(scan_columns[0]))
+
+/**
+ * The names of the missing fields in the order of their flags (_MISSING_...).
+ */
+static const char *missing_names[] = {
+	"artist", "title", "album", "genre", "year", "length"
+};
+
+#define _SCAN_MISSING (sizeof(missing_names) / sizeof(missing_names[0]))
+
+
+/**
+ * scan_has_suffix() returns 1 if name ends with suffix (case does not matter).
+ */
+static int scan_has_suffix(const char *name, const char *suffix) {
+	size_t n = strlen(name), l = strlen(suffix);
+
+	return ((n > l) && (!strcasecmp(name + n - l, suffix)));
+}
+
+
+/**
+ * scan_push() appends a copy of filename to the files of the scan. It returns
+ * 1 on success and 0 if there was no memory left.
+ */
+static int scan_push(struct scan *s, const char *filename) {
+	char **files;
+	char *copy;
+
+	if (s->nfiles == s->sfiles) {
+		files = (char**)realloc(s->files, ((s->sfiles) ? s->sfiles * 2 : 64) * sizeof(char*));
+		if (!files) return 0;
+		s->files = files;
+		s->sfiles = (s->sfiles) ? s->sfiles * 2 : 64;
+	}
+
+	if (!(copy = strdup(filename))) return 0;
+	s->files[s->nfiles++] = copy;
+	return 1;
+}
+
+
+/**
+ * scan_join() returns a newly allocated string with the path of name within
+ * dir (dir has the given length) or NULL if there was no memory left.
+ */
+static char* scan_join(const char *dir, size_t len, const char *name) {
+	char *path;
+
+	if (!(path = (char*)malloc(len + strlen(name) + 2))) return 0;
+	memcpy(path, dir, len);
+	if ((len) && (dir[len - 1] != '/')) path[len++] = '/';
+	strcpy(path + len, name);
+	return path;
+}
+
+
+/**
+ * compare_names() sorts the entries of a directory by name.
+ */
+static int compare_names(const void *a, const void *b) {
+	return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+
+/**
+ * scan_dir() adds all MP3 files below the directory dir in the order of their
+ * names. Hidden files and directories are left out.
+ */
+static unsigned int scan_dir(struct scan *s, const char *dir, int depth) {
+	DIR *d;
+	struct dirent *e;
+	struct stat st;
+	char **names = 0, **tmp;
+	char *path;
+	unsigned int n = 0, size = 0, i, added = 0;
+
+	if ((depth > _SCAN_MAX_DEPTH) || (!(d = opendir(dir)))) return 0;
+
+	while ((e = readdir(d))) {
+		if (e->d_name[0] == '.') continue;
+
+		if (n == size) {
+			if (!(tmp = (char**)realloc(names, ((size) ? size * 2 : 64) * sizeof(char*)))) break;
+			names = tmp;
+			size = (size) ? size * 2 : 64;
+		}
+		if (!(names[n] = strdup(e->d_name))) break;
+		n++;
+	}
+	closedir(d);
+
+	qsort(names, n, sizeof(char*), compare_names);
+
+	for (i = 0; i < n; i++) {
+		path = scan_join(dir, strlen(dir), names[i]);
+		if ((path) && (!stat(path, &st))) {
+			if (S_ISDIR(st.st_mode)) {
+				added += scan_dir(s, path, depth + 1);
+			} else if ((S_ISREG(st.st_mode)) && (scan_has_suffix(names[i], ".mp3"))) {
+				added += scan_push(s, path);
+			}
+		}
+		free(path);
+		free(names[i]);
+	}
+	free(names);
+	return added;
+}
+
+
+/**
+ * scan_playlist() adds all files that are listed in the playlist at path (see
+ * playlist_read()).
+ */
+static unsigned int scan_playlist(struct scan *s, const char *path) {
+	struct playlist *p;
+	unsigned int i, added = 0;
+
+	if (!(p = playlist_read(path))) return 0;
+	for (i = 0; i < p->n; i++) added += scan_push(s, p->files[i]);
+	playlist_free(p);
+	return added;
+}
+
+
+void scan_init(struct scan *s) {
+	s->files = 0;
+	s->tags = 0;
+	s->nfiles = 0;
+	s->sfiles = 0;
+}
+
+
+unsigned int scan_add(struct scan *s, const char *path) {
+	struct stat st;
+
+	if ((!s) || (!path)) return 0;
+
+	if (!stat(path, &st)) {
+		if (S_ISDIR(st.st_mode)) return scan_dir(s, path, 0);
+		if ((S_ISREG(st.st_mode)) && (playlist_is(path))) {
+			return scan_playlist(s, path);
+		}
+	}
+	return scan_push(s, path);
+}
+
+
+/**
+ * The scan for scan_read_job() and whether to use ID3v1 tags.
+ */
+struct scan_job {
+	struct scan *s;
+	char id3v1;
+};
+
+
+/**
+ * scan_read_job() reads all tags of one file. The tag object is released by
+ * id3_tag_need() once everything has been read.
+ */
+static void scan_read_job(void *ctx, unsigned int i) {
+	struct scan_job *job = (struct scan_job*)ctx;
+	struct id3_context id3;
+	s_id3_tag *tag;
+
+	id3_context_init(&id3, job->id3v1);
+	tag = id3_read_file(&id3, job->s->files[i]);
+	id3_context_free(&id3);
+
+	if ((tag) && (!id3_tag_need(tag, _ID3_ALL))) {
+		id3_delete_id3_struct(tag);
+		tag = 0;
+	}
+	job->s->tags[i] = tag;
+}
+
+
+void scan_read(struct scan *s, char id3v1, int threads) {
+	struct scan_job job;
+
+	if ((!s) || (!s->nfiles)) return;
+	if (!(s->tags = (s_id3_tag**)calloc(s->nfiles, sizeof(s_id3_tag*)))) {
+		print_error(G_NOMEM);
+		return;
+	}
+
+	job.s = s;
+	job.id3v1 = id3v1;
+	pool_run(s->nfiles, threads, scan_read_job, &job);
+}
+
+
+/**
+ * scan_write_missing() writes the names of the missing fields, a list with
+ * commas for TSV and CSV and an array for JSON.
+ */
+static void scan_write_missing(struct outbuf *ob, int format, const s_id3_tag *tag,
+			       unsigned int missing) {
+	char list[128];
+	unsigned int k, n = 0;
+
+	list[0] = '\0';
+	if (format == QFMT_JSON) outbuf_putc(ob, '[');
+
+	if (!tag) {
+		if (format == QFMT_JSON) {
+			outbuf_puts(ob, "\"unreadable\"]");
+		} else {
+			outbuf_puts(ob, "unreadable");
+		}
+		return;
+	}
+
+	for (k = 0; k < _SCAN_MISSING; k++) {
+		if (!(missing & (1 << k))) continue;
+
+		if (format == QFMT_JSON) {
+			outbuf_printf(ob, (n) ? ", \"%s\"" : "\"%s\"", missing_names[k]);
+		} else {
+			if (n) strcat(list, ",");
+			strcat(list, missing_names[k]);
+		}
+		n++;
+	}
+
+	if (format == QFMT_JSON) {
+		outbuf_putc(ob, ']');
+	} else {
+		query_write_string(ob, format, list);
+	}
+}
+
+
+int scan_write(struct scan *s, int format, FILE *out) {
+	struct outbuf ob;
+	s_id3_tag *tag;
+	unsigned int i, k;
+	char sep;
+
+	if ((!s) || (!outbuf_init(&ob, out))) return 0;
+	sep = (format == QFMT_CSV) ? ',' : '\t';
+
+	/* TSV and CSV start with a header line */
+	if (format != QFMT_JSON) {
+		for (k = 0; k < _SCAN_COLUMNS; k++) {
+			if (k) outbuf_putc(&ob, sep);
+			outbuf_puts(&ob, scan_columns[k]);
+		}
+		outbuf_putc(&ob, '\n');
+	} else {
+		outbuf_putc(&ob, '[');
+	}
+
+	for (i = 0; i < s->nfiles; i++) {
+		tag = (s->tags) ? s->tags[i] : 0;
+		if (format == QFMT_JSON) outbuf_puts(&ob, (i) ? ",\n {" : "\n {");
+
+		for (k = 0; k < _SCAN_COLUMNS; k++) {
+			if (format == QFMT_JSON) {
+				outbuf_printf(&ob, (k) ? ", \"%s\": " : "\"%s\": ", scan_columns[k]);
+			} else if (k) {
+				outbuf_putc(&ob, sep);
+			}
+
+			switch (k) {
+				case 0:  query_write_string(&ob, format, s->files[i]); break;
+				case 1:  query_write_string(&ob, format, (tag) ? tag->artist : ""); break;
+				case 2:  query_write_string(&ob, format, (tag) ? tag->title : ""); break;
+				case 3:  query_write_string(&ob, format, (tag) ? tag->album : ""); break;
+				case 4:  query_write_string(&ob, format, (tag) ? tag->genre : ""); break;
+				case 5:  outbuf_printf(&ob, "%u", (tag) ? tag->year : 0); break;
+				case 6:  outbuf_printf(&ob, "%u", (tag) ? tag->trackno : 0); break;
+				case 7:  outbuf_printf(&ob, "%u", (tag) ? tag->time : 0); break;
+				case 8:  outbuf_printf(&ob, "%u", (tag) ? tag->bitrate : 0); break;
+				case 9:  outbuf_printf(&ob, "%u", (tag) ? tag->frequency : 0); break;
+				case 10: outbuf_printf(&ob, "%u", (tag) ? tag->size : 0); break;
+				default: scan_write_missing(&ob, format, tag,
+							    (tag) ? id3_missing_fields(tag) : _MISSING_ALL);
+			}
+		}
+
+		outbuf_puts(&ob, (format == QFMT_JSON) ? "}" : "\n");
+	}
+
+	if (format == QFMT_JSON) outbuf_puts(&ob, "\n]\n");
+	return outbuf_free(&ob);
+}
+
+
+unsigned int scan_summary(struct scan *s, FILE *out) {
+	unsigned int counts[_SCAN_MISSING];
+	unsigned int i, k, missing, unreadable = 0, incomplete = 0;
+
+	if (!s) return 0;
+	memset(counts, 0, sizeof(counts));
+
+	for (i = 0; i < s->nfiles; i++) {
+		if ((!s->tags) || (!s->tags[i])) {
+			unreadable++;
+			continue;
+		}
+		if (!(missing = id3_missing_fields(s->tags[i]))) continue;
+
+		incomplete++;
+		for (k = 0; k < _SCAN_MISSING; k++) {
+			if (missing & (1 << k)) counts[k]++;
+		}
+	}
+
+	fprintf(out, " %u file%s scanned, %u could not be read.\n", s->nfiles,
+		(s->nfiles != 1) ? "s" : "", unreadable);
+	if (incomplete) {
+		fprintf(out, " %u file%s cannot be transferred, they lack:\n", incomplete,
+			(incomplete != 1) ? "s" : "");
+		for (k = 0; k < _SCAN_MISSING; k++) {
+			if (counts[k]) fprintf(out, "   %-8s %u\n", missing_names[k], counts[k]);
+		}
+	}
+	fprintf(out, "\n");
+	return unreadable;
+}
+
+
+void scan_free(struct scan *s) {
+	unsigned int i;
+
+	if (!s) return;
+
+	for (i = 0; i < s->nfiles; i++) {
+		if (s->tags) id3_delete_id3_struct(s->tags[i]);
+		free(s->files[i]);
+	}
+	free(s->tags);
+	free(s->files);
+	scan_init(s);
+}
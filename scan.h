@@ -0,0 +1,91 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * scan.h - header file for inspecting the tags of many files
+ *
+ * This file provides the prototypes and structures of the tag scanner that
+ * is used by -p. It collects MP3 files from files, directories (searched
+ * recursively, in the order of their names) and playlists (.m3u, .m3u8),
+ * reads their tags in parallel (see pool.h) and writes one record per file
+ * in the order the files were collected, so the output does not depend on
+ * the number of threads.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_SCAN_H
+#define __ZENCP_SCAN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <limits.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "id3.h"
+#include "query.h"
+#include "outbuf.h"
+#include "pool.h"
+#include "playlist.h"
+#include "misc.h"
+
+/* directories are not searched deeper than this, it stops symbolic link loops */
+#define _SCAN_MAX_DEPTH 32
+
+/**
+ * The files of a scan and their tags. Both arrays have the same order.
+ */
+struct scan {
+	char **files;		/* the filenames */
+	s_id3_tag **tags;	/* the tags, NULL if a file could not be read */
+	unsigned int nfiles;	/* the number of files */
+	unsigned int sfiles;	/* the number of allocated files */
+};
+
+/**
+ * scan_init() sets up an empty scan.
+ */
+void		scan_init(struct scan *s);
+
+/**
+ * scan_add() adds the MP3 files given by path to the scan: a directory adds all
+ * .mp3 files below it, a playlist adds all files it lists (relative to the
+ * directory of the playlist) and anything else is added as it is, so that files
+ * that cannot be read show up in the output. It returns the number of files that
+ * were added.
+ */
+unsigned int	scan_add(struct scan *s, const char *path);
+
+/**
+ * scan_read() reads all tags of all files on up to threads threads (0 means one
+ * per CPU). If id3v1 is non-NULL, ID3v1 tags are used.
+ */
+void		scan_read(struct scan *s, char id3v1, int threads);
+
+/**
+ * scan_write() writes one record per file to out in the given format (see enum
+ * query_format) with all tags, the MP3 header fields and the fields that would
+ * keep the file from being transferred. It returns 1 on success and 0 if writing
+ * failed.
+ */
+int		scan_write(struct scan *s, int format, FILE *out);
+
+/**
+ * scan_summary() writes how many files could not be read and how many of them
+ * lack which field to out. It returns the number of files that could not be read.
+ */
+unsigned int	scan_summary(struct scan *s, FILE *out);
+
+/**
+ * scan_free() frees all files and tags of the scan.
+ */
+void		scan_free(struct scan *s);
+
+#endif
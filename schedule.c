@@ -0,0 +1,428 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * schedule.c - implementation file for deadline aware transfer scheduling
+ *
+ * This file provides the implementation of the deadline scheduler. The time
+ * a file needs to be transferred is estimated from its size and the
+ * throughput of the player, which is measured during the run and stored in
+ * $HOME/.zencp/throughput for the next one. With the estimates, the list of
+ * pending files is sorted into four classes:
+ *
+ *   0. files that will be skipped anyway (already on the player, no tags)
+ *   1. complete albums that fit into the budget, smallest albums first so
+ *      that as many albums as possible are completed
+ *   2. single tracks that still fit into the remaining budget, smallest
+ *      tracks first
+ *   3. everything else, these files will not be started
+ *
+ * The plan is recalculated after each transfer, so a partially transferred
+ * album only counts with its missing tracks and is preferred next time.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "schedule.h"
+
+/**
+ * An MP3 file as the planner sees it. Only used internally.
+ */
+struct plan_entry {
+	mp3_file *file;			/* the element of the list of files */
+	unsigned long long size;	/* the size of the file, 0 if it will be skipped */
+	int group;			/* the album the file belongs to, -1 for none */
+	int order;			/* the position in the list before planning */
+	int cls;			/* the class of the file, see above */
+	double key;			/* the sort key within the class */
+};
+
+/**
+ * An album as the planner sees it. Only used internally.
+ */
+struct plan_group {
+	unsigned long long size;	/* the size of all missing tracks of the album */
+	int rank;			/* the position of the album in the plan, -1 if
+					   it does not fit */
+};
+
+
+double schedule_parse_time(const char *s) {
+	char *end = 0;
+	double t;
+
+	if ((!s) || (!is_digit(s[0]))) return -1.0;
+
+	t = strtod(s, &end);
+
+	/* an optional unit may follow the number */
+	switch (*end) {
+		case '\0':
+		case 's': break;
+		case 'm': t *= 60.0;
+			break;
+		case 'h': t *= 3600.0;
+			break;
+		default: return -1.0;
+	}
+
+	if ((*end != '\0') && (end[1] != '\0')) return -1.0;
+	return t;
+}
+
+
+void schedule_init(struct schedule *s, double start, double budget) {
+	if (!s) return;
+
+	s->start = start;
+	s->budget = budget;
+	s->rate = _SCHEDULE_DEFAULT_RATE;
+	s->samples = 0;
+	s->device = 0;
+}
+
+
+/**
+ * The throughput file contains one line per player: the rate in bytes per
+ * second, a tab and the key of the player.
+ */
+int schedule_load_rate(struct schedule *s, const char *device) {
+	char line[512];
+	char *path, *key;
+	FILE *f;
+	int found = 0;
+
+	if ((!s) || (!device)) return 0;
+	s->device = new_string(device);
+
+	if (!(path = config_file_path(_SCHEDULE_RATE_FILE))) return 0;
+	f = fopen(path, "r");
+	free(path);
+	if (!f) return 0;
+
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = '\0';
+		if (!(key = strchr(line, '\t'))) continue;
+		*key++ = '\0';
+
+		if (!strcmp(key, device)) {
+			s->rate = strtod(line, 0);
+			s->samples = 1;
+			found = 1;
+			break;
+		}
+	}
+
+	fclose(f);
+
+	/* a broken entry is not better than the default */
+	if (s->rate <= 0.0) {
+		s->rate = _SCHEDULE_DEFAULT_RATE;
+		s->samples = 0;
+		found = 0;
+	}
+	return found;
+}
+
+
+int schedule_save_rate(struct schedule *s) {
+	char line[512];
+	char *path, *tmp_path, *key;
+	FILE *in, *out;
+	size_t l;
+
+	if ((!s) || (!s->device) || (!s->samples)) return 0;
+	if (!(path = config_file_path(_SCHEDULE_RATE_FILE))) return 0;
+
+	l = strlen(path) + 5;
+	if (!(tmp_path = (char*)malloc(sizeof(char[l])))) {
+		free(path);
+		return 0;
+	}
+	snprintf(tmp_path, l, "%s.new", path);
+
+	if (!(out = fopen(tmp_path, "w"))) {
+		free(tmp_path);
+		free(path);
+		return 0;
+	}
+
+	/* copy the entries of all other players and replace the one of ours */
+	if ((in = fopen(path, "r"))) {
+		while (fgets(line, sizeof(line), in)) {
+			if (!(key = strchr(line, '\t'))) continue;
+			if (!strncmp(key + 1, s->device, strlen(s->device)) &&
+			    (key[strlen(s->device) + 1] == '\n')) continue;
+			fputs(line, out);
+		}
+		fclose(in);
+	}
+	fprintf(out, "%.0f\t%s\n", s->rate, s->device);
+
+	/* rename() replaces the old file atomically */
+	l = ((fclose(out) == 0) && (rename(tmp_path, path) == 0));
+
+	free(tmp_path);
+	free(path);
+	return (int)l;
+}
+
+
+void schedule_update_rate(struct schedule *s, unsigned long long bytes, double seconds) {
+	double measured;
+
+	if ((!s) || (!bytes) || (seconds <= 0.0)) return;
+	measured = (double)bytes / seconds;
+
+	/* the first measurement replaces the guess, later ones are smoothed so
+	 * that the estimate follows a drifting throughput without jumping around */
+	if (!s->samples) {
+		s->rate = measured;
+	} else {
+		s->rate = (1.0 - _SCHEDULE_ALPHA) * s->rate + _SCHEDULE_ALPHA * measured;
+	}
+	s->samples++;
+}
+
+
+double schedule_remaining(struct schedule *s) {
+	if (!s) return 0.0;
+	return s->budget - (stats_now() - s->start);
+}
+
+
+/**
+ * schedule_estimate() returns the pessimistic number of seconds that are
+ * needed to transfer the given number of bytes.
+ */
+static double schedule_estimate(struct schedule *s, unsigned long long bytes) {
+	return ((double)bytes / s->rate) * _SCHEDULE_SAFETY;
+}
+
+
+int schedule_fits(struct schedule *s, s_id3_tag *tag) {
+	if ((!s) || (!tag)) return 0;
+	return (schedule_estimate(s, tag->size) <= schedule_remaining(s));
+}
+
+
+/**
+ * The files for schedule_read_tags(), whether to use ID3v1 tags and whether
+ * the tags are transient.
+ */
+struct read_job {
+	mp3_file **files;
+	char id3v1;
+	char transient;
+};
+
+
+/**
+ * schedule_read_job() reads the tags of one file. The ID3 functions keep their
+ * state in a context of their own, so the jobs run in parallel.
+ */
+static void schedule_read_job(void *ctx, unsigned int i) {
+	struct read_job *job = (struct read_job*)ctx;
+	struct id3_context id3;
+
+	id3_context_init(&id3, job->id3v1);
+	id3.transient = job->transient;
+	job->files[i]->tag = id3_read_file(&id3, job->files[i]->filename);
+	id3_context_free(&id3);
+
+	/* the planner needs the names, the size and the track number to keep the
+	 * tracks of an album in order, it is read while the tag object is linked.
+	 * The tag object itself would hold memory for every file until it is sent. */
+	id3_tag_need(job->files[i]->tag, _ID3_NUMBERS);
+	id3_tag_release(job->files[i]->tag);
+}
+
+
+void schedule_read_tags(mp3_file *list, char id3v1, char transient) {
+	struct read_job job;
+	mp3_file *i;
+	unsigned int n = 0;
+
+	for (i = list_first_element(list); i; i = i->next) {
+		if (!i->tag) n++;
+	}
+	if (!n) return;
+	if (!(job.files = (mp3_file**)malloc(n * sizeof(mp3_file*)))) {
+		print_error(G_NOMEM);
+		return;
+	}
+
+	n = 0;
+	for (i = list_first_element(list); i; i = i->next) {
+		if (!i->tag) job.files[n++] = i;
+	}
+
+	job.id3v1 = id3v1;
+	job.transient = transient;
+	pool_run(n, 0, schedule_read_job, &job);
+	free(job.files);
+}
+
+
+/**
+ * compare_album() sorts plan entries by artist and album so that all tracks
+ * of an album are next to each other. Entries without tags come last.
+ */
+static int compare_album(const void *a, const void *b) {
+	const s_id3_tag *x = (*(const struct plan_entry**)a)->file->tag;
+	const s_id3_tag *y = (*(const struct plan_entry**)b)->file->tag;
+	int r;
+
+	if ((!x) || (!y)) return (x == 0) - (y == 0);
+	if ((r = strcmp(x->artist, y->artist))) return r;
+	return strcmp(x->album, y->album);
+}
+
+
+/**
+ * compare_plan() sorts plan entries into the order in which they will be
+ * transferred: by class, then by the key within the class and finally by
+ * their former position so that the sort is stable.
+ */
+static int compare_plan(const void *a, const void *b) {
+	const struct plan_entry *x = (const struct plan_entry*)a;
+	const struct plan_entry *y = (const struct plan_entry*)b;
+
+	if (x->cls != y->cls) return x->cls - y->cls;
+	if (x->key != y->key) return (x->key < y->key) ? -1 : 1;
+	return x->order - y->order;
+}
+
+
+/**
+ * compare_group() sorts pointers to the albums of schedule_plan() by their
+ * missing size. Albums of the same size stay in the order of the group array.
+ */
+static int compare_group(const void *a, const void *b) {
+	const struct plan_group *x = *(const struct plan_group* const*)a;
+	const struct plan_group *y = *(const struct plan_group* const*)b;
+
+	if (x->size != y->size) return (x->size < y->size) ? -1 : 1;
+	return (x < y) ? -1 : (x > y);
+}
+
+
+mp3_file* schedule_plan(struct schedule *s, mp3_file *list, struct tracklist *tracklist, char force) {
+	struct plan_entry *entries = 0, **by_album = 0;
+	struct plan_group *groups = 0;
+	struct plan_group **group_order = 0;
+	int n = 0, ngroups = 0, i, k;
+	double budget, used = 0.0;
+	mp3_file *f;
+	s_id3_tag *t, *last = 0;
+
+	if ((!s) || (!(list = list_first_element(list)))) return list;
+
+	for (f = list; f; f = f->next) n++;
+
+	entries = (struct plan_entry*)malloc(n * sizeof(struct plan_entry));
+	by_album = (struct plan_entry**)malloc(n * sizeof(struct plan_entry*));
+	groups = (struct plan_group*)malloc(n * sizeof(struct plan_group));
+	group_order = (struct plan_group**)malloc(n * sizeof(struct plan_group*));
+	if ((!entries) || (!by_album) || (!groups) || (!group_order)) {
+		print_error(G_NOMEM);
+		free(entries); free(by_album); free(groups); free(group_order);
+		return list;
+	}
+
+	/* class 0: files that cost nothing because they are skipped anyway */
+	for (i = 0, f = list; f; f = f->next, i++) {
+		entries[i].file = f;
+		entries[i].size = 0;
+		entries[i].group = -1;
+		entries[i].order = i;
+		entries[i].cls = 0;
+		entries[i].key = 0.0;
+		by_album[i] = &entries[i];
+
+		if ((!(t = f->tag)) || ((!force) && (tracklist_find_tag(tracklist, t)))) continue;
+		entries[i].size = t->size;
+		entries[i].cls = 3;
+	}
+
+	/* find the albums: tracks with the same artist and album, but the
+	 * default tag does not make an album */
+	qsort(by_album, n, sizeof(struct plan_entry*), compare_album);
+	for (i = 0; i < n; i++) {
+		t = by_album[i]->file->tag;
+		if ((by_album[i]->cls == 0) || (!strcmp(t->album, _DEFAULT_STRING))) continue;
+
+		if ((!last) || (strcmp(t->artist, last->artist)) || (strcmp(t->album, last->album))) {
+			groups[ngroups].size = 0;
+			groups[ngroups].rank = -1;
+			group_order[ngroups] = &groups[ngroups];
+			ngroups++;
+		}
+		by_album[i]->group = ngroups - 1;
+		groups[ngroups - 1].size += by_album[i]->size;
+		last = t;
+	}
+
+	budget = schedule_remaining(s);
+
+	/* class 1: complete albums, the smallest first */
+	qsort(group_order, ngroups, sizeof(struct plan_group*), compare_group);
+
+	for (k = 0; k < ngroups; k++) {
+		if (used + schedule_estimate(s, group_order[k]->size) > budget) break;
+		used += schedule_estimate(s, group_order[k]->size);
+		group_order[k]->rank = k;
+	}
+
+	for (i = 0; i < n; i++) {
+		if ((entries[i].group < 0) || (groups[entries[i].group].rank < 0)) continue;
+		entries[i].cls = 1;
+		/* keep the tracks of an album in the order of their track numbers, which
+		 * have usually been read with the names (see schedule_read_tags()) */
+		id3_tag_need(entries[i].file->tag, _ID3_NUMBERS);
+		entries[i].key = groups[entries[i].group].rank * 65536.0 + entries[i].file->tag->trackno;
+	}
+
+	/* class 2: single tracks that fit into what is left, the smallest first */
+	for (i = 0; i < n; i++) {
+		if (entries[i].cls == 3) entries[i].key = (double)entries[i].size;
+	}
+	qsort(entries, n, sizeof(struct plan_entry), compare_plan);
+
+	for (i = 0; i < n; i++) {
+		if (entries[i].cls != 3) continue;
+		if (used + schedule_estimate(s, entries[i].size) > budget) break;
+		used += schedule_estimate(s, entries[i].size);
+		entries[i].cls = 2;
+	}
+
+	/* class 3: keep the original order for the files that will not make it */
+	for (i = 0; i < n; i++) {
+		if (entries[i].cls == 3) entries[i].key = 0.0;
+	}
+	qsort(entries, n, sizeof(struct plan_entry), compare_plan);
+
+	/* relink the list in the planned order */
+	for (i = 0; i < n; i++) {
+		entries[i].file->prev = (i > 0) ? entries[i - 1].file : 0;
+		entries[i].file->next = (i < n - 1) ? entries[i + 1].file : 0;
+	}
+	list = entries[0].file;
+
+	free(entries);
+	free(by_album);
+	free(groups);
+	free(group_order);
+	return list;
+}
+
+
+void schedule_free(struct schedule *s) {
+	if (!s) return;
+
+	free(s->device);
+	s->device = 0;
+}
@@ -0,0 +1,122 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * schedule.h - header file for deadline aware transfer scheduling
+ *
+ * This file provides the prototypes and structures that are needed to
+ * transfer as much as possible to a player within a given time budget.
+ * The list of MP3 files is reordered so that complete albums come first
+ * and files that will not make it before the deadline come last.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_SCHEDULE_H
+#define __ZENCP_SCHEDULE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "list.h"
+#include "id3.h"
+#include "tracklist.h"
+#include "stats.h"
+#include "pool.h"
+#include "misc.h"
+
+/* the throughput that is assumed as long as nothing has been measured and
+ * nothing is known from earlier runs (bytes per second) */
+#define _SCHEDULE_DEFAULT_RATE	(1024.0 * 1024.0)
+
+/* every estimate is stretched by this factor so that a track is not started
+ * if it would only just make it */
+#define _SCHEDULE_SAFETY	1.15
+
+/* the weight of a new measurement when the estimated throughput is updated */
+#define _SCHEDULE_ALPHA		0.3
+
+/* the file in $HOME/.zencp that stores the throughput of known players */
+#define _SCHEDULE_RATE_FILE	"throughput"
+
+/**
+ * Everything the scheduler needs to know about the current run.
+ */
+struct schedule {
+	double start;		/* stats_now() at the beginning of the run */
+	double budget;		/* seconds after start when everything must be done */
+	double rate;		/* estimated throughput in bytes per second */
+	unsigned int samples;	/* number of measurements rate is based on */
+	char *device;		/* the key of the player in the throughput file */
+};
+
+/**
+ * schedule_parse_time() converts a time budget like "90", "45s", "20m" or
+ * "1h" into seconds. It returns a negative value if the string is invalid.
+ */
+double	schedule_parse_time(const char *s);
+
+/**
+ * schedule_init() sets up the scheduler for a run that started at start
+ * (see stats_now()) and has budget seconds.
+ */
+void	schedule_init(struct schedule *s, double start, double budget);
+
+/**
+ * schedule_load_rate() looks up the throughput that was measured for the
+ * player identified by device in earlier runs. It returns 1 if a value was
+ * found and 0 if the default rate is used.
+ */
+int	schedule_load_rate(struct schedule *s, const char *device);
+
+/**
+ * schedule_save_rate() stores the current throughput estimate of the player
+ * for later runs. It returns 1 on success and 0 otherwise.
+ */
+int	schedule_save_rate(struct schedule *s);
+
+/**
+ * schedule_update_rate() feeds the measurement of a finished transfer into
+ * the throughput estimate.
+ */
+void	schedule_update_rate(struct schedule *s, unsigned long long bytes, double seconds);
+
+/**
+ * schedule_remaining() returns the number of seconds left until the deadline.
+ */
+double	schedule_remaining(struct schedule *s);
+
+/**
+ * schedule_fits() returns 1 if the file represented by tag can be
+ * transferred before the deadline and 0 if it should not be started.
+ */
+int	schedule_fits(struct schedule *s, s_id3_tag *tag);
+
+/**
+ * schedule_read_tags() reads the ID3 tags of every file in list that does
+ * not have them yet. The planner needs the album, the track number and the
+ * size of a file in advance. Files whose tags cannot be read keep a NULL tag.
+ * The files are read in parallel. If transient is not 0, the tags only intern
+ * strings that are known already (see id3_settle()).
+ */
+void	schedule_read_tags(mp3_file *list, char id3v1, char transient);
+
+/**
+ * schedule_plan() reorders list for the time that is left: files that will
+ * be skipped anyway come first, then complete albums with the smallest ones
+ * first, then single tracks that still fit and finally everything that will
+ * not make it. Tracks contained in tracklist are only considered to be
+ * skipped if force is not set. Returns the new head of the list.
+ */
+mp3_file* schedule_plan(struct schedule *s, mp3_file *list, struct tracklist *tracklist, char force);
+
+/**
+ * schedule_free() frees what has been allocated by schedule_load_rate().
+ */
+void	schedule_free(struct schedule *s);
+
+#endif
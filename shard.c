@@ -0,0 +1,292 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * shard.c - implementation file for spreading files over several players
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "shard.h"
+
+/* the names of the columns of the manifest */
+static const char *shard_columns[_SHARD_COLUMNS] = {
+	"file", "artist", "title", "serial", "usb", "trackid", "size", "status"
+};
+
+/* the names of enum shard_status */
+static const char *shard_states[] = {
+	"pending", "sending", "sent", "exists", "failed", "noroom"
+};
+
+
+void shard_init(struct shard *s) {
+	memset(s, 0, sizeof(struct shard));
+	pthread_mutex_init(&s->lock, 0);
+}
+
+
+int shard_add(struct shard *s, const char *filename, s_id3_tag *tag, unsigned long long hash) {
+	struct shard_entry *entries;
+	unsigned int size;
+
+	if ((!s) || (!filename) || (!tag)) return -1;
+
+	if (s->n == s->size) {
+		size = (s->size) ? s->size * 2 : 64;
+		if (!(entries = (struct shard_entry*)realloc(s->entries, size * sizeof(struct shard_entry)))) {
+			return -1;
+		}
+		s->entries = entries;
+		s->size = size;
+	}
+
+	s->entries[s->n].filename = intern(filename);
+	s->entries[s->n].tag = tag;
+	s->entries[s->n].hash = hash;
+	s->entries[s->n].size = tag->size;
+	s->entries[s->n].status = SH_PENDING;
+	s->entries[s->n].device = -1;
+	s->entries[s->n].trackid = 0;
+	return s->n++;
+}
+
+
+struct shard_device* shard_add_device(struct shard *s, int index) {
+	struct shard_device *d;
+
+	if ((!s) || (s->ndevices >= _MAX_PLAYERS)) return 0;
+
+	d = &s->devices[s->ndevices++];
+	memset(d, 0, sizeof(struct shard_device));
+	d->index = index;
+	tracklist_setup_tracklist(&d->tracklist);
+	stats_init(&d->stats);
+	return d;
+}
+
+
+/**
+ * compare_size() sorts entries by size, the largest first. Entries of the same
+ * size keep their order.
+ */
+static int compare_size(const void *a, const void *b) {
+	const struct shard_entry *x = *(const struct shard_entry**)a;
+	const struct shard_entry *y = *(const struct shard_entry**)b;
+
+	if (x->size != y->size) return (x->size > y->size) ? -1 : 1;
+	return (x < y) ? -1 : (x > y);
+}
+
+
+/**
+ * shard_push() appends the entry i to the queue of d. It returns 1 on success
+ * and 0 if there was no memory left.
+ */
+static int shard_push(struct shard *s, struct shard_device *d, unsigned int i) {
+	unsigned int *queue;
+
+	if (!(queue = (unsigned int*)realloc(d->queue, (d->nqueue + 1) * sizeof(unsigned int)))) return 0;
+	d->queue = queue;
+	d->queue[d->nqueue++] = i;
+	d->queued += s->entries[i].size;
+	return 1;
+}
+
+
+/**
+ * shard_pop() removes the k-th entry from the queue of d and returns it.
+ */
+static unsigned int shard_pop(struct shard *s, struct shard_device *d, unsigned int k) {
+	unsigned int i = d->queue[k];
+
+	memmove(&d->queue[k], &d->queue[k + 1], (d->nqueue - k - 1) * sizeof(unsigned int));
+	d->nqueue--;
+	d->queued -= s->entries[i].size;
+	return i;
+}
+
+
+unsigned int shard_deal(struct shard *s) {
+	struct shard_entry **order;
+	struct shard_device *d;
+	unsigned int i, dealt = 0;
+	int k, best;
+
+	if ((!s) || (!s->n)) return 0;
+	if (!(order = (struct shard_entry**)malloc(s->n * sizeof(struct shard_entry*)))) return 0;
+
+	for (i = 0; i < s->n; i++) order[i] = &s->entries[i];
+	qsort(order, s->n, sizeof(struct shard_entry*), compare_size);
+
+	/* the largest files first, each to the queue with the fewest bytes. That
+	 * does not need to be exact, the players steal from each other later. */
+	for (i = 0; i < s->n; i++) {
+		if (order[i]->status != SH_PENDING) continue;
+
+		for (k = 0, best = -1; k < s->ndevices; k++) {
+			d = &s->devices[k];
+			if ((!d->player) || (d->queued + order[i]->size > d->free)) continue;
+			if ((best < 0) || (d->queued < s->devices[best].queued)) best = k;
+		}
+
+		if ((best < 0) || (!shard_push(s, &s->devices[best], order[i] - s->entries))) {
+			order[i]->status = SH_NOROOM;
+			continue;
+		}
+		dealt++;
+	}
+
+	free(order);
+	return dealt;
+}
+
+
+int shard_take(struct shard *s, int d) {
+	struct shard_device *dev = &s->devices[d], *victim;
+	unsigned int k, i;
+	int v, best = -1, best_k = 0;
+
+	/* first the own queue, from the head */
+	for (k = 0; k < dev->nqueue; k++) {
+		if (s->entries[dev->queue[k]].size <= dev->free) break;
+	}
+
+	if (k < dev->nqueue) {
+		i = shard_pop(s, dev, k);
+	} else {
+		/* then the tail of the fullest queue with a file that fits */
+		for (v = 0; v < s->ndevices; v++) {
+			victim = &s->devices[v];
+			if ((v == d) || ((best >= 0) && (victim->queued <= s->devices[best].queued))) continue;
+
+			for (k = victim->nqueue; k > 0; k--) {
+				if (s->entries[victim->queue[k - 1]].size <= dev->free) break;
+			}
+			if (!k) continue;
+			best = v;
+			best_k = k - 1;
+		}
+		if (best < 0) return -1;
+
+		i = shard_pop(s, &s->devices[best], best_k);
+		dev->stolen++;
+	}
+
+	dev->free -= s->entries[i].size;
+	s->entries[i].status = SH_SENDING;
+	s->entries[i].device = d;
+	return i;
+}
+
+
+void shard_finish(struct shard *s, int i, unsigned int trackid) {
+	struct shard_entry *e = &s->entries[i];
+
+	e->trackid = trackid;
+	e->status = (trackid) ? SH_SENT : SH_FAILED;
+	if (!trackid) s->devices[e->device].free += e->size;
+}
+
+
+unsigned int shard_leftover(struct shard *s) {
+	unsigned int i, n = 0;
+	int k;
+
+	for (k = 0; k < s->ndevices; k++) {
+		for (i = 0; i < s->devices[k].nqueue; i++) {
+			s->entries[s->devices[k].queue[i]].status = SH_NOROOM;
+			n++;
+		}
+		s->devices[k].nqueue = 0;
+		s->devices[k].queued = 0;
+	}
+	return n;
+}
+
+
+unsigned int shard_count(struct shard *s, int status) {
+	unsigned int i, n = 0;
+
+	for (i = 0; i < s->n; i++) {
+		if (s->entries[i].status == status) n++;
+	}
+	return n;
+}
+
+
+int shard_write(struct shard *s, int format, FILE *out) {
+	struct outbuf ob;
+	struct shard_entry *e;
+	struct device_id *id;
+	unsigned int i, k;
+	char sep;
+
+	if ((!s) || (!outbuf_init(&ob, out))) return 0;
+	sep = (format == QFMT_CSV) ? ',' : '\t';
+
+	/* TSV and CSV start with a header line */
+	if (format != QFMT_JSON) {
+		for (k = 0; k < _SHARD_COLUMNS; k++) {
+			if (k) outbuf_putc(&ob, sep);
+			outbuf_puts(&ob, shard_columns[k]);
+		}
+		outbuf_putc(&ob, '\n');
+	} else {
+		outbuf_putc(&ob, '[');
+	}
+
+	for (i = 0; i < s->n; i++) {
+		e = &s->entries[i];
+		id = (e->device >= 0) ? &s->devices[e->device].id : 0;
+		if (format == QFMT_JSON) outbuf_puts(&ob, (i) ? ",\n {" : "\n {");
+
+		for (k = 0; k < _SHARD_COLUMNS; k++) {
+			if (format == QFMT_JSON) {
+				outbuf_printf(&ob, (k) ? ", \"%s\": " : "\"%s\": ", shard_columns[k]);
+			} else if (k) {
+				outbuf_putc(&ob, sep);
+			}
+
+			switch (k) {
+				case 0:  query_write_string(&ob, format, e->filename); break;
+				case 1:  query_write_string(&ob, format, (e->tag) ? e->tag->artist : ""); break;
+				case 2:  query_write_string(&ob, format, (e->tag) ? e->tag->title : ""); break;
+				case 3:  query_write_string(&ob, format, (id) ? id->serial : ""); break;
+				case 4:  query_write_string(&ob, format, (id) ? id->path : ""); break;
+				case 5:  outbuf_printf(&ob, "%u", e->trackid); break;
+				case 6:  outbuf_printf(&ob, "%llu", e->size); break;
+				default: query_write_string(&ob, format, shard_states[e->status]);
+			}
+		}
+
+		outbuf_puts(&ob, (format == QFMT_JSON) ? "}" : "\n");
+	}
+
+	if (format == QFMT_JSON) outbuf_puts(&ob, "\n]\n");
+	return outbuf_free(&ob);
+}
+
+
+void shard_free(struct shard *s) {
+	unsigned int i;
+	int k;
+
+	if (!s) return;
+
+	for (i = 0; i < s->n; i++) {
+		if (s->entries[i].tag) id3_delete_id3_struct(s->entries[i].tag);
+	}
+	free(s->entries);
+
+	for (k = 0; k < s->ndevices; k++) {
+		free(s->devices[k].queue);
+		tracklist_free(&s->devices[k].tracklist);
+	}
+
+	pthread_mutex_destroy(&s->lock);
+	memset(s, 0, sizeof(struct shard));
+}
@@ -0,0 +1,169 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * shard.h - header file for spreading files over several players
+ *
+ * This file provides the prototypes and structures that are needed to
+ * send every file to exactly one of several players (--shard). Every
+ * player has a queue of its own, which is filled before the transfer
+ * starts so that all queues hold about the same number of bytes. Each
+ * player then takes the files from the head of its queue, the largest
+ * first. A player whose queue is empty steals from the tail of the
+ * fullest queue of another player, so faster players send more files.
+ * A file is only taken by a player that still has room for it.
+ *
+ * The scheduling is done here, the transfers themselves are done by
+ * zencp_shard() (see libzencp.h). The result is a manifest of which file
+ * went to which player.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_SHARD_H
+#define __ZENCP_SHARD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <libnjb.h>
+
+#include "id3.h"
+#include "player.h"
+#include "tracklist.h"
+#include "device.h"
+#include "stats.h"
+#include "query.h"
+#include "outbuf.h"
+#include "intern.h"
+#include "misc.h"
+
+/* the bytes that are left free on every player, the file system needs some */
+#define _SHARD_RESERVE (1024 * 1024)
+
+/* the number of columns of the manifest */
+#define _SHARD_COLUMNS 8
+
+/**
+ * What has become of a file.
+ */
+enum shard_status {
+	SH_PENDING,		/* in a queue */
+	SH_SENDING,		/* being sent */
+	SH_SENT,		/* sent, device and trackid are set */
+	SH_EXISTS,		/* already on a player, device and trackid are set */
+	SH_FAILED,		/* could not be sent by device */
+	SH_NOROOM		/* there is no player with enough room left */
+};
+
+/**
+ * A file that is to be sent to one of the players.
+ */
+struct shard_entry {
+	const char *filename;		/* interned */
+	s_id3_tag *tag;			/* its tags, they belong to the shard */
+	unsigned long long hash;	/* the fingerprint of the audio data */
+	unsigned long long size;	/* the size of the file */
+	int status;			/* see enum shard_status */
+	int device;			/* the index of the device that has it, or -1 */
+	unsigned int trackid;		/* its track ID on that player */
+};
+
+/**
+ * A player that files are spread over.
+ */
+struct shard_device {
+	int index;			/* the index of the player in the array of players */
+	njb_t *player;			/* the captured player or NULL */
+	struct device_id id;		/* its identity */
+	char key[256];			/* its key in the library */
+	struct tracklist tracklist;	/* the tracks on the player */
+	unsigned long long free;	/* the bytes that may still be sent to it */
+
+	unsigned int *queue;		/* the entries it is going to send, the largest first */
+	unsigned int nqueue;		/* their number */
+	unsigned long long queued;	/* their bytes */
+	unsigned int stolen;		/* the entries taken from the queues of others */
+	struct transfer_stats stats;	/* what has been sent to the player */
+};
+
+/**
+ * The files and players of one run. The lock protects the entries and queues
+ * while the players are sending.
+ */
+struct shard {
+	struct shard_entry *entries;
+	unsigned int n;			/* the number of entries */
+	unsigned int size;		/* the number of allocated entries */
+	struct shard_device devices[_MAX_PLAYERS];
+	int ndevices;			/* their number */
+	pthread_mutex_t lock;
+};
+
+/**
+ * shard_init() sets up a shard without files and players.
+ */
+void		shard_init(struct shard *s);
+
+/**
+ * shard_add() adds a file whose tags have been read, the shard takes over the
+ * tags. It returns the index of the entry or -1 if there was no memory left.
+ */
+int		shard_add(struct shard *s, const char *filename, s_id3_tag *tag, unsigned long long hash);
+
+/**
+ * shard_add_device() adds the player with the given index in the array of
+ * players. It returns the new device, which has not been captured yet, or NULL.
+ */
+struct shard_device* shard_add_device(struct shard *s, int index);
+
+/**
+ * shard_deal() fills the queues of the captured players with the pending files,
+ * the largest first, each one to the queue that holds the fewest bytes and has
+ * room for it. Files without a player that has room are SH_NOROOM. It returns
+ * the number of files that have been queued.
+ */
+unsigned int	shard_deal(struct shard *s);
+
+/**
+ * shard_take() returns the index of the next entry the device d should send or
+ * -1 if there is none it has room for. The entry is SH_SENDING and its size is
+ * taken from the free bytes of d. The lock must be held.
+ */
+int		shard_take(struct shard *s, int d);
+
+/**
+ * shard_finish() books the result of sending the entry i: the track ID or 0 if
+ * it has failed, in which case the room is given back. The lock must be held.
+ */
+void		shard_finish(struct shard *s, int i, unsigned int trackid);
+
+/**
+ * shard_leftover() marks the files that are still in a queue as SH_NOROOM once
+ * the players are done. It returns their number.
+ */
+unsigned int	shard_leftover(struct shard *s);
+
+/**
+ * shard_count() returns the number of entries with the given status.
+ */
+unsigned int	shard_count(struct shard *s, int status);
+
+/**
+ * shard_write() writes the manifest, one record per file with the player it is
+ * on, in the given format (see enum query_format) to out. It returns 1 on success
+ * and 0 if out could not be written.
+ */
+int		shard_write(struct shard *s, int format, FILE *out);
+
+/**
+ * shard_free() frees all entries and queues. The players have to be released
+ * before.
+ */
+void		shard_free(struct shard *s);
+
+#endif
@@ -0,0 +1,173 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * source.c - implementation file for the data of tracks that are sent
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+/* memfd_create() is only known with the GNU extensions */
+#define _GNU_SOURCE
+
+#include "source.h"
+
+int source_memfd(void) {
+#ifdef MFD_CLOEXEC
+	return memfd_create("zencp", MFD_CLOEXEC);
+#else
+	char name[] = "/tmp/zencp.XXXXXX";
+	int fd;
+
+	if ((fd = mkstemp(name)) >= 0) unlink(name);
+	return fd;
+#endif
+}
+
+
+/**
+ * source_fd_path() returns the name of the file descriptor fd in /proc/self/fd as a
+ * new string or NULL.
+ */
+static char* source_fd_path(int fd) {
+	char path[32];
+
+	snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+	return new_string(path);
+}
+
+
+/**
+ * source_write() writes the len bytes at data to fd. It returns 1 on success and
+ * 0 otherwise.
+ */
+static int source_write(int fd, const char *data, size_t len) {
+	ssize_t k;
+
+	while (len) {
+		if ((k = write(fd, data, len)) < 0) {
+			if (errno == EINTR) continue;
+			return 0;
+		}
+		data += k;
+		len -= k;
+	}
+	return 1;
+}
+
+
+/**
+ * source_memory() sets up s for the file in memory fd, which holds size bytes. fd
+ * is closed if that fails. It returns 1 on success and 0 otherwise.
+ */
+static int source_memory(struct source *s, int fd, unsigned long long size) {
+	s->kind = SRC_MEMORY;
+	s->fd = fd;
+	s->size = size;
+	s->owned = 1;
+	if (!(s->path = source_fd_path(fd))) {
+		close(fd);
+		return 0;
+	}
+	return 1;
+}
+
+
+int source_from_file(struct source *s, const char *filename) {
+	struct stat st;
+
+	memset(s, 0, sizeof(struct source));
+	s->fd = -1;
+	if ((!filename) || (stat(filename, &st))) return 0;
+
+	s->kind = SRC_FILE;
+	s->size = st.st_size;
+	return ((s->path = new_string(filename)) != 0);
+}
+
+
+int source_from_fd(struct source *s, int fd) {
+	struct stat st;
+
+	memset(s, 0, sizeof(struct source));
+	s->fd = -1;
+	if ((fd < 0) || (fstat(fd, &st)) || (!S_ISREG(st.st_mode))) return 0;
+
+	/* the name in /proc/self/fd opens the file anew, from its start */
+	s->kind = SRC_FD;
+	s->fd = fd;
+	s->size = st.st_size;
+	return ((s->path = source_fd_path(fd)) != 0);
+}
+
+
+int source_from_pipe(struct source *s, int fd, unsigned long long size) {
+	char buffer[_SOURCE_BUFFER];
+	unsigned long long done = 0;
+	ssize_t n = 0;
+	size_t want;
+	int out;
+
+	memset(s, 0, sizeof(struct source));
+	s->fd = -1;
+	if ((fd < 0) || ((out = source_memfd()) < 0)) return 0;
+
+	for (;;) {
+		want = sizeof(buffer);
+		if ((size) && (size - done < want)) want = size - done;
+		if (!want) break;
+
+		if ((n = read(fd, buffer, want)) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if ((n == 0) || (!source_write(out, buffer, n))) break;
+		done += n;
+	}
+
+	if ((n < 0) || ((size) && (done != size)) || ((!size) && (n != 0))) {
+		close(out);
+		return 0;
+	}
+	return source_memory(s, out, done);
+}
+
+
+int source_from_buffer(struct source *s, const void *data, size_t len) {
+	int out;
+
+	memset(s, 0, sizeof(struct source));
+	s->fd = -1;
+	if (((!data) && (len)) || ((out = source_memfd()) < 0)) return 0;
+
+	if (!source_write(out, (const char*)data, len)) {
+		close(out);
+		return 0;
+	}
+	return source_memory(s, out, len);
+}
+
+
+void source_prefetch(const char *filename) {
+	int fd;
+
+	if ((!filename) || ((fd = open(filename, O_RDONLY)) < 0)) return;
+#ifdef POSIX_FADV_WILLNEED
+	posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+	close(fd);
+}
+
+
+void source_free(struct source *s) {
+	if (!s) return;
+	if ((s->owned) && (s->fd >= 0)) close(s->fd);
+	free(s->path);
+	s->path = 0;
+	s->fd = -1;
+	s->owned = 0;
+	s->size = 0;
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * source.h - header file for the data of tracks that are sent
+ *
+ * libnjb only sends tracks that it can open by name. This file provides
+ * the prototypes and structures of a source, which gives a name to the
+ * data of a track wherever it comes from:
+ *
+ *   - a file, which is used as it is
+ *   - a file descriptor of a regular file, which is opened by its name in
+ *     /proc/self/fd
+ *   - a pipe or an in-memory buffer, which are copied into a file in
+ *     memory (memfd) that is opened the same way
+ *
+ * so generated audio never has to be written to the disk.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_SOURCE_H
+#define __ZENCP_SOURCE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "misc.h"
+
+/* the size of the buffer a pipe is read with */
+#define _SOURCE_BUFFER (64 * 1024)
+
+/**
+ * The kinds of sources.
+ */
+enum source_kind {
+	SRC_FILE,		/* a file given by its name */
+	SRC_FD,			/* a file descriptor of a regular file */
+	SRC_MEMORY		/* a file in memory, filled from a pipe or a buffer */
+};
+
+/**
+ * The data of a track.
+ */
+struct source {
+	int kind;		/* see enum source_kind */
+	int fd;			/* the file descriptor, -1 for SRC_FILE */
+	char *path;		/* the name libnjb opens */
+	unsigned long long size;	/* the number of bytes */
+	int owned;		/* fd is closed by source_free() */
+};
+
+/**
+ * source_memfd() returns a new empty file in memory or -1. Where there is no memfd,
+ * it is an unlinked temporary file.
+ */
+int		source_memfd(void);
+
+/**
+ * source_from_file() sets up s for the file filename. It returns 1 on success and
+ * 0 if the file cannot be found.
+ */
+int		source_from_file(struct source *s, const char *filename);
+
+/**
+ * source_from_fd() sets up s for the regular file that is open as fd, from its
+ * start. fd still belongs to the caller and must stay open until s is freed. It
+ * returns 1 on success and 0 if fd is not a regular file.
+ */
+int		source_from_fd(struct source *s, int fd);
+
+/**
+ * source_from_pipe() reads size bytes (or everything up to the end if size is 0)
+ * from fd, e.g. a pipe, into memory and sets up s for them. It returns 1 on
+ * success and 0 if the data could not be read or was shorter than size.
+ */
+int		source_from_pipe(struct source *s, int fd, unsigned long long size);
+
+/**
+ * source_from_buffer() copies the len bytes at data into memory and sets up s for
+ * them. It returns 1 on success and 0 otherwise.
+ */
+int		source_from_buffer(struct source *s, const void *data, size_t len);
+
+/**
+ * source_prefetch() tells the kernel that the file filename is going to be read,
+ * so that it is read from the disk while the file before it is sent.
+ */
+void		source_prefetch(const char *filename);
+
+/**
+ * source_free() frees s and closes its file in memory.
+ */
+void		source_free(struct source *s);
+
+#endif
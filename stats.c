@@ -0,0 +1,72 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * stats.c - implementation file for transfer statistics
+ *
+ * This file provides the implementation of the transfer statistics that
+ * are printed at the end of a run and used for throughput estimation.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "stats.h"
+
+void stats_init(struct transfer_stats *stats) {
+	if (!stats) return;
+
+	stats->tracks = 0;
+	stats->skipped = 0;
+	stats->failed = 0;
+	stats->bytes = 0;
+	stats->seconds = 0.0;
+}
+
+
+double stats_now(void) {
+	struct timespec ts;
+
+	/* the monotonic clock does not jump if someone sets the system time */
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+}
+
+
+void stats_add(struct transfer_stats *stats, unsigned long long bytes, double seconds) {
+	if (!stats) return;
+
+	stats->tracks++;
+	stats->bytes += bytes;
+	stats->seconds += seconds;
+}
+
+
+double stats_rate(const struct transfer_stats *stats) {
+	if ((!stats) || (stats->seconds <= 0.0)) return 0.0;
+	return (double)stats->bytes / stats->seconds;
+}
+
+
+void stats_print(const struct transfer_stats *stats, const char *verb) {
+	if (!stats) return;
+
+	printf(" %u track%s %s (%llu MB in %.1f s, %.2f MB/s)", stats->tracks,
+		(stats->tracks != 1) ? "s" : "", verb, stats->bytes / (1024 * 1024),
+		stats->seconds, stats_rate(stats) / (1024.0 * 1024.0));
+
+	if (stats->skipped) printf(", %u skipped", stats->skipped);
+	if (stats->failed) printf(", %u failed", stats->failed);
+	printf("\n\n");
+}
+
+
+long stats_peak_memory(void) {
+	struct rusage usage;
+
+	/* Linux counts in kilobytes */
+	if (getrusage(RUSAGE_SELF, &usage)) return 0;
+	return usage.ru_maxrss;
+}
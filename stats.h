@@ -0,0 +1,73 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * stats.h - header file for transfer statistics
+ *
+ * This file provides the prototypes and structures that are used to keep
+ * track of how many tracks and bytes have been moved to or from the player
+ * and how long that took.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_STATS_H
+#define __ZENCP_STATS_H
+
+#include <stdio.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/**
+ * A set of counters for one run of zencp. Only transfers that really moved
+ * data end up in bytes and seconds, so bytes/seconds is the throughput of
+ * the USB connection to the player.
+ */
+struct transfer_stats {
+	unsigned int tracks;		/* number of tracks transferred successfully */
+	unsigned int skipped;		/* number of tracks that were skipped */
+	unsigned int failed;		/* number of tracks that could not be transferred */
+	unsigned long long bytes;	/* number of bytes transferred */
+	double seconds;			/* time spent in transfers */
+};
+
+/**
+ * stats_init() sets all counters of stats to 0.
+ */
+void	stats_init(struct transfer_stats *stats);
+
+/**
+ * stats_now() returns the current time in seconds from a monotonic clock.
+ * Only the difference between two calls is meaningful.
+ */
+double	stats_now(void);
+
+/**
+ * stats_add() records a successful transfer of the given number of bytes
+ * that took the given number of seconds.
+ */
+void	stats_add(struct transfer_stats *stats, unsigned long long bytes, double seconds);
+
+/**
+ * stats_rate() returns the measured throughput in bytes per second or 0
+ * if nothing has been transferred yet.
+ */
+double	stats_rate(const struct transfer_stats *stats);
+
+/**
+ * stats_print() prints a one line summary of stats to the screen. The verb
+ * is used to describe the direction ("sent", "received", ...).
+ */
+void	stats_print(const struct transfer_stats *stats, const char *verb);
+
+/**
+ * stats_peak_memory() returns the most memory (resident set) this process has
+ * used so far in kilobytes or 0 if that is not known.
+ */
+long	stats_peak_memory(void);
+
+#endif
@@ -0,0 +1,277 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * stream.c - implementation file for transfers of endless lists of files
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "stream.h"
+
+/**
+ * stream_push() appends item to the queue q, which must have room for it. The
+ * lock must be held.
+ */
+static void stream_push(struct stream *s, struct stream_queue *q, struct stream_item *item) {
+	q->items[(q->first + q->n) % _STREAM_QUEUE] = *item;
+	q->n++;
+	pthread_cond_broadcast(&s->changed);
+}
+
+
+/**
+ * stream_pop() takes the oldest item off the queue q, which must not be empty.
+ * The lock must be held.
+ */
+static void stream_pop(struct stream *s, struct stream_queue *q, struct stream_item *item) {
+	*item = q->items[q->first];
+	q->first = (q->first + 1) % _STREAM_QUEUE;
+	q->n--;
+	pthread_cond_broadcast(&s->changed);
+}
+
+
+/**
+ * stream_close() tells the reader of the queue q that nothing follows. The lock
+ * must be held.
+ */
+static void stream_close(struct stream *s, struct stream_queue *q) {
+	q->closed = 1;
+	pthread_cond_broadcast(&s->changed);
+}
+
+
+/**
+ * stream_bytes() returns the memory that the file f and its tags take.
+ */
+static size_t stream_bytes(mp3_file *f) {
+	return sizeof(mp3_file) + strlen(f->filename) + 1 + ((f->tag) ? id3_tag_memory(f->tag) : 0);
+}
+
+
+/**
+ * stream_read() gives the file filename to the scanner as soon as the queue and
+ * the budget have room for it. It returns 1 on success and 0 if the stream is
+ * stopped or there is no memory.
+ */
+static int stream_read(struct stream *s, const char *filename) {
+	struct stream_item item;
+	char *copy;
+
+	if (!(copy = strdup(filename))) {
+		print_error(G_NOMEM);
+		return 0;
+	}
+	if (!(item.file = new_mp3_element(copy))) {
+		print_error(G_NOMEM);
+		free(copy);
+		return 0;
+	}
+	/* the tags are booked right away with strings of _STREAM_TAG_STRINGS bytes,
+	 * the scanner books what they really take once they have been read */
+	item.bytes = stream_bytes(item.file) + sizeof(s_id3_tag) + _STREAM_TAG_STRINGS;
+
+	/* a single file is always let through, or a tiny budget would stop everything */
+	pthread_mutex_lock(&s->lock);
+	while ((!s->stop) && ((s->names.n == _STREAM_QUEUE) || ((s->bytes) && (s->bytes + item.bytes > s->budget)))) {
+		pthread_cond_wait(&s->changed, &s->lock);
+	}
+	if (s->stop) {
+		pthread_mutex_unlock(&s->lock);
+		free(copy);
+		free(item.file);
+		return 0;
+	}
+
+	s->bytes += item.bytes;
+	if (s->bytes > s->peak) s->peak = s->bytes;
+	s->count++;
+	stream_push(s, &s->names, &item);
+	pthread_mutex_unlock(&s->lock);
+	return 1;
+}
+
+
+/**
+ * stream_drop() takes the first file off the list of files. Only the reader may
+ * do that while it runs.
+ */
+static void stream_drop(struct stream *s) {
+	s->files = list_delete(s->files, 0);
+}
+
+
+/**
+ * stream_reader() is the reader thread.
+ */
+static void* stream_reader(void *arg) {
+	struct stream *s = (struct stream*)arg;
+	char line[PATH_MAX + 2];
+	mp3_file *f;
+	int r = 1;
+
+	/* the files of the list come first, their names are not ours */
+	for (f = s->files; (f) && (r); f = s->files) {
+		r = stream_read(s, f->filename);
+		stream_drop(s);
+	}
+
+	while ((r) && (s->in) && (fgets(line, sizeof(line), s->in))) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0]) r = stream_read(s, line);
+	}
+
+	pthread_mutex_lock(&s->lock);
+	stream_close(s, &s->names);
+	pthread_mutex_unlock(&s->lock);
+	return 0;
+}
+
+
+/**
+ * stream_scanner() is the scanner thread. It takes up to _STREAM_BATCH files at
+ * once, so the fingerprints and tags are read in parallel.
+ */
+static void* stream_scanner(void *arg) {
+	struct stream *s = (struct stream*)arg;
+	struct stream_item batch[_STREAM_BATCH];
+	unsigned int n, i;
+
+	for (;;) {
+		pthread_mutex_lock(&s->lock);
+		while ((!s->stop) && (!s->names.n) && (!s->names.closed)) {
+			pthread_cond_wait(&s->changed, &s->lock);
+		}
+		if ((s->stop) || (!s->names.n)) break;
+
+		for (n = 0; (n < _STREAM_BATCH) && (s->names.n); n++) stream_pop(s, &s->names, &batch[n]);
+		pthread_mutex_unlock(&s->lock);
+
+		/* the batch is a list of its own while it is read */
+		for (i = 1; i < n; i++) {
+			batch[i - 1].file->next = batch[i].file;
+			batch[i].file->prev = batch[i - 1].file;
+		}
+		library_scan_shared(s->library, batch[0].file, s->threads, s->library_lock, 0);
+		schedule_read_tags(batch[0].file, s->id3v1, 1);
+
+		for (i = 0; i < n; i++) batch[i].file->prev = batch[i].file->next = 0;
+
+		/* the strings of the tags that are not interned are now known, so the
+		 * booking is made exact */
+		pthread_mutex_lock(&s->lock);
+		for (i = 0; i < n; i++) {
+			s->bytes -= batch[i].bytes;
+			batch[i].bytes = stream_bytes(batch[i].file);
+			s->bytes += batch[i].bytes;
+		}
+		if (s->bytes > s->peak) s->peak = s->bytes;
+
+		for (i = 0; i < n; i++) {
+			while ((!s->stop) && (s->ready.n == _STREAM_QUEUE)) pthread_cond_wait(&s->changed, &s->lock);
+			if (s->stop) break;
+			stream_push(s, &s->ready, &batch[i]);
+		}
+		pthread_mutex_unlock(&s->lock);
+
+		/* what could not be queued any more */
+		for (; i < n; i++) stream_done(s, &batch[i]);
+	}
+
+	stream_close(s, &s->ready);
+	pthread_mutex_unlock(&s->lock);
+	return 0;
+}
+
+
+void stream_init(struct stream *s, FILE *in, mp3_file *files, struct library *lib,
+		 pthread_mutex_t *library_lock, char id3v1, int threads, size_t budget) {
+	memset(s, 0, sizeof(struct stream));
+	s->in = in;
+	s->files = list_first_element(files);
+	s->library = lib;
+	s->library_lock = library_lock;
+	s->id3v1 = id3v1;
+	s->threads = threads;
+	s->budget = (budget) ? budget : _STREAM_MEMORY;
+	pthread_mutex_init(&s->lock, 0);
+	pthread_cond_init(&s->changed, 0);
+}
+
+
+int stream_start(struct stream *s) {
+	if (s->started) return 1;
+
+	if (pthread_create(&s->reader, 0, stream_reader, s)) return 0;
+	if (pthread_create(&s->scanner, 0, stream_scanner, s)) {
+		pthread_mutex_lock(&s->lock);
+		s->stop = 1;
+		pthread_cond_broadcast(&s->changed);
+		pthread_mutex_unlock(&s->lock);
+		pthread_join(s->reader, 0);
+		return 0;
+	}
+	s->started = 1;
+	return 1;
+}
+
+
+int stream_next(struct stream *s, struct stream_item *item) {
+	pthread_mutex_lock(&s->lock);
+	while ((s->started) && (!s->ready.n) && (!s->ready.closed)) pthread_cond_wait(&s->changed, &s->lock);
+	if (!s->ready.n) {
+		pthread_mutex_unlock(&s->lock);
+		return 0;
+	}
+	stream_pop(s, &s->ready, item);
+	pthread_mutex_unlock(&s->lock);
+	return 1;
+}
+
+
+void stream_done(struct stream *s, struct stream_item *item) {
+	if ((!item) || (!item->file)) return;
+
+	if (item->file->tag) id3_delete_id3_struct(item->file->tag);
+	free(item->file->filename);
+	free(item->file);
+	item->file = 0;
+
+	pthread_mutex_lock(&s->lock);
+	s->bytes -= item->bytes;
+	pthread_cond_broadcast(&s->changed);
+	pthread_mutex_unlock(&s->lock);
+}
+
+
+void stream_free(struct stream *s) {
+	struct stream_item item;
+
+	pthread_mutex_lock(&s->lock);
+	s->stop = 1;
+	pthread_cond_broadcast(&s->changed);
+	pthread_mutex_unlock(&s->lock);
+
+	if (s->started) {
+		pthread_join(s->reader, 0);
+		pthread_join(s->scanner, 0);
+		s->started = 0;
+	}
+
+	while (s->names.n) {
+		stream_pop(s, &s->names, &item);
+		stream_done(s, &item);
+	}
+	while (s->ready.n) {
+		stream_pop(s, &s->ready, &item);
+		stream_done(s, &item);
+	}
+	while (s->files) stream_drop(s);
+
+	pthread_cond_destroy(&s->changed);
+	pthread_mutex_destroy(&s->lock);
+}
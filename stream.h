@@ -0,0 +1,138 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * stream.h - header file for transfers of endless lists of files
+ *
+ * A normal transfer reads all filenames, fingerprints and tags before the
+ * first file is sent, which takes memory for every file. This file
+ * provides the prototypes and structures of a stream, which reads the
+ * filenames (one per line, e.g. from find) while the files are sent:
+ *
+ *   reader  --names-->  scanner  --ready-->  sender
+ *
+ * The reader is a thread that reads the names, the scanner is a thread that
+ * fingerprints (see library_scan_shared()) and reads the tags of a batch of
+ * them at once and the sender is the caller of stream_next(). Both queues
+ * hold at most _STREAM_QUEUE files. Besides, the reader waits as long as
+ * the files between the reader and the end of stream_done() take more than
+ * the memory budget, so a slow player holds up the reading, not the memory.
+ *
+ * The budget only covers the files in the stream. What a file leaves behind
+ * is kept small: the tags of a stream are transient (see id3.h), new files
+ * are not added to the library and their paths are not interned. Only the
+ * tracks that are sent add their names to the interned strings and their
+ * places to the library, as for any transfer. The budget is booked with an
+ * estimate of the tag strings when a name is read and then with their real
+ * size, so a batch of files with long tags may exceed it a little.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_STREAM_H
+#define __ZENCP_STREAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+
+#include "list.h"
+#include "id3.h"
+#include "library.h"
+#include "schedule.h"
+#include "misc.h"
+
+/* the memory budget of a stream if none is given */
+#define _STREAM_MEMORY (16 * 1024 * 1024)
+
+/* the number of files each queue holds */
+#define _STREAM_QUEUE 1024
+
+/* the number of files the scanner reads at once */
+#define _STREAM_BATCH 64
+
+/* the estimate of the tag strings of a file that are not interned */
+#define _STREAM_TAG_STRINGS 256
+
+/**
+ * A file in a stream and the memory that is booked for it.
+ */
+struct stream_item {
+	mp3_file *file;
+	size_t bytes;
+};
+
+/**
+ * A queue of fixed size between two parts of a stream.
+ */
+struct stream_queue {
+	struct stream_item items[_STREAM_QUEUE];
+	unsigned int first;		/* the oldest item */
+	unsigned int n;			/* the number of items */
+	int closed;			/* no item will be added anymore */
+};
+
+/**
+ * A stream. All fields after the lock are guarded by it.
+ */
+struct stream {
+	FILE *in;			/* the filenames, one per line */
+	mp3_file *files;		/* the files that come first, they are taken over */
+	struct library *library;	/* the fingerprints */
+	pthread_mutex_t *library_lock;	/* guards the library, the sender needs it too */
+	char id3v1;			/* use ID3v1 tags */
+	int threads;			/* the threads of the scanner, 0 means one per CPU */
+	size_t budget;			/* the memory budget in bytes */
+
+	pthread_t reader, scanner;
+	int started;			/* the threads are running */
+
+	pthread_mutex_t lock;
+	pthread_cond_t changed;		/* anything below has changed */
+	struct stream_queue names;	/* from the reader to the scanner */
+	struct stream_queue ready;	/* from the scanner to the sender */
+	size_t bytes;			/* the memory that is booked */
+	size_t peak;			/* the most memory that was booked */
+	unsigned long long count;	/* the number of files read */
+	int stop;			/* the threads shall stop */
+};
+
+/**
+ * stream_init() sets up a stream of the files in the list files (which is taken
+ * over and may be NULL) and then those named by the lines of in (which may be
+ * NULL). A budget of 0 means _STREAM_MEMORY.
+ */
+void		stream_init(struct stream *s, FILE *in, mp3_file *files, struct library *lib,
+			    pthread_mutex_t *library_lock, char id3v1, int threads, size_t budget);
+
+/**
+ * stream_start() starts the reader and the scanner. It returns 1 on success and
+ * 0 if the threads could not be started.
+ */
+int		stream_start(struct stream *s);
+
+/**
+ * stream_next() waits for the next file, whose fingerprint is known and whose tags
+ * have been read (the tag is NULL if they could not be read). It returns 1 and
+ * the file in item or 0 at the end of the stream. Every item must be given back
+ * with stream_done().
+ */
+int		stream_next(struct stream *s, struct stream_item *item);
+
+/**
+ * stream_done() frees the file of item and its tags and gives its memory back
+ * to the budget.
+ */
+void		stream_done(struct stream *s, struct stream_item *item);
+
+/**
+ * stream_free() stops the threads and frees all files that are still queued.
+ */
+void		stream_free(struct stream *s);
+
+#endif
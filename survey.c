@@ -0,0 +1,241 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * survey.c - implementation file for talking to all players at once
+ *
+ * The workers are detached threads that take the next job as in pool.c.
+ * The caller waits for the jobs and checks their timeouts. As a worker may
+ * outlive survey_run(), everything the workers share is allocated and
+ * freed by whoever leaves last.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "survey.h"
+
+/**
+ * The state that is shared by the caller and the workers of one survey_run().
+ */
+struct survey {
+	njb_t *players;
+	int mode;
+	unsigned int n;			/* the number of players */
+	unsigned int *jobs;		/* the players that are handled */
+	unsigned int njobs;		/* their number */
+	unsigned int next;		/* the next job that has not been started */
+	unsigned int finished;		/* the jobs that are done, failed or timed out */
+	unsigned int refs;		/* the caller and the workers that are running */
+	int workers;			/* the workers that have not timed out */
+	int abandoned;			/* survey_run() has returned */
+	struct survey_result *results;	/* the results by player */
+	double *started;		/* when the jobs were started, by player */
+	pthread_mutex_t lock;		/* protects all of the above */
+	pthread_cond_t changed;		/* signalled when a job is finished */
+};
+
+
+/**
+ * survey_release() drops a reference to the survey, the last one frees it. The
+ * lock must be held and is released.
+ */
+static void survey_release(struct survey *s) {
+	unsigned int i;
+	int last = !--s->refs;
+
+	pthread_mutex_unlock(&s->lock);
+	if (!last) return;
+
+	for (i = 0; i < s->n; i++) free(s->results[i].text);
+	free(s->results);
+	free(s->started);
+	free(s->jobs);
+	pthread_cond_destroy(&s->changed);
+	pthread_mutex_destroy(&s->lock);
+	free(s);
+}
+
+
+/**
+ * survey_job() handles the n-th player and writes what it has found to r, which
+ * belongs to the job alone. It returns 1 on success and 0 otherwise.
+ */
+static int survey_job(struct survey *s, unsigned int n, struct survey_result *r) {
+	njb_t *player;
+	size_t size = 0;
+	FILE *mem;
+
+	if (s->mode == SM_PROBE) return device_probe(&s->players[n], r->id.serial);
+
+	if (!(player = player_lock(s->players, n))) return 0;
+	device_serial(player, r->id.serial);
+	if ((mem = open_memstream(&r->text, &size))) {
+		player_list_device(mem, player, n);
+		fclose(mem);
+	}
+	player_release(&player);
+	return 1;
+}
+
+
+/**
+ * survey_worker() runs jobs until there are none left or until its job has
+ * timed out, in which case the caller has started another worker instead.
+ */
+static void* survey_worker(void *arg) {
+	struct survey *s = (struct survey*)arg;
+	struct survey_result r;
+	unsigned int i;
+	double t0;
+
+	pthread_mutex_lock(&s->lock);
+	while ((!s->abandoned) && (s->next < s->njobs)) {
+		i = s->jobs[s->next++];
+		s->results[i].state = SS_RUNNING;
+		s->started[i] = t0 = stats_now();
+		r = s->results[i];
+		pthread_mutex_unlock(&s->lock);
+
+		r.state = (survey_job(s, i, &r)) ? SS_DONE : SS_FAILED;
+		r.seconds = stats_now() - t0;
+
+		pthread_mutex_lock(&s->lock);
+		if (s->results[i].state == SS_TIMEOUT) {
+			/* the caller does not count this worker any more */
+			free(r.text);
+			survey_release(s);
+			return 0;
+		}
+		s->results[i] = r;
+		s->finished++;
+		pthread_cond_broadcast(&s->changed);
+	}
+	s->workers--;
+	pthread_cond_broadcast(&s->changed);
+	survey_release(s);
+	return 0;
+}
+
+
+/**
+ * survey_start() starts another worker. The lock must be held. It returns 1 on
+ * success and 0 otherwise.
+ */
+static int survey_start(struct survey *s) {
+	pthread_attr_t attr;
+	pthread_t tid;
+	int r;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	if ((r = !pthread_create(&tid, &attr, survey_worker, s))) {
+		s->refs++;
+		s->workers++;
+	}
+	pthread_attr_destroy(&attr);
+	return r;
+}
+
+
+int survey_run(njb_t *players, int n, const char *skip, int mode, int threads, double timeout,
+	       struct survey_result *results) {
+	struct survey *s;
+	pthread_condattr_t attr;
+	struct timespec ts;
+	double now, wake;
+	unsigned int i;
+	int done = 0;
+
+	if ((!players) || (!results) || (n <= 0)) return 0;
+	if (threads <= 0) threads = _SURVEY_THREADS;
+	if (timeout <= 0.0) timeout = _SURVEY_TIMEOUT;
+
+	for (i = 0; i < (unsigned int)n; i++) {
+		memset(&results[i], 0, sizeof(struct survey_result));
+		results[i].state = SS_WAITING;
+		device_path(&players[i], results[i].id.path);
+	}
+
+	if (!(s = (struct survey*)calloc(1, sizeof(struct survey)))) return 0;
+	s->results = (struct survey_result*)malloc(n * sizeof(struct survey_result));
+	s->started = (double*)calloc(n, sizeof(double));
+	s->jobs = (unsigned int*)malloc(n * sizeof(unsigned int));
+	if ((!s->results) || (!s->started) || (!s->jobs)) {
+		free(s->results);
+		free(s->started);
+		free(s->jobs);
+		free(s);
+		return 0;
+	}
+	memcpy(s->results, results, n * sizeof(struct survey_result));
+	for (i = 0; i < (unsigned int)n; i++) {
+		if ((!skip) || (!skip[i])) s->jobs[s->njobs++] = i;
+	}
+	if ((unsigned int)threads > s->njobs) threads = s->njobs;
+	s->players = players;
+	s->mode = mode;
+	s->n = n;
+	s->refs = 1;
+	pthread_mutex_init(&s->lock, 0);
+
+	/* the timeouts are measured with the clock of stats_now() */
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&s->changed, &attr);
+	pthread_condattr_destroy(&attr);
+
+	pthread_mutex_lock(&s->lock);
+	while (s->finished < s->njobs) {
+		/* keep up to threads workers busy; without any thread, the caller
+		 * does the jobs itself and they cannot time out */
+		while ((s->workers < threads) && (s->next < s->njobs) && (survey_start(s)));
+		if ((!s->workers) && (s->next < s->njobs)) {
+			s->refs++;
+			s->workers++;
+			pthread_mutex_unlock(&s->lock);
+			survey_worker(s);
+			pthread_mutex_lock(&s->lock);
+			continue;
+		}
+
+		/* sleep until the next job would time out or until a job is done */
+		now = stats_now();
+		wake = -1.0;
+		for (i = 0; i < s->n; i++) {
+			if (s->results[i].state != SS_RUNNING) continue;
+			if (now >= s->started[i] + timeout) {
+				/* give the player up and let another thread go on */
+				s->results[i].state = SS_TIMEOUT;
+				s->results[i].seconds = now - s->started[i];
+				s->finished++;
+				s->workers--;
+			} else if ((wake < 0.0) || (s->started[i] + timeout < wake)) {
+				wake = s->started[i] + timeout;
+			}
+		}
+		if (s->finished >= s->njobs) break;
+		while ((s->workers < threads) && (s->next < s->njobs) && (survey_start(s)));
+		if ((!s->workers) && (s->next < s->njobs)) continue;
+
+		if (wake < 0.0) {
+			pthread_cond_wait(&s->changed, &s->lock);
+		} else {
+			ts.tv_sec = (time_t)wake;
+			ts.tv_nsec = (long)((wake - (double)ts.tv_sec) * 1000000000.0);
+			pthread_cond_timedwait(&s->changed, &s->lock, &ts);
+		}
+	}
+
+	/* the texts now belong to the caller */
+	for (i = 0; i < s->n; i++) {
+		results[i] = s->results[i];
+		s->results[i].text = 0;
+		if (results[i].state == SS_DONE) done++;
+	}
+	s->abandoned = 1;
+	survey_release(s);
+	return done;
+}
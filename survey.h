@@ -0,0 +1,85 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * survey.h - header file for talking to all players at once
+ *
+ * This file provides the prototypes and structures that are needed to
+ * open every discovered player in parallel, e.g. to list them (-l) or to
+ * read their serial numbers (-d). Every player is handled by one job; the
+ * jobs run on a bounded number of threads and every job has a timeout.
+ * A player that does not answer in time is given up and its thread is
+ * replaced, so one hung player does not hold up the others. The results
+ * are kept in the order of the players, whichever finished first.
+ *
+ * libusb calls cannot be cancelled, so the thread of a player that timed
+ * out keeps running in the background until the player answers. Such a
+ * player must not be used again by the program.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_SURVEY_H
+#define __ZENCP_SURVEY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <libnjb.h>
+
+#include "player.h"
+#include "device.h"
+#include "stats.h"
+#include "misc.h"
+
+/* the number of threads and the seconds a player may take if nothing is given */
+#define _SURVEY_THREADS 8
+#define _SURVEY_TIMEOUT 15.0
+
+/**
+ * What is done with every player.
+ */
+enum survey_mode {
+	SM_PROBE,		/* open it and read its serial number, without capturing it */
+	SM_LIST			/* capture it, describe it (see player_list_device()) and release it */
+};
+
+/**
+ * The states of a job.
+ */
+enum survey_state {
+	SS_WAITING,		/* not started yet */
+	SS_RUNNING,		/* being worked on */
+	SS_DONE,		/* finished */
+	SS_FAILED,		/* the player could not be opened or captured */
+	SS_TIMEOUT		/* the player did not answer in time */
+};
+
+/**
+ * The result for one player.
+ */
+struct survey_result {
+	int state;		/* see enum survey_state */
+	struct device_id id;	/* the USB path and, if it could be read, the serial number */
+	char *text;		/* SM_LIST: the description of the player or NULL */
+	double seconds;		/* how long the job took */
+};
+
+/**
+ * survey_run() runs a job of the given mode (see enum survey_mode) for each of
+ * the n players in parallel on up to threads threads (0 means _SURVEY_THREADS).
+ * Players whose entry in skip is non-zero are left out (they stay SS_WAITING),
+ * skip may be NULL. A job that takes longer than timeout seconds (0 means
+ * _SURVEY_TIMEOUT) is given up. The results are written to results[i] for the
+ * i-th player, the caller has to free their texts. It returns the number of
+ * players that are SS_DONE.
+ */
+int		survey_run(njb_t *players, int n, const char *skip, int mode, int threads,
+			   double timeout, struct survey_result *results);
+
+#endif
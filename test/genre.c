@@ -0,0 +1,99 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * genre.c - implementation file for the tests of the genre resolver
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "../genre.h"
+#include "test.h"
+
+/**
+ * A content type frame and the genre it has to be resolved to. The length is
+ * given, as ID3v2.4 frames contain '\0'. An empty genre means that the frame
+ * does not contain one.
+ */
+struct genre_case {
+	const char *text;
+	size_t len;
+	const char *genre;
+};
+
+/* the length of a string literal including the '\0' in it */
+#define TEXT(s) s, sizeof(s) - 1
+
+static const struct genre_case genre_corpus[] = {
+	/* ID3v1 and ID3v2.3 references */
+	{ TEXT("(17)"), "Rock" },
+	{ TEXT("(0)"), "Blues" },
+	{ TEXT("(191)"), "Psybient" },
+	{ TEXT("(192)"), "" },
+	{ TEXT("(17)Rock"), "Rock" },
+	{ TEXT("(4)Eurodisco"), "Eurodisco" },
+	{ TEXT("(17)(18)"), "Rock" },
+	{ TEXT("(RX)"), "Remix" },
+	{ TEXT("(CR)"), "Cover" },
+	{ TEXT("((foo"), "(foo" },
+	{ TEXT("(17)((foo)"), "(foo)" },
+
+	/* ID3v2.4 values without parentheses */
+	{ TEXT("17"), "Rock" },
+	{ TEXT("RX"), "Remix" },
+	{ TEXT("CR"), "Cover" },
+	{ TEXT("rx"), "rx" },
+
+	/* names, case does not matter */
+	{ TEXT("Rock"), "Rock" },
+	{ TEXT("hip-hop"), "Hip-Hop" },
+	{ TEXT("  Trip-Hop  "), "Trip-Hop" },
+	{ TEXT("Nerdcore"), "Nerdcore" },
+
+	/* ID3v2.4 values separated by '\0', the first one that means something wins */
+	{ TEXT("\0" "17"), "Rock" },
+	{ TEXT(" \0" "RX"), "Remix" },
+	{ TEXT("(192)\0" "CR"), "Cover" },
+	{ TEXT("Eurodisco\0" "Rock"), "Eurodisco" },
+	{ TEXT("\0\0" "(17)Rock"), "Rock" },
+
+	/* no genre at all */
+	{ TEXT(""), "" },
+	{ TEXT("   "), "" },
+	{ TEXT("()"), "" },
+	{ TEXT("\0"), "" }
+};
+
+#undef TEXT
+
+
+void test_genre(void) {
+	char out[64];
+	unsigned int i;
+	size_t l;
+	int id;
+
+	for (i = 0; i < sizeof(genre_corpus) / sizeof(genre_corpus[0]); i++) {
+		l = genre_parse(genre_corpus[i].text, genre_corpus[i].len, out, sizeof(out));
+		if (strcmp(out, genre_corpus[i].genre)) {
+			fprintf(stderr, " genre %u: got \"%s\", expected \"%s\"\n", i, out, genre_corpus[i].genre);
+		}
+		CHECK(!strcmp(out, genre_corpus[i].genre));
+		CHECK(l == strlen(genre_corpus[i].genre));
+	}
+
+	/* a name that does not fit is cut */
+	CHECK(genre_parse("(17)", 4, out, 3) == 2);
+	CHECK(!strcmp(out, "Ro"));
+
+	/* every name of the list is found by the perfect hash table */
+	for (id = 0; id < _GENRE_COUNT; id++) CHECK(genre_id(genre_name(id)) == id);
+	CHECK(genre_id("ROCK") == 17);
+	CHECK(genre_id("Rock ") == _GENRE_NONE);
+	CHECK(genre_id("Nerdcore") == _GENRE_NONE);
+	CHECK(genre_name(_GENRE_COUNT) == 0);
+	CHECK(genre_name(-1) == 0);
+}
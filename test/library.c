@@ -0,0 +1,138 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * library.c - implementation file for the tests of the library
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include <unistd.h>
+#include "../library.h"
+#include "test.h"
+
+/**
+ * test_write_mp3() writes a file that starts with an ID3v2 tag of tagsize bytes
+ * and has 4096 bytes of audio data made from seed. It returns 1 on success.
+ */
+static int test_write_mp3(const char *path, unsigned int tagsize, unsigned char seed) {
+	unsigned char buff[4096];
+	unsigned int i;
+	FILE *f;
+	int ok;
+
+	if (!(f = fopen(path, "w"))) return 0;
+
+	/* the header, the size is a syncsafe integer */
+	memset(buff, 0, sizeof(buff));
+	memcpy(buff, "ID3\3\0\0", 6);
+	buff[6] = (tagsize >> 21) & 0x7f;
+	buff[7] = (tagsize >> 14) & 0x7f;
+	buff[8] = (tagsize >> 7) & 0x7f;
+	buff[9] = tagsize & 0x7f;
+	ok = (fwrite(buff, 1, 10, f) == 10);
+
+	memset(buff, 0, sizeof(buff));
+	ok = (ok) && (fwrite(buff, 1, tagsize, f) == tagsize);
+
+	for (i = 0; i < sizeof(buff); i++) buff[i] = (unsigned char)(i * 7 + seed);
+	ok = (ok) && (fwrite(buff, 1, sizeof(buff), f) == sizeof(buff));
+
+	return (fclose(f) == 0) && (ok);
+}
+
+
+/**
+ * test_fetched_twice() does what two runs of zencp_download() do with the same
+ * track: the first one fetches it and rewrites its tags, the second one has to
+ * know that the file, which now has another size, is that track.
+ */
+static void test_fetched_twice(void) {
+	char dir[] = "/tmp/zencp-test.XXXXXX";
+	char path[PATH_MAX], other[PATH_MAX], config[PATH_MAX], file[PATH_MAX];
+	struct library lib;
+
+	if (!mkdtemp(dir)) {
+		CHECK(0);
+		return;
+	}
+	snprintf(path, sizeof(path), "%s/Queen - Mustapha.mp3", dir);
+	snprintf(other, sizeof(other), "%s/Queen - Mustapha (8).mp3", dir);
+	snprintf(config, sizeof(config), "%s/.zencp", dir);
+	snprintf(file, sizeof(file), "%s/.zencp/%s", dir, _LIBRARY_FILE);
+
+	/* the library lives in $HOME/.zencp */
+	setenv("HOME", dir, 1);
+
+	/* the first run */
+	library_init(&lib);
+	library_load(&lib);
+	CHECK(!library_is_fetched(&lib, path, "Nomad", 7));
+	CHECK(test_write_mp3(path, 100, 1));
+	CHECK(library_add_fetched(&lib, path, "Nomad", 7));
+	CHECK(test_write_mp3(path, 300, 1));
+	CHECK(library_save(&lib));
+	library_free(&lib);
+
+	/* the second run */
+	library_init(&lib);
+	CHECK(library_load(&lib));
+	CHECK(library_is_fetched(&lib, path, "Nomad", 7));
+	CHECK(!library_is_fetched(&lib, path, "Nomad", 8));
+	CHECK(!library_is_fetched(&lib, path, "Jukebox", 7));
+
+	/* another track with the same name is not mistaken for it */
+	CHECK(test_write_mp3(other, 100, 2));
+	CHECK(!library_is_fetched(&lib, other, "Nomad", 8));
+	CHECK(library_add_fetched(&lib, other, "Nomad", 8));
+	CHECK(library_is_fetched(&lib, other, "Nomad", 8));
+	CHECK(library_is_fetched(&lib, path, "Nomad", 7));
+	library_free(&lib);
+
+	unlink(path);
+	unlink(other);
+	unlink(file);
+	rmdir(config);
+	rmdir(dir);
+}
+
+
+/**
+ * test_unique() removes the files with the same audio data from a list, also
+ * one that is left alone, and checks that every element is freed but no name.
+ */
+static void test_unique(void) {
+	static char *names[] = { "a.mp3", "b.mp3", "c.mp3", "d.mp3" };
+	static const unsigned long long hashes[] = { 1, 2, 1, 2 };
+	mp3_file *list = 0, *f;
+	unsigned int dropped, i;
+
+	for (i = 0; i < 4; i++) {
+		f = append_new_file(list, names[i]);
+		if (!list) list = f;
+		if (f) f->hash = hashes[i];
+	}
+
+	list = library_unique(list, &dropped);
+	CHECK(dropped == 2);
+	CHECK((list) && (list->filename == names[0]) && (list->next) && (list->next->filename == names[1]));
+	CHECK((list) && (list->next) && (!list->next->next));
+
+	/* an element without neighbours is freed as well */
+	list = list_delete(list, 0);
+	CHECK((list) && (list->filename == names[1]) && (!list->prev));
+	list = list_delete(list, 0);
+	CHECK(!list);
+
+	list = new_mp3_element(new_string("e.mp3"));
+	CHECK(!list_delete(list, 1));
+}
+
+
+void test_library(void) {
+	test_fetched_twice();
+	test_unique();
+}
@@ -0,0 +1,56 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * query.c - implementation file for the tests of the query layer
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "../query.h"
+#include "../outbuf.h"
+#include "test.h"
+
+/**
+ * test_json() returns 1 if s is written as the JSON string json.
+ */
+static int test_json(const char *s, const char *json) {
+	struct outbuf ob;
+	char buffer[256];
+	size_t n;
+	FILE *f;
+
+	if (!(f = tmpfile())) return 0;
+	if (!outbuf_init(&ob, f)) {
+		fclose(f);
+		return 0;
+	}
+	query_write_string(&ob, QFMT_JSON, s);
+	outbuf_free(&ob);
+
+	rewind(f);
+	n = fread(buffer, 1, sizeof(buffer) - 1, f);
+	buffer[n] = '\0';
+	fclose(f);
+	return !strcmp(buffer, json);
+}
+
+
+void test_query(void) {
+	CHECK(test_json("Queen", "\"Queen\""));
+	CHECK(test_json("say \"hi\"\\", "\"say \\\"hi\\\"\\\\\""));
+	CHECK(test_json("tab\there", "\"tab\\u0009here\""));
+
+	/* UTF-8 is kept, Latin-1 is escaped */
+	CHECK(test_json("Motörhead", "\"Motörhead\""));
+	CHECK(test_json("Mot\xf6rhead", "\"Mot\\u00f6rhead\""));
+	CHECK(test_json("Bj\xf6rk \xe9t\xe9", "\"Bj\\u00f6rk \\u00e9t\\u00e9\""));
+	CHECK(test_json("\xe2\x82\xac", "\"\xe2\x82\xac\""));
+
+	/* a cut sequence and an overlong one are not UTF-8 */
+	CHECK(test_json("\xe2\x82", "\"\\u00e2\\u0082\""));
+	CHECK(test_json("\xc0\xaf", "\"\\u00c0\\u00af\""));
+}
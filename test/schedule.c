@@ -0,0 +1,84 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * schedule.c - implementation file for the tests of the deadline planner
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "../schedule.h"
+#include "../intern.h"
+#include "test.h"
+
+/**
+ * test_file() appends a file with the given album, track number and size to
+ * list and returns the new element.
+ */
+static mp3_file* test_file(mp3_file *list, const char *album, unsigned int trackno,
+			   unsigned long long size) {
+	char name[64];
+	s_id3_tag *tag;
+	mp3_file *f;
+
+	snprintf(name, sizeof(name), "%s %u.mp3", album, trackno);
+	f = (list) ? append_new_file(list, new_string(name)) : new_mp3_element(new_string(name));
+	if ((!f) || (!(tag = (s_id3_tag*)calloc(1, sizeof(s_id3_tag))))) return f;
+
+	tag->artist = intern("Queen");
+	tag->title = intern(name);
+	tag->album = intern(album);
+	tag->genre = intern("Rock");
+	tag->trackno = trackno;
+	tag->size = size;
+	tag->valid = _ID3_ALL;
+	id3_make_keys(tag);
+	f->tag = tag;
+	return f;
+}
+
+
+/**
+ * test_album_order() plans two albums whose files are mixed up and checks that
+ * the smaller album comes first and each album is in the order of its tracks.
+ */
+static void test_album_order(void) {
+	static const unsigned int expected[] = { 1, 2, 3, 1, 2 };
+	struct schedule s;
+	struct tracklist tl;
+	mp3_file *list = 0, *f, *next;
+	unsigned int i;
+
+	list = test_file(list, "Sheer Heart Attack", 3, 1000);
+	test_file(list, "Jazz", 2, 5000);
+	test_file(list, "Sheer Heart Attack", 1, 1000);
+	test_file(list, "Jazz", 1, 5000);
+	test_file(list, "Sheer Heart Attack", 2, 1000);
+
+	tracklist_setup_tracklist(&tl);
+	schedule_init(&s, stats_now(), 3600.0);
+	list = schedule_plan(&s, list, &tl, 0);
+
+	for (i = 0, f = list; (f) && (i < 5); f = f->next, i++) {
+		CHECK(f->tag->trackno == expected[i]);
+		CHECK(f->tag->album == intern((i < 3) ? "Sheer Heart Attack" : "Jazz"));
+	}
+	CHECK((i == 5) && (!f));
+
+	for (f = list; f; f = next) {
+		next = f->next;
+		free(f->tag);
+		free(f->filename);
+		free(f);
+	}
+	schedule_free(&s);
+	tracklist_free(&tl);
+}
+
+
+void test_schedule(void) {
+	test_album_order();
+}
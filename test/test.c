@@ -0,0 +1,28 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * test.c - implementation file for the tests of zencp
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "test.h"
+
+unsigned int test_checks = 0;
+unsigned int test_failed = 0;
+
+
+int main(void) {
+	test_tracklist();
+	test_query();
+	test_genre();
+	test_schedule();
+	test_library();
+
+	fprintf(stderr, " %u checks, %u failed\n", test_checks, test_failed);
+	return (test_failed) ? 1 : 0;
+}
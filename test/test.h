@@ -0,0 +1,48 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * test.h - header file for the tests of zencp
+ *
+ * This file provides the check macro and the suites of the tests that are
+ * built and run by "make check". A failed check prints where it failed and
+ * the suite goes on, the program returns the number of failed checks.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_TEST_H
+#define __ZENCP_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the checks that have been made and those that failed */
+extern unsigned int test_checks;
+extern unsigned int test_failed;
+
+/**
+ * CHECK() counts the check cond and prints it if it fails.
+ */
+#define CHECK(cond) do { \
+		test_checks++; \
+		if (!(cond)) { \
+			test_failed++; \
+			fprintf(stderr, " FAILED: %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+		} \
+	} while (0)
+
+/**
+ * The suites, each of them makes its checks with CHECK().
+ */
+void	test_tracklist(void);
+void	test_query(void);
+void	test_genre(void);
+void	test_schedule(void);
+void	test_library(void);
+
+#endif
@@ -0,0 +1,122 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * tracklist.c - implementation file for the tests of the tracklist
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "../tracklist.h"
+#include "../intern.h"
+#include "test.h"
+
+/**
+ * test_tag() fills tag with a track as the player reports it.
+ */
+static s_id3_tag* test_tag(s_id3_tag *tag, const char *artist, const char *title, const char *album,
+			   unsigned int trackid) {
+	memset(tag, 0, sizeof(s_id3_tag));
+	tag->artist = intern(artist);
+	tag->title = intern(title);
+	tag->album = intern(album);
+	tag->genre = intern("Rock");
+	tag->trackid = trackid;
+	tag->valid = _ID3_ALL;
+	id3_make_keys(tag);
+	return tag;
+}
+
+
+/**
+ * test_duplicate_titles() checks that tracks with the same artist and title
+ * are all kept, so that listings and --delete see every one of them.
+ */
+static void test_duplicate_titles(void) {
+	static const char *albums[] = { "A Night at the Opera", "Greatest Hits", "Live Killers", "Live at Wembley" };
+	struct tracklist tl;
+	s_id3_tag tag, *t;
+	unsigned int i, count;
+	s_id3_tag **list;
+
+	tracklist_setup_tracklist(&tl);
+	for (i = 0; i < 4; i++) {
+		tracklist_insert(&tl, test_tag(&tag, "Queen", "Bohemian Rhapsody", albums[i], i + 1));
+	}
+	CHECK(tracklist_count(&tl) == 4);
+
+	/* the same track is not inserted twice */
+	t = tracklist_insert(&tl, test_tag(&tag, "Queen", "Bohemian Rhapsody", albums[2], 3));
+	CHECK((t) && (t->trackid == 3));
+	CHECK(tracklist_count(&tl) == 4);
+
+	for (i = 0; i < 4; i++) {
+		CHECK(((t = tracklist_find_trackid(&tl, i + 1))) && (t->album == intern(albums[i])));
+		t = tracklist_find_tag(&tl, test_tag(&tag, "Queen", "Bohemian Rhapsody", albums[i], 0));
+		CHECK((t) && (t->trackid == i + 1));
+	}
+
+	list = tracklist_flatten(&tl, &count);
+	CHECK((list) && (count == 4));
+	free(list);
+
+	/* removing one of them leaves the others */
+	CHECK(tracklist_remove(&tl, tracklist_find_trackid(&tl, 1)));
+	CHECK(tracklist_count(&tl) == 3);
+	CHECK(!tracklist_find_trackid(&tl, 1));
+	CHECK(tracklist_find_trackid(&tl, 4) != 0);
+	CHECK(!tracklist_find_tag(&tl, test_tag(&tag, "Queen", "Bohemian Rhapsody", albums[0], 0)));
+
+	tracklist_free(&tl);
+}
+
+
+/**
+ * test_normalized_albums() checks that tracks whose artists only differ in
+ * case or punctuation are all kept, so that a file is found on the album it
+ * is on and not reported missing because another album came first.
+ */
+static void test_normalized_albums(void) {
+	struct tracklist tl;
+	s_id3_tag tag, *t;
+
+	tracklist_setup_tracklist(&tl);
+	tracklist_insert(&tl, test_tag(&tag, "Queen", "Innuendo", "Innuendo", 1));
+	tracklist_insert(&tl, test_tag(&tag, "QUEEN", "Innuendo", "Greatest Hits II", 2));
+	tracklist_insert(&tl, test_tag(&tag, "AC/DC", "Thunderstruck", "The Razors Edge", 3));
+	tracklist_insert(&tl, test_tag(&tag, "ac-dc", "Thunderstruck", "Live", 4));
+	CHECK(tracklist_count(&tl) == 4);
+
+	/* the album that was inserted second is found as well */
+	t = tracklist_find_tag(&tl, test_tag(&tag, "queen", "INNUENDO", "greatest hits ii", 0));
+	CHECK((t) && (t->trackid == 2));
+	t = tracklist_find_tag(&tl, test_tag(&tag, "Queen", "Innuendo", "Innuendo", 0));
+	CHECK((t) && (t->trackid == 1));
+	t = tracklist_find_tag(&tl, test_tag(&tag, "Ac Dc", "Thunderstruck", "LIVE", 0));
+	CHECK((t) && (t->trackid == 4));
+	CHECK(!tracklist_find_tag(&tl, test_tag(&tag, "AC/DC", "Thunderstruck", "Stiff Upper Lip", 0)));
+
+	/* the tracks keep their own spelling */
+	CHECK(((t = tracklist_find_trackid(&tl, 2))) && (t->artist == intern("QUEEN")));
+	tracklist_free(&tl);
+
+	/* with the exact policy, only equal strings match */
+	tracklist_setup_tracklist(&tl);
+	tracklist_set_policy(&tl, MATCH_EXACT);
+	tracklist_insert(&tl, test_tag(&tag, "AC/DC", "Thunderstruck", "Live", 3));
+	tracklist_insert(&tl, test_tag(&tag, "ac-dc", "Thunderstruck", "Live", 4));
+	CHECK(tracklist_count(&tl) == 2);
+	t = tracklist_find_tag(&tl, test_tag(&tag, "ac-dc", "Thunderstruck", "Live", 0));
+	CHECK((t) && (t->trackid == 4));
+	CHECK(!tracklist_find_tag(&tl, test_tag(&tag, "Ac Dc", "Thunderstruck", "Live", 0)));
+	tracklist_free(&tl);
+}
+
+
+void test_tracklist(void) {
+	test_duplicate_titles();
+	test_normalized_albums();
+}
@@ -0,0 +1,192 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * trackcols.c - implementation file for a column oriented tracklist
+ *
+ * This file provides the implementation of the column oriented tracklist.
+ * The statistics are linear scans over one column at a time, the distinct
+ * strings are counted in a bitmap over the IDs of the string table.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#include "trackcols.h"
+
+/**
+ * trackcols_grow() doubles the number of rows of all columns. It returns 1
+ * on success and 0 if no memory could be allocated.
+ */
+static int trackcols_grow(struct trackcols *c) {
+	unsigned int size = (c->size) ? c->size * 2 : 1024;
+	void *p;
+
+/* every column is grown the same way, a failed realloc() keeps the old one */
+#define GROW_COLUMN(col) \
+	if (!(p = realloc(c->col, size * sizeof(*c->col)))) return 0; \
+	c->col = p;
+
+	GROW_COLUMN(artist);
+	GROW_COLUMN(title);
+	GROW_COLUMN(album);
+	GROW_COLUMN(genre);
+	GROW_COLUMN(year);
+	GROW_COLUMN(trackno);
+	GROW_COLUMN(length);
+	GROW_COLUMN(bytes);
+	GROW_COLUMN(trackid);
+#undef GROW_COLUMN
+
+	c->size = size;
+	return 1;
+}
+
+
+void trackcols_init(struct trackcols *c) {
+	if (!c) return;
+
+	c->count = 0;
+	c->size = 0;
+	c->artist = c->title = c->album = c->genre = 0;
+	c->year = c->trackno = 0;
+	c->length = c->bytes = c->trackid = 0;
+}
+
+
+unsigned int trackcols_append(struct trackcols *c, const s_id3_tag *tag) {
+	unsigned int row;
+
+	if ((!c) || (!tag)) return _TRACKCOLS_NONE;
+
+	if ((c->count == c->size) && (!trackcols_grow(c))) {
+		print_error(G_NOMEM);
+		return _TRACKCOLS_NONE;
+	}
+
+	/* the strings of a tag are interned, so their IDs are stored right in front
+	 * of them; missing strings are stored as empty strings */
+	row = c->count;
+	if (((c->artist[row] = intern_id_of((tag->artist) ? tag->artist : intern(""))) == _INTERN_NONE) ||
+	    ((c->title[row] = intern_id_of((tag->title) ? tag->title : intern(""))) == _INTERN_NONE) ||
+	    ((c->album[row] = intern_id_of((tag->album) ? tag->album : intern(""))) == _INTERN_NONE) ||
+	    ((c->genre[row] = intern_id_of((tag->genre) ? tag->genre : intern(""))) == _INTERN_NONE)) {
+		return _TRACKCOLS_NONE;
+	}
+
+	c->year[row] = (unsigned short)tag->year;
+	c->trackno[row] = (unsigned short)tag->trackno;
+	c->length[row] = tag->time;
+	c->bytes[row] = tag->size;
+	c->trackid[row] = tag->trackid;
+
+	c->count++;
+	return row;
+}
+
+
+unsigned int trackcols_from_tracklist(struct trackcols *c, struct tracklist *tl) {
+	s_id3_tag **tracks;
+	unsigned int i, n, added = 0;
+
+	if ((!c) || (!(tracks = tracklist_flatten(tl, &n)))) return 0;
+
+	for (i = 0; i < n; i++) {
+		if (trackcols_append(c, tracks[i]) != _TRACKCOLS_NONE) added++;
+	}
+
+	free(tracks);
+	return added;
+}
+
+
+int trackcols_get(const struct trackcols *c, unsigned int row, s_id3_tag *tag) {
+	if ((!c) || (!tag) || (row >= c->count)) return 0;
+
+	memset(tag, 0, sizeof(s_id3_tag));
+	tag->artist = intern_string(intern_global(), c->artist[row]);
+	tag->title = intern_string(intern_global(), c->title[row]);
+	tag->album = intern_string(intern_global(), c->album[row]);
+	tag->genre = intern_string(intern_global(), c->genre[row]);
+	tag->year = c->year[row];
+	tag->trackno = c->trackno[row];
+	tag->time = c->length[row];
+	tag->size = c->bytes[row];
+	tag->trackid = c->trackid[row];
+	tag->valid = _ID3_ALL;		/* whatever the row does not know stays empty */
+	return 1;
+}
+
+
+/**
+ * trackcols_distinct() returns the number of distinct IDs in a string column.
+ * The bitmap seen has size bytes, one bit for every string in the global string
+ * table.
+ */
+static unsigned int trackcols_distinct(const struct trackcols *c, const unsigned int *col,
+				       unsigned char *seen, size_t size) {
+	unsigned int i, n = 0;
+
+	memset(seen, 0, size);
+	for (i = 0; i < c->count; i++) {
+		if (seen[col[i] >> 3] & (1 << (col[i] & 7))) continue;
+		seen[col[i] >> 3] |= 1 << (col[i] & 7);
+		n++;
+	}
+	return n;
+}
+
+
+void trackcols_stats(const struct trackcols *c, struct trackcols_stats *stats) {
+	unsigned char *seen;
+	unsigned int i;
+	size_t size;
+
+	if ((!c) || (!stats)) return;
+	memset(stats, 0, sizeof(struct trackcols_stats));
+	stats->tracks = c->count;
+
+	for (i = 0; i < c->count; i++) {
+		stats->bytes += c->bytes[i];
+		stats->length += c->length[i];
+	}
+
+	/* the strings of the rows are interned already, other threads may only add
+	 * strings with higher IDs */
+	size = intern_count() / 8 + 1;
+	if (!(seen = (unsigned char*)malloc(size))) {
+		print_error(G_NOMEM);
+		return;
+	}
+	stats->artists = trackcols_distinct(c, c->artist, seen, size);
+	stats->albums = trackcols_distinct(c, c->album, seen, size);
+	stats->genres = trackcols_distinct(c, c->genre, seen, size);
+	free(seen);
+}
+
+
+size_t trackcols_memory(const struct trackcols *c) {
+	if (!c) return 0;
+
+	/* four string columns, two short and three int columns */
+	return c->size * (4 * sizeof(unsigned int) + 2 * sizeof(unsigned short) +
+			  3 * sizeof(unsigned int));
+}
+
+
+void trackcols_free(struct trackcols *c) {
+	if (!c) return;
+
+	free(c->artist);
+	free(c->title);
+	free(c->album);
+	free(c->genre);
+	free(c->year);
+	free(c->trackno);
+	free(c->length);
+	free(c->bytes);
+	free(c->trackid);
+	trackcols_init(c);
+}
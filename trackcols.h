@@ -0,0 +1,114 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * trackcols.h - header file for a column oriented tracklist
+ *
+ * This file provides the prototypes and structures of an alternative
+ * representation of the tracklist. Instead of one struct id3_struct per
+ * track that is linked to the others (see tracklist.h), every field is
+ * stored in an array of its own. The string columns only contain the IDs
+ * of the strings in the global string table (see intern.h), so comparing
+ * two strings means comparing two integers.
+ *
+ * Row i of all columns together describes the i-th track. Scanning over
+ * all tracks reads the arrays from front to back, which is what caches and
+ * prefetchers like best. Building the columns walks the tracklist once,
+ * which costs more than the statistics of -T themselves, so zencp computes
+ * those right from the tracklist and the columns are only used by the
+ * benchmarks (see bench/core.c). Duplicate checks and queries stay with the
+ * tracklist, which knows the match policy and the normalized keys (see
+ * tracklist.h).
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_TRACKCOLS_H
+#define __ZENCP_TRACKCOLS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "id3.h"
+#include "tracklist.h"
+#include "intern.h"
+#include "misc.h"
+
+/* the ID that marks "no such row" */
+#define _TRACKCOLS_NONE ((unsigned int)-1)
+
+/**
+ * The column oriented tracklist.
+ */
+struct trackcols {
+	unsigned int count;		/* the number of tracks */
+	unsigned int size;		/* the number of allocated rows */
+
+	unsigned int *artist;		/* string IDs */
+	unsigned int *title;
+	unsigned int *album;
+	unsigned int *genre;
+	unsigned short *year;		/* packed integers */
+	unsigned short *trackno;
+	unsigned int *length;
+	unsigned int *bytes;
+	unsigned int *trackid;
+};
+
+/**
+ * Statistics over the tracks in a column oriented tracklist.
+ */
+struct trackcols_stats {
+	unsigned int tracks;		/* the number of tracks */
+	unsigned long long bytes;	/* the size of all tracks */
+	unsigned long long length;	/* the playtime of all tracks in seconds */
+	unsigned int artists;		/* the number of distinct artists */
+	unsigned int albums;		/* the number of distinct albums */
+	unsigned int genres;		/* the number of distinct genres */
+};
+
+/**
+ * trackcols_init() sets up an empty column oriented tracklist.
+ */
+void		trackcols_init(struct trackcols *c);
+
+/**
+ * trackcols_append() adds the track represented by tag as a new row. It returns
+ * the number of that row or _TRACKCOLS_NONE in case of errors.
+ */
+unsigned int	trackcols_append(struct trackcols *c, const s_id3_tag *tag);
+
+/**
+ * trackcols_from_tracklist() appends all tracks of the tracklist tl. It
+ * returns the number of tracks that were added.
+ */
+unsigned int	trackcols_from_tracklist(struct trackcols *c, struct tracklist *tl);
+
+/**
+ * trackcols_get() fills tag with the contents of the given row. The strings of
+ * tag are interned and must not be freed. It returns 1 on success and 0 if there
+ * is no such row.
+ */
+int		trackcols_get(const struct trackcols *c, unsigned int row, s_id3_tag *tag);
+
+/**
+ * trackcols_stats() calculates the statistics over all tracks in c.
+ */
+void		trackcols_stats(const struct trackcols *c, struct trackcols_stats *stats);
+
+/**
+ * trackcols_memory() returns the number of bytes that are allocated by c. The
+ * global string table is shared and therefore not included.
+ */
+size_t		trackcols_memory(const struct trackcols *c);
+
+/**
+ * trackcols_free() frees all memory that is held by c.
+ */
+void		trackcols_free(struct trackcols *c);
+
+#endif
@@ -64,15 +64,56 @@
 
 #include "tracklist.h"
 
-s_id3_tag* trackarray[_MAX_INDEX];
+/**
+ * tracklist_same() compares one field of two tracks according to the match
+ * policy policy. a and b are the strings, ka and kb their keys and cut_a and cut_b
+ * tell if the strings may have been cut by ID3v1. It returns 1 if the fields
+ * are the same and 0 otherwise.
+ */
+static int tracklist_same(int policy, const char *a, const char *ka, int cut_a,
+			  const char *b, const char *kb, int cut_b) {
+	/* the strings are interned, so equal strings have equal pointers */
+	if (a == b) return 1;
+	if ((policy == MATCH_EXACT) || (!ka) || (!kb)) return 0;
+
+	if (ka == kb) return 1;
+	return ((cut_a) && (normalize_is_prefix(ka, kb))) ||
+	       ((cut_b) && (normalize_is_prefix(kb, ka)));
+}
+
+
+/**
+ * tracklist_keys() makes sure that the keys of tag have been made, they are
+ * needed for the index even if the policy is MATCH_EXACT.
+ */
+static void tracklist_keys(s_id3_tag *tag) {
+	if (!tag->k_artist) id3_make_keys(tag);
+}
+
 
-void tracklist_setup_tracklist(s_id3_tag* array[]) {
+void tracklist_set_policy(struct tracklist *tl, int policy) {
+	if (tl) tl->policy = policy;
+}
+
+
+int tracklist_parse_policy(const char *name) {
+	if (!name) return -1;
+
+	if (!strcmp(name, "exact")) return MATCH_EXACT;
+	if (!strcmp(name, "normal")) return MATCH_NORMAL;
+	if (!strcmp(name, "loose")) return MATCH_LOOSE;
+	return -1;
+}
+
+
+void tracklist_setup_tracklist(struct tracklist *tl) {
 	int i;
-	if (!array) return;
+	if (!tl) return;
 	
 	for (i = 0; i < _MAX_INDEX; i++) {
-		array[i] = 0;
+		tl->index[i] = 0;
 	}
+	tl->policy = MATCH_NORMAL;
 }
 
 
@@ -80,7 +121,9 @@ int tracklist_get_index(s_id3_tag *tag) {
 	int index;
 	if ((!tag) || (!tag->artist)) return -1;
 
-	index = (tag->artist)[0];	/* get the ASCII value of the first letter */
+	/* get the ASCII value of the first letter, tracks with the same key must
+	 * end up at the same index */
+	index = (unsigned char)((tag->k_artist) ? tag->k_artist : tag->artist)[0];
 
 	if ((index >= 65) && (index <= 90)) {	/* if it is a capital letter, subtract 65 */
 		index -= 65;
@@ -103,7 +146,7 @@ int tracklist_get_index(s_id3_tag *tag) {
  * so the comments may seem weird. Note that this function was written at 23:36 inside of a very
  * crowded train of the Light City Rail transport in Stuttgart (service line U6).
  */
-s_id3_tag* tracklist_insert(s_id3_tag* array[], s_id3_tag *new_tag) {
+s_id3_tag* tracklist_insert(struct tracklist *tl, s_id3_tag *new_tag) {
 	int index = 0;
 	s_id3_tag* root = 0;
 	s_id3_tag* artist = 0;
@@ -111,62 +154,81 @@ s_id3_tag* tracklist_insert(s_id3_tag* array[], s_id3_tag *new_tag) {
 	s_id3_tag* tag = 0;
 
 	/* return if arguments were empty */
-	if ((!array) || (!new_tag)) return 0;
+	if ((!tl) || (!new_tag)) return 0;
+	tracklist_keys(new_tag);
+	id3_tag_need(new_tag, _ID3_ALL);	/* the copy cannot read the rest later */
 	
 	/* TODO: possible memory leak in here... */
 	/* allocate a new instance of struct id3_struct as I want to
 	 * have a copy, and set its field to the same values as in
 	 * new_tag */
 	tag = (s_id3_tag*)malloc(sizeof(s_id3_tag));
-	tag->artist = new_string(new_tag->artist);
-	tag->title = new_string(new_tag->title);
-	tag->album = new_string(new_tag->album);
+	tag->artist = intern(new_tag->artist);	/* usually already interned, then */
+	tag->title = intern(new_tag->title);	/* this is a lookup and no copy */
+	tag->album = intern(new_tag->album);
+	tag->genre = intern(new_tag->genre);
+	tag->k_artist = intern(new_tag->k_artist);	/* the keys are interned as well, */
+	tag->k_title = intern(new_tag->k_title);	/* a transient tag may have copies */
+	tag->k_album = intern(new_tag->k_album);
+	tag->transient = 0;
+	tag->owned = 0;
+	tag->cut = new_tag->cut;
+	tag->id3 = 0;
+	tag->valid = new_tag->valid;
+	tag->id3v1 = new_tag->id3v1;
 	tag->next = 0;	/* IMPORTANT to set these two to 0 */
 	tag->element = 0;
 	tag->trackid = new_tag->trackid;
+
+	/* the rest is needed for track listings and queries, the filename and the
+	 * string representation of the year are not kept */
+	tag->filename = 0;
+	tag->s_year = 0;
+	tag->size = new_tag->size;
+	tag->year = new_tag->year;
+	tag->time = new_tag->time;
+	tag->trackno = new_tag->trackno;
+	tag->frequency = new_tag->frequency;
+	tag->bitrate = new_tag->bitrate;
 	
 	/* get the index value */
 	index = tracklist_get_index(tag);
 
-	/* if the array[index] already points to an element, assign it to
-	 * root, otherwise, let array[index] point to the new element tag and
+	/* if the index already points to an element, assign it to
+	 * root, otherwise, let the index point to the new element tag and
 	 * exit happily */
-	if (!(root = array[index])) {
-		array[index] = tag;
+	if (!(root = tl->index[index])) {
+		tl->index[index] = tag;
 		return tag;
 	} 
 
-	/* ok, array[index] already pointed to an element, so we will look
+	/* ok, the index already pointed to an element, so we will look
 	 * if our artist is already in the list (note that the pointer to
 	 * root is called by reference: if the artist was not found, NULL is
 	 * returned and root will point to the last element of the list)
 	 */
-	artist = tracklist_find_artist(&root, tag);
+	artist = tracklist_find_artist(tl, &root, tag);
 
-	/* the artist was found so we will look for the title */	
+	/* the artist was found, so the track is appended to the tracks of that artist */
 	if (artist) {
-		/* Starting from the first track by our looked-for artist we will
-		 * search through the list of titles (element pointers) and look
-		 * if the title is contained. If not, we get a NULL here and artist
-		 * will point to the last element of the list.
-		 */
-		title = tracklist_find_title(&artist, tag);
-		
-		/* the title was found in the list, that means that the track is already
-		 * on the player, so we will not need out tag object anymore and return the
-		 * the pointer to the element in the list
+		/* Every track of the player is kept, even if another one has the same
+		 * artist and title (e.g. on another album). Only the very same track is
+		 * not inserted twice: the same track ID or, for tracks without one, the
+		 * same artist, title and album.
 		 */
-		if (title) {
-			free(tag);
-			return title;
-		} else {
-			/* The track is not in there, so artist will point to the last element of tracks
-			 * by that artist. We first assign it to title (not necessary but more
-			 * elegant) and make its element field point to the new track.
-			 */
-			title = artist;
-			title->element = tag;
+		for (title = artist; title; title = title->element) {
+			if ((tag->trackid) ? (title->trackid == tag->trackid) :
+			    ((!title->trackid) && (title->artist == tag->artist) &&
+			     (title->title == tag->title) && (title->album == tag->album))) {
+				free(tag);
+				return title;
+			}
+			if (!title->element) break;
 		}
+
+		/* title now points to the last track by that artist, so we make its
+		 * element field point to the new track */
+		title->element = tag;
 	} else {
 		/* Similar to above, the artist was not found so root will point to the last
 		 * element of artist, so that we make its next element point to the new tag.
@@ -180,25 +242,54 @@ s_id3_tag* tracklist_insert(s_id3_tag* array[], s_id3_tag *new_tag) {
 	return tag;
 }
 
-s_id3_tag* tracklist_remove(s_id3_tag *tag) {
-	/* Guess what: not implemented yet as it is not needed by now. */
+int tracklist_remove(struct tracklist *tl, s_id3_tag *tag) {
+	s_id3_tag **link, *t;
+
+	if ((!tl) || (!tag)) return 0;
+
+	/* walk the artists with the index of tag, link is the pointer to the current one */
+	for (link = &tl->index[tracklist_get_index(tag)]; (t = *link); link = &t->next) {
+		if (t == tag) {
+			/* the first track of an artist: the next track of the same artist
+			 * takes its place in the list of artists */
+			if (tag->element) {
+				tag->element->next = tag->next;
+				*link = tag->element;
+			} else {
+				*link = tag->next;
+			}
+			free(tag);
+			return 1;
+		}
+
+		/* any other track is just taken out of the list of titles */
+		for (; t->element; t = t->element) {
+			if (t->element == tag) {
+				t->element = tag->element;
+				free(tag);
+				return 1;
+			}
+		}
+		t = *link;
+	}
 	return 0;
 }
 
 
-s_id3_tag* tracklist_find_artist(s_id3_tag **root, s_id3_tag *tag) {
+s_id3_tag* tracklist_find_artist(struct tracklist *tl, s_id3_tag **root, s_id3_tag *tag) {
 	s_id3_tag* r;
 
 	/* If root or tag or *root or tag->artist or *root->artist is
 	 * NULL (which should never be the case), return immediately.
 	 * *root is assigned to r in this step
 	 */
-	if ((!root) || (!tag) || (!(r = *root)) ||
+	if ((!tl) || (!root) || (!tag) || (!(r = *root)) ||
 	    (!tag->artist) || (!r->artist)) return 0;
 	
 	while (r) {
 		/* if the current element has the artist we are looking for */
-		if (!strcmp(tag->artist, r->artist)) return r;	/* just return its pointer */
+		if (tracklist_same(tl->policy, tag->artist, tag->k_artist, tag->cut & _CUT_ARTIST,
+				   r->artist, r->k_artist, r->cut & _CUT_ARTIST)) return r;	/* just return its pointer */
 		if (!r->next) break;	/* otherwise proceed to the next element as long as there is */
 		*root = r = r->next;	/* a pointer to it */
 	}
@@ -207,13 +298,14 @@ s_id3_tag* tracklist_find_artist(s_id3_tag **root, s_id3_tag *tag) {
 }
 
 
-s_id3_tag* tracklist_find_title(s_id3_tag **node, s_id3_tag *tag) {
+s_id3_tag* tracklist_find_title(struct tracklist *tl, s_id3_tag **node, s_id3_tag *tag) {
 	s_id3_tag *n;
-	if ((!node) || (!(n = *node)) ||
+	if ((!tl) || (!node) || (!(n = *node)) ||
 	    (!tag->title) || (!n->title)) return 0;
 
 	while (n) {
-		if (!strcmp(tag->title, n->title)) return *node;
+		if (tracklist_same(tl->policy, tag->title, tag->k_title, tag->cut & _CUT_TITLE,
+				   n->title, n->k_title, n->cut & _CUT_TITLE)) return *node;
 		if (!n->element) break;
 		*node = n = n->element;
 	}
@@ -222,7 +314,7 @@ s_id3_tag* tracklist_find_title(s_id3_tag **node, s_id3_tag *tag) {
 }
 
 
-s_id3_tag* tracklist_find_tag(s_id3_tag *array[], s_id3_tag *tag) {
+s_id3_tag* tracklist_find_tag(struct tracklist *tl, s_id3_tag *tag) {
 	int index = 0;
 	s_id3_tag *artist = 0;
 	s_id3_tag *title = 0;
@@ -230,18 +322,23 @@ s_id3_tag* tracklist_find_tag(s_id3_tag *array[], s_id3_tag *tag) {
 	
 	/* if neither the index array nor a tag is given, it is hard to say if one is contained in the other,
 	 * therefore return NULL */
-	if ((!array) || (!tag)) return 0;
+	if ((!tl) || (!tag)) return 0;
+	tracklist_keys(tag);
 
 	index = tracklist_get_index(tag);	/* Determine the index and get the pointer to the first artist */
-	if (!(root = array[index])) return 0;	/* with the same index. If it does not exist, return NULL. */
+	if (!(root = tl->index[index])) return 0;	/* with the same index. If it does not exist, return NULL. */
 
-	artist = tracklist_find_artist(&root, tag);	/* search for the artist */
-	if (artist) {				/* ahh, the artist was found, now search for the title */
-		title = tracklist_find_title(&artist, tag);
+	artist = tracklist_find_artist(tl, &root, tag);	/* search for the artist */
 
+	/* ahh, the artist was found, now search for the title. The same title may be there
+	 * several times (e.g. on different albums), so every one of them is looked at. */
+	while ((artist) && (title = tracklist_find_title(tl, &artist, tag))) {
 		/* ok, title was found as well, so compare the album string and if they are equal, return the
-		 * pointer to that element*/
-		if ((title) && (!strcmp(title->album, tag->album))) return title;
+		 * pointer to that element (the loose policy does not care about the album) */
+		if ((tl->policy == MATCH_LOOSE) ||
+		    (tracklist_same(tl->policy, title->album, title->k_album, title->cut & _CUT_ALBUM,
+				    tag->album, tag->k_album, tag->cut & _CUT_ALBUM))) return title;
+		artist = title->element;
 	}
 	
 	/* either artist or title was not found at this point so return 0 */
@@ -249,18 +346,76 @@ s_id3_tag* tracklist_find_tag(s_id3_tag *array[], s_id3_tag *tag) {
 }
 
 
-void tracklist_dump(s_id3_tag *array[]) {
+s_id3_tag* tracklist_find_trackid(struct tracklist *tl, unsigned int trackid) {
+	int i;
+	s_id3_tag *t, *s;
+
+	if ((!tl) || (!trackid)) return 0;
+
+	/* the tracklist is sorted by artist, so all tracks have to be looked at */
+	for (i = 0; i < _MAX_INDEX; i++) {
+		for (t = tl->index[i]; t; t = t->next) {
+			for (s = t; s; s = s->element) {
+				if (s->trackid == trackid) return s;
+			}
+		}
+	}
+	return 0;
+}
+
+
+unsigned int tracklist_count(struct tracklist *tl) {
+	unsigned int n = 0;
+	int i;
+	s_id3_tag *t, *s;
+
+	if (!tl) return 0;
+
+	for (i = 0; i < _MAX_INDEX; i++) {
+		for (t = tl->index[i]; t; t = t->next) {
+			for (s = t; s; s = s->element) n++;
+		}
+	}
+	return n;
+}
+
+
+s_id3_tag** tracklist_flatten(struct tracklist *tl, unsigned int *count) {
+	unsigned int n = 0;
+	int i;
+	s_id3_tag **list, *t, *s;
+
+	if ((!tl) || (!count)) return 0;
+
+	/* one more than needed, so that an empty tracklist does not return NULL */
+	*count = tracklist_count(tl);
+	if (!(list = (s_id3_tag**)malloc((*count + 1) * sizeof(s_id3_tag*)))) {
+		print_error(G_NOMEM);
+		return 0;
+	}
+
+	/* walk the tracklist in the same order as tracklist_dump() does */
+	for (i = 0; i < _MAX_INDEX; i++) {
+		for (t = tl->index[i]; t; t = t->next) {
+			for (s = t; s; s = s->element) list[n++] = s;
+		}
+	}
+	return list;
+}
+
+
+void tracklist_dump(struct tracklist *tl) {
 	int i;
 	s_id3_tag* t, *s;
-	if (!array) return;
+	if (!tl) return;
 
 	for (i = 0; i < _MAX_INDEX; i++) {
 		printf("\n%2d \\\n", i);
-		if (!array[i]) {
+		if (!tl->index[i]) {
 			printf("    +- NULL\n");
 			continue;
 		} else {
-			t = array[i];
+			t = tl->index[i];
 
 			while (t) {
 				printf("    +- %s - %s (%d)\n", t->artist, t->title, t->trackid);
@@ -277,3 +432,23 @@ void tracklist_dump(s_id3_tag *array[]) {
 	printf("\n");
 	return;
 }
+
+
+void tracklist_free(struct tracklist *tl) {
+	int i;
+	s_id3_tag *t, *s, *next;
+
+	if (!tl) return;
+
+	for (i = 0; i < _MAX_INDEX; i++) {
+		for (t = tl->index[i]; t; t = next) {
+			next = t->next;
+			while (t) {
+				s = t->element;
+				free(t);
+				t = s;
+			}
+		}
+		tl->index[i] = 0;
+	}
+}
@@ -29,43 +29,81 @@
  */
 #define _MAX_INDEX 28
 
+/**
+ * The policies that decide when two tracks are the same (see
+ * tracklist_set_policy()).
+ */
+enum match_policy {
+	MATCH_EXACT,	/* artist, title and album are exactly equal */
+	MATCH_NORMAL,	/* their keys are equal (see normalize.h), a field that has
+			   been cut by ID3v1 matches the beginning of the other one */
+	MATCH_LOOSE	/* like MATCH_NORMAL but the album is ignored, so the same
+			   song on a different album is a duplicate as well */
+};
 
 /**
- * tracklist_setup_tracklist() will set every element of an array to
+ * A tracklist: the index of the tracks by the first letter of their artist
+ * and the match policy that decides when two tracks are the same.
+ */
+struct tracklist {
+	s_id3_tag *index[_MAX_INDEX];
+	int policy;		/* see enum match_policy */
+};
+
+
+/**
+ * tracklist_setup_tracklist() will set every element of the index to
  * NULL which is quite important so call this function before you attempt
- * to create a new tracklist
+ * to create a new tracklist. The policy is set to MATCH_NORMAL.
  */
-void tracklist_setup_tracklist(s_id3_tag* array[]);
+void tracklist_setup_tracklist(struct tracklist *tl);
+
+/**
+ * tracklist_set_policy() selects the match policy of the tracklist. It must
+ * be called before the first track is inserted.
+ */
+void tracklist_set_policy(struct tracklist *tl, int policy);
+
+/**
+ * tracklist_parse_policy() returns the match policy with the given name
+ * ("exact", "normal" or "loose") or -1 if there is no such policy.
+ */
+int tracklist_parse_policy(const char *name);
 
 /**
  * tracklist_get_index() will return the index for the element tag. This
  * element is of type struct id3_tag and has a field artist of which the
- * first character is used to obtain the index value.
+ * first character (of its key, if the key has been made) is used to obtain
+ * the index value.
  */
 int tracklist_get_index(s_id3_tag *tag);
 
 /**
  * tracklist_insert() will insert the element new_tag into the tracklist
- * that is maintained by array[]. If the element is already contained in
- * the list, it will return a pointer to it. Otherwise, a pointer to the
- * newly inserted element is returned.
+ * tl. Every track of the player is kept, even if the list already has one
+ * with the same artist and title. Only if the element itself (the same track
+ * ID, or the same artist, title and album for tracks without an ID) is
+ * already contained in the list, it will return a pointer to it. Otherwise,
+ * a pointer to the newly inserted element is returned.
  */
-s_id3_tag* tracklist_insert(s_id3_tag* array[], s_id3_tag *new_tag);
+s_id3_tag* tracklist_insert(struct tracklist *tl, s_id3_tag *new_tag);
 
 /**
- * tracklist_remove() does nothing as it is not implemented yet
+ * tracklist_remove() takes the track tag out of the tracklist tl and frees it. tag must be an element of the tracklist (as returned
+ * by tracklist_insert() or one of the find functions). It returns 1 if the track
+ * was removed and 0 if it was not found.
  */
-s_id3_tag* tracklist_remove(s_id3_tag *tag);
+int tracklist_remove(struct tracklist *tl, s_id3_tag *tag);
 
 /**
  * tracklist_find_artist() takes the first (**root) element of a simply 
  * linked list of struct id3_tag elements and looks for an element that
- * has the same artist as the element tag. If this search is 
- * successfull, a pointer to that element is returned. Otherwise,
- * NULL is returned and **root will point to the last element in
+ * has the same artist as the element tag (according to the policy of tl).
+ * If this search is successfull, a pointer to that element is returned.
+ * Otherwise, NULL is returned and **root will point to the last element in
  * that list.
  */
-s_id3_tag* tracklist_find_artist(s_id3_tag **root, s_id3_tag *tag);
+s_id3_tag* tracklist_find_artist(struct tracklist *tl, s_id3_tag **root, s_id3_tag *tag);
 
 /**
  * tracklist_find_title() takes the first (**node) element of a simply 
@@ -75,20 +113,45 @@ s_id3_tag* tracklist_find_artist(s_id3_tag **root, s_id3_tag *tag);
  * NULL is returned and **node will point to the last element in
  * that list.
  */
-s_id3_tag* tracklist_find_title(s_id3_tag **node, s_id3_tag *tag);
+s_id3_tag* tracklist_find_title(struct tracklist *tl, s_id3_tag **node, s_id3_tag *tag);
 
 /**
  * tracklist_find_tag() is the combination of the two functions
  * given above. It will look through the whole tracklist for an element
- * that has equal artist, title and album fields as tag and will 
+ * that has equal artist, title and album fields as tag (all tracks with
+ * the same title are looked at, not only the first one) and will 
  * return a pointer to it, if this search was successful. If not, NULL
- * is returned.
+ * is returned. What equal means is decided by the match policy.
  */
-s_id3_tag* tracklist_find_tag(s_id3_tag *array[], s_id3_tag *tag);
+s_id3_tag* tracklist_find_tag(struct tracklist *tl, s_id3_tag *tag);
+
+/**
+ * tracklist_find_trackid() returns the track with the given track ID or NULL
+ * if there is no such track in the tracklist.
+ */
+s_id3_tag* tracklist_find_trackid(struct tracklist *tl, unsigned int trackid);
+
+/**
+ * tracklist_count() returns the number of tracks in the tracklist.
+ */
+unsigned int tracklist_count(struct tracklist *tl);
+
+/**
+ * tracklist_flatten() returns a newly allocated array with pointers to all
+ * tracks in the tracklist, the number of tracks is stored in count. The
+ * tracks themselves are not copied, so only the array must be freed. NULL
+ * is returned in case of errors.
+ */
+s_id3_tag** tracklist_flatten(struct tracklist *tl, unsigned int *count);
 
 /**
  * tracklist_dump() prints the contents of the tracklist to the screen.
  */
-void tracklist_dump(s_id3_tag *array[]);
+void tracklist_dump(struct tracklist *tl);
+
+/**
+ * tracklist_free() frees all tracks of the tracklist, which is empty afterwards.
+ */
+void tracklist_free(struct tracklist *tl);
 
 #endif
@@ -0,0 +1,375 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * transcode.c - implementation file for turning other audio files into MP3
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+/* pipe2() and O_CLOEXEC are only known with the GNU extensions */
+#define _GNU_SOURCE
+
+#include "transcode.h"
+
+/* the extensions of the files that are encoded */
+static const char *transcode_extensions[] = {
+	"flac", "ogg", "oga", "opus", "wav", "aif", "aiff", "m4a", "aac", "wma", "ape", "wv", "mpc", 0
+};
+
+
+int transcode_wanted(const char *filename) {
+	const char *ext;
+	int i;
+
+	if ((!filename) || (!(ext = strrchr(filename, '.'))) || (strchr(ext, '/'))) return 0;
+
+	for (i = 0; transcode_extensions[i]; i++) {
+		if (!strcasecmp(ext + 1, transcode_extensions[i])) return 1;
+	}
+	return 0;
+}
+
+
+void transcode_init(struct transcoder *t, const char *command, char id3v1) {
+	memset(t, 0, sizeof(struct transcoder));
+	t->command = (command) ? command : _TRANSCODE_COMMAND;
+	t->id3v1 = id3v1;
+
+	/* without the cache, every file is encoded each time */
+	if ((t->cache = config_file_path(_TRANSCODE_CACHE)) &&
+	    (mkdir(t->cache, 0700)) && (errno != EEXIST)) {
+		free(t->cache);
+		t->cache = 0;
+	}
+
+	pthread_mutex_init(&t->lock, 0);
+	pthread_cond_init(&t->changed, 0);
+}
+
+
+int transcode_add(struct transcoder *t, const char *filename, unsigned long long hash) {
+	struct transcode_job *jobs, *job;
+	unsigned int size;
+
+	if (!filename) return 0;
+
+	if (t->n == t->size) {
+		size = (t->size) ? 2 * t->size : 16;
+		if (!(jobs = (struct transcode_job*)realloc(t->jobs, size * sizeof(struct transcode_job)))) {
+			print_error(G_NOMEM);
+			return 0;
+		}
+		t->jobs = jobs;
+		t->size = size;
+	}
+
+	job = &t->jobs[t->n++];
+	memset(job, 0, sizeof(struct transcode_job));
+	job->filename = intern(filename);
+	job->hash = hash;
+	job->src.fd = -1;
+	job->state = TC_WAITING;
+	return 1;
+}
+
+
+/**
+ * transcode_command() returns the encoder command for filename as a new string:
+ * every %i is replaced by the quoted filename and every %% by %. input is set if
+ * there is no %i, so the file has to be given on the standard input.
+ */
+static char* transcode_command(const char *command, const char *filename, int *input) {
+	const char *c, *f;
+	char *out, *o;
+	size_t l;
+
+	/* a quote in the filename takes four characters, the quotes around it two */
+	l = strlen(command) + 1;
+	for (c = command; (c = strstr(c, "%i")); c += 2) l += 4 * strlen(filename) + 2;
+
+	if (!(out = (char*)malloc(sizeof(char[l])))) return 0;
+
+	*input = 1;
+	for (c = command, o = out; *c; c++) {
+		if ((c[0] == '%') && (c[1] == '%')) {
+			*o++ = '%';
+			c++;
+		} else if ((c[0] == '%') && (c[1] == 'i')) {
+			*o++ = '\'';
+			for (f = filename; *f; f++) {
+				if (*f == '\'') {
+					memcpy(o, "'\\''", 4);
+					o += 4;
+				} else {
+					*o++ = *f;
+				}
+			}
+			*o++ = '\'';
+			*input = 0;
+			c++;
+		} else {
+			*o++ = *c;
+		}
+	}
+	*o = '\0';
+	return out;
+}
+
+
+int transcode_open(const char *command, const char *filename, pid_t *pid) {
+	char *line;
+	int fds[2], in, input;
+
+	if ((!command) || (!filename) || (!pid)) return -1;
+	if (!(line = transcode_command(command, filename, &input))) return -1;
+
+	/* the descriptors must not leak into the commands of other threads, or their
+	 * pipes would never be closed */
+	in = open((input) ? filename : "/dev/null", O_RDONLY | O_CLOEXEC);
+	if ((in < 0) || (pipe2(fds, O_CLOEXEC))) {
+		if (in >= 0) close(in);
+		free(line);
+		return -1;
+	}
+
+	if ((*pid = fork()) == 0) {
+		dup2(in, 0);
+		dup2(fds[1], 1);
+		execl("/bin/sh", "sh", "-c", line, (char*)0);
+		_exit(127);
+	}
+	close(fds[1]);
+	close(in);
+	free(line);
+	if (*pid < 0) {
+		close(fds[0]);
+		return -1;
+	}
+	return fds[0];
+}
+
+
+int transcode_close(int fd, pid_t pid) {
+	int status;
+
+	close(fd);		/* a command that is not done yet gets SIGPIPE */
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) return 0;
+	}
+	return (WIFEXITED(status)) && (!WEXITSTATUS(status));
+}
+
+
+/**
+ * transcode_encode() runs the encoder on the file of the job and reads its output
+ * into job->src. It returns 1 on success and 0 if the encoder failed.
+ */
+static int transcode_encode(struct transcoder *t, struct transcode_job *job) {
+	pid_t pid;
+	int fd, r;
+
+	if ((fd = transcode_open(t->command, job->filename, &pid)) < 0) return 0;
+
+	r = source_from_pipe(&job->src, fd, 0);
+	if ((!transcode_close(fd, pid)) || (!r) || (!job->src.size)) {
+		source_free(&job->src);
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * transcode_store() copies the MP3 data src to the file path of the cache. It
+ * is written under a temporary name first, so the cache never holds half a file.
+ */
+static void transcode_store(const char *path, const struct source *src) {
+	char buffer[_SOURCE_BUFFER], *tmp;
+	off_t pos = 0;
+	ssize_t n, k, done;
+	size_t l;
+	int out, r = 1;
+
+	l = strlen(path) + 6;
+	if (!(tmp = (char*)malloc(sizeof(char[l])))) return;
+	snprintf(tmp, l, "%s.part", path);
+
+	if ((out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) < 0) {
+		free(tmp);
+		return;
+	}
+
+	while ((r) && ((n = pread(src->fd, buffer, sizeof(buffer), pos)) != 0)) {
+		if (n < 0) {
+			if (errno != EINTR) r = 0;
+			continue;
+		}
+		for (done = 0; (r) && (done < n); done += k) {
+			if ((k = write(out, buffer + done, n - done)) < 0) {
+				if (errno != EINTR) r = 0;
+				k = 0;
+			}
+		}
+		pos += n;
+	}
+
+	if (close(out)) r = 0;
+	if ((!r) || (rename(tmp, path))) unlink(tmp);
+	free(tmp);
+}
+
+
+/**
+ * transcode_run() gets the MP3 data of the job from the cache or the encoder and
+ * reads its tags. The lock must not be held.
+ */
+static void transcode_run(struct transcoder *t, struct transcode_job *job) {
+	struct fingerprint_state st;
+	char *path = 0;
+	size_t l;
+
+	/* the same file encoded by another command is another file */
+	if ((t->cache) && (job->hash)) {
+		fingerprint_init(&st, job->hash);
+		fingerprint_update(&st, t->command, strlen(t->command));
+
+		l = strlen(t->cache) + 22;
+		if ((path = (char*)malloc(sizeof(char[l])))) {
+			snprintf(path, l, "%s/%016llx.mp3", t->cache, fingerprint_digest(&st));
+			if ((source_from_file(&job->src, path)) && (job->src.size)) {
+				job->cached = 1;
+			} else {
+				source_free(&job->src);
+			}
+		}
+	}
+
+	if (!job->cached) {
+		if (!transcode_encode(t, job)) {
+			free(path);
+			return;
+		}
+		if (path) transcode_store(path, &job->src);
+	}
+	free(path);
+
+	/* everything is read right here, so the sender does not have to wait */
+	if ((!(job->tag = id3_get_id3_struct(job->src.path, t->id3v1))) ||
+	    (!id3_tag_need(job->tag, _ID3_ALL))) {
+		id3_delete_id3_struct(job->tag);
+		job->tag = 0;
+		source_free(&job->src);
+		return;
+	}
+	job->tag->filename = job->filename;
+	job->tag->size = job->src.size;
+	fingerprint_file(job->src.path, &job->mp3hash);
+}
+
+
+/**
+ * transcode_worker() is a worker thread, it encodes the files in their order as
+ * long as it is not too far ahead of the sender.
+ */
+static void* transcode_worker(void *arg) {
+	struct transcoder *t = (struct transcoder*)arg;
+	struct transcode_job *job;
+
+	pthread_mutex_lock(&t->lock);
+	while ((!t->stop) && (t->started < t->n)) {
+		if (t->started - t->taken >= t->ahead) {
+			pthread_cond_wait(&t->changed, &t->lock);
+			continue;
+		}
+		job = &t->jobs[t->started++];
+		job->state = TC_RUNNING;
+		pthread_mutex_unlock(&t->lock);
+
+		transcode_run(t, job);
+
+		pthread_mutex_lock(&t->lock);
+		job->state = TC_DONE;
+		pthread_cond_broadcast(&t->changed);
+	}
+	pthread_mutex_unlock(&t->lock);
+	return 0;
+}
+
+
+int transcode_start(struct transcoder *t, int threads) {
+	if (t->nworkers) return t->nworkers;
+
+	if (threads <= 0) threads = pool_threads();
+	if (threads > _TRANSCODE_THREADS) threads = _TRANSCODE_THREADS;
+	if ((unsigned int)threads > t->n) threads = t->n;
+
+	/* every worker has a file of its own, some more may wait for the sender */
+	t->ahead = threads + _TRANSCODE_AHEAD;
+	for (; t->nworkers < threads; t->nworkers++) {
+		if (pthread_create(&t->workers[t->nworkers], 0, transcode_worker, t)) break;
+	}
+	return t->nworkers;
+}
+
+
+struct transcode_job* transcode_next(struct transcoder *t) {
+	struct transcode_job *job;
+
+	pthread_mutex_lock(&t->lock);
+	if (t->taken >= t->n) {
+		pthread_mutex_unlock(&t->lock);
+		return 0;
+	}
+
+	job = &t->jobs[t->taken];
+	while (job->state != TC_DONE) {
+		/* without the workers the file is encoded right here */
+		if ((!t->nworkers) && (job->state == TC_WAITING)) {
+			job->state = TC_RUNNING;
+			t->started++;
+			pthread_mutex_unlock(&t->lock);
+			transcode_run(t, job);
+			pthread_mutex_lock(&t->lock);
+			break;
+		}
+		pthread_cond_wait(&t->changed, &t->lock);
+	}
+
+	job->state = TC_TAKEN;
+	t->taken++;
+	pthread_cond_broadcast(&t->changed);
+	pthread_mutex_unlock(&t->lock);
+	return job;
+}
+
+
+void transcode_done(struct transcoder *t, struct transcode_job *job) {
+	if (!job) return;
+
+	source_free(&job->src);
+	id3_delete_id3_struct(job->tag);
+	job->tag = 0;
+}
+
+
+void transcode_free(struct transcoder *t) {
+	unsigned int i;
+	int w;
+
+	pthread_mutex_lock(&t->lock);
+	t->stop = 1;
+	pthread_cond_broadcast(&t->changed);
+	pthread_mutex_unlock(&t->lock);
+	for (w = 0; w < t->nworkers; w++) pthread_join(t->workers[w], 0);
+
+	for (i = 0; i < t->n; i++) transcode_done(t, &t->jobs[i]);
+	free(t->jobs);
+	free(t->cache);
+	pthread_cond_destroy(&t->changed);
+	pthread_mutex_destroy(&t->lock);
+	memset(t, 0, sizeof(struct transcoder));
+}
@@ -0,0 +1,165 @@
+/***************************************************************************
+ * ZenCP - a command line utility for handling Creative Nomad Audio Players
+ * ========================================================================
+ *
+ * transcode.h - header file for turning other audio files into MP3
+ *
+ * The players only take MP3 files. This file provides the prototypes and
+ * structures that are needed to encode other files (FLAC, Ogg, ...) on
+ * the fly with an external encoder before they are sent. The encoder is
+ * a shell command that writes MP3 to its standard output, e.g.
+ *
+ *   ffmpeg -v quiet -i %i -vn -f mp3 -b:a 192k -
+ *
+ * where %i is replaced by the name of the file (without %i, the file is
+ * given to the encoder on its standard input). The MP3 data goes into a
+ * file in memory (see source.h), its tags are read from there, so the
+ * encoder has to carry them over.
+ *
+ * The files are encoded by a pool of worker threads in the order they are
+ * sent, but only a few of them ahead of the sender, so that the encoded
+ * data does not pile up in memory. Every encoded file is also kept in a
+ * cache (~/.zencp/transcoded) by the fingerprint of the original and the
+ * encoder command, so a file is only encoded once.
+ *
+ * Written by:     Thomas Buchner
+ * Copyright (c):  2005 by Thomas Buchner
+ * GitHub:         https://github.com/MrBatschner/zencp
+ *
+ ***************************************************************************/
+
+#ifndef __ZENCP_TRANSCODE_H
+#define __ZENCP_TRANSCODE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "id3.h"
+#include "source.h"
+#include "fingerprint.h"
+#include "intern.h"
+#include "pool.h"
+#include "misc.h"
+
+/* the encoder that is used if none is given */
+#define _TRANSCODE_COMMAND "ffmpeg -v quiet -i %i -vn -f mp3 -b:a 192k -"
+
+/* the directory below ~/.zencp that holds the encoded files */
+#define _TRANSCODE_CACHE "transcoded"
+
+/* the number of encoded files that may wait for the sender */
+#define _TRANSCODE_AHEAD 2
+
+/* the most worker threads */
+#define _TRANSCODE_THREADS 16
+
+/**
+ * The states of a job.
+ */
+enum transcode_state {
+	TC_WAITING,		/* not started yet */
+	TC_RUNNING,		/* being encoded */
+	TC_DONE,		/* encoded or failed */
+	TC_TAKEN		/* handed to the caller */
+};
+
+/**
+ * A file that is encoded.
+ */
+struct transcode_job {
+	const char *filename;		/* the original file (interned) */
+	unsigned long long hash;	/* its fingerprint, 0 if it is unknown */
+	struct source src;		/* the MP3 data */
+	s_id3_tag *tag;			/* its tags, NULL if the file failed */
+	unsigned long long mp3hash;	/* the fingerprint of the MP3 data */
+	int cached;			/* the MP3 data came from the cache */
+	int state;			/* see enum transcode_state */
+};
+
+/**
+ * The encoding stage of one transfer.
+ */
+struct transcoder {
+	const char *command;		/* the encoder */
+	char *cache;			/* the cache directory or NULL */
+	char id3v1;			/* the tags are read with ID3v1 only */
+
+	struct transcode_job *jobs;	/* the files in the order they are sent */
+	unsigned int n;			/* their number */
+	unsigned int size;		/* the room in jobs */
+	unsigned int started;		/* the next job a worker takes */
+	unsigned int taken;		/* the next job that is handed out */
+	unsigned int ahead;		/* how far the workers may be ahead */
+
+	pthread_t workers[_TRANSCODE_THREADS];
+	int nworkers;			/* the worker threads that are running */
+	int stop;			/* the worker threads have to stop */
+	pthread_mutex_t lock;		/* protects all of the above */
+	pthread_cond_t changed;		/* signalled whenever a job changes its state */
+};
+
+/**
+ * transcode_wanted() returns 1 if filename has to be encoded before it can be
+ * sent, which is decided by its extension.
+ */
+int		transcode_wanted(const char *filename);
+
+/**
+ * transcode_open() runs command for filename like the encoder (see above) and
+ * returns the end of a pipe its standard output can be read from or -1. The
+ * process ID is stored in pid.
+ */
+int		transcode_open(const char *command, const char *filename, pid_t *pid);
+
+/**
+ * transcode_close() closes fd and waits for the command pid. It returns 1 if the
+ * command succeeded and 0 otherwise.
+ */
+int		transcode_close(int fd, pid_t pid);
+
+/**
+ * transcode_init() sets up an encoding stage for the encoder command (NULL means
+ * _TRANSCODE_COMMAND) whose output tags are read with ID3v1 only if id3v1 is set.
+ */
+void		transcode_init(struct transcoder *t, const char *command, char id3v1);
+
+/**
+ * transcode_add() adds filename with the fingerprint hash to the files that are
+ * encoded. It returns 1 on success and 0 if there is no memory.
+ */
+int		transcode_add(struct transcoder *t, const char *filename, unsigned long long hash);
+
+/**
+ * transcode_start() starts up to threads worker threads (0 means one per CPU).
+ * Without them, the files are encoded by transcode_next() one by one. It returns
+ * the number of threads that are running.
+ */
+int		transcode_start(struct transcoder *t, int threads);
+
+/**
+ * transcode_next() waits for the next file and returns its job or NULL if all
+ * files have been handed out. job->tag is NULL if the file could not be encoded.
+ * The job belongs to the caller until it is given back with transcode_done().
+ */
+struct transcode_job* transcode_next(struct transcoder *t);
+
+/**
+ * transcode_done() gives the job back, its MP3 data and tags are freed.
+ */
+void		transcode_done(struct transcoder *t, struct transcode_job *job);
+
+/**
+ * transcode_free() stops the worker threads and frees everything.
+ */
+void		transcode_free(struct transcoder *t);
+
+#endif
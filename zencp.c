@@ -21,15 +21,38 @@ static char _b_switch_f = 0;
 static char _b_switch_e = 0;
 static char _b_switch_i = 0;
 static char _b_switch_y = 0;
+static char _b_switch_delete = 0;
 static char _b_switch_T = 0;
+static char _b_switch_D = 0;
+static char _b_switch_C = 0;
+static char _b_switch_M = 0;
+static char _b_switch_x = 0;
 static char _b_switch_unknown = 0;
-/* two switches take arguments that are stored in these strings */
+/* some switches take arguments that are stored in these strings */
 static char* _s_switch_d = 0;
 static char* _s_switch_F = 0;
+static char* _s_switch_t = 0;
+static char* _s_switch_S = 0;
+static char* _s_switch_G = 0;
+static char* _s_switch_from = 0;
+static char* _s_switch_encoder = 0;
+static char* _s_switch_data = 0;
+static char* _s_switch_stream = 0;
+/* the commands a client sends to the daemon (-C) and the number of -R */
+static struct daemon_request _r_request;
+static unsigned int _i_switch_R = 0;
+/* the query for the track listing (-w, -s, -c, -o) */
+static struct query _q_query;
 
-/* the number of players and the player array */
-int players = 0;
-njb_t player_array[_MAX_PLAYERS];
+/* the match policy (-m), < 0 if it was not given */
+static int _i_switch_m = -1;
+/* the loudness normalization (-n) */
+static int _i_switch_n = LM_OFF;
+/* the memory budget of --stream in MB (--memory), 0 if it was not given */
+static int _i_switch_memory = 0;
+
+/* the context of this run, it is needed by the signal handler */
+static struct zencp *_z_context = 0;
 
 
 /**
@@ -38,19 +61,13 @@ njb_t player_array[_MAX_PLAYERS];
  * knows how to implement a proper signal handler will get a heart attack.
  */
 void sigint_cleanup(int sig) {
-	unsigned int i, p = 0;
-	njb_t *player;
+	int p = 0;
 
 	printf("\n\nCaught CTRL+C (SIGINT). Releasing all locked players.\n");
 	
 	/* go through the array of players and release every single player in
 	 * there */
-	for (i = 0; i < players; i++) {
-		player = &(player_array[i]);
-		if (player_release(&player)) {
-			p++;
-		}
-	}
+	if (_z_context) p = zencp_release_all(_z_context);
 
 	printf("Released %d player%s. Exiting.\n", p, (p > 1) ? "s" : "");
 
@@ -62,22 +79,51 @@ void sigint_cleanup(int sig) {
 
 void print_help_screen(void) {
 	printf(" Usage: zencp [ACTION] [OPTION]... MEDIAFILE...\n");
-	printf("        zencp (-h | --help | -l | --list-devices)\n\n");
+	printf("        zencp (-h | --help | -l | --list-devices)\n");
+	printf("        A MEDIAFILE may be a playlist (.m3u), it is written to the Jukebox after its files\n\n");
 	
 	printf(" Actions:\n");
 	printf("   -l, --list-devices \t\t list all connected Jukebox devices\n");
 	printf("   -T, --track-list \t\t print a list with all tracks on the Jukebox\n");
-	printf("   -p, --print-id3 \t\t print ID3 information of file, do not transfer\n");
+	printf("   -p, --print-id3 \t\t print ID3 information of files, directories and playlists\n");
+	printf("   -G, --get DIR \t\t copy tracks from the Jukebox to DIR as Artist/Album/NN Title.mp3\n");
+	printf("       --copy-from DEV \t\t copy tracks from the Jukebox DEV to another one (-d or --to)\n");
+	printf("       --data DIR \t\t copy the directory tree DIR to the data area of the Jukebox\n");
+	printf("       --delete \t\t delete the tracks selected by -w from the Jukebox\n");
+	printf("       --stream LIST \t\t send the files named in LIST (one per line, - for stdin) while it is read\n");
+	printf("   -D, --daemon \t\t keep the Jukebox captured and wait for jobs from clients\n");
 	printf("   -h, --help \t\t\t print this help screen\n");
 	printf("   -V, --version \t\t print version information and exit\n\n");
 	
 	printf(" Options:\n");
-	printf("   -d, --device DEV \t\t transfer files to Jukebox device DEV\n");
+	printf("   -d, --device DEV \t\t use the Jukebox with serial number (prefix) or USB path DEV\n");
+	printf("       --to DEV \t\t the same as -d, the destination of --copy-from\n");
 	printf("   -f, --force \t\t\t transfer and overwrite already present files on the Jukebox\n");
 	printf("   -e, --empty-id3 \t\t allow emtpy ID3 tags\n");
 	printf("   -F, --fill-id3 STRING \t fill empty ID3 tags with STRING for transfer\n");
 	printf("   -i, --id3v1 \t\t\t use ID3v1 tags instead of ID3v2\n");
+	printf("   -m, --match POLICY \t\t when tracks are duplicates: exact, normal (default) or loose\n");
+	printf("   -n, --normalize MODE \t even out the loudness: tag (ReplayGain) or apply (MP3 gain)\n");
+	printf("   -M, --shard \t\t\t spread the files over all Jukeboxes and print where they went\n");
+	printf("       --memory MB \t\t with --stream: the memory for the queued files, not the sent ones (default %d)\n",
+		_STREAM_MEMORY / (1024 * 1024));
+	printf("   -t, --deadline TIME \t\t transfer as much as possible within TIME (90, 45s, 20m, 1h)\n");
+	printf("   -x, --transcode \t\t encode files that are not MP3 (FLAC, Ogg, ...) before sending them\n");
+	printf("       --encoder CMD \t\t encode them with CMD (%%i: the file, MP3 to stdout) instead of ffmpeg\n");
 	printf("   -y, --yes \t\t\t transfer files without user interaction\n\n");
+
+	printf(" Daemon options (-D, -C):\n");
+	printf("   -C, --client \t\t send the files, -T and -R as jobs to a running daemon\n");
+	printf("   -R, --remove ID \t\t with -C: delete the track with ID, may be repeated\n");
+	printf("   -S, --socket PATH \t\t the socket of the daemon (default: ~/.zencp/socket)\n\n");
+
+	printf(" Track list options (-T, -G, --copy-from, --delete):\n");
+	printf("   -w, --where TERM \t\t only list tracks matching TERM, may be repeated:\n");
+	printf("\t\t\t\t   field=value, field=min..max, field~text, field~/regex/\n");
+	printf("   -s, --sort FIELDS \t\t sort by a comma separated list of fields (-field: descending)\n");
+	printf("   -c, --fields FIELDS \t\t print only the fields in the comma separated list\n");
+	printf("   -o, --format FORMAT \t\t print as tsv (default), csv or json (also for -p and -M)\n");
+	printf("\t\t\t\t fields: trackid artist title album genre year trackno length size\n\n");
 }
 
 
@@ -88,7 +134,7 @@ void print_version_information(void) {
 
 
 int parse_cmdline(int argc, char *argv[], mp3_file **file_list) {
-	int i = 0;
+	int i = 0, k = 0;
 	unsigned int songs = 0;
 	int args = argc;
 	
@@ -119,9 +165,21 @@ int parse_cmdline(int argc, char *argv[], mp3_file **file_list) {
 		if ((!strcmp(argv[i], "-T")) || (!strcmp(argv[i], "--track-list"))) {
 			_b_switch_T = 1;
 			args--;
-			break;
+			continue;
 		}
 		
+		if ((!strcmp(argv[i], "-D")) || (!strcmp(argv[i], "--daemon"))) {
+			_b_switch_D = 1;
+			args--;
+			continue;
+		}
+
+		if ((!strcmp(argv[i], "-C")) || (!strcmp(argv[i], "--client"))) {
+			_b_switch_C = 1;
+			args--;
+			continue;
+		}
+
 		if ((!strcmp(argv[i], "-p")) || (!strcmp(argv[i], "--print-id3"))) {
 			_b_switch_p = 1;
 			args--;
@@ -155,9 +213,27 @@ int parse_cmdline(int argc, char *argv[], mp3_file **file_list) {
 			continue;
 		}
 
+		if (!strcmp(argv[i], "--delete")) {
+			_b_switch_delete = 1;
+			args--;
+			continue;
+		}
+
+		if ((!strcmp(argv[i], "-M")) || (!strcmp(argv[i], "--shard"))) {
+			_b_switch_M = 1;
+			args--;
+			continue;
+		}
+
+		if ((!strcmp(argv[i], "-x")) || (!strcmp(argv[i], "--transcode"))) {
+			_b_switch_x = 1;
+			args--;
+			continue;
+		}
+
 
 		/* and here the complex argumented command line options */
-                if ((!strcmp(argv[i], "-d")) || (!strcmp(argv[i], "--device"))) {
+                if ((!strcmp(argv[i], "-d")) || (!strcmp(argv[i], "--device")) || (!strcmp(argv[i], "--to"))) {
 			/* we expect an argument to this switch here, if there is nothing
 			 * left in argv or the next element in argv begins with a -
 			 * someone did call this option in the right way */
@@ -171,6 +247,189 @@ int parse_cmdline(int argc, char *argv[], mp3_file **file_list) {
                         continue; 
                 }
 
+		/* the query options for -T, each of them takes an argument */
+                if ((!strcmp(argv[i], "-w")) || (!strcmp(argv[i], "--where")) ||
+		    (!strcmp(argv[i], "-s")) || (!strcmp(argv[i], "--sort")) ||
+		    (!strcmp(argv[i], "-c")) || (!strcmp(argv[i], "--fields")) ||
+		    (!strcmp(argv[i], "-o")) || (!strcmp(argv[i], "--format"))) {
+			if (++i >= argc) {
+				print_error(OPT_Q);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			if ((!strcmp(argv[i-1], "-w")) || (!strcmp(argv[i-1], "--where"))) {
+				k = query_add_term(&_q_query, argv[i]);
+			} else if ((!strcmp(argv[i-1], "-s")) || (!strcmp(argv[i-1], "--sort"))) {
+				k = query_set_sort(&_q_query, argv[i]);
+			} else if ((!strcmp(argv[i-1], "-c")) || (!strcmp(argv[i-1], "--fields"))) {
+				k = query_set_fields(&_q_query, argv[i]);
+			} else {
+				k = query_set_format(&_q_query, argv[i]);
+			}
+
+			if (!k) {
+				print_error(OPT_Q);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			/* a client hands the query on to the daemon */
+			if ((!strcmp(argv[i-1], "-w")) || (!strcmp(argv[i-1], "--where"))) {
+				daemon_request_add(&_r_request, "WHERE", argv[i]);
+			} else if ((!strcmp(argv[i-1], "-s")) || (!strcmp(argv[i-1], "--sort"))) {
+				daemon_request_add(&_r_request, "SORT", argv[i]);
+			} else if ((!strcmp(argv[i-1], "-c")) || (!strcmp(argv[i-1], "--fields"))) {
+				daemon_request_add(&_r_request, "FIELDS", argv[i]);
+			} else {
+				daemon_request_add(&_r_request, "FORMAT", argv[i]);
+			}
+                        args-=2;
+                        continue; 
+                }
+
+                if ((!strcmp(argv[i], "-m")) || (!strcmp(argv[i], "--match"))) {
+			/* the policy must be known before the first track is inserted */
+			if ((++i >= argc) || ((k = tracklist_parse_policy(argv[i])) < 0)) {
+				print_error(OPT_M);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_i_switch_m = k;
+                        args-=2;
+                        continue; 
+                }
+
+                if ((!strcmp(argv[i], "-n")) || (!strcmp(argv[i], "--normalize"))) {
+			if ((++i >= argc) || ((k = loudness_parse_mode(argv[i])) < 0)) {
+				print_error(OPT_N);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_i_switch_n = k;
+                        args-=2;
+                        continue; 
+                }
+
+                if (!strcmp(argv[i], "--stream")) {
+			/* the list is opened by main(), "-" is the standard input */
+			if ((++i >= argc) || (!argv[i][0])) {
+				print_error(OPT_L);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_s_switch_stream = argv[i];
+                        args-=2;
+                        continue; 
+                }
+
+                if (!strcmp(argv[i], "--memory")) {
+			if ((++i >= argc) || ((k = atoi(argv[i])) <= 0)) {
+				print_error(OPT_B);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_i_switch_memory = k;
+                        args-=2;
+                        continue; 
+                }
+
+                if ((!strcmp(argv[i], "-R")) || (!strcmp(argv[i], "--remove"))) {
+			/* the track ID is a number */
+			if ((++i >= argc) || (!is_digit(argv[i][0]))) {
+				print_error(OPT_R);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			daemon_request_add(&_r_request, "DELETE", argv[i]);
+			_i_switch_R++;
+                        args-=2;
+                        continue; 
+                }
+
+                if ((!strcmp(argv[i], "-S")) || (!strcmp(argv[i], "--socket"))) {
+			if ((++i >= argc) || (argv[i][0] == '-')) {
+				print_error(OPT_S);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_s_switch_S = argv[i];
+                        args-=2;
+                        continue; 
+                }
+
+                if (!strcmp(argv[i], "--copy-from")) {
+			/* the source is named like the player of -d */
+			if ((++i >= argc) || (argv[i][0] == '-')) {
+				print_error(OPT_D);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_s_switch_from = argv[i];
+                        args-=2;
+                        continue; 
+                }
+
+                if (!strcmp(argv[i], "--data")) {
+			/* the directory is read by zencp_send_data() */
+			if ((++i >= argc) || (!argv[i][0])) {
+				print_error(OPT_A);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_s_switch_data = argv[i];
+                        args-=2;
+                        continue; 
+                }
+
+                if (!strcmp(argv[i], "--encoder")) {
+			/* the command is a single argument, it is run by the shell */
+			if ((++i >= argc) || (!argv[i][0])) {
+				print_error(OPT_X);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_s_switch_encoder = argv[i];
+			_b_switch_x = 1;
+                        args-=2;
+                        continue; 
+                }
+
+                if ((!strcmp(argv[i], "-G")) || (!strcmp(argv[i], "--get"))) {
+			/* the directory is created by the download if it does not exist */
+			if ((++i >= argc) || (argv[i][0] == '-')) {
+				print_error(OPT_G);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_s_switch_G = argv[i];
+                        args-=2;
+                        continue; 
+                }
+
+                if ((!strcmp(argv[i], "-t")) || (!strcmp(argv[i], "--deadline"))) {
+			/* the time budget is checked by main() */
+			if ((++i >= argc) || (argv[i][0] == '-')) {
+				print_error(OPT_T);
+				_b_switch_unknown = 1;
+				break;
+			}
+
+			_s_switch_t = argv[i];
+                        args-=2;
+                        continue; 
+                }
+
                 if ((!strcmp(argv[i], "-F")) || (!strcmp(argv[i], "--fill-id3"))) {
 			/* we expect an argument to this switch here, if there is nothing
 			 * left in argv or the next element in argv begins with a -
@@ -218,25 +477,266 @@ int parse_cmdline(int argc, char *argv[], mp3_file **file_list) {
 }
 
 
+
+
+/**
+ * cli_progress() prints the progress of a transfer. It is the progress callback
+ * of the context and only prints whenever the number of transmitted bytes is
+ * divisable by 10.
+ */
+static void cli_progress(void *user, s_id3_tag *tag, unsigned long long sent, unsigned long long total) {
+	int sent_kb = sent / 1024;
+	int total_kb = total / 1024;
+	int percentage = (((float)sent / (float)total) * 100);
+	
+	if ((sent % 10 != 0) && (sent != total)) return;
+
+	printf("   %8d KB of %d KB %s (%2d%%)\r", sent_kb, total_kb, (_s_switch_G) ? "received" : "sent",
+		percentage);
+	fflush(stdout);
+}
+
+
+/**
+ * cli_decide() asks the user for every song if he really wants to transfer it.
+ * It is the decide callback of the context unless -y was given.
+ */
+static int cli_decide(void *user, s_id3_tag *tag, s_id3_tag *existing) {
+	char yesno = 0;
+
+	/* tell the user which track he is transferring */
+	id3_print_tags(tag);
+
+	/* the track is on the player but -f was set, so the track will be overwritten */
+	if (existing) {
+		printf("%s - %s already exists,\n", tag->artist, tag->title);
+		printf("and will be overwritten!\n\n");
+	}
+
+	/* TODO: this must be done in a better way !!!!!!!!! */
+
+	printf("Really send this file ([Y]es/[n]o/[Q]uit)? ");
+	do {
+		yesno = fgetc(stdin);
+	} while ((yesno != EOF) && (strchr("YyNnQ", yesno) == 0));
+
+	if ((yesno == 'Y') || (yesno == 'y')) return ZD_SEND;
+	if (yesno == 'Q') return ZD_QUIT;
+	printf("\n");
+	return ZD_SKIP;
+}
+
+
+/**
+ * cli_confirm() asks the user the question and returns 1 if he says yes.
+ */
+static int cli_confirm(const char *question) {
+	char yesno = 0;
+
+	printf("%s ([y]es/[N]o)? ", question);
+	do {
+		yesno = fgetc(stdin);
+	} while ((yesno != EOF) && (strchr("YyNn\n", yesno) == 0));
+
+	printf("\n");
+	return (yesno == 'Y') || (yesno == 'y');
+}
+
+
+/**
+ * cli_event() prints what happens during a transfer to the stream user, it is the
+ * event callback of the context. With -M, the player is named as well.
+ */
+static void cli_event(void *user, const struct zencp_event *e) {
+	FILE *out = (FILE*)user;
+
+	if ((_b_switch_M) && (e->player >= 0)) fprintf(out, " [%d]", e->player);
+
+	switch (e->type) {
+		case ZE_SAME_AUDIO:
+			fprintf(out, " Skipping %u file%s with the same audio data as another file.\n\n",
+				e->count, (e->count != 1) ? "s" : "");
+			break;
+		case ZE_PLAN:
+			fprintf(out, " Time budget: %.0f s left, assuming %.2f MB/s.\n\n", e->seconds,
+				e->rate / (1024.0 * 1024.0));
+			break;
+		case ZE_UNREADABLE:
+			print_error(ID3_RETR);
+			/*TODO: insert a strtoerr into here after you got the dev manpages */
+			fprintf(out, " Skipping %s\n", e->filename);
+			break;
+		case ZE_EXISTS:
+			/* data files have no tags, they are named by their file */
+			if (!e->tag) {
+				fprintf(out, " %s already exists, skipping.\n\n", e->filename);
+				break;
+			}
+			fprintf(out, " %s - %s already exists, skipping.\n\n", e->tag->artist, e->tag->title);
+			break;
+		case ZE_SENDING:
+			if (!e->tag) {
+				fprintf(out, " Sending %s\n", e->filename);
+				break;
+			}
+			fprintf(out, " Sending %s - %s\n", e->tag->artist, e->tag->title);
+			break;
+		case ZE_SENT:
+			if (!e->tag) {
+				fprintf(out, "   Successfully sent %s\n\n", e->filename);
+				break;
+			}
+			fprintf(out, "   Successfully sent %s - %s\n\n", e->tag->artist, e->tag->title);
+			break;
+		case ZE_FAILED:
+			if (!e->tag) {
+				fprintf(out, "   Could not send %s\n\n", e->filename);
+				break;
+			}
+			fprintf(out, "   Could not %s %s - %s\n\n",
+				(_s_switch_G) ? "fetch" : ((_b_switch_delete) ? "delete" : "send"),
+				e->tag->artist, e->tag->title);
+			break;
+		case ZE_PLAYLIST:
+			fprintf(out, " Wrote the playlist %s with %u track%s.\n\n", e->filename, e->count,
+				(e->count != 1) ? "s" : "");
+			break;
+		case ZE_LEFT_OUT:
+			fprintf(out, " %s is not on the player, it is left out of its playlist.\n", e->filename);
+			break;
+		case ZE_DELETED:
+			fprintf(out, " Deleted %s - %s (%u)\n", e->tag->artist, e->tag->title, e->tag->trackid);
+			break;
+		case ZE_RETRYING:
+			fprintf(out, "\n   Failed, trying again (%u)\n", e->count);
+			break;
+		case ZE_DEADLINE:
+			fprintf(out, " Deadline: %.0f s left, not starting %u more file%s.\n\n",
+				e->seconds, e->count, (e->count != 1) ? "s" : "");
+			break;
+		case ZE_ABORTED:
+			print_error(G_ABRT);
+			break;
+		case ZE_RECEIVING:
+			fprintf(out, " Fetching %s - %s\n", e->tag->artist, e->tag->title);
+			break;
+		case ZE_RECEIVED:
+			fprintf(out, "   Successfully fetched to %s\n\n", e->filename);
+			break;
+		case ZE_PRESENT:
+			fprintf(out, " %s is already there, skipping.\n\n", e->filename);
+			break;
+		case ZE_ANALYSED:
+			fprintf(out, " Measured the loudness of %u file%s.\n\n",
+				e->count, (e->count != 1) ? "s" : "");
+			break;
+		case ZE_NOROOM:
+			fprintf(out, " %u file%s did not fit on any player.\n\n",
+				e->count, (e->count != 1) ? "s" : "");
+			break;
+	}
+	fflush(out);
+}
+
+
 /**
  * This is the main function (why, really...).
  */
+/**
+ * cli_mark() marks the string s in the bitmap seen and returns 1 if it has not
+ * been marked yet. Missing strings count as the empty string.
+ */
+static unsigned int cli_mark(unsigned char *seen, const char *s) {
+	unsigned int id = intern_id_of((s) ? s : intern(""));
+
+	if ((id == _INTERN_NONE) || (seen[id >> 3] & (1 << (id & 7)))) return 0;
+	seen[id >> 3] |= 1 << (id & 7);
+	return 1;
+}
+
+
+/**
+ * cli_summary() prints how many artists, albums and genres the tracks of the
+ * tracklist tl have and how big and long they are, it is the summary of -T. The
+ * tracks are counted in one pass over the tracklist.
+ */
+static void cli_summary(FILE *msg, struct tracklist *tl) {
+	unsigned long long bytes = 0, length = 0;
+	unsigned int artists = 0, albums = 0, genres = 0;
+	unsigned char *seen;
+	s_id3_tag *t, *s;
+	size_t size;
+	int i;
+
+	/* one bitmap for each of artists, albums and genres, one bit for every
+	 * string; intern("") above may add one more string */
+	size = (intern_count() + 1) / 8 + 1;
+	if (!(seen = (unsigned char*)calloc(3, size))) {
+		print_error(G_NOMEM);
+		return;
+	}
+
+	for (i = 0; i < _MAX_INDEX; i++) {
+		for (t = tl->index[i]; t; t = t->next) {
+			for (s = t; s; s = s->element) {
+				bytes += s->size;
+				length += s->time;
+				artists += cli_mark(seen, s->artist);
+				albums += cli_mark(seen + size, s->album);
+				genres += cli_mark(seen + 2 * size, s->genre);
+			}
+		}
+	}
+	free(seen);
+
+	fprintf(msg, " The player holds %u artists, %u albums and %u genres: %llu MB, %llu:%02llu h.\n\n",
+		artists, albums, genres, bytes / (1024 * 1024), length / 3600, (length / 60) % 60);
+}
+
+
 int main (int argc, char *argv[]) {
 	unsigned int songs = 0;		/* the number of songs received as cmdline args */
 	unsigned int playersongs = 0;	/* the number of songs stored on the player */
-	unsigned int id = 0;
-	int i = 0;
-	njb_t *player;			/* a pointer to the Creative player to be used */
-	s_id3_tag* player_tracklist[_MAX_INDEX];	/* the index list for player tracks */
-	s_id3_tag *tag = 0;		/* a pointer for an ID3 tag object */
-	s_id3_tag *track_tag = 0;	/* ... */
+	int i = 0, k = 0;
+	struct zencp z;			/* the context with the Creative player to be used */
+	struct survey_result results[_MAX_PLAYERS];	/* what the players said for -l */
 	mp3_file *file_list = 0;	/* a list of filenames received as cmdline args */
-	char yesno = 0;
+	s_id3_tag **tracks = 0;		/* the result of a track list query */
+	unsigned int listed = 0;
+	unsigned long long bytes = 0;	/* the size of the tracks for --delete */
+	FILE *msg = stdout;		/* the stream for messages */
+	struct scan scan;		/* the files and tags for -p */
+	struct shard shard;		/* the files and players for -M */
+	struct shard_device *dev;
+	mp3_file *file;
+	char *socket_path = 0;		/* the socket of the daemon (-D, -C) */
+	FILE *in;			/* the list of files for --stream */
+	char path[PATH_MAX];
 
-	printf("zencp %s - Copyright (C) 2005 by Thomas Buchner\n\n", ZENCP_VERSION);
-	tracklist_setup_tracklist(player_tracklist);	/* initialize the track list */
+	zencp_init(&z);
+	z.options.start = stats_now();	/* the time budget starts now */
+	z.callbacks.progress = cli_progress;
+	z.callbacks.event = cli_event;
+	_z_context = &z;
+	query_init(&_q_query);
+	daemon_request_init(&_r_request);
 	signal(SIGINT, sigint_cleanup);			/* set the signal handler */
 	songs = parse_cmdline(argc, argv, &file_list);	/* parse the command line */
+
+	/* the policy must be known before the first track is inserted */
+	if (_i_switch_m >= 0) tracklist_set_policy(&z.tracklist, _i_switch_m);
+	z.options.id3v1 = _b_switch_i;
+	z.options.force = _b_switch_f;
+	z.options.normalize = _i_switch_n;
+	z.options.memory = (size_t)_i_switch_memory * 1024 * 1024;
+	if (_b_switch_x) z.options.transcode = (_s_switch_encoder) ? _s_switch_encoder : _TRANSCODE_COMMAND;
+	if (!_b_switch_y) z.callbacks.decide = cli_decide;
+
+	/* the track list is written to stdout so that it can be piped into other
+	 * programs, all messages go to stderr in that case */
+	if ((_b_switch_T) || (_b_switch_p) || (_b_switch_M)) msg = stderr;
+	z.callbacks.user = msg;
+	fprintf(msg, "zencp %s - Copyright (C) 2005 by Thomas Buchner\n\n", ZENCP_VERSION);
 	
 	/* unknown cmd switch or -h or no argument at all was given */
 	if ((_b_switch_unknown) || (_b_switch_h) || (argc == 1)) {
@@ -244,236 +744,360 @@ int main (int argc, char *argv[]) {
 		return 0;
 	}
 
+	/* a time budget was given, so check that it makes sense */
+	if ((_s_switch_t) && ((z.options.deadline = schedule_parse_time(_s_switch_t)) < 0)) {
+		print_error(OPT_T);
+		return 1;
+	}
+
 	/* someone wants to know the version of this program (-V) */
 	if (_b_switch_V) {
 		print_version_information();
 		return 0;
 	}
 
-	/* someone just wants to know the ID3 information stored in an MP3 file  */
+	/* someone just wants to know the ID3 information stored in MP3 files */
 	if (_b_switch_p) {
-		if (songs != 1) {	/* this only works with exactly one file name */
+		if (!songs) {		/* this needs at least one file, directory or playlist */
 			print_error(OPT_P);
 			return 1;
 		}
-		
-		/* get the tag object from the specific file and check for errors */
+
+		scan_init(&scan);
+		for (file = list_first_element(file_list); file; file = file->next) {
+			scan_add(&scan, file->filename);
+		}
+
 		/* _b_switch_i will control wether ID3 v1 (true) or ID3 v2 (NULL) tags
 		 * will be used */
-		if (!(tag = id3_get_id3_struct(file_list->filename, _b_switch_i))) {
-			print_error(ID3_RETR);
-			/*TODO: insert a strtoerr into here after you got the dev manpages */
-			return 2;
+		if (_b_switch_i) fprintf(msg, " Using ID3 v.1 tags.\n\n");
+		scan_read(&scan, _b_switch_i, 0);
+
+		/* the records go to stdout in the order of the files, the summary to msg */
+		if (!scan_write(&scan, _q_query.format, stdout)) {
+			fprintf(stderr, " ERROR: the tags could not be written\n\n");
+			scan_free(&scan);
+			return 4;
 		}
+		i = scan_summary(&scan, msg);
+		scan_free(&scan);
+		return (i) ? 2 : 0;	/* and exit */
+	}
 
-		
-		if (_b_switch_i) printf("Using ID3 v.1 tags:\n\n");
-		id3_print_tags(tag);	/* print the tag to the screen */
-		free(tag);		/* free the tag */
-		return 0;		/* and exit */
+	/* the answers to the questions would be read from the list */
+	if ((_s_switch_stream) && (!strcmp(_s_switch_stream, "-")) && (!_b_switch_y)) {
+		print_error(OPT_L);
+		return 1;
+	}
+
+	/* --delete without a query would clear the whole player */
+	if ((_b_switch_delete) && (!_q_query.terms)) {
+		print_error(OPT_W);
+		return 1;
+	}
+
+	/* -R only means something to the daemon */
+	if ((_i_switch_R) && (!_b_switch_C)) {
+		print_error(OPT_R);
+		return 1;
 	}
 
-	/* no filenames for songs were given and the switched -l or -T (the only ones that 
-	 * do not allow any filename) were not set -> the user needs help */
-	if ((!_b_switch_l) && (!_b_switch_T) && (songs == 0)) {
+	/* the socket is needed by the daemon and its clients */
+	if ((_b_switch_D) || (_b_switch_C)) {
+		socket_path = (_s_switch_S) ? new_string(_s_switch_S) : daemon_socket_path();
+		if (!socket_path) {
+			print_error(OPT_S);
+			return 1;
+		}
+	}
+
+	/* someone wants a running daemon to do the job, so no player is needed here */
+	if (_b_switch_C) {
+		/* the daemon runs in a directory of its own, so it gets absolute paths */
+		for (file = list_first_element(file_list); file; file = file->next) {
+			daemon_request_add(&_r_request, "SEND",
+					   (realpath(file->filename, path)) ? path : file->filename);
+		}
+		if (_b_switch_T) daemon_request_add(&_r_request, "LIST", 0);
+
+		if ((!songs) && (!_b_switch_T) && (!_i_switch_R)) {
+			print_help_screen();
+			return 0;
+		}
+
+		i = daemon_client(socket_path, &_r_request, stdout, msg);
+		if (i < 0) fprintf(stderr, " ERROR: no daemon is running on %s\n\n", socket_path);
+		daemon_request_free(&_r_request);
+		free(socket_path);
+		if (i < 0) return 3;
+		return (i) ? 2 : 0;
+	}
+
+	/* no filenames for songs were given and the switched -l, -T or -D (the only ones
+	 * that do not allow any filename) were not set -> the user needs help */
+	if ((!_b_switch_l) && (!_b_switch_T) && (!_b_switch_D) && (!_s_switch_G) && (!_s_switch_from) &&
+	    (!_s_switch_data) && (!_b_switch_delete) && (!_s_switch_stream) && (songs == 0)) {
 		print_help_screen();
 		return 0;
 	}
 	
 	/* up to this point we needed no player connectivity but now we will discover creative
 	 * players */
-	players = player_discovery(player_array);
-	if (players < 0) {		/* error while discovering players */
+	if (zencp_discover(&z) < 0) {	/* error while discovering players */
 		print_error(PL_DISC);
 		return 3;
 	}
 		
-	if (players == 0) {		/* no player found */
-		printf(" No Creative MP3 player discovered.\n\n");
+	if (z.nplayers == 0) {		/* no player found */
+		fprintf(msg, " No Creative MP3 player discovered.\n\n");
 		return -1;
 	}
 
-	printf(" %i Creative MP3 player%s discovered.\n\n", players, (players > 1) ? "s" : "");
+	fprintf(msg, " %i Creative MP3 player%s discovered.\n\n", z.nplayers, (z.nplayers > 1) ? "s" : "");
 
-	/* the user just wants to see a list of connected players */
+	/* the user just wants to see a list of connected players, they are all asked at
+	 * once and printed in the order of the player array */
 	if (_b_switch_l) {
-		for (i = 0; i < players; i++) {		/* go through the player array */
-			player = player_lock(player_array, i);	/* lock the player */
-			if (!player) {			/* lock impossible? -> ERROR */
-				print_error(PL_COMM);
-				/*TODO: player_print_errors(stderr)*/;
-				return 3;
+		zencp_survey(&z, SM_LIST, 0, results);
+		for (i = 0, k = 0; i < z.nplayers; i++) {
+			if (results[i].state == SS_DONE) {
+				if (results[i].text) fputs(results[i].text, stdout);	/* print player info */
+			} else {
+				/* lock impossible or no answer? -> ERROR */
+				printf("   %2d\t --- %s (USB: %s)\n\n", i,
+					(results[i].state == SS_TIMEOUT) ? "no answer" : "cannot be captured",
+					(results[i].id.path[0]) ? results[i].id.path : "unknown");
+				k++;
 			}
-			player_list_device(player, i);	/* print player info to screen */
-			player_release(&player);	/* release the player */
+			free(results[i].text);
 		}
-		return 0;				/* and exit */
+		zencp_free(&z);
+		return (k) ? 3 : 0;			/* and exit */
 	}
 
-	
-	/* the user wants to use a specified device */
-	if (_s_switch_d) {
-		/* convert the argument containing the ID string into an integer */
-		id = (unsigned int)strtol(_s_switch_d, 0, 10);
-
-		printf(" Using player with ID %d.\n\n", id);
-
-		/* Selecting a certain player works by looping through the array that
-		 * contains pointers to the players, locking each player, comparing its ID
-		 * to the requested ID and, if the IDs are not equal, releasing the
-		 * player again. If the IDs are equal, the loop is exited and the player
-		 * stays captured. */
-
-		/* go through the array of players ... */
-		for (i = 0; i < players; i++) {
-			player = player_lock(player_array, i);	/* lock each player */
-			if (!player) {
-				print_error(PL_COMM);
-				return 3;
-			}
 
-			/* and compare the ID, if it is equal to the requested one, exit the
-			 * loop and the requested player will be in the variable player */
-			if (id == player_get_deviceid(player)) {
-				break;
+	/* the files are spread over all players, they are captured by zencp_shard()
+	 * and the manifest goes to stdout */
+	if (_b_switch_M) {
+		if (_b_switch_i) fprintf(msg, " Using ID3 v.1 tags.\n\n");
+		fprintf(msg, " Spreading the files over all players.\n\n");
+
+		shard_init(&shard);
+		k = zencp_shard(&z, file_list, &shard);
+		if ((!k) && (z.error == PL_COMM)) {
+			print_error(z.error);
+			shard_free(&shard);
+			zencp_free(&z);
+			return 3;
+		}
+
+		for (i = 0; i < shard.ndevices; i++) {
+			dev = &shard.devices[i];
+			fprintf(msg, "   %2d\t %s (USB: %s): ", dev->index,
+				(dev->id.serial[0]) ? dev->id.serial : "unknown serial",
+				(dev->id.path[0]) ? dev->id.path : "unknown");
+			if (!dev->key[0]) {
+				fprintf(msg, "cannot be captured\n");
+				continue;
 			}
+			fprintf(msg, "%u track%s sent (%llu MB in %.1f s, %.2f MB/s), %u taken from others\n",
+				dev->stats.tracks, (dev->stats.tracks != 1) ? "s" : "",
+				dev->stats.bytes / (1024 * 1024), dev->stats.seconds,
+				stats_rate(&dev->stats) / (1024.0 * 1024.0), dev->stolen);
+		}
+		fprintf(msg, "\n %u track%s sent (%llu MB in %.1f s, %.2f MB/s), %u skipped, %u failed\n\n",
+			z.stats.tracks, (z.stats.tracks != 1) ? "s" : "", z.stats.bytes / (1024 * 1024),
+			z.stats.seconds, stats_rate(&z.stats) / (1024.0 * 1024.0), z.stats.skipped,
+			z.stats.failed);
 
-			player_release(&player);	/* release any player that does
-							   not have the requested ID */
+		if (!shard_write(&shard, _q_query.format, stdout)) {
+			fprintf(stderr, " ERROR: the manifest could not be written\n\n");
+			k = -1;
 		}
-		
-		/* the previous loop was exited without leaving a player object
-		 * behing, thus no player with that ID exists */
-		if (!player) {
-			print_error(PL_NOID);
+		shard_free(&shard);
+		zencp_free(&z);
+		_z_context = 0;
+		return (k < 0) ? 4 : ((k) ? 0 : 2);
+	}
+
+	/* the source of a copy is captured first, so that the destination is another
+	 * player even if none is given */
+	if (_s_switch_from) {
+		fprintf(msg, " Copying from player %s:\n\n", _s_switch_from);
+		if (!zencp_open_source(&z, _s_switch_from)) {
+			print_error(z.error);
+			zencp_free(&z);
 			return 3;
 		}
-	} else {
-		/* the else part of _b_switch_d, the user does not want to have a specific
-		 * player so we will use the first one in the array */
-		player = player_lock(player_array, 0);
+		player_list_device(msg, z.source, 0);
 	}
-	
-	if (!player) {
-		print_error(PL_COMM);
+
+	/* the user wants to use a specified device (by its serial number or USB path),
+	 * otherwise the first one in the array is used */
+	if (_s_switch_d) fprintf(msg, " Using player %s.\n\n", _s_switch_d);
+	if (!zencp_open(&z, _s_switch_d)) {
+		print_error(z.error);
+		zencp_free(&z);		/* releases the source of a copy */
 		return 3;
 	}
 		
-	printf(" Using the following device:\n\n");
-	player_list_device(player, 0);
+	fprintf(msg, " Using the following device:\n\n");
+	player_list_device(msg, z.player, 0);
 
-	printf("Retrieving player tracklist...");
-	playersongs = player_get_tracklist(player, player_tracklist);
-	printf("\rRetrieved player tracklist: %d songs on the player\n", playersongs);
-	printf("\n");
+	fprintf(msg, "Retrieving player tracklist...");
+	fflush(msg);
+	playersongs = zencp_load(&z);
+	fprintf(msg, "\rRetrieved player tracklist: %d songs on the player\n", playersongs);
+	fprintf(msg, "\n");
 
-	/* the user just wants to see which tracks are stored on the device */
-	if (_b_switch_T) {
-		printf("The following tracks are stored on the player:\n");
-		tracklist_dump(player_tracklist);
-		player_release(&player);
-		return 0;	/* only track listing, so release the player and exit at this
-				   point */
+	/* from now on, the daemon does the jobs of its clients */
+	if (_b_switch_D) {
+		i = daemon_serve(socket_path, &z);
+		zencp_free(&z);
+		free(socket_path);
+		return (i) ? 0 : 3;
 	}
-	
-	/* ok, we've come this far, so the user wants to transfer a file to the player */
-	if (_b_switch_i) printf("Using ID3 v.1 tags:\n\n");
 
-	/* iterate over the list of filenames */
-	while (file_list) {
-		/* get an s_id3_tag object from the current filename */
-		if (!(tag = id3_get_id3_struct(file_list->filename, _b_switch_i))) {
-			print_error(ID3_RETR);
-			/*TODO: insert a strtoerr into here after you got the dev manpages */
-			printf(" Skipping %s\n", file_list->filename);
-			file_list = list_remove(file_list);
-			continue;
+	/* the user wants the tracks selected by -w (in the order of -s) copied from
+	 * another player to this one */
+	if (_s_switch_from) {
+		fprintf(msg, "Retrieving source tracklist...");
+		fflush(msg);
+		k = zencp_load_source(&z);
+		fprintf(msg, "\rRetrieved source tracklist: %d songs on the player\n\n", k);
+
+		if (!(tracks = query_run(&_q_query, &z.source_tracklist, &listed))) {
+			fprintf(stderr, " ERROR: the tracks could not be selected\n\n");
+			return 4;
 		}
 
-		
-		/* _b_switch_y controls wether we use user interaction */
-		if (!_b_switch_y) {
-			/* it was not set, so for every song we ask the user if he really wants
-			 * to transfer it */
-
-			/* look wether the track is already on the player */
-			track_tag = tracklist_find_tag(player_tracklist, tag);
-
-			/* if track_tag is non-NULL, the track is on the player and we
-			 * skip this track if the -f (force) switch is not set */
-			if ((track_tag) && (!_b_switch_f)) {
-				printf(" %s - %s already exists, skipping.\n\n", tag->artist, tag->title);
-				file_list = list_remove(file_list);	
-				/* remove the current filename from the list and advance to
-				 * the next one */
-				continue;
-			}
-			
-			/* tell the user which track he is transferring */
-			id3_print_tags(tag);
-
-			/* the track_tag is non-NULL, i.e. the track is on the player but
-			 * -f was set, so the track will be overwritten */
-			if ((track_tag) && (_b_switch_f)) {
-				printf("%s - %s already exists,\n", tag->artist, tag->title);
-				printf("and will be overwritten!\n\n");
-			}
-		
-			/* TODO: this must be done in a better way !!!!!!!!! */
+		fprintf(msg, " Copying %u of %d tracks.\n\n", listed, k);
+		i = zencp_copy(&z, tracks, listed);
 
-			printf("Really send this file ([Y]es/[n]o/[Q]uit)? ");
-			do {
-				yesno = fgetc(stdin);
-			} while ((yesno != EOF) && (strchr("YyNnQ", yesno) == 0));
-			
-			if ((yesno == 'Y') || (yesno == 'y')) {
-				/* if the track is on the player and -f is set, we have to
-				 * delete the track first */
-				if ((_b_switch_f) && (track_tag)) {
-					player_delete_track(player, track_tag);
-					track_tag = 0;
-				}
-				printf(" Sending %s - %s\n", tag->artist, tag->title);
-				/* send the data */
-				tag->trackid = player_send_file(player, tag);
-				/* insert the new track in the player track list so that it
-				 * cannot be sent twice in a row */
-				tracklist_insert(player_tracklist, tag);
-				printf("   Successfully sent %s - %s\n", tag->artist, tag->title);
-			}
+		/* all player communication done, release both players */
+		zencp_release(&z);
+		stats_print(&z.stats, "copied");
+		free(tracks);
+		query_free(&_q_query);
+		zencp_free(&z);
+		_z_context = 0;
+		return (i) ? 0 : 2;
+	}
 
-			if (yesno == 'Q') {
-				print_error(G_ABRT);
-				break;
-			}
+	/* the user wants a directory tree in the data area of the player */
+	if (_s_switch_data) {
+		fprintf(msg, " Copying %s to the data area of the player.\n\n", _s_switch_data);
+		i = zencp_send_data(&z, _s_switch_data);
 
-		} else {
-		/* _b_switch_y was set, so we do not interact with the user but just transfer
-		 * any non-existent track to the player */
+		/* all player communication done, release the player */
+		zencp_release(&z);
+		stats_print(&z.stats, "sent");
+		zencp_free(&z);
+		_z_context = 0;
+		return (i) ? 0 : 2;
+	}
 
-			/* check if the track is already on the player and skip if so */
-			if ((tracklist_find_tag(player_tracklist, tag))) {
-				printf(" %s - %s already exists, skipping.\n\n", tag->artist, tag->title);
-				file_list = list_remove(file_list);
-				continue;
-			}
-			printf(" Sending %s - %s\n", tag->artist, tag->title);
-			tag->trackid = player_send_file(player, tag);
-			tracklist_insert(player_tracklist, tag);
-			printf("   Successfully sent %s - %s\n", tag->artist, tag->title);
-		}			
-		printf("\n");
-
-		/* all transfer was fine (or not), but we do not need the s_id3_tag for the
-		 * current song any more, so we free it */
-		free(tag);
-		/* current song is remove from the filename list and the list-pointer is
-		 * advanced to the next entry */
-		file_list = list_remove(file_list);
+	/* the user wants the tracks selected by -w (in the order of -s) off the player */
+	if (_b_switch_delete) {
+		if ((!(tracks = query_run(&_q_query, &z.tracklist, &listed))) ||
+		    (!query_write(&_q_query, tracks, listed, stdout))) {
+			fprintf(stderr, " ERROR: the tracks could not be selected\n\n");
+			return 4;
+		}
+
+		for (k = 0, bytes = 0; k < (int)listed; k++) bytes += tracks[k]->size;
+		fprintf(msg, "\n Deleting %u of %d tracks, %llu MB are freed.\n\n", listed, playersongs,
+			bytes / (1024 * 1024));
+
+		i = ((listed) && ((_b_switch_y) || (cli_confirm("Really delete these tracks")))) ?
+			zencp_delete_tracks(&z, tracks, listed) : 1;
+
+		/* all player communication done, release the player */
+		zencp_release(&z);
+		fprintf(msg, "\n");
+		stats_print(&z.stats, "deleted");
+		free(tracks);
+		query_free(&_q_query);
+		zencp_free(&z);
+		_z_context = 0;
+		return (i) ? 0 : 2;
+	}
+
+	/* the user wants the tracks selected by -w (in the order of -s) on the local disk */
+	if (_s_switch_G) {
+		if (!(tracks = query_run(&_q_query, &z.tracklist, &listed))) {
+			fprintf(stderr, " ERROR: the tracks could not be selected\n\n");
+			return 4;
+		}
+
+		fprintf(msg, " Fetching %u of %d tracks to %s.\n\n", listed, playersongs, _s_switch_G);
+		i = zencp_download(&z, tracks, listed, _s_switch_G);
+
+		/* all player communication done, release the player */
+		zencp_release(&z);
+		stats_print(&z.stats, "received");
+		free(tracks);
+		query_free(&_q_query);
+		zencp_free(&z);
+		_z_context = 0;
+		return (i) ? 0 : 2;
+	}
+
+	/* the user just wants to see which tracks are stored on the device */
+	if (_b_switch_T) {
+		/* we do not need the player to answer the query, so release it first */
+		zencp_release(&z);
+
+		/* select and sort the tracks given by -w and -s and print them */
+		if ((!(tracks = query_run(&_q_query, &z.tracklist, &listed))) ||
+		    (!query_write(&_q_query, tracks, listed, stdout))) {
+			fprintf(stderr, " ERROR: the track list could not be written\n\n");
+			return 4;
+		}
+
+		fprintf(msg, "\n %u of %d tracks listed.\n", listed, playersongs);
+		cli_summary(msg, &z.tracklist);
+		free(tracks);
+		query_free(&_q_query);
+		zencp_free(&z);
+		return 0;	/* only track listing, so exit at this point */
 	}
 	
+	/* the user wants the files of a list sent while the list is read */
+	if (_s_switch_stream) {
+		in = (strcmp(_s_switch_stream, "-")) ? fopen(_s_switch_stream, "r") : stdin;
+		if (!in) {
+			fprintf(stderr, " ERROR: %s could not be opened\n\n", _s_switch_stream);
+			zencp_free(&z);
+			_z_context = 0;
+			return 4;
+		}
+
+		fprintf(msg, " Sending the files named in %s.\n\n", (in == stdin) ? "the standard input" : _s_switch_stream);
+		i = zencp_stream(&z, in, file_list);
+		if (in != stdin) fclose(in);
+
+		/* all player communication done, release the player */
+		zencp_release(&z);
+		stats_print(&z.stats, "sent");
+		fprintf(msg, " Peak memory use: %ld MB\n\n", (stats_peak_memory() + 1023) / 1024);
+		zencp_free(&z);
+		_z_context = 0;
+		return (i) ? 0 : 2;
+	}
+
+	/* ok, we've come this far, so the user wants to transfer a file to the player */
+	if (_b_switch_i) printf("Using ID3 v.1 tags:\n\n");
+
+	/* the files of playlists are sent, the playlists follow them */
+	file_list = zencp_add_playlists(&z, file_list);
+	zencp_transfer(&z, file_list);
+
 	/* all player communication done, release the player */
-	player_release(&player);
+	zencp_release(&z);
+	stats_print(&z.stats, "sent");
+	zencp_free(&z);
+	_z_context = 0;
 
 	return 0;
 }
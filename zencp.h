@@ -24,6 +24,13 @@
 #include "id3.h"
 #include "player.h"
 #include "tracklist.h"
+#include "schedule.h"
+#include "stats.h"
+#include "query.h"
+#include "library.h"
+#include "scan.h"
+#include "daemon.h"
+#include "libzencp.h"
 #include "misc.h"
 
 #define ZENCP_VERSION "v.0.02"